@@ -253,6 +253,12 @@ void Config::SetWindowBackend(WindowBackend backend) {
         case WindowBackend::GX2:
             SetString("Window.Backend.Name", "GX2");
             break;
+        case WindowBackend::HEADLESS:
+            SetString("Window.Backend.Name", "Headless");
+            break;
+        case WindowBackend::SOFTWARE:
+            SetString("Window.Backend.Name", "Software");
+            break;
         default:
             SetString("Window.Backend.Name", "");
     }
@@ -6,6 +6,7 @@
 #include <memory>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 
 namespace Ship {
 typedef enum class ConsoleVariableType { Integer, Float, String, Color, Color24 } ConsoleVariableType;
@@ -20,6 +21,14 @@ typedef struct CVar {
     Color_RGB8 Color24;
 } CVar;
 
+// Lets the variables be looked up by a C string without building a std::string for it, since they are read every frame
+struct ConsoleVariableNameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const {
+        return std::hash<std::string_view>()(name);
+    }
+};
+
 class ConsoleVariable {
   public:
     ConsoleVariable();
@@ -56,6 +65,6 @@ class ConsoleVariable {
     void LoadLegacy();
 
   private:
-    std::unordered_map<std::string, std::shared_ptr<CVar>> mVariables;
+    std::unordered_map<std::string, std::shared_ptr<CVar>, ConsoleVariableNameHash, std::equal_to<>> mVariables;
 };
 } // namespace Ship
@@ -114,7 +114,12 @@ static struct {
     ComPtr<ID3D11ComputeShader> compute_shader;
     ComPtr<ID3D11ComputeShader> compute_shader_msaa;
     ComPtr<ID3DBlob> compute_shader_msaa_blob;
-    size_t coord_buffer_size;
+    // Staging copies of depth_value_output_buffer for asynchronous depth reads, mapped once the GPU is done with them
+    struct {
+        ComPtr<ID3D11Buffer> buffer;
+        size_t count;
+        bool pending;
+    } depth_value_readbacks[GFX_PIXEL_DEPTH_SLOTS];
 
 #if DEBUG_D3D
     ComPtr<ID3D11Debug> debug;
@@ -1103,63 +1108,64 @@ FilteringMode gfx_d3d11_get_texture_filter(void) {
     return d3d.current_filter_mode;
 }
 
-std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-gfx_d3d11_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& coordinates) {
+// The depth query buffers are sized for the largest batch once, so they never need to be recreated
+static void gfx_d3d11_create_pixel_depth_buffers(void) {
+    D3D11_BUFFER_DESC coord_buf_desc;
+    coord_buf_desc.Usage = D3D11_USAGE_DYNAMIC;
+    coord_buf_desc.ByteWidth = sizeof(Coord) * GFX_PIXEL_DEPTH_MAX_COORDS;
+    coord_buf_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    coord_buf_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    coord_buf_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    coord_buf_desc.StructureByteStride = sizeof(Coord);
+
+    ThrowIfFailed(d3d.device->CreateBuffer(&coord_buf_desc, nullptr, d3d.coord_buffer.GetAddressOf()));
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC coord_buf_srv_desc;
+    coord_buf_srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+    coord_buf_srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    coord_buf_srv_desc.Buffer.FirstElement = 0;
+    coord_buf_srv_desc.Buffer.NumElements = GFX_PIXEL_DEPTH_MAX_COORDS;
+
+    ThrowIfFailed(d3d.device->CreateShaderResourceView(d3d.coord_buffer.Get(), &coord_buf_srv_desc,
+                                                       d3d.coord_buffer_srv.GetAddressOf()));
+
+    D3D11_BUFFER_DESC output_buffer_desc;
+    output_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+    output_buffer_desc.ByteWidth = sizeof(float) * GFX_PIXEL_DEPTH_MAX_COORDS;
+    output_buffer_desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+    output_buffer_desc.CPUAccessFlags = 0;
+    output_buffer_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    output_buffer_desc.StructureByteStride = sizeof(float);
+    ThrowIfFailed(
+        d3d.device->CreateBuffer(&output_buffer_desc, nullptr, d3d.depth_value_output_buffer.GetAddressOf()));
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC output_buffer_uav_desc;
+    output_buffer_uav_desc.Format = DXGI_FORMAT_UNKNOWN;
+    output_buffer_uav_desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+    output_buffer_uav_desc.Buffer.FirstElement = 0;
+    output_buffer_uav_desc.Buffer.NumElements = GFX_PIXEL_DEPTH_MAX_COORDS;
+    output_buffer_uav_desc.Buffer.Flags = 0;
+    ThrowIfFailed(d3d.device->CreateUnorderedAccessView(
+        d3d.depth_value_output_buffer.Get(), &output_buffer_uav_desc, d3d.depth_value_output_uav.GetAddressOf()));
+
+    output_buffer_desc.Usage = D3D11_USAGE_STAGING;
+    output_buffer_desc.BindFlags = 0;
+    output_buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    ThrowIfFailed(
+        d3d.device->CreateBuffer(&output_buffer_desc, nullptr, d3d.depth_value_output_buffer_copy.GetAddressOf()));
+    for (auto& readback : d3d.depth_value_readbacks) {
+        ThrowIfFailed(d3d.device->CreateBuffer(&output_buffer_desc, nullptr, readback.buffer.GetAddressOf()));
+    }
+}
+
+// Runs the depth compute shader over coordinates and queues a copy of the results to the staging buffer
+static void gfx_d3d11_dispatch_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count,
+                                           const ComPtr<ID3D11Buffer>& staging_buffer) {
     Framebuffer& fb = d3d.framebuffers[fb_id];
     TextureData& td = d3d.textures[fb.texture_id];
 
-    if (coordinates.size() > d3d.coord_buffer_size) {
-        d3d.coord_buffer.Reset();
-        d3d.coord_buffer_srv.Reset();
-        d3d.depth_value_output_buffer.Reset();
-        d3d.depth_value_output_uav.Reset();
-        d3d.depth_value_output_buffer_copy.Reset();
-
-        D3D11_BUFFER_DESC coord_buf_desc;
-        coord_buf_desc.Usage = D3D11_USAGE_DYNAMIC;
-        coord_buf_desc.ByteWidth = sizeof(Coord) * coordinates.size();
-        coord_buf_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        coord_buf_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        coord_buf_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-        coord_buf_desc.StructureByteStride = sizeof(Coord);
-
-        ThrowIfFailed(d3d.device->CreateBuffer(&coord_buf_desc, nullptr, d3d.coord_buffer.GetAddressOf()));
-
-        D3D11_SHADER_RESOURCE_VIEW_DESC coord_buf_srv_desc;
-        coord_buf_srv_desc.Format = DXGI_FORMAT_UNKNOWN;
-        coord_buf_srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-        coord_buf_srv_desc.Buffer.FirstElement = 0;
-        coord_buf_srv_desc.Buffer.NumElements = coordinates.size();
-
-        ThrowIfFailed(d3d.device->CreateShaderResourceView(d3d.coord_buffer.Get(), &coord_buf_srv_desc,
-                                                           d3d.coord_buffer_srv.GetAddressOf()));
-
-        D3D11_BUFFER_DESC output_buffer_desc;
-        output_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-        output_buffer_desc.ByteWidth = sizeof(float) * coordinates.size();
-        output_buffer_desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
-        output_buffer_desc.CPUAccessFlags = 0;
-        output_buffer_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-        output_buffer_desc.StructureByteStride = sizeof(float);
-        ThrowIfFailed(
-            d3d.device->CreateBuffer(&output_buffer_desc, nullptr, d3d.depth_value_output_buffer.GetAddressOf()));
-
-        D3D11_UNORDERED_ACCESS_VIEW_DESC output_buffer_uav_desc;
-        output_buffer_uav_desc.Format = DXGI_FORMAT_UNKNOWN;
-        output_buffer_uav_desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
-        output_buffer_uav_desc.Buffer.FirstElement = 0;
-        output_buffer_uav_desc.Buffer.NumElements = coordinates.size();
-        output_buffer_uav_desc.Buffer.Flags = 0;
-        ThrowIfFailed(d3d.device->CreateUnorderedAccessView(
-            d3d.depth_value_output_buffer.Get(), &output_buffer_uav_desc, d3d.depth_value_output_uav.GetAddressOf()));
-
-        output_buffer_desc.Usage = D3D11_USAGE_STAGING;
-        output_buffer_desc.BindFlags = 0;
-        output_buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-        ThrowIfFailed(
-            d3d.device->CreateBuffer(&output_buffer_desc, nullptr, d3d.depth_value_output_buffer_copy.GetAddressOf()));
-
-        d3d.coord_buffer_size = coordinates.size();
+    if (d3d.coord_buffer.Get() == nullptr) {
+        gfx_d3d11_create_pixel_depth_buffers();
     }
 
     D3D11_MAPPED_SUBRESOURCE ms;
@@ -1176,15 +1182,11 @@ gfx_d3d11_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& co
 
     ThrowIfFailed(d3d.context->Map(d3d.coord_buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms));
     Coord* coord_cb = (Coord*)ms.pData;
-    {
-        size_t i = 0;
-        for (const auto& coord : coordinates) {
-            coord_cb[i].x = coord.first;
-            // We invert y because the gfx_pc assumes OpenGL coordinates (bottom-left corner is origin), while DX's
-            // origin is top-left corner
-            coord_cb[i].y = td.height - 1 - coord.second;
-            ++i;
-        }
+    for (size_t i = 0; i < count; i++) {
+        coord_cb[i].x = coordinates[i].x;
+        // We invert y because the gfx_pc assumes OpenGL coordinates (bottom-left corner is origin), while DX's
+        // origin is top-left corner
+        coord_cb[i].y = td.height - 1 - coordinates[i].y;
     }
     d3d.context->Unmap(d3d.coord_buffer.Get(), 0);
 
@@ -1195,23 +1197,49 @@ gfx_d3d11_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& co
     ID3D11ShaderResourceView* srvs[] = { fb.depth_stencil_srv.Get(), d3d.coord_buffer_srv.Get() };
     d3d.context->CSSetShaderResources(0, 2, srvs);
 
-    d3d.context->Dispatch(coordinates.size(), 1, 1);
+    d3d.context->Dispatch(count, 1, 1);
 
-    d3d.context->CopyResource(d3d.depth_value_output_buffer_copy.Get(), d3d.depth_value_output_buffer.Get());
-    ThrowIfFailed(d3d.context->Map(d3d.depth_value_output_buffer_copy.Get(), 0, D3D11_MAP_READ, 0, &ms));
-    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res;
-    {
-        size_t i = 0;
-        for (const auto& coord : coordinates) {
-            res.emplace(coord, ((float*)ms.pData)[i++] * 65532.0f);
-        }
-    }
-    d3d.context->Unmap(d3d.depth_value_output_buffer_copy.Get(), 0);
+    D3D11_BOX box = { 0, 0, 0, (UINT)(sizeof(float) * count), 1, 1 };
+    d3d.context->CopySubresourceRegion(staging_buffer.Get(), 0, 0, 0, 0, d3d.depth_value_output_buffer.Get(), 0, &box);
 
     ID3D11ShaderResourceView* null_arr[2] = { nullptr, nullptr };
     d3d.context->CSSetShaderResources(0, 2, null_arr);
+}
 
-    return res;
+// Returns false without reading anything if the GPU has not finished with the staging buffer and wait is not set
+static bool gfx_d3d11_read_pixel_depth(ID3D11Buffer* staging_buffer, size_t count, uint16_t* depths, bool wait) {
+    D3D11_MAPPED_SUBRESOURCE ms;
+    HRESULT hr = d3d.context->Map(staging_buffer, 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &ms);
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING) {
+        return false;
+    }
+    ThrowIfFailed(hr);
+    for (size_t i = 0; i < count; i++) {
+        depths[i] = ((float*)ms.pData)[i] * 65532.0f;
+    }
+    d3d.context->Unmap(staging_buffer, 0);
+    return true;
+}
+
+void gfx_d3d11_get_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count, uint16_t* depths) {
+    gfx_d3d11_dispatch_pixel_depth(fb_id, coordinates, count, d3d.depth_value_output_buffer_copy);
+    gfx_d3d11_read_pixel_depth(d3d.depth_value_output_buffer_copy.Get(), count, depths, true);
+}
+
+void gfx_d3d11_request_pixel_depth(int slot, int fb_id, const GfxPixelCoord* coordinates, size_t count) {
+    auto& readback = d3d.depth_value_readbacks[slot];
+    gfx_d3d11_dispatch_pixel_depth(fb_id, coordinates, count, readback.buffer);
+    readback.count = count;
+    readback.pending = true;
+}
+
+bool gfx_d3d11_poll_pixel_depth(int slot, uint16_t* depths, bool wait) {
+    auto& readback = d3d.depth_value_readbacks[slot];
+    if (!readback.pending || !gfx_d3d11_read_pixel_depth(readback.buffer.Get(), readback.count, depths, wait)) {
+        return false;
+    }
+    readback.pending = false;
+    return true;
 }
 
 } // namespace
@@ -1238,6 +1266,7 @@ struct GfxRenderingAPI gfx_direct3d11_api = { gfx_d3d11_get_name,
                                               gfx_d3d11_set_scissor,
                                               gfx_d3d11_set_use_alpha,
                                               gfx_d3d11_draw_triangles,
+                                              nullptr,
                                               gfx_d3d11_init,
                                               gfx_d3d11_on_resize,
                                               gfx_d3d11_start_frame,
@@ -1251,6 +1280,8 @@ struct GfxRenderingAPI gfx_direct3d11_api = { gfx_d3d11_get_name,
                                               gfx_d3d11_read_framebuffer_to_cpu,
                                               gfx_d3d11_resolve_msaa_color_buffer,
                                               gfx_d3d11_get_pixel_depth,
+                                              gfx_d3d11_request_pixel_depth,
+                                              gfx_d3d11_poll_pixel_depth,
                                               gfx_d3d11_get_framebuffer_texture_id,
                                               gfx_d3d11_select_texture_fb,
                                               gfx_d3d11_delete_texture,
@@ -0,0 +1,507 @@
+#include "gfx_frame_recorder.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gfx_cc.h"
+#include "gfx_pc.h"
+
+// Texture bindings are keyed by texture id, framebuffer textures get their own key space
+#define TEXTURE_KEY_NONE UINT64_MAX
+#define TEXTURE_KEY_FRAMEBUFFER (1ULL << 32)
+
+// Texture and framebuffer ids from here up share one referenced flag
+#define MAX_FLAGGED_TEXTURE_ID 65536
+
+#define MAX_MERGED_VERTICES 65536
+// Same as the buf_vbo size in gfx_pc. Backends size their vertex buffers for it, so merged draws must not exceed it.
+#define MAX_MERGED_VBO_LEN (MAX_BUFFERED * 32 * 3)
+
+struct RecordedState {
+    struct ShaderProgram* shader;
+    uint64_t textures[SHADER_MAX_TEXTURES];
+    int8_t depth_test_and_mask; // -1 while unknown, otherwise 1: depth test, 2: depth mask
+    int8_t zmode_decal;         // -1 while unknown
+    int8_t use_alpha;           // -1 while unknown
+    bool has_viewport, has_scissor;
+    int viewport[4];
+    int scissor[4];
+
+    bool operator==(const RecordedState&) const noexcept = default;
+};
+
+struct RecordedDraw {
+    RecordedState state;
+    size_t vbo_offset, vbo_len;
+    size_t num_tris;
+    size_t ibo_offset, ibo_len; // ibo_len is 0 for non indexed draws
+    uint32_t num_verts;         // Indexed draws only, highest index + 1
+    uint32_t stride;            // Indexed draws only, 0 if the draw can't be merged
+};
+
+static struct GfxRenderingAPI* backend;
+static struct GfxRenderingAPI recorder_api;
+
+static RecordedState current;
+static RecordedState applied;
+static int current_tile;
+
+static std::vector<RecordedDraw> draws;
+static std::vector<float> vbo_arena;
+static std::vector<uint16_t> ibo_arena;
+static std::vector<float> merged_vbo;
+static std::vector<uint16_t> merged_ibo;
+// Whether a pending draw samples from a texture, one flag per texture id and one per framebuffer id. Backends hand
+// out small consecutive ids, so the flags stay small and stop allocating once they have grown to fit.
+static std::vector<uint8_t> referenced_texture_flags;
+static std::vector<uint8_t> referenced_fb_flags;
+// The keys flagged since the last flush, to clear their flags again
+static std::vector<uint64_t> referenced_textures;
+
+static GfxFrameRecorderStats stats;
+
+static void reset_state(RecordedState& state) {
+    state = {};
+    std::fill(std::begin(state.textures), std::end(state.textures), TEXTURE_KEY_NONE);
+    state.depth_test_and_mask = -1;
+    state.zmode_decal = -1;
+    state.use_alpha = -1;
+}
+
+static void apply_texture(int tile, uint64_t key) {
+    if (key == TEXTURE_KEY_NONE || key == applied.textures[tile]) {
+        return;
+    }
+    if (key & TEXTURE_KEY_FRAMEBUFFER) {
+        backend->select_texture_fb((int)(uint32_t)key);
+    } else {
+        backend->select_texture(tile, (uint32_t)key);
+    }
+    applied.textures[tile] = key;
+}
+
+// Only issues what differs from the state last sent to the backend. Unknown fields are left alone since the backend
+// still holds whatever was set before recording started.
+static void apply_state(const RecordedState& state) {
+    if (state.shader != nullptr && state.shader != applied.shader) {
+        backend->unload_shader(applied.shader);
+        backend->load_shader(state.shader);
+        applied.shader = state.shader;
+    }
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        apply_texture(i, state.textures[i]);
+    }
+    if (state.depth_test_and_mask != -1 && state.depth_test_and_mask != applied.depth_test_and_mask) {
+        backend->set_depth_test_and_mask(state.depth_test_and_mask & 1, state.depth_test_and_mask & 2);
+        applied.depth_test_and_mask = state.depth_test_and_mask;
+    }
+    if (state.zmode_decal != -1 && state.zmode_decal != applied.zmode_decal) {
+        backend->set_zmode_decal(state.zmode_decal);
+        applied.zmode_decal = state.zmode_decal;
+    }
+    if (state.use_alpha != -1 && state.use_alpha != applied.use_alpha) {
+        backend->set_use_alpha(state.use_alpha);
+        applied.use_alpha = state.use_alpha;
+    }
+    if (state.has_viewport &&
+        (!applied.has_viewport || !std::equal(state.viewport, state.viewport + 4, applied.viewport))) {
+        backend->set_viewport(state.viewport[0], state.viewport[1], state.viewport[2], state.viewport[3]);
+        applied.has_viewport = true;
+        std::copy(state.viewport, state.viewport + 4, applied.viewport);
+    }
+    if (state.has_scissor && (!applied.has_scissor || !std::equal(state.scissor, state.scissor + 4, applied.scissor))) {
+        backend->set_scissor(state.scissor[0], state.scissor[1], state.scissor[2], state.scissor[3]);
+        applied.has_scissor = true;
+        std::copy(state.scissor, state.scissor + 4, applied.scissor);
+    }
+}
+
+static uint8_t& referenced_flag(uint64_t key) {
+    std::vector<uint8_t>& flags = (key & TEXTURE_KEY_FRAMEBUFFER) ? referenced_fb_flags : referenced_texture_flags;
+    const uint32_t id = std::min<uint32_t>((uint32_t)key, MAX_FLAGGED_TEXTURE_ID);
+    if (id >= flags.size()) {
+        flags.resize(id + 1, 0);
+    }
+    return flags[id];
+}
+
+// Opaque draws that test and write depth give the same result in any order, barring coplanar overlaps
+static bool is_sortable(const RecordedDraw& draw) {
+    return draw.state.depth_test_and_mask == 3 && draw.state.zmode_decal == 0 && draw.state.use_alpha == 0;
+}
+
+static bool sort_order(const RecordedDraw& a, const RecordedDraw& b) {
+    if (a.state.shader != b.state.shader) {
+        return a.state.shader < b.state.shader;
+    }
+    return std::lexicographical_compare(a.state.textures, a.state.textures + SHADER_MAX_TEXTURES, b.state.textures,
+                                        b.state.textures + SHADER_MAX_TEXTURES);
+}
+
+static bool can_merge(const RecordedDraw& first, const RecordedDraw& next, uint32_t merged_verts,
+                      size_t merged_vbo_len) {
+    if (!(next.state == first.state) || (next.ibo_len > 0) != (first.ibo_len > 0)) {
+        return false;
+    }
+    if (merged_vbo_len + next.vbo_len > MAX_MERGED_VBO_LEN) {
+        return false;
+    }
+    if (first.ibo_len == 0) {
+        return true;
+    }
+    return first.stride != 0 && next.stride == first.stride && merged_verts + next.num_verts <= MAX_MERGED_VERTICES;
+}
+
+static void submit_group(size_t begin, size_t end) {
+    const RecordedDraw& first = draws[begin];
+    stats.draws_submitted++;
+
+    if (end - begin == 1) {
+        if (first.ibo_len > 0) {
+            backend->draw_triangles_indexed(&vbo_arena[first.vbo_offset], first.vbo_len, &ibo_arena[first.ibo_offset],
+                                            first.ibo_len);
+        } else {
+            backend->draw_triangles(&vbo_arena[first.vbo_offset], first.vbo_len, first.num_tris);
+        }
+        return;
+    }
+
+    merged_vbo.clear();
+    merged_ibo.clear();
+    size_t num_tris = 0;
+    uint32_t base_vertex = 0;
+    for (size_t i = begin; i < end; i++) {
+        const RecordedDraw& draw = draws[i];
+        merged_vbo.insert(merged_vbo.end(), vbo_arena.begin() + draw.vbo_offset,
+                          vbo_arena.begin() + draw.vbo_offset + draw.vbo_len);
+        num_tris += draw.num_tris;
+        for (size_t j = 0; j < draw.ibo_len; j++) {
+            merged_ibo.push_back((uint16_t)(ibo_arena[draw.ibo_offset + j] + base_vertex));
+        }
+        base_vertex += draw.num_verts;
+    }
+    if (first.ibo_len > 0) {
+        backend->draw_triangles_indexed(merged_vbo.data(), merged_vbo.size(), merged_ibo.data(), merged_ibo.size());
+    } else {
+        backend->draw_triangles(merged_vbo.data(), merged_vbo.size(), num_tris);
+    }
+}
+
+void gfx_frame_recorder_flush(void) {
+    if (!draws.empty()) {
+        for (size_t begin = 0; begin < draws.size();) {
+            size_t end = begin;
+            while (end < draws.size() && is_sortable(draws[end])) {
+                end++;
+            }
+            if (end - begin > 1) {
+                std::stable_sort(draws.begin() + begin, draws.begin() + end, sort_order);
+            }
+            begin = end + 1;
+        }
+
+        for (size_t begin = 0; begin < draws.size();) {
+            size_t end = begin + 1;
+            uint32_t merged_verts = draws[begin].num_verts;
+            size_t merged_vbo_len = draws[begin].vbo_len;
+            while (end < draws.size() && can_merge(draws[begin], draws[end], merged_verts, merged_vbo_len)) {
+                merged_verts += draws[end].num_verts;
+                merged_vbo_len += draws[end].vbo_len;
+                end++;
+            }
+            apply_state(draws[begin].state);
+            submit_group(begin, end);
+            begin = end;
+        }
+
+        draws.clear();
+        vbo_arena.clear();
+        ibo_arena.clear();
+        for (uint64_t key : referenced_textures) {
+            referenced_flag(key) = 0;
+        }
+        referenced_textures.clear();
+    }
+    apply_state(current);
+}
+
+// Texture ids of the backend may be reused after deletion and texture contents and sampler parameters are stored
+// with the texture, so changing a texture that a pending draw samples from has to flush first
+static void flush_if_referenced(uint64_t key) {
+    if (key != TEXTURE_KEY_NONE && referenced_flag(key) != 0) {
+        gfx_frame_recorder_flush();
+    }
+}
+
+// Backend calls outside the recorder's control may rebind textures, so don't trust the cached bindings after them
+static void invalidate_applied_textures(void) {
+    std::fill(std::begin(applied.textures), std::end(applied.textures), TEXTURE_KEY_NONE);
+}
+
+static void record_draw(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris, const uint16_t buf_ibo[],
+                        size_t buf_ibo_len) {
+    RecordedDraw draw = {};
+    draw.state = current;
+    draw.vbo_offset = vbo_arena.size();
+    draw.vbo_len = buf_vbo_len;
+    draw.num_tris = buf_vbo_num_tris;
+    draw.ibo_offset = ibo_arena.size();
+    draw.ibo_len = buf_ibo_len;
+    if (buf_ibo_len > 0) {
+        draw.num_verts = (uint32_t)*std::max_element(buf_ibo, buf_ibo + buf_ibo_len) + 1;
+        draw.stride = buf_vbo_len % draw.num_verts == 0 ? (uint32_t)(buf_vbo_len / draw.num_verts) : 0;
+        ibo_arena.insert(ibo_arena.end(), buf_ibo, buf_ibo + buf_ibo_len);
+    }
+    vbo_arena.insert(vbo_arena.end(), buf_vbo, buf_vbo + buf_vbo_len);
+    for (uint64_t key : current.textures) {
+        if (key != TEXTURE_KEY_NONE) {
+            uint8_t& flag = referenced_flag(key);
+            if (flag == 0) {
+                flag = 1;
+                referenced_textures.push_back(key);
+            }
+        }
+    }
+    draws.push_back(draw);
+    stats.draws_recorded++;
+}
+
+static void gfx_frame_recorder_unload_shader(struct ShaderProgram* old_prg) {
+    // The shader that ends up bound is decided at replay
+}
+
+static void gfx_frame_recorder_load_shader(struct ShaderProgram* new_prg) {
+    current.shader = new_prg;
+}
+
+static struct ShaderProgram* gfx_frame_recorder_create_and_load_new_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    backend->unload_shader(applied.shader);
+    struct ShaderProgram* prg = backend->create_and_load_new_shader(shader_id0, shader_id1);
+    applied.shader = prg;
+    current.shader = prg;
+    return prg;
+}
+
+static void gfx_frame_recorder_select_texture(int tile, uint32_t texture_id) {
+    current.textures[tile] = texture_id;
+    current_tile = tile;
+}
+
+static void gfx_frame_recorder_select_texture_fb(int fb_id) {
+    current.textures[0] = TEXTURE_KEY_FRAMEBUFFER | (uint32_t)fb_id;
+    current_tile = 0;
+}
+
+static void gfx_frame_recorder_upload_texture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
+    const uint64_t key = current.textures[current_tile];
+    flush_if_referenced(key);
+    // Always reselect, the backend uploads to the texture of the last selected tile
+    applied.textures[current_tile] = TEXTURE_KEY_NONE;
+    apply_texture(current_tile, key);
+    backend->upload_texture(rgba32_buf, width, height);
+}
+
+static void gfx_frame_recorder_set_sampler_parameters(int sampler, bool linear_filter, uint32_t cms, uint32_t cmt) {
+    const uint64_t key = current.textures[sampler];
+    flush_if_referenced(key);
+    apply_texture(sampler, key);
+    backend->set_sampler_parameters(sampler, linear_filter, cms, cmt);
+}
+
+static void gfx_frame_recorder_delete_texture(uint32_t texID) {
+    flush_if_referenced(texID);
+    backend->delete_texture(texID);
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        if (applied.textures[i] == texID) {
+            applied.textures[i] = TEXTURE_KEY_NONE;
+        }
+    }
+}
+
+static void gfx_frame_recorder_set_depth_test_and_mask(bool depth_test, bool z_upd) {
+    current.depth_test_and_mask = (depth_test ? 1 : 0) | (z_upd ? 2 : 0);
+}
+
+static void gfx_frame_recorder_set_zmode_decal(bool zmode_decal) {
+    current.zmode_decal = zmode_decal;
+}
+
+static void gfx_frame_recorder_set_viewport(int x, int y, int width, int height) {
+    current.has_viewport = true;
+    current.viewport[0] = x;
+    current.viewport[1] = y;
+    current.viewport[2] = width;
+    current.viewport[3] = height;
+}
+
+static void gfx_frame_recorder_set_scissor(int x, int y, int width, int height) {
+    current.has_scissor = true;
+    current.scissor[0] = x;
+    current.scissor[1] = y;
+    current.scissor[2] = width;
+    current.scissor[3] = height;
+}
+
+static void gfx_frame_recorder_set_use_alpha(bool use_alpha) {
+    current.use_alpha = use_alpha;
+}
+
+static void gfx_frame_recorder_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+    record_draw(buf_vbo, buf_vbo_len, buf_vbo_num_tris, nullptr, 0);
+}
+
+static void gfx_frame_recorder_draw_triangles_indexed(float buf_vbo[], size_t buf_vbo_len, const uint16_t buf_ibo[],
+                                                      size_t buf_ibo_len) {
+    record_draw(buf_vbo, buf_vbo_len, buf_ibo_len / 3, buf_ibo, buf_ibo_len);
+}
+
+// Everything below reads or changes framebuffers or global backend state, so the pending draws go first
+
+static void gfx_frame_recorder_init(void) {
+    gfx_frame_recorder_flush();
+    backend->init();
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_on_resize(void) {
+    gfx_frame_recorder_flush();
+    backend->on_resize();
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_start_frame(void) {
+    gfx_frame_recorder_flush();
+    backend->start_frame();
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_end_frame(void) {
+    gfx_frame_recorder_flush();
+    backend->end_frame();
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_finish_render(void) {
+    gfx_frame_recorder_flush();
+    backend->finish_render();
+}
+
+static int gfx_frame_recorder_create_framebuffer(void) {
+    gfx_frame_recorder_flush();
+    int fb_id = backend->create_framebuffer();
+    invalidate_applied_textures();
+    return fb_id;
+}
+
+static void gfx_frame_recorder_update_framebuffer_parameters(int fb_id, uint32_t width, uint32_t height,
+                                                             uint32_t msaa_level, bool opengl_invert_y,
+                                                             bool render_target, bool has_depth_buffer,
+                                                             bool can_extract_depth) {
+    gfx_frame_recorder_flush();
+    backend->update_framebuffer_parameters(fb_id, width, height, msaa_level, opengl_invert_y, render_target,
+                                           has_depth_buffer, can_extract_depth);
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_start_draw_to_framebuffer(int fb_id, float noise_scale) {
+    gfx_frame_recorder_flush();
+    backend->start_draw_to_framebuffer(fb_id, noise_scale);
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_copy_framebuffer(int fb_dst_id, int fb_src_id, int srcX0, int srcY0, int srcX1,
+                                                int srcY1, int dstX0, int dstY0, int dstX1, int dstY1) {
+    gfx_frame_recorder_flush();
+    backend->copy_framebuffer(fb_dst_id, fb_src_id, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1);
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_clear_framebuffer(void) {
+    gfx_frame_recorder_flush();
+    backend->clear_framebuffer();
+}
+
+static void gfx_frame_recorder_read_framebuffer_to_cpu(int fb_id, uint32_t width, uint32_t height,
+                                                       uint16_t* rgba16_buf) {
+    gfx_frame_recorder_flush();
+    backend->read_framebuffer_to_cpu(fb_id, width, height, rgba16_buf);
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_resolve_msaa_color_buffer(int fb_id_target, int fb_id_source) {
+    gfx_frame_recorder_flush();
+    backend->resolve_msaa_color_buffer(fb_id_target, fb_id_source);
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_get_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count,
+                                               uint16_t* depths) {
+    gfx_frame_recorder_flush();
+    backend->get_pixel_depth(fb_id, coordinates, count, depths);
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_request_pixel_depth(int slot, int fb_id, const GfxPixelCoord* coordinates,
+                                                   size_t count) {
+    gfx_frame_recorder_flush();
+    backend->request_pixel_depth(slot, fb_id, coordinates, count);
+    invalidate_applied_textures();
+}
+
+static void gfx_frame_recorder_set_texture_filter(FilteringMode mode) {
+    gfx_frame_recorder_flush();
+    backend->set_texture_filter(mode);
+    invalidate_applied_textures();
+}
+
+struct GfxRenderingAPI* gfx_frame_recorder_begin(struct GfxRenderingAPI* rapi) {
+    backend = rapi;
+    reset_state(current);
+    reset_state(applied);
+    current_tile = 0;
+    stats = {};
+
+    // Queries and resource creation go straight to the backend
+    recorder_api = *rapi;
+    recorder_api.unload_shader = gfx_frame_recorder_unload_shader;
+    recorder_api.load_shader = gfx_frame_recorder_load_shader;
+    recorder_api.create_and_load_new_shader = gfx_frame_recorder_create_and_load_new_shader;
+    recorder_api.select_texture = gfx_frame_recorder_select_texture;
+    recorder_api.upload_texture = gfx_frame_recorder_upload_texture;
+    recorder_api.set_sampler_parameters = gfx_frame_recorder_set_sampler_parameters;
+    recorder_api.set_depth_test_and_mask = gfx_frame_recorder_set_depth_test_and_mask;
+    recorder_api.set_zmode_decal = gfx_frame_recorder_set_zmode_decal;
+    recorder_api.set_viewport = gfx_frame_recorder_set_viewport;
+    recorder_api.set_scissor = gfx_frame_recorder_set_scissor;
+    recorder_api.set_use_alpha = gfx_frame_recorder_set_use_alpha;
+    recorder_api.draw_triangles = gfx_frame_recorder_draw_triangles;
+    recorder_api.draw_triangles_indexed =
+        rapi->draw_triangles_indexed != nullptr ? gfx_frame_recorder_draw_triangles_indexed : nullptr;
+    recorder_api.init = gfx_frame_recorder_init;
+    recorder_api.on_resize = gfx_frame_recorder_on_resize;
+    recorder_api.start_frame = gfx_frame_recorder_start_frame;
+    recorder_api.end_frame = gfx_frame_recorder_end_frame;
+    recorder_api.finish_render = gfx_frame_recorder_finish_render;
+    recorder_api.create_framebuffer = gfx_frame_recorder_create_framebuffer;
+    recorder_api.update_framebuffer_parameters = gfx_frame_recorder_update_framebuffer_parameters;
+    recorder_api.start_draw_to_framebuffer = gfx_frame_recorder_start_draw_to_framebuffer;
+    recorder_api.copy_framebuffer = gfx_frame_recorder_copy_framebuffer;
+    recorder_api.clear_framebuffer = gfx_frame_recorder_clear_framebuffer;
+    recorder_api.read_framebuffer_to_cpu = gfx_frame_recorder_read_framebuffer_to_cpu;
+    recorder_api.resolve_msaa_color_buffer = gfx_frame_recorder_resolve_msaa_color_buffer;
+    recorder_api.get_pixel_depth = gfx_frame_recorder_get_pixel_depth;
+    recorder_api.request_pixel_depth =
+        rapi->request_pixel_depth != nullptr ? gfx_frame_recorder_request_pixel_depth : nullptr;
+    recorder_api.select_texture_fb = gfx_frame_recorder_select_texture_fb;
+    recorder_api.delete_texture = gfx_frame_recorder_delete_texture;
+    recorder_api.set_texture_filter = gfx_frame_recorder_set_texture_filter;
+    return &recorder_api;
+}
+
+void gfx_frame_recorder_end(void) {
+    gfx_frame_recorder_flush();
+}
+
+const GfxFrameRecorderStats& gfx_frame_recorder_get_stats(void) {
+    return stats;
+}
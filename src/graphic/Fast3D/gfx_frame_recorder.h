@@ -0,0 +1,23 @@
+#ifndef GFX_FRAME_RECORDER_H
+#define GFX_FRAME_RECORDER_H
+
+#include <stdint.h>
+
+#include "gfx_rendering_api.h"
+
+// Number of draws Fast3D issued to the recorder and the number it actually submitted to the backend
+struct GfxFrameRecorderStats {
+    uint32_t draws_recorded;
+    uint32_t draws_submitted;
+};
+
+// Starts recording a frame for the given backend. The returned API records draws and their state instead of
+// submitting them; pending draws are state sorted, merged and replayed on flush and on every call that reads or
+// changes framebuffers. The caller must reissue its rendering state to the returned API before drawing.
+struct GfxRenderingAPI* gfx_frame_recorder_begin(struct GfxRenderingAPI* backend);
+void gfx_frame_recorder_flush(void);
+// Flushes the remaining draws, after which the backend state matches the last state set through the recorder
+void gfx_frame_recorder_end(void);
+const GfxFrameRecorderStats& gfx_frame_recorder_get_stats(void);
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef GFX_HASH_POOL_H
+#define GFX_HASH_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash table for pools that only grow, such as color combiners and compiled shaders. Values live in a
+// deque so pointers to them stay valid as the pool grows; the table itself holds only hashes and indices, probed
+// linearly. The values found most recently are compared first, since draws tend to alternate between a few of them.
+// Hasher returns a 64-bit hash of the key, which does not need to be well distributed in its low bits.
+template <typename Key, typename Value, typename Hasher> class GfxHashPool {
+  public:
+    Value* find(const Key& key) {
+        for (uint32_t i = 0; i < MRU_SIZE; i++) {
+            const uint32_t index = mru[i];
+            if (index != 0 && entries[index - 1].first == key) {
+                remember(index);
+                return &entries[index - 1].second;
+            }
+        }
+        if (slots.empty()) {
+            return nullptr;
+        }
+
+        const uint64_t hash = mix(Hasher()(key));
+        const size_t mask = slots.size() - 1;
+        for (size_t s = hash & mask;; s = (s + 1) & mask) {
+            const Slot& slot = slots[s];
+            if (slot.index == 0) {
+                return nullptr;
+            }
+            if (slot.hash == (uint32_t)hash && entries[slot.index - 1].first == key) {
+                remember(slot.index);
+                return &entries[slot.index - 1].second;
+            }
+        }
+    }
+
+    // Adds a default constructed value for a key that is not in the pool yet
+    Value* insert(const Key& key) {
+        if ((entries.size() + 1) * 2 > slots.size()) {
+            grow();
+        }
+        entries.emplace_back(key, Value());
+        const uint32_t index = (uint32_t)entries.size();
+        place(mix(Hasher()(key)), index);
+        remember(index);
+        return &entries.back().second;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    void clear() {
+        entries.clear();
+        slots.clear();
+        for (uint32_t i = 0; i < MRU_SIZE; i++) {
+            mru[i] = 0;
+        }
+    }
+
+  private:
+    static constexpr uint32_t MRU_SIZE = 4;
+
+    struct Slot {
+        uint32_t hash;  // Low bits of the mixed hash, to skip most key comparisons
+        uint32_t index; // 1 + index into entries, 0 for an empty slot
+    };
+
+    // Finalizer of MurmurHash3, spreads every input bit over the bits used to pick a slot
+    static uint64_t mix(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    void place(uint64_t hash, uint32_t index) {
+        const size_t mask = slots.size() - 1;
+        size_t s = hash & mask;
+        while (slots[s].index != 0) {
+            s = (s + 1) & mask;
+        }
+        slots[s].hash = (uint32_t)hash;
+        slots[s].index = index;
+    }
+
+    void grow() {
+        slots.assign(slots.empty() ? 64 : slots.size() * 2, Slot{ 0, 0 });
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            place(mix(Hasher()(entries[i].first)), i + 1);
+        }
+    }
+
+    // Moves index to the front of the recently found values, dropping the oldest one if it was not among them
+    void remember(uint32_t index) {
+        uint32_t i = 0;
+        while (i < MRU_SIZE - 1 && mru[i] != index) {
+            i++;
+        }
+        for (; i > 0; i--) {
+            mru[i] = mru[i - 1];
+        }
+        mru[0] = index;
+    }
+
+    std::deque<std::pair<Key, Value>> entries;
+    std::vector<Slot> slots;
+    uint32_t mru[MRU_SIZE] = {};
+};
+
+// Hasher for the (shader_id0, shader_id1) keys the rendering backends look their shader programs up by
+struct GfxShaderIdHasher {
+    uint64_t operator()(const std::pair<uint64_t, uint32_t>& ids) const {
+        return ids.first ^ (ids.second * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+#endif
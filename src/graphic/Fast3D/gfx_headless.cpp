@@ -0,0 +1,398 @@
+#include "gfx_headless.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <utility>
+
+#include "gfx_cc.h"
+#include "gfx_hash_pool.h"
+#include "gfx_screen_config.h"
+#include "window/gui/Gui.h"
+#include "Context.h"
+
+struct ShaderProgramHeadless {
+    uint64_t shader_id0;
+    uint32_t shader_id1;
+    uint8_t num_inputs;
+    bool used_textures[2];
+};
+
+static GfxHashPool<std::pair<uint64_t, uint32_t>, ShaderProgramHeadless, GfxShaderIdHasher> shader_program_pool;
+static uint32_t next_texture_id = 1;
+static int next_framebuffer_id = 1; // 0 is the window
+static uint32_t frame_count;
+static FilteringMode texture_filter = FILTER_THREE_POINT;
+
+static bool recording;
+static std::vector<GfxHeadlessCall> call_log;
+
+static uint32_t window_width = DESIRED_SCREEN_WIDTH;
+static uint32_t window_height = DESIRED_SCREEN_HEIGHT;
+static int32_t window_pos_x, window_pos_y;
+static bool is_running = true;
+
+static void record(GfxHeadlessCallType type, int32_t arg0 = 0, int32_t arg1 = 0, int32_t arg2 = 0, int32_t arg3 = 0) {
+    if (recording) {
+        call_log.push_back({ type, { arg0, arg1, arg2, arg3 } });
+    }
+}
+
+static void record_shader(GfxHeadlessCallType type, struct ShaderProgram* prg) {
+    const ShaderProgramHeadless* p = (const ShaderProgramHeadless*)prg;
+    if (p != nullptr) {
+        record(type, (int32_t)p->shader_id0, (int32_t)(p->shader_id0 >> 32), (int32_t)p->shader_id1);
+    }
+}
+
+static const char* gfx_headless_get_name(void) {
+    return "Headless";
+}
+
+static int gfx_headless_get_max_texture_size(void) {
+    return 8192;
+}
+
+static struct GfxClipParameters gfx_headless_get_clip_parameters(void) {
+    return { false, false };
+}
+
+static void gfx_headless_unload_shader(struct ShaderProgram* old_prg) {
+    record_shader(GfxHeadlessCallType::UnloadShader, old_prg);
+}
+
+static void gfx_headless_load_shader(struct ShaderProgram* new_prg) {
+    record_shader(GfxHeadlessCallType::LoadShader, new_prg);
+}
+
+static struct ShaderProgram* gfx_headless_create_and_load_new_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    struct CCFeatures cc_features;
+    gfx_cc_get_features(shader_id0, shader_id1, &cc_features);
+
+    ShaderProgramHeadless* prg = shader_program_pool.insert(std::make_pair(shader_id0, shader_id1));
+    prg->shader_id0 = shader_id0;
+    prg->shader_id1 = shader_id1;
+    prg->num_inputs = cc_features.num_inputs;
+    prg->used_textures[0] = cc_features.used_textures[0];
+    prg->used_textures[1] = cc_features.used_textures[1];
+    gfx_headless_load_shader((struct ShaderProgram*)prg);
+    return (struct ShaderProgram*)prg;
+}
+
+static struct ShaderProgram* gfx_headless_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    return (struct ShaderProgram*)shader_program_pool.find(std::make_pair(shader_id0, shader_id1));
+}
+
+static void gfx_headless_shader_get_info(struct ShaderProgram* prg, uint8_t* num_inputs, bool used_textures[2]) {
+    const ShaderProgramHeadless* p = (const ShaderProgramHeadless*)prg;
+    *num_inputs = p->num_inputs;
+    used_textures[0] = p->used_textures[0];
+    used_textures[1] = p->used_textures[1];
+}
+
+static uint32_t gfx_headless_new_texture(void) {
+    return next_texture_id++;
+}
+
+static void gfx_headless_select_texture(int tile, uint32_t texture_id) {
+    record(GfxHeadlessCallType::SelectTexture, tile, texture_id);
+}
+
+static void gfx_headless_upload_texture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
+    record(GfxHeadlessCallType::UploadTexture, width, height);
+}
+
+static void gfx_headless_set_sampler_parameters(int sampler, bool linear_filter, uint32_t cms, uint32_t cmt) {
+    record(GfxHeadlessCallType::SetSamplerParameters, sampler, linear_filter, cms, cmt);
+}
+
+static void gfx_headless_set_depth_test_and_mask(bool depth_test, bool z_upd) {
+    record(GfxHeadlessCallType::SetDepthTestAndMask, depth_test, z_upd);
+}
+
+static void gfx_headless_set_zmode_decal(bool zmode_decal) {
+    record(GfxHeadlessCallType::SetZmodeDecal, zmode_decal);
+}
+
+static void gfx_headless_set_viewport(int x, int y, int width, int height) {
+    record(GfxHeadlessCallType::SetViewport, x, y, width, height);
+}
+
+static void gfx_headless_set_scissor(int x, int y, int width, int height) {
+    record(GfxHeadlessCallType::SetScissor, x, y, width, height);
+}
+
+static void gfx_headless_set_use_alpha(bool use_alpha) {
+    record(GfxHeadlessCallType::SetUseAlpha, use_alpha);
+}
+
+static void gfx_headless_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+    const size_t num_vertices = buf_vbo_num_tris * 3;
+    record(GfxHeadlessCallType::DrawTriangles, buf_vbo_num_tris, num_vertices,
+           num_vertices > 0 ? buf_vbo_len / num_vertices : 0);
+}
+
+static void gfx_headless_draw_triangles_indexed(float buf_vbo[], size_t buf_vbo_len, const uint16_t buf_ibo[],
+                                                size_t buf_ibo_len) {
+    // The vertex buffer holds each vertex once, the largest index tells how many there are
+    uint16_t max_index = 0;
+    for (size_t i = 0; i < buf_ibo_len; i++) {
+        max_index = buf_ibo[i] > max_index ? buf_ibo[i] : max_index;
+    }
+    const size_t num_vertices = buf_ibo_len > 0 ? max_index + 1 : 0;
+    record(GfxHeadlessCallType::DrawTrianglesIndexed, buf_ibo_len / 3, num_vertices,
+           num_vertices > 0 ? buf_vbo_len / num_vertices : 0);
+}
+
+static void gfx_headless_init(void) {
+}
+
+static void gfx_headless_on_resize(void) {
+}
+
+static void gfx_headless_start_frame(void) {
+    record(GfxHeadlessCallType::StartFrame, frame_count++);
+}
+
+static void gfx_headless_end_frame(void) {
+    record(GfxHeadlessCallType::EndFrame);
+}
+
+static void gfx_headless_finish_render(void) {
+}
+
+static int gfx_headless_create_framebuffer(void) {
+    return next_framebuffer_id++;
+}
+
+static void gfx_headless_update_framebuffer_parameters(int fb_id, uint32_t width, uint32_t height,
+                                                       uint32_t msaa_level, bool opengl_invert_y, bool render_target,
+                                                       bool has_depth_buffer, bool can_extract_depth) {
+    record(GfxHeadlessCallType::UpdateFramebufferParameters, fb_id, width, height, msaa_level);
+}
+
+static void gfx_headless_start_draw_to_framebuffer(int fb_id, float noise_scale) {
+    record(GfxHeadlessCallType::StartDrawToFramebuffer, fb_id);
+}
+
+static void gfx_headless_copy_framebuffer(int fb_dst_id, int fb_src_id, int srcX0, int srcY0, int srcX1, int srcY1,
+                                          int dstX0, int dstY0, int dstX1, int dstY1) {
+    record(GfxHeadlessCallType::CopyFramebuffer, fb_dst_id, fb_src_id);
+}
+
+static void gfx_headless_clear_framebuffer(void) {
+    record(GfxHeadlessCallType::ClearFramebuffer);
+}
+
+static void gfx_headless_read_framebuffer_to_cpu(int fb_id, uint32_t width, uint32_t height, uint16_t* rgba16_buf) {
+    memset(rgba16_buf, 0, (size_t)width * height * sizeof(uint16_t));
+    record(GfxHeadlessCallType::ReadFramebufferToCpu, fb_id, width, height);
+}
+
+static void gfx_headless_resolve_msaa_color_buffer(int fb_id_target, int fb_id_source) {
+    record(GfxHeadlessCallType::ResolveMsaaColorBuffer, fb_id_target, fb_id_source);
+}
+
+static void gfx_headless_get_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count,
+                                         uint16_t* depths) {
+    memset(depths, 0, count * sizeof(uint16_t));
+}
+
+static void* gfx_headless_get_framebuffer_texture_id(int fb_id) {
+    return nullptr;
+}
+
+static void gfx_headless_select_texture_fb(int fb_id) {
+    record(GfxHeadlessCallType::SelectTextureFb, fb_id);
+}
+
+static void gfx_headless_delete_texture(uint32_t texID) {
+    record(GfxHeadlessCallType::DeleteTexture, texID);
+}
+
+static void gfx_headless_set_texture_filter(FilteringMode mode) {
+    texture_filter = mode;
+}
+
+static FilteringMode gfx_headless_get_texture_filter(void) {
+    return texture_filter;
+}
+
+struct GfxRenderingAPI gfx_headless_rapi = { gfx_headless_get_name,
+                                             gfx_headless_get_max_texture_size,
+                                             gfx_headless_get_clip_parameters,
+                                             gfx_headless_unload_shader,
+                                             gfx_headless_load_shader,
+                                             gfx_headless_create_and_load_new_shader,
+                                             gfx_headless_lookup_shader,
+                                             gfx_headless_shader_get_info,
+                                             gfx_headless_new_texture,
+                                             gfx_headless_select_texture,
+                                             gfx_headless_upload_texture,
+                                             gfx_headless_set_sampler_parameters,
+                                             gfx_headless_set_depth_test_and_mask,
+                                             gfx_headless_set_zmode_decal,
+                                             gfx_headless_set_viewport,
+                                             gfx_headless_set_scissor,
+                                             gfx_headless_set_use_alpha,
+                                             gfx_headless_draw_triangles,
+                                             gfx_headless_draw_triangles_indexed,
+                                             gfx_headless_init,
+                                             gfx_headless_on_resize,
+                                             gfx_headless_start_frame,
+                                             gfx_headless_end_frame,
+                                             gfx_headless_finish_render,
+                                             gfx_headless_create_framebuffer,
+                                             gfx_headless_update_framebuffer_parameters,
+                                             gfx_headless_start_draw_to_framebuffer,
+                                             gfx_headless_copy_framebuffer,
+                                             gfx_headless_clear_framebuffer,
+                                             gfx_headless_read_framebuffer_to_cpu,
+                                             gfx_headless_resolve_msaa_color_buffer,
+                                             gfx_headless_get_pixel_depth,
+                                             nullptr,
+                                             nullptr,
+                                             gfx_headless_get_framebuffer_texture_id,
+                                             gfx_headless_select_texture_fb,
+                                             gfx_headless_delete_texture,
+                                             gfx_headless_set_texture_filter,
+                                             gfx_headless_get_texture_filter };
+
+static void gfx_headless_wm_init(const char* game_name, const char* gfx_api_name, bool start_in_fullscreen,
+                                 uint32_t width, uint32_t height, int32_t posX, int32_t posY) {
+    window_width = width;
+    window_height = height;
+    window_pos_x = posX;
+    window_pos_y = posY;
+    is_running = true;
+
+    Ship::GuiWindowInitData window_impl = {};
+    Ship::Context::GetInstance()->GetWindow()->GetGui()->Init(window_impl);
+}
+
+static void gfx_headless_wm_close(void) {
+    is_running = false;
+}
+
+static void gfx_headless_wm_set_keyboard_callbacks(bool (*on_key_down)(int scancode), bool (*on_key_up)(int scancode),
+                                                   void (*on_all_keys_up)(void)) {
+}
+
+static void gfx_headless_wm_set_fullscreen_changed_callback(void (*on_fullscreen_changed)(bool is_now_fullscreen)) {
+}
+
+static void gfx_headless_wm_set_fullscreen(bool enable) {
+}
+
+static void gfx_headless_wm_get_active_window_refresh_rate(uint32_t* refresh_rate) {
+    *refresh_rate = 60;
+}
+
+static void gfx_headless_wm_set_cursor_visibility(bool visible) {
+}
+
+static void gfx_headless_wm_main_loop(void (*run_one_game_iter)(void)) {
+    while (is_running) {
+        run_one_game_iter();
+    }
+}
+
+static void gfx_headless_wm_get_dimensions(uint32_t* width, uint32_t* height, int32_t* posX, int32_t* posY) {
+    *width = window_width;
+    *height = window_height;
+    *posX = window_pos_x;
+    *posY = window_pos_y;
+}
+
+static void gfx_headless_wm_handle_events(void) {
+}
+
+static bool gfx_headless_wm_start_frame(void) {
+    return true;
+}
+
+// Frames are not paced, so benchmarks run as fast as the interpreter allows
+static void gfx_headless_wm_swap_buffers_begin(void) {
+}
+
+static void gfx_headless_wm_swap_buffers_end(void) {
+}
+
+static double gfx_headless_wm_get_time(void) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void gfx_headless_wm_set_target_fps(int fps) {
+}
+
+static void gfx_headless_wm_set_maximum_frame_latency(int latency) {
+}
+
+static const char* gfx_headless_wm_get_key_name(int scancode) {
+    return "";
+}
+
+static bool gfx_headless_wm_can_disable_vsync(void) {
+    return true;
+}
+
+struct GfxWindowManagerAPI gfx_headless_wapi = { gfx_headless_wm_init,
+                                                 gfx_headless_wm_close,
+                                                 gfx_headless_wm_set_keyboard_callbacks,
+                                                 gfx_headless_wm_set_fullscreen_changed_callback,
+                                                 gfx_headless_wm_set_fullscreen,
+                                                 gfx_headless_wm_get_active_window_refresh_rate,
+                                                 gfx_headless_wm_set_cursor_visibility,
+                                                 gfx_headless_wm_main_loop,
+                                                 gfx_headless_wm_get_dimensions,
+                                                 gfx_headless_wm_handle_events,
+                                                 gfx_headless_wm_start_frame,
+                                                 gfx_headless_wm_swap_buffers_begin,
+                                                 gfx_headless_wm_swap_buffers_end,
+                                                 gfx_headless_wm_get_time,
+                                                 gfx_headless_wm_set_target_fps,
+                                                 gfx_headless_wm_set_maximum_frame_latency,
+                                                 gfx_headless_wm_get_key_name,
+                                                 gfx_headless_wm_can_disable_vsync,
+                                                 nullptr };
+
+void gfx_headless_set_recording(bool enabled) {
+    recording = enabled;
+}
+
+const std::vector<GfxHeadlessCall>& gfx_headless_get_log(void) {
+    return call_log;
+}
+
+void gfx_headless_clear_log(void) {
+    call_log.clear();
+}
+
+const char* gfx_headless_get_call_name(GfxHeadlessCallType type) {
+    static const char* const names[] = {
+        "LoadShader",
+        "UnloadShader",
+        "SelectTexture",
+        "UploadTexture",
+        "SetSamplerParameters",
+        "SetDepthTestAndMask",
+        "SetZmodeDecal",
+        "SetViewport",
+        "SetScissor",
+        "SetUseAlpha",
+        "DrawTriangles",
+        "DrawTrianglesIndexed",
+        "StartFrame",
+        "EndFrame",
+        "UpdateFramebufferParameters",
+        "StartDrawToFramebuffer",
+        "CopyFramebuffer",
+        "ClearFramebuffer",
+        "ReadFramebufferToCpu",
+        "ResolveMsaaColorBuffer",
+        "SelectTextureFb",
+        "DeleteTexture",
+    };
+    const size_t index = (size_t)type;
+    return index < sizeof(names) / sizeof(names[0]) ? names[index] : "Unknown";
+}
@@ -0,0 +1,52 @@
+#ifndef GFX_HEADLESS_H
+#define GFX_HEADLESS_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "gfx_rendering_api.h"
+#include "gfx_window_manager_api.h"
+
+// Rendering and window manager APIs that create no window and no GPU resources, so display lists can be interpreted
+// on machines without a display, for benchmarks and regression tests. Calls are discarded unless recording is on.
+
+enum class GfxHeadlessCallType : uint8_t {
+    LoadShader,                  // shader_id0 low, shader_id0 high, shader_id1
+    UnloadShader,                // shader_id0 low, shader_id0 high, shader_id1
+    SelectTexture,               // tile, texture id
+    UploadTexture,               // width, height
+    SetSamplerParameters,        // sampler, linear filter, cms, cmt
+    SetDepthTestAndMask,         // depth test, z update
+    SetZmodeDecal,               // zmode decal
+    SetViewport,                 // x, y, width, height
+    SetScissor,                  // x, y, width, height
+    SetUseAlpha,                 // use alpha
+    DrawTriangles,               // triangles, vertices, floats per vertex
+    DrawTrianglesIndexed,        // triangles, vertices, floats per vertex
+    StartFrame,                  // frame number
+    EndFrame,                    //
+    UpdateFramebufferParameters, // framebuffer id, width, height, msaa level
+    StartDrawToFramebuffer,      // framebuffer id
+    CopyFramebuffer,             // destination framebuffer id, source framebuffer id
+    ClearFramebuffer,            //
+    ReadFramebufferToCpu,        // framebuffer id, width, height
+    ResolveMsaaColorBuffer,      // target framebuffer id, source framebuffer id
+    SelectTextureFb,             // framebuffer id
+    DeleteTexture,               // texture id
+};
+
+struct GfxHeadlessCall {
+    GfxHeadlessCallType type;
+    int32_t args[4];
+};
+
+extern struct GfxRenderingAPI gfx_headless_rapi;
+extern struct GfxWindowManagerAPI gfx_headless_wapi;
+
+// Starts or stops appending rendering API calls to the log
+void gfx_headless_set_recording(bool enabled);
+const std::vector<GfxHeadlessCall>& gfx_headless_get_log(void);
+void gfx_headless_clear_log(void);
+const char* gfx_headless_get_call_name(GfxHeadlessCallType type);
+
+#endif
@@ -12,6 +12,7 @@
 #include <vector>
 #include <algorithm>
 #include <unordered_map>
+#include <set>
 #include <queue>
 #include <time.h>
 #include <math.h>
@@ -1003,31 +1004,28 @@ void gfx_metal_resolve_msaa_color_buffer(int fb_id_target, int fb_id_source) {
     }
 }
 
-std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-gfx_metal_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& coordinates) {
+void gfx_metal_get_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count, uint16_t* depths) {
     auto framebuffer = mctx.framebuffers[fb_id];
 
-    if (coordinates.size() > mctx.coord_buffer_size) {
+    if (count > mctx.coord_buffer_size) {
         if (mctx.depth_value_output_buffer != nullptr)
             mctx.depth_value_output_buffer->release();
 
         mctx.depth_value_output_buffer =
-            mctx.device->newBuffer(sizeof(float) * coordinates.size(), MTL::ResourceOptionCPUCacheModeDefault);
+            mctx.device->newBuffer(sizeof(float) * count, MTL::ResourceOptionCPUCacheModeDefault);
         mctx.depth_value_output_buffer->setLabel(NS::String::string("Depth output buffer", NS::UTF8StringEncoding));
 
-        mctx.coord_buffer_size = coordinates.size();
+        mctx.coord_buffer_size = count;
     }
 
     // zero out the buffer
     memset(mctx.coord_uniform_buffer->contents(), 0, sizeof(CoordUniforms));
-    memset(mctx.depth_value_output_buffer->contents(), 0, sizeof(float) * coordinates.size());
+    memset(mctx.depth_value_output_buffer->contents(), 0, sizeof(float) * count);
 
     // map coordinates to right y axis
-    size_t i = 0;
-    for (const auto& coord : coordinates) {
-        mctx.coord_uniforms.coords[i].x = coord.first;
-        mctx.coord_uniforms.coords[i].y = framebuffer.depth_texture->height() - 1 - coord.second;
-        ++i;
+    for (size_t i = 0; i < count; i++) {
+        mctx.coord_uniforms.coords[i].x = coordinates[i].x;
+        mctx.coord_uniforms.coords[i].y = framebuffer.depth_texture->height() - 1 - coordinates[i].y;
     }
 
     // set uniform values
@@ -1049,7 +1047,7 @@ gfx_metal_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& co
     compute_encoder->setBuffer(mctx.depth_value_output_buffer, 0, 1);
 
     MTL::Size thread_group_size = MTL::Size::Make(1, 1, 1);
-    MTL::Size thread_group_count = MTL::Size::Make(coordinates.size(), 1, 1);
+    MTL::Size thread_group_count = MTL::Size::Make(count, 1, 1);
 
     compute_encoder->dispatchThreads(thread_group_count, thread_group_size);
     compute_encoder->endEncoding();
@@ -1060,18 +1058,12 @@ gfx_metal_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& co
     // Now the depth values can be accessed in the buffer.
     float* depth_values = (float*)mctx.depth_value_output_buffer->contents();
 
-    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res;
-    {
-        size_t i = 0;
-        for (const auto& coord : coordinates) {
-            res.emplace(coord, depth_values[i++] * 65532.0f);
-        }
+    for (size_t i = 0; i < count; i++) {
+        depths[i] = depth_values[i] * 65532.0f;
     }
 
     compute_pipeline_state->release();
     autorelease_pool->release();
-
-    return res;
 }
 
 void* gfx_metal_get_framebuffer_texture_id(int fb_id) {
@@ -1225,6 +1217,7 @@ struct GfxRenderingAPI gfx_metal_api = { gfx_metal_get_name,
                                          gfx_metal_set_scissor,
                                          gfx_metal_set_use_alpha,
                                          gfx_metal_draw_triangles,
+                                         nullptr,
                                          gfx_metal_init,
                                          gfx_metal_on_resize,
                                          gfx_metal_start_frame,
@@ -1238,6 +1231,8 @@ struct GfxRenderingAPI gfx_metal_api = { gfx_metal_get_name,
                                          gfx_metal_read_framebuffer_to_cpu,
                                          gfx_metal_resolve_msaa_color_buffer,
                                          gfx_metal_get_pixel_depth,
+                                         nullptr,
+                                         nullptr,
                                          gfx_metal_get_framebuffer_texture_id,
                                          gfx_metal_select_texture_fb,
                                          gfx_metal_delete_texture,
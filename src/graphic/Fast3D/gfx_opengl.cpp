@@ -48,8 +48,16 @@
 #include "window/gui/Gui.h"
 #include "window/Window.h"
 #include "gfx_pc.h"
+#include "gfx_shader_cache.h"
+#include "gfx_hash_pool.h"
+#include "Context.h"
 #include <public/bridge/consolevariablebridge.h>
 
+// Asynchronous depth readback needs fences and pixel pack buffers, and GLES cannot read depth values at all
+#if !defined(USE_OPENGLES) && defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+#define GFX_OPENGL_ASYNC_PIXEL_DEPTH
+#endif
+
 using namespace std;
 
 struct ShaderProgram {
@@ -73,8 +81,20 @@ struct Framebuffer {
     GLuint fbo, clrbuf, clrbuf_msaa, rbo;
 };
 
-static map<pair<uint64_t, uint32_t>, struct ShaderProgram> shader_program_pool;
+static GfxHashPool<pair<uint64_t, uint32_t>, struct ShaderProgram, GfxShaderIdHasher> shader_program_pool;
+
+// gShaderCache: linked programs are saved where the driver supports program binaries (GL 4.1, ARB_get_program_binary
+// or GLES 3.0) and loaded instead of compiled in later sessions. The file is tied to the driver that wrote it, and each
+// binary to the shader source it was linked from.
+#define PROGRAM_BINARY_CACHE_VERSION 2
+static struct {
+    GfxShaderCacheFile file;
+    // Binaries read at startup that no program has been loaded from yet
+    map<pair<uint64_t, uint32_t>, GfxProgramBinary> binaries;
+} program_binary_cache;
+
 static GLuint opengl_vbo;
+static GLuint opengl_ibo;
 #if defined(__APPLE__) || defined(USE_OPENGLES)
 static GLuint opengl_vao;
 #endif
@@ -89,7 +109,19 @@ static FilteringMode current_filter_mode = FILTER_THREE_POINT;
 
 GLint max_msaa_level = 1;
 GLuint pixel_depth_rb, pixel_depth_fb;
-size_t pixel_depth_rb_size;
+
+// Asynchronous depth reads go to a pixel pack buffer per slot, which is mapped once its fence has signaled. Contexts
+// older than GL 3.2 have no fences, so requests read the values right away there.
+#ifdef GFX_OPENGL_ASYNC_PIXEL_DEPTH
+static bool pixel_depth_fences_supported;
+static struct {
+    GLuint pbo;
+    GLsync fence;
+    size_t count;
+    bool pending;
+    uint16_t depths[GFX_PIXEL_DEPTH_MAX_COORDS];
+} pixel_depth_readbacks[GFX_PIXEL_DEPTH_SLOTS];
+#endif
 
 static int gfx_opengl_get_max_texture_size() {
     GLint max_texture_size;
@@ -247,6 +279,125 @@ static void append_formula(char* buf, size_t* len, uint8_t c[2][4], bool do_sing
     }
 }
 
+static GLuint gfx_opengl_compile_program(const GLchar* sources[2], const GLint lengths[2]) {
+    GLint success;
+
+    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex_shader, 1, &sources[0], &lengths[0]);
+    glCompileShader(vertex_shader);
+    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLint max_length = 0;
+        glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &max_length);
+        char error_log[1024];
+        // fprintf(stderr, "Vertex shader compilation failed\n");
+        glGetShaderInfoLog(vertex_shader, max_length, &max_length, &error_log[0]);
+        // fprintf(stderr, "%s\n", &error_log[0]);
+        abort();
+    }
+
+    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment_shader, 1, &sources[1], &lengths[1]);
+    glCompileShader(fragment_shader);
+    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLint max_length = 0;
+        glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &max_length);
+        char error_log[1024];
+        fprintf(stderr, "Fragment shader compilation failed\n");
+        glGetShaderInfoLog(fragment_shader, max_length, &max_length, &error_log[0]);
+        fprintf(stderr, "%s\n", &error_log[0]);
+        abort();
+    }
+
+    GLuint shader_program = glCreateProgram();
+    glAttachShader(shader_program, vertex_shader);
+    glAttachShader(shader_program, fragment_shader);
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    if (program_binary_cache.file.file != nullptr) {
+        glProgramParameteri(shader_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+#endif
+    glLinkProgram(shader_program);
+    return shader_program;
+}
+
+static void gfx_opengl_load_program_binaries(void) {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    if (num_formats <= 0) {
+        return;
+    }
+
+    vector<uint8_t> header = { 'F', '3', 'D', 'G', 'L', 'B', 'I', 'N', PROGRAM_BINARY_CACHE_VERSION };
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        const char* str = (const char*)glGetString(name);
+        if (str != nullptr) {
+            header.insert(header.end(), str, str + strlen(str));
+        }
+        header.push_back('\0');
+    }
+    vector<uint8_t> records;
+    if (!gfx_shader_cache_open(&program_binary_cache.file,
+                               Ship::Context::GetPathRelativeToAppDirectory("shader_binaries.bin"), header, &records)) {
+        return;
+    }
+
+    // A later record for the same program replaces the earlier one
+    for (GfxProgramBinary& binary : gfx_shader_cache_read_program_binaries(records)) {
+        program_binary_cache.binaries[make_pair(binary.shader_id0, binary.shader_id1)] = std::move(binary);
+    }
+#endif
+}
+
+static GLuint gfx_opengl_load_program_binary(uint64_t shader_id0, uint32_t shader_id1, uint64_t source_hash) {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+    auto it = program_binary_cache.binaries.find(make_pair(shader_id0, shader_id1));
+    if (it == program_binary_cache.binaries.end()) {
+        return 0;
+    }
+    // Linked from what an older build generated for these ids, the program is compiled and saved again instead
+    if (it->second.source_hash != source_hash) {
+        program_binary_cache.binaries.erase(it);
+        return 0;
+    }
+    GLuint shader_program = glCreateProgram();
+    glProgramBinary(shader_program, it->second.format, it->second.data.data(), it->second.data.size());
+    program_binary_cache.binaries.erase(it);
+
+    // Drivers may reject binaries of an older build even if they report the same version string
+    GLint success;
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+    if (success) {
+        return shader_program;
+    }
+    glDeleteProgram(shader_program);
+#endif
+    return 0;
+}
+
+static void gfx_opengl_save_program_binary(uint64_t shader_id0, uint32_t shader_id1, uint64_t source_hash,
+                                           GLuint shader_program) {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+    if (program_binary_cache.file.file == nullptr) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(shader_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    GfxProgramBinary binary = { shader_id0, shader_id1, source_hash, 0, vector<uint8_t>(length) };
+    GLenum format = 0;
+    glGetProgramBinary(shader_program, length, &length, &format, binary.data.data());
+    binary.format = format;
+    binary.data.resize(length);
+    gfx_shader_cache_append_program_binary(&program_binary_cache.file, binary);
+#endif
+}
+
 static struct ShaderProgram* gfx_opengl_create_and_load_new_shader(uint64_t shader_id0, uint32_t shader_id1) {
     struct CCFeatures cc_features;
     gfx_cc_get_features(shader_id0, shader_id1, &cc_features);
@@ -597,44 +748,17 @@ static struct ShaderProgram* gfx_opengl_create_and_load_new_shader(uint64_t shad
 
     const GLchar* sources[2] = { vs_buf, fs_buf };
     const GLint lengths[2] = { (GLint)vs_len, (GLint)fs_len };
-    GLint success;
-
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &sources[0], &lengths[0]);
-    glCompileShader(vertex_shader);
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        GLint max_length = 0;
-        glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &max_length);
-        char error_log[1024];
-        // fprintf(stderr, "Vertex shader compilation failed\n");
-        glGetShaderInfoLog(vertex_shader, max_length, &max_length, &error_log[0]);
-        // fprintf(stderr, "%s\n", &error_log[0]);
-        abort();
-    }
 
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &sources[1], &lengths[1]);
-    glCompileShader(fragment_shader);
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        GLint max_length = 0;
-        glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &max_length);
-        char error_log[1024];
-        fprintf(stderr, "Fragment shader compilation failed\n");
-        glGetShaderInfoLog(fragment_shader, max_length, &max_length, &error_log[0]);
-        fprintf(stderr, "%s\n", &error_log[0]);
-        abort();
+    const uint64_t source_hash = gfx_shader_source_hash(vs_buf, vs_len, fs_buf, fs_len);
+    GLuint shader_program = gfx_opengl_load_program_binary(shader_id0, shader_id1, source_hash);
+    if (shader_program == 0) {
+        shader_program = gfx_opengl_compile_program(sources, lengths);
+        gfx_opengl_save_program_binary(shader_id0, shader_id1, source_hash, shader_program);
     }
 
-    GLuint shader_program = glCreateProgram();
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-    glLinkProgram(shader_program);
-
     size_t cnt = 0;
 
-    struct ShaderProgram* prg = &shader_program_pool[make_pair(shader_id0, shader_id1)];
+    struct ShaderProgram* prg = shader_program_pool.insert(make_pair(shader_id0, shader_id1));
     prg->attrib_locations[cnt] = glGetAttribLocation(shader_program, "aVtxPos");
     prg->attrib_sizes[cnt] = 4;
     ++cnt;
@@ -723,8 +847,7 @@ static struct ShaderProgram* gfx_opengl_create_and_load_new_shader(uint64_t shad
 }
 
 static struct ShaderProgram* gfx_opengl_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
-    auto it = shader_program_pool.find(make_pair(shader_id0, shader_id1));
-    return it == shader_program_pool.end() ? nullptr : &it->second;
+    return shader_program_pool.find(make_pair(shader_id0, shader_id1));
 }
 
 static void gfx_opengl_shader_get_info(struct ShaderProgram* prg, uint8_t* num_inputs, bool used_textures[2]) {
@@ -846,6 +969,16 @@ static void gfx_opengl_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_
     glDrawArrays(GL_TRIANGLES, 0, 3 * buf_vbo_num_tris);
 }
 
+static void gfx_opengl_draw_triangles_indexed(float buf_vbo[], size_t buf_vbo_len, const uint16_t buf_ibo[],
+                                              size_t buf_ibo_len) {
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * buf_vbo_len, buf_vbo, GL_STREAM_DRAW);
+    // The element buffer binding is not preserved by everything else drawing with this context (e.g. ImGui), so bind
+    // it every time
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, opengl_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * buf_ibo_len, buf_ibo, GL_STREAM_DRAW);
+    glDrawElements(GL_TRIANGLES, buf_ibo_len, GL_UNSIGNED_SHORT, 0);
+}
+
 static void gfx_opengl_init(void) {
 #if !defined(__SWITCH__) && !defined(__linux__)
     glewInit();
@@ -853,6 +986,7 @@ static void gfx_opengl_init(void) {
 
     glGenBuffers(1, &opengl_vbo);
     glBindBuffer(GL_ARRAY_BUFFER, opengl_vbo);
+    glGenBuffers(1, &opengl_ibo);
 
 #if defined(__APPLE__) || defined(USE_OPENGLES)
     glGenVertexArrays(1, &opengl_vao);
@@ -869,7 +1003,7 @@ static void gfx_opengl_init(void) {
 
     glGenRenderbuffers(1, &pixel_depth_rb);
     glBindRenderbuffer(GL_RENDERBUFFER, pixel_depth_rb);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1, 1);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, GFX_PIXEL_DEPTH_MAX_COORDS, 1);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
     glGenFramebuffers(1, &pixel_depth_fb);
@@ -877,9 +1011,19 @@ static void gfx_opengl_init(void) {
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, pixel_depth_rb);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    pixel_depth_rb_size = 1;
+#ifdef GFX_OPENGL_ASYNC_PIXEL_DEPTH
+    // Left untouched by contexts before GL 3.0, which do not know these queries
+    GLint major_version = 0, minor_version = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+    glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+    pixel_depth_fences_supported = major_version > 3 || (major_version == 3 && minor_version >= 2);
+#endif
 
     glGetIntegerv(GL_MAX_SAMPLES, &max_msaa_level);
+
+    if (CVarGetInteger("gShaderCache", 0)) {
+        gfx_opengl_load_program_binaries();
+    }
 }
 
 static void gfx_opengl_on_resize(void) {
@@ -911,7 +1055,7 @@ static int gfx_opengl_create_framebuffer() {
     GLuint rbo;
     glGenRenderbuffers(1, &rbo);
     glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1, 1);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, GFX_PIXEL_DEPTH_MAX_COORDS, 1);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
     GLuint fbo;
@@ -1100,74 +1244,124 @@ void gfx_opengl_read_framebuffer_to_cpu(int fb_id, uint32_t width, uint32_t heig
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[current_framebuffer].fbo);
 }
 
-static std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-gfx_opengl_get_pixel_depth(int fb_id, const std::set<std::pair<float, float>>& coordinates) {
-    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res;
+static uint16_t gfx_opengl_depth_from_depth_stencil(uint32_t depth_stencil_value) {
+    return (depth_stencil_value >> 18) << 2;
+}
+
+// Copies the depth and stencil values at coordinates into the first row of pixel_depth_fb, which also resolves
+// multisampled framebuffers, and leaves pixel_depth_fb bound for reading
+static void gfx_opengl_blit_pixel_depth(const Framebuffer& fb, const GfxPixelCoord* coordinates, size_t count) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fb.fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, pixel_depth_fb);
 
+    glDisable(GL_SCISSOR_TEST); // needed for the blit operation
+
+    for (size_t i = 0; i < count; i++) {
+        int x = coordinates[i].x;
+        int y = coordinates[i].y;
+        if (fb.invert_y) {
+            y = fb.height - y;
+        }
+        glBlitFramebuffer(x, y, x + 1, y + 1, i, 0, i + 1, 1, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, pixel_depth_fb);
+}
+
+static void gfx_opengl_get_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count, uint16_t* depths) {
     Framebuffer& fb = framebuffers[fb_id];
+    uint32_t depth_stencil_values[GFX_PIXEL_DEPTH_MAX_COORDS] = {};
 
     // When looking up one value and the framebuffer is single-sampled, we can read pixels directly
     // Otherwise we need to blit first to a new buffer then read it
-    if (coordinates.size() == 1 && fb.msaa_level <= 1) {
-        uint32_t depth_stencil_value;
+    if (count == 1 && fb.msaa_level <= 1) {
         glBindFramebuffer(GL_FRAMEBUFFER, fb.fbo);
-        int x = coordinates.begin()->first;
-        int y = coordinates.begin()->second;
+        int x = coordinates[0].x;
+        int y = coordinates[0].y;
 #ifndef USE_OPENGLES // not supported on gles. Runs fine without it, but this may cause issues
         glReadPixels(x, fb.invert_y ? fb.height - y : y, 1, 1, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8,
-                     &depth_stencil_value);
+                     depth_stencil_values);
 #endif
-        res.emplace(*coordinates.begin(), (depth_stencil_value >> 18) << 2);
     } else {
-        if (pixel_depth_rb_size < coordinates.size()) {
-            // Resizing a renderbuffer seems broken with Intel's driver, so recreate one instead.
-            glBindFramebuffer(GL_FRAMEBUFFER, pixel_depth_fb);
-            glDeleteRenderbuffers(1, &pixel_depth_rb);
-            glGenRenderbuffers(1, &pixel_depth_rb);
-            glBindRenderbuffer(GL_RENDERBUFFER, pixel_depth_rb);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, coordinates.size(), 1);
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, pixel_depth_rb);
-            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        gfx_opengl_blit_pixel_depth(fb, coordinates, count);
+#ifndef USE_OPENGLES // not supported on gles. Runs fine without it, but this may cause issues
+        glReadPixels(0, 0, count, 1, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, depth_stencil_values);
+#endif
+    }
+    for (size_t i = 0; i < count; i++) {
+        depths[i] = gfx_opengl_depth_from_depth_stencil(depth_stencil_values[i]);
+    }
 
-            pixel_depth_rb_size = coordinates.size();
-        }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[current_framebuffer].fbo);
+}
+
+#ifdef GFX_OPENGL_ASYNC_PIXEL_DEPTH
+static void gfx_opengl_request_pixel_depth(int slot, int fb_id, const GfxPixelCoord* coordinates, size_t count) {
+    auto& readback = pixel_depth_readbacks[slot];
+    readback.count = count;
+    readback.pending = true;
+    if (!pixel_depth_fences_supported) {
+        gfx_opengl_get_pixel_depth(fb_id, coordinates, count, readback.depths);
+        return;
+    }
+
+    if (readback.fence != nullptr) {
+        // The previous request in this slot was never polled
+        glDeleteSync(readback.fence);
+    }
+    if (readback.pbo == 0) {
+        glGenBuffers(1, &readback.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, GFX_PIXEL_DEPTH_MAX_COORDS * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+    } else {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    }
 
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, fb.fbo);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, pixel_depth_fb);
+    gfx_opengl_blit_pixel_depth(framebuffers[fb_id], coordinates, count);
+    glReadPixels(0, 0, count, 1, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Submit the copy now, so that polling without waiting sees it complete
+    glFlush();
 
-        glDisable(GL_SCISSOR_TEST); // needed for the blit operation
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[current_framebuffer].fbo);
+}
 
-        {
-            size_t i = 0;
-            for (const auto& coord : coordinates) {
-                int x = coord.first;
-                int y = coord.second;
-                if (fb.invert_y) {
-                    y = fb.height - y;
-                }
-                glBlitFramebuffer(x, y, x + 1, y + 1, i, 0, i + 1, 1, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT,
-                                  GL_NEAREST);
-                ++i;
-            }
-        }
+static bool gfx_opengl_poll_pixel_depth(int slot, uint16_t* depths, bool wait) {
+    auto& readback = pixel_depth_readbacks[slot];
+    if (!readback.pending) {
+        return false;
+    }
 
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, pixel_depth_fb);
-        vector<uint32_t> depth_stencil_values(coordinates.size());
-#ifndef USE_OPENGLES // not supported on gles. Runs fine without it, but this may cause issues
-        glReadPixels(0, 0, coordinates.size(), 1, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, depth_stencil_values.data());
-#endif
-        {
-            size_t i = 0;
-            for (const auto& coord : coordinates) {
-                res.emplace(coord, (depth_stencil_values[i++] >> 18) << 2);
-            }
+    if (readback.fence != nullptr) {
+        GLenum status;
+        do {
+            status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000 : 0);
+        } while (wait && status == GL_TIMEOUT_EXPIRED);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        const uint32_t* depth_stencil_values = (const uint32_t*)glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, readback.count * sizeof(uint32_t), GL_MAP_READ_BIT);
+        for (size_t i = 0; i < readback.count; i++) {
+            readback.depths[i] =
+                depth_stencil_values != nullptr ? gfx_opengl_depth_from_depth_stencil(depth_stencil_values[i]) : 0;
         }
+        if (depth_stencil_values != nullptr) {
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, current_framebuffer);
-
-    return res;
+    readback.pending = false;
+    memcpy(depths, readback.depths, readback.count * sizeof(uint16_t));
+    return true;
 }
+#endif
 
 void gfx_opengl_set_texture_filter(FilteringMode mode) {
     current_filter_mode = mode;
@@ -1196,6 +1390,7 @@ struct GfxRenderingAPI gfx_opengl_api = { gfx_opengl_get_name,
                                           gfx_opengl_set_scissor,
                                           gfx_opengl_set_use_alpha,
                                           gfx_opengl_draw_triangles,
+                                          gfx_opengl_draw_triangles_indexed,
                                           gfx_opengl_init,
                                           gfx_opengl_on_resize,
                                           gfx_opengl_start_frame,
@@ -1209,6 +1404,13 @@ struct GfxRenderingAPI gfx_opengl_api = { gfx_opengl_get_name,
                                           gfx_opengl_read_framebuffer_to_cpu,
                                           gfx_opengl_resolve_msaa_color_buffer,
                                           gfx_opengl_get_pixel_depth,
+#ifdef GFX_OPENGL_ASYNC_PIXEL_DEPTH
+                                          gfx_opengl_request_pixel_depth,
+                                          gfx_opengl_poll_pixel_depth,
+#else
+                                          nullptr,
+                                          nullptr,
+#endif
                                           gfx_opengl_get_framebuffer_texture_id,
                                           gfx_opengl_select_texture_fb,
                                           gfx_opengl_delete_texture,
@@ -9,11 +9,16 @@
 #include <stdio.h>
 
 #include <map>
-#include <set>
 #include <unordered_map>
 #include <vector>
 #include <list>
 #include <stack>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <chrono>
 
 #ifndef _LANGUAGE_C
 #define _LANGUAGE_C
@@ -22,12 +27,19 @@
 #include "libultraship/libultra/gbi.h"
 #include "libultraship/libultra/gs2dex.h"
 #include <string>
+#include <string_view>
 
 #include "gfx_pc.h"
 #include "gfx_cc.h"
 #include "gfx_window_manager_api.h"
 #include "gfx_rendering_api.h"
 #include "gfx_screen_config.h"
+#include "gfx_frame_recorder.h"
+#include "gfx_render_thread.h"
+#include "gfx_texture_decode.h"
+#include "gfx_vertex_transform.h"
+#include "gfx_shader_cache.h"
+#include "gfx_hash_pool.h"
 
 #include "log/luslog.h"
 #include "window/gui/Gui.h"
@@ -37,11 +49,13 @@
 #include "libultraship/libultraship.h"
 #include "libultraship/bridge.h"
 #include "debug/GfxDebugger.h"
+#include "thread-pool/BS_thread_pool.hpp"
 
 #include <spdlog/fmt/fmt.h>
 
 uintptr_t gfxFramebuffer;
-std::stack<std::string> currentDir;
+// Directories pushed by G_PUSHCD. The views point into display list data, which outlives the frame.
+std::vector<std::string_view> currentDir;
 
 using namespace std;
 
@@ -63,14 +77,62 @@ using namespace std;
 #define RATIO_X (gfx_current_dimensions.width / (2.0f * HALF_SCREEN_WIDTH))
 #define RATIO_Y (gfx_current_dimensions.height / (2.0f * HALF_SCREEN_HEIGHT))
 
-#define TEXTURE_CACHE_MAX_SIZE 500
+// Default of gTextureCacheBudgetMB, the decoded size of the textures the cache keeps
+#define TEXTURE_CACHE_DEFAULT_BUDGET_MB 256
+
+// Atlas pages of gTextureAtlas, holding copies of textures of at most TEXTURE_ATLAS_MAX_TEXTURE_SIZE texels per side
+#define TEXTURE_ATLAS_PAGE_SIZE 512
+#define TEXTURE_ATLAS_MAX_PAGES 8
+#define TEXTURE_ATLAS_MAX_TEXTURE_SIZE 32
+// Edge texels repeated around each copy, so sampling up to one texel outside a texture matches clamping
+#define TEXTURE_ATLAS_PADDING 2
+
+// Number of vertices gfx_sp_vertex transforms together before lighting them
+#define GFX_VERTEX_BATCH_SIZE 8
+// Memoized vertex batches that go unused for this many frames are dropped
+#define VERTEX_MEMO_MAX_AGE 30
+// Memory held by memoized vertex batches, beyond which the least recently used ones are dropped
+#define VERTEX_MEMO_MAX_BYTES (8 << 20)
+// Speculatively decoded textures that no import adopts within this many frames are dropped
+#define TEXTURE_PREDECODE_MAX_AGE 600
 
 static struct {
     TextureCacheMap map;
     list<TextureCacheMapIter> lru;
     vector<uint32_t> free_texture_ids;
+    // Entries by texture address, for G_INVALTEXCACHE
+    std::unordered_multimap<const uint8_t*, TextureCacheNode*> by_addr;
+    // With gTextureContentDedup, an entry per content hash, and the entries sharing each aliased texture id. Sampler
+    // parameters belong to the backend texture, so they are mirrored across all entries sharing it.
+    std::unordered_map<uint64_t, TextureCacheNode*> by_content;
+    std::unordered_map<uint32_t, std::vector<TextureCacheNode*>> aliases;
+    size_t resident_bytes;
 } gfx_texture_cache;
 
+struct TextureAtlasPage {
+    uint32_t texture_id;
+    std::vector<uint8_t> pixels;
+    // Copies are packed left to right on shelves, a new shelf starts below the tallest copy of the current one
+    uint16_t shelf_x, shelf_y, shelf_height;
+    uint32_t live_entries;
+    bool dirty;
+    bool sampler_valid;
+    bool linear_filter;
+};
+
+// gTextureAtlas: small clamped textures are also copied into shared pages. Triangles that sample such a texture
+// only within its padded copy draw from the page instead, so switching between textures on the same page does not
+// end the batch.
+static struct {
+    std::vector<TextureAtlasPage> pages;
+    // 1 + index of the page bound to each texture slot, 0 when the slot holds something else
+    uint8_t bound[SHADER_MAX_TEXTURES];
+    // Set after a framebuffer is bound as texture, until the next texture import
+    bool suspended[2];
+    // Whether the current triangle draws texture 0 and 1 from their atlas copy
+    bool active[2];
+} texture_atlas;
+
 struct ColorCombiner {
     uint64_t shader_id0;
     uint32_t shader_id1;
@@ -79,8 +141,21 @@ struct ColorCombiner {
     uint8_t shader_input_mapping[2][7];
 };
 
-static map<ColorCombinerKey, struct ColorCombiner> color_combiner_pool;
-static map<ColorCombinerKey, struct ColorCombiner>::iterator prev_combiner = color_combiner_pool.end();
+struct ColorCombinerKeyHasher {
+    uint64_t operator()(const ColorCombinerKey& key) const {
+        return key.combine_mode ^ (key.options * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+static GfxHashPool<ColorCombinerKey, struct ColorCombiner, ColorCombinerKeyHasher> color_combiner_pool;
+
+// gShaderCache: every color combiner and shader program created is recorded in a manifest in the app directory, and
+// the manifest is replayed at startup so materials seen in earlier sessions do not compile in the middle of a frame.
+// The version must be bumped whenever the meaning of combiner keys or shader ids changes.
+#define SHADER_MANIFEST_VERSION 1
+#define SHADER_MANIFEST_COMBINER 0
+#define SHADER_MANIFEST_PROGRAM 1
+static GfxShaderCacheFile shader_manifest;
 
 static uint8_t* tex_upload_buffer = nullptr;
 
@@ -114,14 +189,47 @@ static bool has_drawn_imgui_menu;
 
 static bool dropped_frame;
 
+// Set while the render thread is still drawing the GUI and presenting the last frame
+static bool threaded_frame_in_flight;
+static bool threaded_frame_recorded;
+
 static const std::unordered_map<Mtx*, MtxF>* current_mtx_replacements;
 
+// Decoded G_MTX matrices by source address. A hit skips both the replacement lookup and the fixed point decode. Entries
+// are only used within the gfx_run that decoded them, since the replacement matrices change between runs; the source
+// data is compared as well, in case a matrix resource is reloaded at the same address mid-frame.
+#define MATRIX_CACHE_SIZE 256
+static struct {
+    struct {
+        const int32_t* addr;
+        uint32_t generation;
+        Mtx source;
+        float matrix[4][4];
+    } entries[MATRIX_CACHE_SIZE];
+    uint32_t generation;
+} matrix_cache;
+
+static GfxFrameStats frame_stats;
+static GfxFrameStats last_frame_stats;
+
 static float buf_vbo[MAX_BUFFERED * (32 * 3)]; // 3 vertices in a triangle and 32 floats per vtx
 static size_t buf_vbo_len;
 static size_t buf_vbo_num_tris;
 
+// Index buffer used with draw_triangles_indexed. Each loaded vertex is emitted into buf_vbo at most once per
+// generation, and the generation is bumped whenever a previously emitted copy could be stale: on flush, when
+// loaded_vertices is rewritten, and when the per triangle vertex inputs change.
+static uint16_t buf_ibo[MAX_BUFFERED * 3];
+static size_t buf_ibo_len;
+static uint16_t buf_vbo_num_verts;
+static uint16_t emitted_vertex_index[MAX_VERTICES + 4];
+static uint32_t emitted_vertex_generation[MAX_VERTICES + 4];
+static uint32_t current_emit_generation = 1;
+
 static struct GfxWindowManagerAPI* gfx_wapi;
 static struct GfxRenderingAPI* gfx_rapi;
+// The backend given to gfx_init, gfx_rapi points to the frame recorder or render thread while a frame uses them
+static struct GfxRenderingAPI* gfx_backend_rapi;
 
 static int markerOn;
 uintptr_t gSegmentPointers[16];
@@ -137,44 +245,102 @@ static bool fbActive = 0;
 static map<int, FBInfo>::iterator active_fb;
 static map<int, FBInfo> framebuffers;
 
-static set<pair<float, float>> get_pixel_depth_pending;
-static unordered_map<pair<float, float>, uint16_t, hash_pair_ff> get_pixel_depth_cached;
+struct PixelDepthSample {
+    GfxPixelCoord coord;
+    uint16_t depth;
+};
+
+// Depth queries of the game. Coordinates asked for between frames collect in pending, and a blocking read fetches them
+// all at once into this frame's samples. With gAsyncPixelDepth, pending is instead read back without waiting once the
+// next frame is drawn, into one of GFX_PIXEL_DEPTH_SLOTS readbacks that typically arrive a frame or two later. Queries
+// then answer with the latest value that has arrived and only block for coordinates never read before.
+static struct {
+    GfxPixelCoord pending[GFX_PIXEL_DEPTH_MAX_COORDS];
+    size_t num_pending;
+    PixelDepthSample samples[GFX_PIXEL_DEPTH_MAX_COORDS]; // Read by blocking this frame
+    size_t num_samples;
+    PixelDepthSample resolved[GFX_PIXEL_DEPTH_MAX_COORDS]; // Latest values of the asynchronous readbacks
+    size_t num_resolved;
+    struct {
+        GfxPixelCoord coords[GFX_PIXEL_DEPTH_MAX_COORDS];
+        size_t count;
+        bool in_flight;
+    } readbacks[GFX_PIXEL_DEPTH_SLOTS];
+    int next_slot;
+} pixel_depth;
+
+static bool gfx_pixel_depth_async(void);
+static void gfx_pixel_depth_request(void);
 
 struct MaskedTextureEntry {
     uint8_t* mask;
     uint8_t* replacementData;
 };
 
-static map<string, MaskedTextureEntry> masked_textures;
+// Transparent comparator, so the resource paths can be looked up as string_views without copying them
+static map<string, MaskedTextureEntry, std::less<>> masked_textures;
 
 static UcodeHandlers ucode_handler_index = UcodeHandlers::ucode_f3dex2;
 
-static std::string GetPathWithoutFileName(char* filePath) {
-    size_t len = strlen(filePath);
+static std::string_view GetPathWithoutFileName(const char* filePath) {
+    const std::string_view path(filePath);
+    const size_t separator = path.find_last_of("/\\");
+    return separator == std::string_view::npos ? path : path.substr(0, separator);
+}
 
-    for (size_t i = len - 1; i >= 0; i--) {
-        if (filePath[i] == '/' || filePath[i] == '\\') {
-            return std::string(filePath).substr(0, i);
-        }
+// Reissues the tracked rendering state after gfx_rapi changed, so the new implementation starts from the state the
+// backend is in. Textures are reselected through the texture cache on the next triangle.
+static void gfx_resync_rendering_state(void) {
+    gfx_rapi->set_depth_test_and_mask(rendering_state.depth_test_and_mask & 1, rendering_state.depth_test_and_mask & 2);
+    gfx_rapi->set_zmode_decal(rendering_state.decal_mode);
+    gfx_rapi->set_use_alpha(rendering_state.alpha_blend);
+    if (rendering_state.shader_program != nullptr) {
+        gfx_rapi->load_shader(rendering_state.shader_program);
     }
-
-    return filePath;
+    g_rdp.textures_changed[0] = true;
+    g_rdp.textures_changed[1] = true;
+    memset(texture_atlas.bound, 0, sizeof(texture_atlas.bound));
 }
 
 static void gfx_flush(void) {
     if (buf_vbo_len > 0) {
-        gfx_rapi->draw_triangles(buf_vbo, buf_vbo_len, buf_vbo_num_tris);
+        frame_stats.draw_calls_issued++;
+        if (buf_ibo_len > 0) {
+            gfx_rapi->draw_triangles_indexed(buf_vbo, buf_vbo_len, buf_ibo, buf_ibo_len);
+        } else {
+            gfx_rapi->draw_triangles(buf_vbo, buf_vbo_len, buf_vbo_num_tris);
+        }
         buf_vbo_len = 0;
         buf_vbo_num_tris = 0;
+        buf_ibo_len = 0;
+        buf_vbo_num_verts = 0;
+        current_emit_generation++;
     }
 }
 
+static void gfx_shader_manifest_record_combiner(const ColorCombinerKey& key) {
+    uint8_t record[17];
+    record[0] = SHADER_MANIFEST_COMBINER;
+    memcpy(record + 1, &key.combine_mode, sizeof(key.combine_mode));
+    memcpy(record + 9, &key.options, sizeof(key.options));
+    gfx_shader_cache_append(&shader_manifest, record, sizeof(record));
+}
+
+static void gfx_shader_manifest_record_program(uint64_t shader_id0, uint32_t shader_id1) {
+    uint8_t record[13];
+    record[0] = SHADER_MANIFEST_PROGRAM;
+    memcpy(record + 1, &shader_id0, sizeof(shader_id0));
+    memcpy(record + 9, &shader_id1, sizeof(shader_id1));
+    gfx_shader_cache_append(&shader_manifest, record, sizeof(record));
+}
+
 static struct ShaderProgram* gfx_lookup_or_create_shader_program(uint64_t shader_id0, uint32_t shader_id1) {
     struct ShaderProgram* prg = gfx_rapi->lookup_shader(shader_id0, shader_id1);
     if (prg == NULL) {
         gfx_rapi->unload_shader(rendering_state.shader_program);
         prg = gfx_rapi->create_and_load_new_shader(shader_id0, shader_id1);
         rendering_state.shader_program = prg;
+        gfx_shader_manifest_record_program(shader_id0, shader_id1);
     }
     return prg;
 }
@@ -404,47 +570,230 @@ static void gfx_generate_cc(struct ColorCombiner* comb, const ColorCombinerKey&
 }
 
 static struct ColorCombiner* gfx_lookup_or_create_color_combiner(const ColorCombinerKey& key) {
-    if (prev_combiner != color_combiner_pool.end() && prev_combiner->first == key) {
-        return &prev_combiner->second;
+    struct ColorCombiner* comb = color_combiner_pool.find(key);
+    if (comb != nullptr) {
+        return comb;
+    }
+    gfx_flush();
+    comb = color_combiner_pool.insert(key);
+    gfx_generate_cc(comb, key);
+    gfx_shader_manifest_record_combiner(key);
+    return comb;
+}
+
+static void gfx_shader_manifest_load(void) {
+    static const uint8_t magic[] = { 'F', '3', 'D', 'S', 'H', 'D', 'R', SHADER_MANIFEST_VERSION };
+    const vector<uint8_t> header(magic, magic + sizeof(magic));
+    vector<uint8_t> records;
+    GfxShaderCacheFile manifest;
+    if (!gfx_shader_cache_open(&manifest, Ship::Context::GetPathRelativeToAppDirectory("shader_manifest.bin"), header,
+                               &records)) {
+        return;
     }
 
-    prev_combiner = color_combiner_pool.find(key);
-    if (prev_combiner != color_combiner_pool.end()) {
-        return &prev_combiner->second;
+    // Replay before the manifest is attached, so the entries being recreated are not recorded a second time
+    uint32_t num_combiners = 0;
+    uint32_t num_programs = 0;
+    size_t pos = 0;
+    while (pos < records.size()) {
+        if (records[pos] == SHADER_MANIFEST_COMBINER && pos + 17 <= records.size()) {
+            ColorCombinerKey key;
+            memcpy(&key.combine_mode, &records[pos + 1], sizeof(key.combine_mode));
+            memcpy(&key.options, &records[pos + 9], sizeof(key.options));
+            gfx_lookup_or_create_color_combiner(key);
+            num_combiners++;
+            pos += 17;
+        } else if (records[pos] == SHADER_MANIFEST_PROGRAM && pos + 13 <= records.size()) {
+            uint64_t shader_id0;
+            uint32_t shader_id1;
+            memcpy(&shader_id0, &records[pos + 1], sizeof(shader_id0));
+            memcpy(&shader_id1, &records[pos + 9], sizeof(shader_id1));
+            gfx_lookup_or_create_shader_program(shader_id0, shader_id1);
+            num_programs++;
+            pos += 13;
+        } else {
+            // Truncated by a crash while writing, the entry is recorded again when it is next created
+            break;
+        }
     }
-    gfx_flush();
-    prev_combiner = color_combiner_pool.insert(make_pair(key, ColorCombiner())).first;
-    gfx_generate_cc(&prev_combiner->second, key);
-    return &prev_combiner->second;
+    gfx_rapi->unload_shader(rendering_state.shader_program);
+    rendering_state.shader_program = nullptr;
+    shader_manifest = manifest;
+
+    SPDLOG_INFO("Shader cache: created {} color combiners and {} shader programs", num_combiners, num_programs);
 }
 
 void gfx_texture_cache_clear() {
+    for (const TextureAtlasPage& page : texture_atlas.pages) {
+        gfx_texture_cache.free_texture_ids.push_back(page.texture_id);
+    }
+    texture_atlas.pages.clear();
+    memset(texture_atlas.bound, 0, sizeof(texture_atlas.bound));
     for (const auto& entry : gfx_texture_cache.map) {
-        gfx_texture_cache.free_texture_ids.push_back(entry.second.texture_id);
+        if (!gfx_texture_cache.aliases.contains(entry.second.texture_id)) {
+            gfx_texture_cache.free_texture_ids.push_back(entry.second.texture_id);
+        }
+    }
+    for (const auto& alias : gfx_texture_cache.aliases) {
+        gfx_texture_cache.free_texture_ids.push_back(alias.first);
     }
     gfx_texture_cache.map.clear();
     gfx_texture_cache.lru.clear();
+    gfx_texture_cache.by_addr.clear();
+    gfx_texture_cache.by_content.clear();
+    gfx_texture_cache.aliases.clear();
+    gfx_texture_cache.resident_bytes = 0;
+}
+
+// Removes an entry, its texture id is reused by the next import unless other entries alias it
+static void gfx_texture_cache_erase(TextureCacheMap::iterator it) {
+    TextureCacheNode* node = &*it;
+    auto range = gfx_texture_cache.by_addr.equal_range(it->first.texture_addr);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+        if (entry->second == node) {
+            gfx_texture_cache.by_addr.erase(entry);
+            break;
+        }
+    }
+
+    // An entry aliasing the same texture inherits it, along with its place in the content index and its size
+    TextureCacheNode* heir = nullptr;
+    auto alias = gfx_texture_cache.aliases.find(node->second.texture_id);
+    if (alias != gfx_texture_cache.aliases.end()) {
+        std::vector<TextureCacheNode*>& sharing = alias->second;
+        sharing.erase(std::find(sharing.begin(), sharing.end(), node));
+        heir = sharing.front();
+        if (sharing.size() == 1) {
+            gfx_texture_cache.aliases.erase(alias);
+        }
+    }
+    if (node->second.content_hash != 0) {
+        auto content = gfx_texture_cache.by_content.find(node->second.content_hash);
+        if (content != gfx_texture_cache.by_content.end() && content->second == node) {
+            if (heir != nullptr) {
+                content->second = heir;
+            } else {
+                gfx_texture_cache.by_content.erase(content);
+            }
+        }
+    }
+
+    if (node->second.atlas_page != 0) {
+        texture_atlas.pages[node->second.atlas_page - 1].live_entries--;
+    }
+
+    gfx_texture_cache.lru.erase(it->second.lru_location);
+    if (heir != nullptr) {
+        heir->second.upload_bytes += it->second.upload_bytes;
+    } else {
+        gfx_texture_cache.free_texture_ids.push_back(it->second.texture_id);
+        gfx_texture_cache.resident_bytes -= it->second.upload_bytes;
+    }
+    gfx_texture_cache.map.erase(it);
+}
+
+// Copies the sampler parameters just set for an entry to the other entries sharing its texture
+static void gfx_texture_cache_sync_sampler(TextureCacheNode* node) {
+    auto alias = gfx_texture_cache.aliases.find(node->second.texture_id);
+    if (alias == gfx_texture_cache.aliases.end()) {
+        return;
+    }
+    for (TextureCacheNode* other : alias->second) {
+        other->second.linear_filter = node->second.linear_filter;
+        other->second.cms = node->second.cms;
+        other->second.cmt = node->second.cmt;
+    }
+}
+
+// Points the entry just created for slot i at the texture of a cached entry with the same content hash instead of
+// uploading its own. Returns false and indexes the entry when there is no such texture yet.
+static bool gfx_texture_cache_alias(int i, uint64_t content_hash) {
+    TextureCacheNode* node = rendering_state.textures[i];
+    node->second.content_hash = content_hash;
+
+    auto content = gfx_texture_cache.by_content.find(content_hash);
+    if (content == gfx_texture_cache.by_content.end()) {
+        gfx_texture_cache.by_content.emplace(content_hash, node);
+        return false;
+    }
+    TextureCacheNode* source = content->second;
+    if (source->second.pending_decode != nullptr) {
+        return false;
+    }
+
+    gfx_texture_cache.free_texture_ids.push_back(node->second.texture_id);
+    node->second.texture_id = source->second.texture_id;
+    node->second.linear_filter = source->second.linear_filter;
+    node->second.cms = source->second.cms;
+    node->second.cmt = source->second.cmt;
+    if (source->second.atlas_page != 0) {
+        node->second.atlas_page = source->second.atlas_page;
+        node->second.atlas_x = source->second.atlas_x;
+        node->second.atlas_y = source->second.atlas_y;
+        node->second.atlas_width = source->second.atlas_width;
+        node->second.atlas_height = source->second.atlas_height;
+        texture_atlas.pages[node->second.atlas_page - 1].live_entries++;
+    }
+
+    std::vector<TextureCacheNode*>& sharing = gfx_texture_cache.aliases[source->second.texture_id];
+    if (sharing.empty()) {
+        sharing.push_back(source);
+    }
+    sharing.push_back(node);
+
+    gfx_rapi->select_texture(i, node->second.texture_id);
+    texture_atlas.bound[i] = 0;
+    frame_stats.texture_uploads_aliased++;
+    return true;
+}
+
+// Removes the least recently used textures until the cache fits in gTextureCacheBudgetMB. Textures bound for the
+// current draw are the most recently used and are always kept, even when they alone exceed the budget.
+static void gfx_texture_cache_evict() {
+    const size_t budget =
+        (size_t)std::max(CVarGetInteger("gTextureCacheBudgetMB", TEXTURE_CACHE_DEFAULT_BUDGET_MB), 1) << 20;
+    auto next = gfx_texture_cache.lru.begin();
+    while (gfx_texture_cache.resident_bytes > budget && next != gfx_texture_cache.lru.end()) {
+        TextureCacheMap::iterator it = (next++)->it;
+        // Bound textures stay, the next least recently used one goes instead
+        bool bound = false;
+        for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+            bound |= rendering_state.textures[i] == &*it;
+        }
+        if (bound) {
+            continue;
+        }
+        gfx_texture_cache_erase(it);
+        frame_stats.texture_cache_evictions++;
+    }
+}
+
+// Uploads the image of the texture selected in slot i, node being its cache entry
+static void gfx_texture_cache_upload(TextureCacheNode* node, const uint8_t* rgba32_buf, uint32_t width,
+                                     uint32_t height) {
+    gfx_rapi->upload_texture(rgba32_buf, width, height);
+
+    const uint32_t upload_bytes = width * height * 4;
+    gfx_texture_cache.resident_bytes = gfx_texture_cache.resident_bytes - node->second.upload_bytes + upload_bytes;
+    node->second.upload_bytes = upload_bytes;
+    frame_stats.texture_bytes_uploaded += upload_bytes;
+    gfx_texture_cache_evict();
 }
 
 static bool gfx_texture_cache_lookup(int i, const TextureCacheKey& key) {
     TextureCacheMap::iterator it = gfx_texture_cache.map.find(key);
     TextureCacheNode** n = &rendering_state.textures[i];
 
+    texture_atlas.bound[i] = 0;
     if (it != gfx_texture_cache.map.end()) {
         gfx_rapi->select_texture(i, it->second.texture_id);
         *n = &*it;
         gfx_texture_cache.lru.splice(gfx_texture_cache.lru.end(), gfx_texture_cache.lru,
                                      it->second.lru_location); // move to back
+        frame_stats.texture_cache_hits++;
         return true;
     }
-
-    if (gfx_texture_cache.map.size() >= TEXTURE_CACHE_MAX_SIZE) {
-        // Remove the texture that was least recently used
-        it = gfx_texture_cache.lru.front().it;
-        gfx_texture_cache.free_texture_ids.push_back(it->second.texture_id);
-        gfx_texture_cache.map.erase(it);
-        gfx_texture_cache.lru.pop_front();
-    }
+    frame_stats.texture_cache_misses++;
 
     uint32_t texture_id;
     if (!gfx_texture_cache.free_texture_ids.empty()) {
@@ -458,6 +807,7 @@ static bool gfx_texture_cache_lookup(int i, const TextureCacheKey& key) {
     TextureCacheNode* node = &*it;
     node->second.texture_id = texture_id;
     node->second.lru_location = gfx_texture_cache.lru.insert(gfx_texture_cache.lru.end(), { it });
+    gfx_texture_cache.by_addr.emplace(key.texture_addr, node);
 
     gfx_rapi->select_texture(i, texture_id);
     gfx_rapi->set_sampler_parameters(i, false, 0, 0);
@@ -465,7 +815,74 @@ static bool gfx_texture_cache_lookup(int i, const TextureCacheKey& key) {
     return false;
 }
 
-static std::string gfx_get_base_texture_path(const std::string& path) {
+// Finds room for a w by h copy in page, starting a new shelf when the current one is full
+static bool gfx_texture_atlas_place(TextureAtlasPage& page, uint32_t w, uint32_t h, uint16_t* x, uint16_t* y) {
+    if (page.live_entries == 0) {
+        page.shelf_x = page.shelf_y = page.shelf_height = 0;
+    }
+    if (page.shelf_x + w > TEXTURE_ATLAS_PAGE_SIZE) {
+        page.shelf_x = 0;
+        page.shelf_y += page.shelf_height;
+        page.shelf_height = 0;
+    }
+    if (page.shelf_y + h > TEXTURE_ATLAS_PAGE_SIZE) {
+        return false;
+    }
+    *x = page.shelf_x;
+    *y = page.shelf_y;
+    page.shelf_x += w;
+    page.shelf_height = std::max<uint16_t>(page.shelf_height, h);
+    return true;
+}
+
+// Copies a texture that was just uploaded for node into an atlas page, when it is small enough and a page has room
+static void gfx_texture_atlas_insert(TextureCacheNode* node, const uint8_t* rgba32_buf, uint32_t width,
+                                     uint32_t height) {
+    if (!CVarGetInteger("gTextureAtlas", 0) || node->second.atlas_page != 0 || width == 0 || height == 0 ||
+        width > TEXTURE_ATLAS_MAX_TEXTURE_SIZE || height > TEXTURE_ATLAS_MAX_TEXTURE_SIZE) {
+        return;
+    }
+
+    const uint32_t padded_width = width + 2 * TEXTURE_ATLAS_PADDING;
+    const uint32_t padded_height = height + 2 * TEXTURE_ATLAS_PADDING;
+    uint16_t x, y;
+    size_t index = 0;
+    while (index < texture_atlas.pages.size() &&
+           !gfx_texture_atlas_place(texture_atlas.pages[index], padded_width, padded_height, &x, &y)) {
+        index++;
+    }
+    if (index == texture_atlas.pages.size()) {
+        if (index == TEXTURE_ATLAS_MAX_PAGES) {
+            return;
+        }
+        TextureAtlasPage& page = texture_atlas.pages.emplace_back();
+        page.texture_id = gfx_rapi->new_texture();
+        page.pixels.resize(TEXTURE_ATLAS_PAGE_SIZE * TEXTURE_ATLAS_PAGE_SIZE * 4);
+        gfx_texture_atlas_place(page, padded_width, padded_height, &x, &y);
+    }
+
+    TextureAtlasPage& page = texture_atlas.pages[index];
+    for (uint32_t row = 0; row < padded_height; row++) {
+        int32_t src_row = std::clamp<int32_t>((int32_t)row - TEXTURE_ATLAS_PADDING, 0, height - 1);
+        const uint8_t* src = rgba32_buf + src_row * width * 4;
+        uint8_t* dst = page.pixels.data() + ((y + row) * TEXTURE_ATLAS_PAGE_SIZE + x) * 4;
+        for (uint32_t col = 0; col < TEXTURE_ATLAS_PADDING; col++) {
+            memcpy(dst + col * 4, src, 4);
+            memcpy(dst + (TEXTURE_ATLAS_PADDING + width + col) * 4, src + (width - 1) * 4, 4);
+        }
+        memcpy(dst + TEXTURE_ATLAS_PADDING * 4, src, width * 4);
+    }
+    page.dirty = true;
+    page.live_entries++;
+
+    node->second.atlas_page = index + 1;
+    node->second.atlas_x = x + TEXTURE_ATLAS_PADDING;
+    node->second.atlas_y = y + TEXTURE_ATLAS_PADDING;
+    node->second.atlas_width = width;
+    node->second.atlas_height = height;
+}
+
+static std::string_view gfx_get_base_texture_path(std::string_view path) {
     if (path.starts_with(Ship::IResource::gAltAssetPrefix)) {
         return path.substr(Ship::IResource::gAltAssetPrefix.length());
     }
@@ -474,283 +891,164 @@ static std::string gfx_get_base_texture_path(const std::string& path) {
 }
 
 void gfx_texture_cache_delete(const uint8_t* orig_addr) {
-    while (gfx_texture_cache.map.bucket_count() > 0) {
-        TextureCacheKey key = { orig_addr, { 0 }, 0, 0, 0 }; // bucket index only depends on the address
-        size_t bucket = gfx_texture_cache.map.bucket(key);
-        bool again = false;
-        for (auto it = gfx_texture_cache.map.begin(bucket); it != gfx_texture_cache.map.end(bucket); ++it) {
-            if (it->first.texture_addr == orig_addr) {
-                gfx_texture_cache.lru.erase(it->second.lru_location);
-                gfx_texture_cache.free_texture_ids.push_back(it->second.texture_id);
-                gfx_texture_cache.map.erase(it->first);
-                again = true;
-                break;
-            }
-        }
-        if (!again) {
-            break;
-        }
-    }
-}
+    for (auto entry = gfx_texture_cache.by_addr.find(orig_addr); entry != gfx_texture_cache.by_addr.end();
+         entry = gfx_texture_cache.by_addr.find(orig_addr)) {
+        gfx_texture_cache_erase(gfx_texture_cache.map.find(entry->second->first));
+    }
+}
+
+// Everything the decoders read, captured when a texture is imported so the decode can also run on a worker thread
+struct TextureDecodeParams {
+    const uint8_t* addr;
+    uint8_t fmt, siz;
+    uint8_t palette_index;
+    uint32_t tex_flags;
+    uint32_t size_bytes, orig_size_bytes;
+    uint32_t full_image_line_size_bytes, line_size_bytes;
+    uint32_t tile_line_size_bytes;
+    const uint8_t* palettes[2];
+    RawTexMetadata metadata;
+};
 
-static void import_texture_rgba16(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+// The pixels to upload, either the decoder's output buffer or the source data when it can be uploaded as is
+struct DecodedTexture {
+    const uint8_t* pixels;
+    uint32_t width, height;
+};
+
+static DecodedTexture decode_texture_rgba16(const TextureDecodeParams& p, uint8_t* out) {
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
     // SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    uint32_t width = g_rdp.texture_tile[tile].line_size_bytes / 2;
-    uint32_t height = size_bytes / g_rdp.texture_tile[tile].line_size_bytes;
+    uint32_t width = p.tile_line_size_bytes / 2;
+    uint32_t height = size_bytes / p.tile_line_size_bytes;
 
     // A single line of pixels should not equal the entire image (height == 1 non-withstanding)
     if (full_image_line_size_bytes == size_bytes)
         full_image_line_size_bytes = width * 2;
 
-    uint32_t i = 0;
-
     for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            uint32_t clrIdx = (y * (full_image_line_size_bytes / 2)) + (x);
-
-            uint16_t col16 = (addr[2 * clrIdx] << 8) | addr[2 * clrIdx + 1];
-            uint8_t a = col16 & 1;
-            uint8_t r = col16 >> 11;
-            uint8_t g = (col16 >> 6) & 0x1f;
-            uint8_t b = (col16 >> 1) & 0x1f;
-            tex_upload_buffer[4 * i + 0] = SCALE_5_8(r);
-            tex_upload_buffer[4 * i + 1] = SCALE_5_8(g);
-            tex_upload_buffer[4 * i + 2] = SCALE_5_8(b);
-            tex_upload_buffer[4 * i + 3] = a ? 255 : 0;
-
-            i++;
-        }
+        gfx_decode_rgba16(addr + y * (full_image_line_size_bytes / 2) * 2, out + 4 * y * width, width);
     }
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_rgba32(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+static DecodedTexture decode_texture_rgba32(const TextureDecodeParams& p, uint8_t* out) {
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    uint32_t width = g_rdp.texture_tile[tile].line_size_bytes / 2;
-    uint32_t height = (size_bytes / 2) / g_rdp.texture_tile[tile].line_size_bytes;
-    gfx_rapi->upload_texture(addr, width, height);
+    uint32_t width = p.tile_line_size_bytes / 2;
+    uint32_t height = (size_bytes / 2) / p.tile_line_size_bytes;
+    return { addr, width, height };
 }
 
-static void import_texture_ia4(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+static DecodedTexture decode_texture_ia4(const TextureDecodeParams& p, uint8_t* out) {
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes * 2; i++) {
-        uint8_t byte = addr[i / 2];
-        uint8_t part = (byte >> (4 - (i % 2) * 4)) & 0xf;
-        uint8_t intensity = part >> 1;
-        uint8_t alpha = part & 1;
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        tex_upload_buffer[4 * i + 0] = SCALE_3_8(r);
-        tex_upload_buffer[4 * i + 1] = SCALE_3_8(g);
-        tex_upload_buffer[4 * i + 2] = SCALE_3_8(b);
-        tex_upload_buffer[4 * i + 3] = alpha ? 255 : 0;
-    }
+    gfx_decode_ia4(addr, out, size_bytes * 2);
 
-    uint32_t width = g_rdp.texture_tile[tile].line_size_bytes * 2;
-    uint32_t height = size_bytes / g_rdp.texture_tile[tile].line_size_bytes;
+    uint32_t width = p.tile_line_size_bytes * 2;
+    uint32_t height = size_bytes / p.tile_line_size_bytes;
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_ia8(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+static DecodedTexture decode_texture_ia8(const TextureDecodeParams& p, uint8_t* out) {
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes; i++) {
-        uint8_t intensity = addr[i] >> 4;
-        uint8_t alpha = addr[i] & 0xf;
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        tex_upload_buffer[4 * i + 0] = SCALE_4_8(r);
-        tex_upload_buffer[4 * i + 1] = SCALE_4_8(g);
-        tex_upload_buffer[4 * i + 2] = SCALE_4_8(b);
-        tex_upload_buffer[4 * i + 3] = SCALE_4_8(alpha);
-    }
+    gfx_decode_ia8(addr, out, size_bytes);
 
-    uint32_t width = g_rdp.texture_tile[tile].line_size_bytes;
-    uint32_t height = size_bytes / g_rdp.texture_tile[tile].line_size_bytes;
+    uint32_t width = p.tile_line_size_bytes;
+    uint32_t height = size_bytes / p.tile_line_size_bytes;
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_ia16(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+static DecodedTexture decode_texture_ia16(const TextureDecodeParams& p, uint8_t* out) {
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes / 2; i++) {
-        uint8_t intensity = addr[2 * i];
-        uint8_t alpha = addr[2 * i + 1];
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        tex_upload_buffer[4 * i + 0] = r;
-        tex_upload_buffer[4 * i + 1] = g;
-        tex_upload_buffer[4 * i + 2] = b;
-        tex_upload_buffer[4 * i + 3] = alpha;
-    }
+    gfx_decode_ia16(addr, out, size_bytes / 2);
 
-    uint32_t width = g_rdp.texture_tile[tile].line_size_bytes / 2;
-    uint32_t height = size_bytes / g_rdp.texture_tile[tile].line_size_bytes;
+    uint32_t width = p.tile_line_size_bytes / 2;
+    uint32_t height = size_bytes / p.tile_line_size_bytes;
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_i4(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+static DecodedTexture decode_texture_i4(const TextureDecodeParams& p, uint8_t* out) {
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
     // SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes * 2; i++) {
-        uint8_t byte = addr[i / 2];
-        uint8_t part = (byte >> (4 - (i % 2) * 4)) & 0xf;
-        uint8_t intensity = part;
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        uint8_t a = intensity;
-        tex_upload_buffer[4 * i + 0] = SCALE_4_8(r);
-        tex_upload_buffer[4 * i + 1] = SCALE_4_8(g);
-        tex_upload_buffer[4 * i + 2] = SCALE_4_8(b);
-        tex_upload_buffer[4 * i + 3] = SCALE_4_8(a);
-    }
+    gfx_decode_i4(addr, out, size_bytes * 2);
 
-    uint32_t width = g_rdp.texture_tile[tile].line_size_bytes * 2;
-    uint32_t height = size_bytes / g_rdp.texture_tile[tile].line_size_bytes;
+    uint32_t width = p.tile_line_size_bytes * 2;
+    uint32_t height = size_bytes / p.tile_line_size_bytes;
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_i8(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+static DecodedTexture decode_texture_i8(const TextureDecodeParams& p, uint8_t* out) {
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
     // SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes; i++) {
-        uint8_t intensity = addr[i];
-        uint8_t r = intensity;
-        uint8_t g = intensity;
-        uint8_t b = intensity;
-        uint8_t a = intensity;
-        tex_upload_buffer[4 * i + 0] = r;
-        tex_upload_buffer[4 * i + 1] = g;
-        tex_upload_buffer[4 * i + 2] = b;
-        tex_upload_buffer[4 * i + 3] = a;
-    }
+    gfx_decode_i8(addr, out, size_bytes);
 
-    uint32_t width = g_rdp.texture_tile[tile].line_size_bytes;
-    uint32_t height = size_bytes / g_rdp.texture_tile[tile].line_size_bytes;
+    uint32_t width = p.tile_line_size_bytes;
+    uint32_t height = size_bytes / p.tile_line_size_bytes;
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_ci4(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
-    uint32_t pal_idx = g_rdp.texture_tile[tile].palette; // 0-15
+static DecodedTexture decode_texture_ci4(const TextureDecodeParams& p, uint8_t* out) {
+    const RawTexMetadata* metadata = &p.metadata;
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
+    uint32_t pal_idx = p.palette_index; // 0-15
 
     uint8_t* palette = nullptr;
-    // const uint8_t* palette = g_rdp.palettes[pal_idx / 8] + (pal_idx % 8) * 16 * 2; // 16 pixel entries, 16 bits each
+    // const uint8_t* palette = p.palettes[pal_idx / 8] + (pal_idx % 8) * 16 * 2; // 16 pixel entries, 16 bits each
 
     if (pal_idx > 7)
-        palette = (uint8_t*)g_rdp.palettes[pal_idx / 8]; // 16 pixel entries, 16 bits each
+        palette = (uint8_t*)p.palettes[pal_idx / 8]; // 16 pixel entries, 16 bits each
     else
-        palette = (uint8_t*)(g_rdp.palettes[pal_idx / 8] + (pal_idx % 8) * 16 * 2);
+        palette = (uint8_t*)(p.palettes[pal_idx / 8] + (pal_idx % 8) * 16 * 2);
 
     SUPPORT_CHECK(full_image_line_size_bytes == line_size_bytes);
 
-    for (uint32_t i = 0; i < size_bytes * 2; i++) {
-        uint8_t byte = addr[i / 2];
-        uint8_t idx = (byte >> (4 - (i % 2) * 4)) & 0xf;
-        uint16_t col16 = (palette[idx * 2] << 8) | palette[idx * 2 + 1]; // Big endian load
-        uint8_t a = col16 & 1;
-        uint8_t r = col16 >> 11;
-        uint8_t g = (col16 >> 6) & 0x1f;
-        uint8_t b = (col16 >> 1) & 0x1f;
-        tex_upload_buffer[4 * i + 0] = SCALE_5_8(r);
-        tex_upload_buffer[4 * i + 1] = SCALE_5_8(g);
-        tex_upload_buffer[4 * i + 2] = SCALE_5_8(b);
-        tex_upload_buffer[4 * i + 3] = a ? 255 : 0;
-    }
-
-    uint32_t result_line_size = g_rdp.texture_tile[tile].line_size_bytes;
+    bool used[16] = {};
+    uint32_t lut[16];
+    gfx_mark_ci4_indices(addr, size_bytes * 2, used);
+    gfx_decode_palette_rgba16(palette, used, 16, lut);
+    gfx_decode_ci4(addr, lut, out, size_bytes * 2);
+
+    uint32_t result_line_size = p.tile_line_size_bytes;
     if (metadata->h_byte_scale != 1) {
         result_line_size *= metadata->h_byte_scale;
     }
@@ -758,38 +1056,30 @@ static void import_texture_ci4(int tile, bool importReplacement) {
     uint32_t width = result_line_size * 2;
     uint32_t height = size_bytes / result_line_size;
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_ci8(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
-    uint32_t size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
-
-    for (uint32_t i = 0, j = 0; i < size_bytes; j += full_image_line_size_bytes - line_size_bytes) {
-        for (uint32_t k = 0; k < line_size_bytes; i++, k++, j++) {
-            uint8_t idx = addr[j];
-            uint16_t col16 = (g_rdp.palettes[idx / 128][(idx % 128) * 2] << 8) |
-                             g_rdp.palettes[idx / 128][(idx % 128) * 2 + 1]; // Big endian load
-            uint8_t a = col16 & 1;
-            uint8_t r = col16 >> 11;
-            uint8_t g = (col16 >> 6) & 0x1f;
-            uint8_t b = (col16 >> 1) & 0x1f;
-            tex_upload_buffer[4 * i + 0] = SCALE_5_8(r);
-            tex_upload_buffer[4 * i + 1] = SCALE_5_8(g);
-            tex_upload_buffer[4 * i + 2] = SCALE_5_8(b);
-            tex_upload_buffer[4 * i + 3] = a ? 255 : 0;
-        }
+static DecodedTexture decode_texture_ci8(const TextureDecodeParams& p, uint8_t* out) {
+    const RawTexMetadata* metadata = &p.metadata;
+    const uint8_t* addr = p.addr;
+    uint32_t size_bytes = p.size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
+
+    // Entries 0-127 come from the first palette and 128-255 from the second
+    bool used[256] = {};
+    uint32_t lut[256];
+    for (uint32_t i = 0, j = 0; i < size_bytes; i += line_size_bytes, j += full_image_line_size_bytes) {
+        gfx_mark_ci8_indices(addr + j, line_size_bytes, used);
+    }
+    gfx_decode_palette_rgba16(p.palettes[0], used, 128, lut);
+    gfx_decode_palette_rgba16(p.palettes[1], used + 128, 128, lut + 128);
+
+    for (uint32_t i = 0, j = 0; i < size_bytes; i += line_size_bytes, j += full_image_line_size_bytes) {
+        gfx_decode_ci8(addr + j, lut, out + 4 * i, line_size_bytes);
     }
 
-    uint32_t result_line_size = g_rdp.texture_tile[tile].line_size_bytes;
+    uint32_t result_line_size = p.tile_line_size_bytes;
     if (metadata->h_byte_scale != 1) {
         result_line_size *= metadata->h_byte_scale;
     }
@@ -797,16 +1087,12 @@ static void import_texture_ci8(int tile, bool importReplacement) {
     uint32_t width = result_line_size;
     uint32_t height = size_bytes / result_line_size;
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    return { out, width, height };
 }
 
-static void import_texture_raw(int tile, bool importReplacement) {
-    const RawTexMetadata* metadata = &g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata;
-    const uint8_t* addr =
-        importReplacement && (metadata->resource != nullptr)
-            ? masked_textures.find(gfx_get_base_texture_path(metadata->resource->GetInitData()->Path))
-                  ->second.replacementData
-            : g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr;
+static DecodedTexture decode_texture_raw(const TextureDecodeParams& p, uint8_t* out) {
+    const RawTexMetadata* metadata = &p.metadata;
+    const uint8_t* addr = p.addr;
 
     uint16_t width = metadata->width;
     uint16_t height = metadata->height;
@@ -816,20 +1102,18 @@ static void import_texture_raw(int tile, bool importReplacement) {
     // if texture type is CI4 or CI8 we need to apply tlut to it
     switch (type) {
         case LUS::TextureType::Palette4bpp:
-            import_texture_ci4(tile, importReplacement);
-            return;
+            return decode_texture_ci4(p, out);
         case LUS::TextureType::Palette8bpp:
-            import_texture_ci8(tile, importReplacement);
-            return;
+            return decode_texture_ci8(p, out);
         default:
             break;
     }
 
-    uint32_t num_loaded_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].size_bytes;
-    uint32_t num_originally_loaded_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].orig_size_bytes;
+    uint32_t num_loaded_bytes = p.size_bytes;
+    uint32_t num_originally_loaded_bytes = p.orig_size_bytes;
 
-    uint32_t result_orig_line_size = g_rdp.texture_tile[tile].line_size_bytes;
-    switch (g_rdp.texture_tile[tile].siz) {
+    uint32_t result_orig_line_size = p.tile_line_size_bytes;
+    switch (p.siz) {
         case G_IM_SIZ_32b:
             result_orig_line_size *= 2;
             break;
@@ -840,13 +1124,11 @@ static void import_texture_raw(int tile, bool importReplacement) {
 
     if (result_new_line_size == 4 * width && result_new_height == height) {
         // Can use the texture directly since it has the correct dimensions
-        gfx_rapi->upload_texture(addr, width, height);
-        return;
+        return { addr, width, height };
     }
 
-    uint32_t full_image_line_size_bytes =
-        g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].full_image_line_size_bytes;
-    uint32_t line_size_bytes = g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].line_size_bytes;
+    uint32_t full_image_line_size_bytes = p.full_image_line_size_bytes;
+    uint32_t line_size_bytes = p.line_size_bytes;
 
     // Get the resource's true image size
     uint32_t resource_image_size_bytes = resource->ImageDataSize;
@@ -866,15 +1148,257 @@ static void import_texture_raw(int tile, bool importReplacement) {
     // Safely only copy the amount of bytes the resource can allow
     for (uint32_t i = 0, j = 0; i < safe_loaded_bytes;
          i += safe_line_size_bytes, j += safe_full_image_line_size_bytes) {
-        memcpy(tex_upload_buffer + i, addr + j, safe_line_size_bytes);
+        memcpy(out + i, addr + j, safe_line_size_bytes);
     }
 
     // Set the remaining bytes to load as 0
     if (num_loaded_bytes > resource_image_size_bytes) {
-        memset(tex_upload_buffer + resource_image_size_bytes, 0, num_loaded_bytes - resource_image_size_bytes);
+        memset(out + resource_image_size_bytes, 0, num_loaded_bytes - resource_image_size_bytes);
     }
 
-    gfx_rapi->upload_texture(tex_upload_buffer, result_new_line_size / 4, result_new_height);
+    return { out, result_new_line_size / 4, result_new_height };
+}
+
+static DecodedTexture decode_texture(const TextureDecodeParams& p, uint8_t* out) {
+    // if load as raw is set then we load_raw();
+    if ((p.tex_flags & TEX_FLAG_LOAD_AS_RAW) != 0) {
+        return decode_texture_raw(p, out);
+    }
+
+    if (p.fmt == G_IM_FMT_RGBA) {
+        if (p.siz == G_IM_SIZ_16b) {
+            return decode_texture_rgba16(p, out);
+        } else if (p.siz == G_IM_SIZ_32b) {
+            return decode_texture_rgba32(p, out);
+        } else {
+            // abort(); // OTRTODO: Sometimes, seemingly randomly, we end up here. Could be a bad dlist, could be
+            // something F3D does not have supported. Further investigation is needed.
+            return { nullptr, 0, 0 };
+        }
+    } else if (p.fmt == G_IM_FMT_IA) {
+        if (p.siz == G_IM_SIZ_4b) {
+            return decode_texture_ia4(p, out);
+        } else if (p.siz == G_IM_SIZ_8b) {
+            return decode_texture_ia8(p, out);
+        } else if (p.siz == G_IM_SIZ_16b) {
+            return decode_texture_ia16(p, out);
+        }
+    } else if (p.fmt == G_IM_FMT_CI) {
+        if (p.siz == G_IM_SIZ_4b) {
+            return decode_texture_ci4(p, out);
+        } else if (p.siz == G_IM_SIZ_8b) {
+            return decode_texture_ci8(p, out);
+        }
+    } else if (p.fmt == G_IM_FMT_I) {
+        if (p.siz == G_IM_SIZ_4b) {
+            return decode_texture_i4(p, out);
+        } else if (p.siz == G_IM_SIZ_8b) {
+            return decode_texture_i8(p, out);
+        }
+    }
+    abort();
+}
+
+struct TextureDecodeJob {
+    TextureDecodeParams params;
+    std::vector<uint8_t> buffer;
+    DecodedTexture result;
+    std::shared_future<void> done;
+    uint32_t queued_frame;
+};
+
+// gfx_texture_predecode may be called from any thread, including resource loading threads and before gfx_init
+static struct {
+    std::once_flag pool_created;
+    std::unique_ptr<BS::thread_pool> pool;
+    // Speculative decodes of whole Texture resources, keyed by image data and adopted by the first matching import
+    std::mutex predecoded_mutex;
+    std::unordered_map<const uint8_t*, std::shared_ptr<TextureDecodeJob>> predecoded;
+    // Advanced by the render thread at the start of every frame
+    std::atomic<uint32_t> frame;
+} texture_decoder;
+
+// Hash of the bytes the decoder reads combined with every other decode input, or 0 when the texture can't be
+// deduplicated. Palettes are identified by address; their contents are not hashed since a TLUT may be shorter than
+// the entries the texture could reference.
+static uint64_t gfx_texture_content_hash(const TextureDecodeParams& p) {
+    if ((p.tex_flags & TEX_FLAG_LOAD_AS_RAW) != 0 || p.tile_line_size_bytes == 0 || p.line_size_bytes == 0) {
+        return 0;
+    }
+
+    uint32_t source_bytes = p.size_bytes;
+    if (p.fmt == G_IM_FMT_RGBA && p.siz == G_IM_SIZ_16b) {
+        uint32_t width = p.tile_line_size_bytes / 2;
+        uint32_t height = p.size_bytes / p.tile_line_size_bytes;
+        uint32_t stride = p.full_image_line_size_bytes == p.size_bytes ? width * 2 : p.full_image_line_size_bytes;
+        source_bytes = height == 0 ? 0 : (height - 1) * (stride / 2) * 2 + width * 2;
+    } else if (p.fmt == G_IM_FMT_RGBA && p.siz == G_IM_SIZ_32b) {
+        source_bytes = (p.tile_line_size_bytes / 2) * ((p.size_bytes / 2) / p.tile_line_size_bytes) * 4;
+    } else if (p.fmt == G_IM_FMT_CI && p.siz == G_IM_SIZ_8b) {
+        uint32_t rows = (p.size_bytes + p.line_size_bytes - 1) / p.line_size_bytes;
+        source_bytes = (rows - 1) * p.full_image_line_size_bytes + p.line_size_bytes;
+    }
+    if (source_bytes == 0) {
+        return 0;
+    }
+
+    uint64_t inputs[] = { gfx_hash_texels(p.addr, source_bytes),
+                          p.fmt | (p.siz << 8) | (p.palette_index << 16) | ((uint64_t)p.tex_flags << 32),
+                          p.size_bytes | ((uint64_t)p.orig_size_bytes << 32),
+                          p.full_image_line_size_bytes | ((uint64_t)p.line_size_bytes << 32),
+                          p.tile_line_size_bytes,
+                          p.fmt == G_IM_FMT_CI ? (uintptr_t)p.palettes[0] : 0,
+                          p.fmt == G_IM_FMT_CI ? (uintptr_t)p.palettes[1] : 0 };
+    uint64_t hash = gfx_hash_texels((const uint8_t*)inputs, sizeof(inputs));
+    return hash != 0 ? hash : 1;
+}
+
+// Game memory and palettes may change before a worker gets to the texture, resource data is immutable and the params
+// keep the resource alive. Replacement data can be unregistered at any time, so it's decoded synchronously too.
+static bool gfx_texture_can_decode_async(const TextureDecodeParams& p, bool importReplacement) {
+    return !importReplacement && p.metadata.resource != nullptr && p.fmt != G_IM_FMT_CI &&
+           p.metadata.type != LUS::TextureType::Palette4bpp && p.metadata.type != LUS::TextureType::Palette8bpp;
+}
+
+static bool gfx_texture_decode_inputs_equal(const TextureDecodeParams& a, const TextureDecodeParams& b) {
+    return a.addr == b.addr && a.fmt == b.fmt && a.siz == b.siz && a.tex_flags == b.tex_flags &&
+           a.size_bytes == b.size_bytes && a.orig_size_bytes == b.orig_size_bytes &&
+           a.full_image_line_size_bytes == b.full_image_line_size_bytes && a.line_size_bytes == b.line_size_bytes &&
+           a.tile_line_size_bytes == b.tile_line_size_bytes;
+}
+
+static std::shared_ptr<TextureDecodeJob> gfx_texture_decode_async(const TextureDecodeParams& params) {
+    std::call_once(texture_decoder.pool_created, [] {
+        texture_decoder.pool = std::make_unique<BS::thread_pool>(std::max(1u, std::thread::hardware_concurrency() / 2));
+    });
+
+    auto job = std::make_shared<TextureDecodeJob>();
+    job->params = params;
+    // Upper bound of what any decoder writes, 4 bit formats expand every byte to 8 and rows may overshoot by a line
+    job->buffer.resize(8 * ((size_t)params.size_bytes + params.line_size_bytes));
+    job->queued_frame = texture_decoder.frame;
+    job->done = texture_decoder.pool
+                    ->submit_back([job] { job->result = decode_texture(job->params, job->buffer.data()); })
+                    .share();
+    return job;
+}
+
+static std::shared_ptr<TextureDecodeJob> gfx_texture_take_predecoded(const TextureDecodeParams& params) {
+    std::lock_guard<std::mutex> lock(texture_decoder.predecoded_mutex);
+    auto it = texture_decoder.predecoded.find(params.addr);
+    if (it == texture_decoder.predecoded.end() || !gfx_texture_decode_inputs_equal(it->second->params, params)) {
+        return nullptr;
+    }
+    std::shared_ptr<TextureDecodeJob> job = std::move(it->second);
+    texture_decoder.predecoded.erase(it);
+    return job;
+}
+
+void gfx_texture_predecode(const std::shared_ptr<LUS::Texture>& texture) {
+    uint8_t fmt, siz;
+    switch (texture->Type) {
+        case LUS::TextureType::RGBA16bpp:
+            fmt = G_IM_FMT_RGBA;
+            siz = G_IM_SIZ_16b;
+            break;
+        case LUS::TextureType::Grayscale4bpp:
+            fmt = G_IM_FMT_I;
+            siz = G_IM_SIZ_4b;
+            break;
+        case LUS::TextureType::Grayscale8bpp:
+            fmt = G_IM_FMT_I;
+            siz = G_IM_SIZ_8b;
+            break;
+        case LUS::TextureType::GrayscaleAlpha4bpp:
+            fmt = G_IM_FMT_IA;
+            siz = G_IM_SIZ_4b;
+            break;
+        case LUS::TextureType::GrayscaleAlpha8bpp:
+            fmt = G_IM_FMT_IA;
+            siz = G_IM_SIZ_8b;
+            break;
+        case LUS::TextureType::GrayscaleAlpha16bpp:
+            fmt = G_IM_FMT_IA;
+            siz = G_IM_SIZ_16b;
+            break;
+        default:
+            // RGBA32 is uploaded without decoding and palette textures depend on the TLUT loaded when they're drawn
+            return;
+    }
+    if (texture->ImageData == nullptr || (texture->Flags & TEX_FLAG_LOAD_AS_RAW) != 0) {
+        return;
+    }
+
+    // Predict the import of the whole image loaded with a single LoadBlock, which is how most textures are loaded
+    const uint32_t line_bytes = siz == G_IM_SIZ_4b ? texture->Width / 2 : texture->Width << (siz - G_IM_SIZ_8b);
+    TextureDecodeParams params = {};
+    params.addr = texture->ImageData;
+    params.fmt = fmt;
+    params.siz = siz;
+    params.tex_flags = texture->Flags;
+    params.size_bytes = texture->ImageDataSize;
+    params.orig_size_bytes = texture->ImageDataSize;
+    params.full_image_line_size_bytes = texture->ImageDataSize;
+    params.line_size_bytes = texture->ImageDataSize;
+    params.tile_line_size_bytes = (line_bytes + 7) & ~7;
+    params.metadata = { texture->Width, texture->Height, texture->HByteScale, texture->VPixelScale, texture,
+                        texture->Type };
+
+    {
+        std::lock_guard<std::mutex> lock(texture_decoder.predecoded_mutex);
+        if (texture_decoder.predecoded.count(params.addr) != 0) {
+            return;
+        }
+    }
+    std::shared_ptr<TextureDecodeJob> job = gfx_texture_decode_async(params);
+    std::lock_guard<std::mutex> lock(texture_decoder.predecoded_mutex);
+    texture_decoder.predecoded.emplace(params.addr, std::move(job));
+}
+
+// Drops speculative decodes nothing adopted, they hold on to their resource
+static void gfx_texture_decode_start_frame(void) {
+    const uint32_t frame = ++texture_decoder.frame;
+    std::lock_guard<std::mutex> lock(texture_decoder.predecoded_mutex);
+    for (auto it = texture_decoder.predecoded.begin(); it != texture_decoder.predecoded.end();) {
+        if (frame - it->second->queued_frame > TEXTURE_PREDECODE_MAX_AGE) {
+            it = texture_decoder.predecoded.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Uploads the result of an asynchronous decode. In placeholder mode this only uploads once the worker is done,
+// otherwise it waits for the worker.
+static void gfx_texture_finish_decode(int i, TextureCacheNode* node) {
+    TextureDecodeJob& job = *node->second.pending_decode;
+    if (CVarGetInteger("gAsyncTextureDecoding", 0) == 2 &&
+        job.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    job.done.wait();
+
+    gfx_flush();
+    gfx_rapi->select_texture(i, node->second.texture_id);
+    texture_atlas.bound[i] = 0;
+    if (job.result.pixels != nullptr) {
+        gfx_texture_cache_upload(node, job.result.pixels, job.result.width, job.result.height);
+        gfx_texture_atlas_insert(node, job.result.pixels, job.result.width, job.result.height);
+    }
+    node->second.pending_decode = nullptr;
+}
+
+// Key of the texture loaded for tile, with its data at addr
+static TextureCacheKey gfx_texture_cache_key(int tile, const uint8_t* addr) {
+    const auto& texture_tile = g_rdp.texture_tile[tile];
+    const uint32_t orig_size_bytes = g_rdp.loaded_texture[texture_tile.tmem_index].orig_size_bytes;
+    TextureCacheKey key = { addr, {}, texture_tile.fmt, texture_tile.siz, texture_tile.palette, orig_size_bytes,
+                            texture_tile.line_size_bytes };
+    if (texture_tile.fmt == G_IM_FMT_CI) {
+        key.palette_addrs[0] = g_rdp.palettes[0];
+        key.palette_addrs[1] = g_rdp.palettes[1];
+    }
+    return key;
 }
 
 static void import_texture(int i, int tile, bool importReplacement) {
@@ -892,60 +1416,58 @@ static void import_texture(int i, int tile, bool importReplacement) {
                   ->second.replacementData
             : g_rdp.loaded_texture[tmem_index].addr;
 
-    TextureCacheKey key;
-    if (fmt == G_IM_FMT_CI) {
-        key = { orig_addr, { g_rdp.palettes[0], g_rdp.palettes[1] }, fmt, siz, palette_index, orig_size_bytes };
-    } else {
-        key = { orig_addr, {}, fmt, siz, palette_index, orig_size_bytes };
-    }
+    const uint32_t line_size_bytes = g_rdp.texture_tile[tile].line_size_bytes;
+    TextureCacheKey key = gfx_texture_cache_key(tile, orig_addr);
 
     if (gfx_texture_cache_lookup(i, key)) {
         return;
     }
 
-    // if load as raw is set then we load_raw();
-    if ((texFlags & TEX_FLAG_LOAD_AS_RAW) != 0) {
-        import_texture_raw(tile, importReplacement);
-        return;
+    TextureDecodeParams params;
+    params.addr = orig_addr;
+    params.fmt = fmt;
+    params.siz = siz;
+    params.palette_index = palette_index;
+    params.tex_flags = texFlags;
+    params.size_bytes = g_rdp.loaded_texture[tmem_index].size_bytes;
+    params.orig_size_bytes = orig_size_bytes;
+    params.full_image_line_size_bytes = g_rdp.loaded_texture[tmem_index].full_image_line_size_bytes;
+    params.line_size_bytes = g_rdp.loaded_texture[tmem_index].line_size_bytes;
+    params.tile_line_size_bytes = line_size_bytes;
+    params.palettes[0] = g_rdp.palettes[0];
+    params.palettes[1] = g_rdp.palettes[1];
+    params.metadata = *metadata;
+
+    // gTextureContentDedup: reuse the texture of a cached entry with identical source data loaded from elsewhere
+    if (CVarGetInteger("gTextureContentDedup", 0)) {
+        uint64_t content_hash = gfx_texture_content_hash(params);
+        if (content_hash != 0 && gfx_texture_cache_alias(i, content_hash)) {
+            return;
+        }
     }
 
-    if (fmt == G_IM_FMT_RGBA) {
-        if (siz == G_IM_SIZ_16b) {
-            import_texture_rgba16(tile, importReplacement);
-        } else if (siz == G_IM_SIZ_32b) {
-            import_texture_rgba32(tile, importReplacement);
-        } else {
-            // abort(); // OTRTODO: Sometimes, seemingly randomly, we end up here. Could be a bad dlist, could be
-            // something F3D does not have supported. Further investigation is needed.
+    // gAsyncTextureDecoding: 1 decodes on a worker and waits for it at the first draw, 2 draws with a placeholder
+    // until the worker is done
+    const int async_mode = CVarGetInteger("gAsyncTextureDecoding", 0);
+    if (async_mode != 0 && gfx_texture_can_decode_async(params, importReplacement)) {
+        TextureCacheNode* node = rendering_state.textures[i];
+        node->second.pending_decode = gfx_texture_take_predecoded(params);
+        if (node->second.pending_decode == nullptr) {
+            node->second.pending_decode = gfx_texture_decode_async(params);
         }
-    } else if (fmt == G_IM_FMT_IA) {
-        if (siz == G_IM_SIZ_4b) {
-            import_texture_ia4(tile, importReplacement);
-        } else if (siz == G_IM_SIZ_8b) {
-            import_texture_ia8(tile, importReplacement);
-        } else if (siz == G_IM_SIZ_16b) {
-            import_texture_ia16(tile, importReplacement);
-        } else {
-            abort();
+        if (async_mode == 2) {
+            static const uint8_t placeholder[4] = { 0x80, 0x80, 0x80, 0xFF };
+            gfx_texture_cache_upload(node, placeholder, 1, 1);
         }
-    } else if (fmt == G_IM_FMT_CI) {
-        if (siz == G_IM_SIZ_4b) {
-            import_texture_ci4(tile, importReplacement);
-        } else if (siz == G_IM_SIZ_8b) {
-            import_texture_ci8(tile, importReplacement);
-        } else {
-            abort();
-        }
-    } else if (fmt == G_IM_FMT_I) {
-        if (siz == G_IM_SIZ_4b) {
-            import_texture_i4(tile, importReplacement);
-        } else if (siz == G_IM_SIZ_8b) {
-            import_texture_i8(tile, importReplacement);
-        } else {
-            abort();
+        return;
+    }
+
+    DecodedTexture decoded = decode_texture(params, tex_upload_buffer);
+    if (decoded.pixels != nullptr) {
+        gfx_texture_cache_upload(rendering_state.textures[i], decoded.pixels, decoded.width, decoded.height);
+        if (!importReplacement) {
+            gfx_texture_atlas_insert(rendering_state.textures[i], decoded.pixels, decoded.width, decoded.height);
         }
-    } else {
-        abort();
     }
 }
 
@@ -968,7 +1490,7 @@ static void import_texture_mask(int i, int tile) {
         return;
     }
 
-    TextureCacheKey key = { orig_addr, {}, 0, 0, 0, 0 };
+    TextureCacheKey key = { orig_addr, {}, 0, 0, 0, 0, g_rdp.texture_tile[tile].line_size_bytes };
 
     if (gfx_texture_cache_lookup(i, key)) {
         return;
@@ -1007,7 +1529,60 @@ static void import_texture_mask(int i, int tile) {
         }
     }
 
-    gfx_rapi->upload_texture(tex_upload_buffer, width, height);
+    gfx_texture_cache_upload(rendering_state.textures[i], tex_upload_buffer, width, height);
+}
+
+// Switches slot i to the texture loaded for tile without ending the batch, when that texture is cached with a copy
+// on the atlas page the slot already draws from. gfx_texture_atlas_select still checks the triangle against the copy.
+static bool gfx_texture_atlas_reuse(int i, int tile) {
+    if (texture_atlas.bound[i] == 0 || g_rdp.loaded_texture[i].masked || g_rdp.loaded_texture[i].blended) {
+        return false;
+    }
+
+    auto it = gfx_texture_cache.map.find(
+        gfx_texture_cache_key(tile, g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr));
+    if (it == gfx_texture_cache.map.end() || it->second.atlas_page != texture_atlas.bound[i] ||
+        it->second.pending_decode != nullptr) {
+        return false;
+    }
+
+    rendering_state.textures[i] = &*it;
+    gfx_texture_cache.lru.splice(gfx_texture_cache.lru.end(), gfx_texture_cache.lru, it->second.lru_location);
+    frame_stats.texture_cache_hits++;
+    return true;
+}
+
+// Binds the atlas page holding the texture of slot i when use_atlas is set, otherwise makes sure the texture itself
+// is bound. Returns whether the page is used, in which case the page's sampler parameters are already set.
+static bool gfx_texture_atlas_select(int i, bool use_atlas, bool linear_filter) {
+    TextureCacheNode* node = rendering_state.textures[i];
+    texture_atlas.active[i] = use_atlas;
+    if (!use_atlas) {
+        if (texture_atlas.bound[i] != 0) {
+            gfx_flush();
+            gfx_rapi->select_texture(i, node->second.texture_id);
+            texture_atlas.bound[i] = 0;
+        }
+        return false;
+    }
+
+    TextureAtlasPage& page = texture_atlas.pages[node->second.atlas_page - 1];
+    if (texture_atlas.bound[i] != node->second.atlas_page || page.dirty) {
+        gfx_flush();
+        gfx_rapi->select_texture(i, page.texture_id);
+        if (page.dirty) {
+            gfx_rapi->upload_texture(page.pixels.data(), TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE);
+            page.dirty = false;
+        }
+        texture_atlas.bound[i] = node->second.atlas_page;
+    }
+    if (!page.sampler_valid || page.linear_filter != linear_filter) {
+        gfx_flush();
+        gfx_rapi->set_sampler_parameters(i, linear_filter, G_TX_CLAMP, G_TX_CLAMP);
+        page.linear_filter = linear_filter;
+        page.sampler_valid = true;
+    }
+    return true;
 }
 
 static void gfx_normalize_vector(float v[3]) {
@@ -1017,12 +1592,6 @@ static void gfx_normalize_vector(float v[3]) {
     v[2] /= s;
 }
 
-static void gfx_transposed_matrix_mul(float res[3], const float a[3], const float b[4][4]) {
-    res[0] = a[0] * b[0][0] + a[1] * b[0][1] + a[2] * b[0][2];
-    res[1] = a[0] * b[1][0] + a[1] * b[1][1] + a[2] * b[1][2];
-    res[2] = a[0] * b[2][0] + a[1] * b[2][1] + a[2] * b[2][2];
-}
-
 static void calculate_normal_dir(const Light_t* light, float coeffs[3]) {
     float light_dir[3] = { light->dir[0] / 127.0f, light->dir[1] / 127.0f, light->dir[2] / 127.0f };
 
@@ -1030,19 +1599,7 @@ static void calculate_normal_dir(const Light_t* light, float coeffs[3]) {
     gfx_normalize_vector(coeffs);
 }
 
-static void gfx_matrix_mul(float res[4][4], const float a[4][4], const float b[4][4]) {
-    float tmp[4][4];
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            tmp[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
-        }
-    }
-    memcpy(res, tmp, sizeof(tmp));
-}
-
-static void gfx_sp_matrix(uint8_t parameters, const int32_t* addr) {
-    float matrix[4][4];
-
+static void gfx_sp_decode_matrix(const int32_t* addr, float matrix[4][4]) {
     if (auto it = current_mtx_replacements->find((Mtx*)addr); it != current_mtx_replacements->end()) {
         for (int i = 0; i < 4; i++) {
             for (int j = 0; j < 4; j++) {
@@ -1064,13 +1621,26 @@ static void gfx_sp_matrix(uint8_t parameters, const int32_t* addr) {
         }
 #else
         // For a modified GBI where fixed point values are replaced with floats
-        memcpy(matrix, addr, sizeof(matrix));
+        memcpy(matrix, addr, 16 * sizeof(float));
 #endif
     }
+}
+
+static void gfx_sp_matrix(uint8_t parameters, const int32_t* addr) {
+    // Mtx is 64 bytes, so consecutive matrices of a pool land in consecutive entries
+    auto& cached = matrix_cache.entries[((uintptr_t)addr / sizeof(Mtx)) % MATRIX_CACHE_SIZE];
+    if (cached.addr != addr || cached.generation != matrix_cache.generation ||
+        memcmp(&cached.source, addr, sizeof(Mtx)) != 0) {
+        gfx_sp_decode_matrix(addr, cached.matrix);
+        cached.addr = addr;
+        cached.generation = matrix_cache.generation;
+        memcpy(&cached.source, addr, sizeof(Mtx));
+    }
+    const float(*matrix)[4] = cached.matrix;
 
     if (parameters & G_MTX_PROJECTION) {
         if (parameters & G_MTX_LOAD) {
-            memcpy(g_rsp.P_matrix, matrix, sizeof(matrix));
+            memcpy(g_rsp.P_matrix, matrix, sizeof(g_rsp.P_matrix));
         } else {
             gfx_matrix_mul(g_rsp.P_matrix, matrix, g_rsp.P_matrix);
         }
@@ -1078,35 +1648,42 @@ static void gfx_sp_matrix(uint8_t parameters, const int32_t* addr) {
         if ((parameters & G_MTX_PUSH) && g_rsp.modelview_matrix_stack_size < 11) {
             ++g_rsp.modelview_matrix_stack_size;
             memcpy(g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1],
-                   g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 2], sizeof(matrix));
+                   g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 2],
+                   sizeof(g_rsp.modelview_matrix_stack[0]));
         }
         if (parameters & G_MTX_LOAD) {
             if (g_rsp.modelview_matrix_stack_size == 0)
                 ++g_rsp.modelview_matrix_stack_size;
-            memcpy(g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1], matrix, sizeof(matrix));
+            memcpy(g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1], matrix,
+                   sizeof(g_rsp.modelview_matrix_stack[0]));
         } else {
             gfx_matrix_mul(g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1], matrix,
                            g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1]);
         }
         g_rsp.lights_changed = 1;
     }
-    gfx_matrix_mul(g_rsp.MP_matrix, g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1],
-                   g_rsp.P_matrix);
+    g_rsp.MP_matrix_dirty = true;
 }
 
 static void gfx_sp_pop_matrix(uint32_t count) {
     while (count--) {
         if (g_rsp.modelview_matrix_stack_size > 0) {
             --g_rsp.modelview_matrix_stack_size;
-            if (g_rsp.modelview_matrix_stack_size > 0) {
-                gfx_matrix_mul(g_rsp.MP_matrix, g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1],
-                               g_rsp.P_matrix);
-            }
+            g_rsp.MP_matrix_dirty = true;
         }
     }
     g_rsp.lights_changed = true;
 }
 
+// Matrix loads and pops only mark MP_matrix dirty, since games often set several matrices before drawing anything
+static void gfx_sp_update_mp_matrix(void) {
+    if (g_rsp.MP_matrix_dirty && g_rsp.modelview_matrix_stack_size > 0) {
+        gfx_matrix_mul(g_rsp.MP_matrix, g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1],
+                       g_rsp.P_matrix);
+    }
+    g_rsp.MP_matrix_dirty = false;
+}
+
 static float gfx_adjust_x_for_aspect_ratio(float x) {
     if (fbActive) {
         return x;
@@ -1129,124 +1706,238 @@ static void gfx_adjust_width_height_for_scale(uint32_t& width, uint32_t& height,
     }
 }
 
-static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx* vertices) {
-    for (size_t i = 0; i < n_vertices; i++, dest_index++) {
-        const Vtx_t* v = &vertices[i].v;
-        const Vtx_tn* vn = &vertices[i].n;
-        struct LoadedVertex* d = &g_rsp.loaded_vertices[dest_index];
+// Memoized output of gfx_sp_vertex, enabled with the gVertexMemoization CVar. Entries are keyed by the source vertex
+// pointer, the vertex count and a hash of all RSP state the transform reads. A copy of the source vertices is kept
+// and compared on lookup, so vertex data rewritten in place or a resource reloaded at the same address is never served
+// stale output.
+struct VertexMemoKey {
+    const Vtx* vertices;
+    size_t count;
+    uint64_t state_hash;
 
-        if (v == NULL) {
-            return;
+    bool operator==(const VertexMemoKey&) const noexcept = default;
+
+    struct Hasher {
+        size_t operator()(const VertexMemoKey& key) const noexcept {
+            uintptr_t addr = (uintptr_t)key.vertices;
+            return (size_t)((addr ^ (addr >> 5)) ^ key.state_hash ^ (key.count << 3));
         }
+    };
+};
+
+struct VertexMemoEntry {
+    std::vector<Vtx> source;
+    std::vector<LoadedVertex> result;
+    uint32_t last_used_frame;
+    list<VertexMemoKey>::iterator lru_location;
+};
+
+static struct {
+    std::unordered_map<VertexMemoKey, VertexMemoEntry, VertexMemoKey::Hasher> map;
+    // Keys from least to most recently used
+    list<VertexMemoKey> lru;
+    size_t bytes;
+    uint32_t frame;
+    bool enabled;
+} vertex_memo;
+
+static uint64_t gfx_hash_bytes(uint64_t hash, const void* data, size_t size) {
+    // FNV-1a
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t gfx_vertex_memo_state_hash() {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = gfx_hash_bytes(hash, g_rsp.MP_matrix, sizeof(g_rsp.MP_matrix));
+    hash = gfx_hash_bytes(hash, &g_rsp.geometry_mode, sizeof(g_rsp.geometry_mode));
+    hash = gfx_hash_bytes(hash, &g_rsp.texture_scaling_factor, sizeof(g_rsp.texture_scaling_factor));
+    hash = gfx_hash_bytes(hash, &g_rsp.fog_mul, sizeof(g_rsp.fog_mul));
+    hash = gfx_hash_bytes(hash, &g_rsp.fog_offset, sizeof(g_rsp.fog_offset));
+
+    // Inputs of gfx_adjust_x_for_aspect_ratio
+    hash = gfx_hash_bytes(hash, &fbActive, sizeof(fbActive));
+    hash = gfx_hash_bytes(hash, &gfx_current_dimensions.width, sizeof(gfx_current_dimensions.width));
+    hash = gfx_hash_bytes(hash, &gfx_current_dimensions.height, sizeof(gfx_current_dimensions.height));
+
+    if (g_rsp.geometry_mode & G_LIGHTING) {
+        hash = gfx_hash_bytes(hash, &g_rsp.current_num_lights, sizeof(g_rsp.current_num_lights));
+        hash = gfx_hash_bytes(hash, g_rsp.current_lights, sizeof(Light) * g_rsp.current_num_lights);
+        hash = gfx_hash_bytes(hash, g_rsp.current_lights_coeffs, sizeof(g_rsp.current_lights_coeffs));
+        hash = gfx_hash_bytes(hash, g_rsp.current_lookat_coeffs, sizeof(g_rsp.current_lookat_coeffs));
+    }
+    if (g_rsp.geometry_mode & G_LIGHTING_POSITIONAL) {
+        hash = gfx_hash_bytes(hash, g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1],
+                              sizeof(g_rsp.modelview_matrix_stack[0]));
+    }
+    return hash;
+}
+
+static bool gfx_vertex_memo_restore(const VertexMemoKey& key, size_t dest_index) {
+    auto it = vertex_memo.map.find(key);
+    if (it == vertex_memo.map.end() ||
+        memcmp(it->second.source.data(), key.vertices, key.count * sizeof(Vtx)) != 0) {
+        frame_stats.vertex_memo_misses++;
+        return false;
+    }
+
+    memcpy(&g_rsp.loaded_vertices[dest_index], it->second.result.data(), key.count * sizeof(LoadedVertex));
+    it->second.last_used_frame = vertex_memo.frame;
+    vertex_memo.lru.splice(vertex_memo.lru.end(), vertex_memo.lru, it->second.lru_location);
+    frame_stats.vertex_memo_hits++;
+    return true;
+}
+
+static void gfx_vertex_memo_erase_oldest() {
+    const VertexMemoKey key = vertex_memo.lru.front();
+    vertex_memo.lru.pop_front();
+    vertex_memo.bytes -= key.count * (sizeof(Vtx) + sizeof(LoadedVertex));
+    vertex_memo.map.erase(key);
+}
+
+static void gfx_vertex_memo_store(const VertexMemoKey& key, size_t dest_index) {
+    auto [it, inserted] = vertex_memo.map.try_emplace(key);
+    VertexMemoEntry& entry = it->second;
+    if (inserted) {
+        entry.lru_location = vertex_memo.lru.insert(vertex_memo.lru.end(), key);
+        vertex_memo.bytes += key.count * (sizeof(Vtx) + sizeof(LoadedVertex));
+    } else {
+        vertex_memo.lru.splice(vertex_memo.lru.end(), vertex_memo.lru, entry.lru_location);
+    }
+    entry.source.assign(key.vertices, key.vertices + key.count);
+    entry.result.assign(&g_rsp.loaded_vertices[dest_index], &g_rsp.loaded_vertices[dest_index + key.count]);
+    entry.last_used_frame = vertex_memo.frame;
+
+    // The entry just stored is the most recently used, so it is only dropped if it alone exceeds the limit
+    while (vertex_memo.bytes > VERTEX_MEMO_MAX_BYTES) {
+        gfx_vertex_memo_erase_oldest();
+    }
+}
+
+static void gfx_vertex_memo_start_frame() {
+    vertex_memo.enabled = CVarGetInteger("gVertexMemoization", 0);
+    vertex_memo.frame++;
 
-        float x = v->ob[0] * g_rsp.MP_matrix[0][0] + v->ob[1] * g_rsp.MP_matrix[1][0] +
-                  v->ob[2] * g_rsp.MP_matrix[2][0] + g_rsp.MP_matrix[3][0];
-        float y = v->ob[0] * g_rsp.MP_matrix[0][1] + v->ob[1] * g_rsp.MP_matrix[1][1] +
-                  v->ob[2] * g_rsp.MP_matrix[2][1] + g_rsp.MP_matrix[3][1];
-        float z = v->ob[0] * g_rsp.MP_matrix[0][2] + v->ob[1] * g_rsp.MP_matrix[1][2] +
-                  v->ob[2] * g_rsp.MP_matrix[2][2] + g_rsp.MP_matrix[3][2];
-        float w = v->ob[0] * g_rsp.MP_matrix[0][3] + v->ob[1] * g_rsp.MP_matrix[1][3] +
-                  v->ob[2] * g_rsp.MP_matrix[2][3] + g_rsp.MP_matrix[3][3];
-
-        float world_pos[3];
-        if (g_rsp.geometry_mode & G_LIGHTING_POSITIONAL) {
-            float(*mtx)[4] = g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1];
-            world_pos[0] = v->ob[0] * mtx[0][0] + v->ob[1] * mtx[1][0] + v->ob[2] * mtx[2][0] + mtx[3][0];
-            world_pos[1] = v->ob[0] * mtx[0][1] + v->ob[1] * mtx[1][1] + v->ob[2] * mtx[2][1] + mtx[3][1];
-            world_pos[2] = v->ob[0] * mtx[0][2] + v->ob[1] * mtx[1][2] + v->ob[2] * mtx[2][2] + mtx[3][2];
+    if (!vertex_memo.enabled) {
+        vertex_memo.map.clear();
+        vertex_memo.lru.clear();
+        vertex_memo.bytes = 0;
+        return;
+    }
+
+    while (!vertex_memo.lru.empty() &&
+           vertex_memo.frame - vertex_memo.map.find(vertex_memo.lru.front())->second.last_used_frame >
+               VERTEX_MEMO_MAX_AGE) {
+        gfx_vertex_memo_erase_oldest();
+    }
+}
+
+// Fills in the lights for gfx_light_vertices from the current ones, the last of which is the ambient light
+static int gfx_collect_vertex_lights(GfxVertexLight* lights, uint8_t ambient[3]) {
+    const int num_lights = g_rsp.current_num_lights - 1;
+    for (int i = 0; i < num_lights; i++) {
+        const Light* light = &g_rsp.current_lights[i];
+        for (int j = 0; j < 3; j++) {
+            lights[i].dir[j] = g_rsp.current_lights_coeffs[i][j];
+            lights[i].color[j] = light->l.col[j];
+            lights[i].pos[j] = light->p.pos[j];
         }
+        lights[i].positional = (g_rsp.geometry_mode & G_LIGHTING_POSITIONAL) && light->p.unk3 != 0;
+        lights[i].linear_attenuation = light->p.unk7 * 2.0f;
+        lights[i].quadratic_attenuation = light->p.unkE / 8.0f;
+    }
+    for (int j = 0; j < 3; j++) {
+        ambient[j] = g_rsp.current_lights[num_lights].l.col[j];
+    }
+    return num_lights;
+}
 
-        x = gfx_adjust_x_for_aspect_ratio(x);
+static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx* vertices) {
+    float clip_pos[GFX_VERTEX_BATCH_SIZE][4];
+    float eye_pos[GFX_VERTEX_BATCH_SIZE][4];
+    uint8_t lit_colors[GFX_VERTEX_BATCH_SIZE][3];
+    float texgen_dots[GFX_VERTEX_BATCH_SIZE][2];
 
-        short U = v->tc[0] * g_rsp.texture_scaling_factor.s >> 16;
-        short V = v->tc[1] * g_rsp.texture_scaling_factor.t >> 16;
+    if (vertices == NULL) {
+        return;
+    }
 
-        if (g_rsp.geometry_mode & G_LIGHTING) {
-            if (g_rsp.lights_changed) {
-                for (int i = 0; i < g_rsp.current_num_lights - 1; i++) {
-                    calculate_normal_dir(&g_rsp.current_lights[i].l, g_rsp.current_lights_coeffs[i]);
-                }
-                /*static const Light_t lookat_x = {{0, 0, 0}, 0, {0, 0, 0}, 0, {127, 0, 0}, 0};
-                static const Light_t lookat_y = {{0, 0, 0}, 0, {0, 0, 0}, 0, {0, 127, 0}, 0};*/
-                calculate_normal_dir(&g_rsp.lookat[0], g_rsp.current_lookat_coeffs[0]);
-                calculate_normal_dir(&g_rsp.lookat[1], g_rsp.current_lookat_coeffs[1]);
-                g_rsp.lights_changed = false;
-            }
+    current_emit_generation++;
+    gfx_sp_update_mp_matrix();
 
-            int r = g_rsp.current_lights[g_rsp.current_num_lights - 1].l.col[0];
-            int g = g_rsp.current_lights[g_rsp.current_num_lights - 1].l.col[1];
-            int b = g_rsp.current_lights[g_rsp.current_num_lights - 1].l.col[2];
-
-            for (int i = 0; i < g_rsp.current_num_lights - 1; i++) {
-                float intensity = 0;
-                if ((g_rsp.geometry_mode & G_LIGHTING_POSITIONAL) && (g_rsp.current_lights[i].p.unk3 != 0)) {
-                    // Calculate distance from the light to the vertex
-                    float dist_vec[3] = { g_rsp.current_lights[i].p.pos[0] - world_pos[0],
-                                          g_rsp.current_lights[i].p.pos[1] - world_pos[1],
-                                          g_rsp.current_lights[i].p.pos[2] - world_pos[2] };
-                    float dist_sq =
-                        dist_vec[0] * dist_vec[0] + dist_vec[1] * dist_vec[1] +
-                        dist_vec[2] * dist_vec[2] * 2; // The *2 comes from GLideN64, unsure of why it does it
-                    float dist = sqrt(dist_sq);
-
-                    // Transform distance vector (which acts as a direction light vector) into model's space
-                    float light_model[3];
-                    gfx_transposed_matrix_mul(light_model, dist_vec,
-                                              g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1]);
-
-                    // Calculate intensity for each axis using standard formula for intensity
-                    float light_intensity[3];
-                    for (int light_i = 0; light_i < 3; light_i++) {
-                        light_intensity[light_i] = 4.0f * light_model[light_i] / dist_sq;
-                        light_intensity[light_i] = clamp(light_intensity[light_i], -1.0f, 1.0f);
-                    }
+    if ((g_rsp.geometry_mode & G_LIGHTING) && g_rsp.lights_changed) {
+        for (int i = 0; i < g_rsp.current_num_lights - 1; i++) {
+            calculate_normal_dir(&g_rsp.current_lights[i].l, g_rsp.current_lights_coeffs[i]);
+        }
+        /*static const Light_t lookat_x = {{0, 0, 0}, 0, {0, 0, 0}, 0, {127, 0, 0}, 0};
+        static const Light_t lookat_y = {{0, 0, 0}, 0, {0, 0, 0}, 0, {0, 127, 0}, 0};*/
+        calculate_normal_dir(&g_rsp.lookat[0], g_rsp.current_lookat_coeffs[0]);
+        calculate_normal_dir(&g_rsp.lookat[1], g_rsp.current_lookat_coeffs[1]);
+        g_rsp.lights_changed = false;
+    }
+
+    VertexMemoKey memo_key;
+    const bool memoize = vertex_memo.enabled && dest_index + n_vertices <= MAX_VERTICES + 4;
+    const size_t first_dest_index = dest_index;
+    if (memoize) {
+        memo_key = { vertices, n_vertices, gfx_vertex_memo_state_hash() };
+        if (gfx_vertex_memo_restore(memo_key, dest_index)) {
+            return;
+        }
+    }
 
-                    // Adjust intensity based on surface normal and sum up total
-                    float total_intensity =
-                        light_intensity[0] * vn->n[0] + light_intensity[1] * vn->n[1] + light_intensity[2] * vn->n[2];
-                    total_intensity = clamp(total_intensity, -1.0f, 1.0f);
-
-                    // Attenuate intensity based on attenuation values.
-                    // Example formula found at https://ogldev.org/www/tutorial20/tutorial20.html
-                    // Specific coefficients for MM's microcode sourced from GLideN64
-                    // https://github.com/gonetz/GLideN64/blob/3b43a13a80dfc2eb6357673440b335e54eaa3896/src/gSP.cpp#L636
-                    float distf = floorf(dist);
-                    float attenuation = (distf * g_rsp.current_lights[i].p.unk7 * 2.0f +
-                                         distf * distf * g_rsp.current_lights[i].p.unkE / 8.0f) /
-                                            (float)0xFFFF +
-                                        1.0f;
-                    intensity = total_intensity / attenuation;
-                } else {
-                    intensity += vn->n[0] * g_rsp.current_lights_coeffs[i][0];
-                    intensity += vn->n[1] * g_rsp.current_lights_coeffs[i][1];
-                    intensity += vn->n[2] * g_rsp.current_lights_coeffs[i][2];
-                    intensity /= 127.0f;
-                }
-                if (intensity > 0.0f) {
-                    r += intensity * g_rsp.current_lights[i].l.col[0];
-                    g += intensity * g_rsp.current_lights[i].l.col[1];
-                    b += intensity * g_rsp.current_lights[i].l.col[2];
+    const float(*modelview)[4] = g_rsp.modelview_matrix_stack[g_rsp.modelview_matrix_stack_size - 1];
+    GfxVertexLight lights[MAX_LIGHTS];
+    int num_lights = 0;
+    uint8_t ambient[3];
+    if (g_rsp.geometry_mode & G_LIGHTING) {
+        num_lights = gfx_collect_vertex_lights(lights, ambient);
+    }
+
+    for (size_t i = 0; i < n_vertices; i++, dest_index++) {
+        const Vtx_t* v = &vertices[i].v;
+        struct LoadedVertex* d = &g_rsp.loaded_vertices[dest_index];
+
+        // Positions, lighting and the texgen dot products are computed a batch at a time ahead of the per vertex
+        // texture coordinates and clipping below
+        const size_t batch_index = i % GFX_VERTEX_BATCH_SIZE;
+        if (batch_index == 0) {
+            const size_t batch_size = std::min<size_t>(GFX_VERTEX_BATCH_SIZE, n_vertices - i);
+            gfx_transform_vertex_positions(g_rsp.MP_matrix, &vertices[i], batch_size, clip_pos);
+            if (g_rsp.geometry_mode & G_LIGHTING_POSITIONAL) {
+                gfx_transform_vertex_positions(modelview, &vertices[i], batch_size, eye_pos);
+            }
+            if (g_rsp.geometry_mode & G_LIGHTING) {
+                gfx_light_vertices(lights, num_lights, ambient, modelview, &vertices[i],
+                                   (g_rsp.geometry_mode & G_LIGHTING_POSITIONAL) ? eye_pos : NULL, batch_size,
+                                   lit_colors);
+                if (g_rsp.geometry_mode & G_TEXTURE_GEN) {
+                    gfx_texgen_vertices(g_rsp.current_lookat_coeffs, &vertices[i], batch_size, texgen_dots);
                 }
             }
+        }
 
-            d->color.r = r > 255 ? 255 : r;
-            d->color.g = g > 255 ? 255 : g;
-            d->color.b = b > 255 ? 255 : b;
+        float x = clip_pos[batch_index][0];
+        float y = clip_pos[batch_index][1];
+        float z = clip_pos[batch_index][2];
+        float w = clip_pos[batch_index][3];
 
-            if (g_rsp.geometry_mode & G_TEXTURE_GEN) {
-                float dotx = 0, doty = 0;
-                dotx += vn->n[0] * g_rsp.current_lookat_coeffs[0][0];
-                dotx += vn->n[1] * g_rsp.current_lookat_coeffs[0][1];
-                dotx += vn->n[2] * g_rsp.current_lookat_coeffs[0][2];
-                doty += vn->n[0] * g_rsp.current_lookat_coeffs[1][0];
-                doty += vn->n[1] * g_rsp.current_lookat_coeffs[1][1];
-                doty += vn->n[2] * g_rsp.current_lookat_coeffs[1][2];
+        x = gfx_adjust_x_for_aspect_ratio(x);
+
+        short U = v->tc[0] * g_rsp.texture_scaling_factor.s >> 16;
+        short V = v->tc[1] * g_rsp.texture_scaling_factor.t >> 16;
 
-                dotx /= 127.0f;
-                doty /= 127.0f;
+        if (g_rsp.geometry_mode & G_LIGHTING) {
+            d->color.r = lit_colors[batch_index][0];
+            d->color.g = lit_colors[batch_index][1];
+            d->color.b = lit_colors[batch_index][2];
 
-                dotx = Ship::Math::clamp(dotx, -1.0f, 1.0f);
-                doty = Ship::Math::clamp(doty, -1.0f, 1.0f);
+            if (g_rsp.geometry_mode & G_TEXTURE_GEN) {
+                float dotx = texgen_dots[batch_index][0];
+                float doty = texgen_dots[batch_index][1];
 
                 if (g_rsp.geometry_mode & G_TEXTURE_GEN_LINEAR) {
                     // Not sure exactly what formula we should use to get accurate values
@@ -1315,6 +2006,10 @@ static void gfx_sp_vertex(size_t n_vertices, size_t dest_index, const Vtx* verti
             d->color.a = v->cn[3];
         }
     }
+
+    if (memoize) {
+        gfx_vertex_memo_store(memo_key, first_dest_index);
+    }
 }
 
 static void gfx_sp_modify_vertex(uint16_t vtx_idx, uint8_t where, uint32_t val) {
@@ -1326,6 +2021,281 @@ static void gfx_sp_modify_vertex(uint16_t vtx_idx, uint8_t where, uint32_t val)
     struct LoadedVertex* v = &g_rsp.loaded_vertices[vtx_idx];
     v->u = s;
     v->v = t;
+    current_emit_generation++;
+}
+
+// Per texture inputs of the vertex emitters, see gfx_emit_texture_coords
+struct VertexEmitTexture {
+    float scale_s, scale_t;
+    float offset_s, offset_t;
+    float bias;
+    float width, height;
+    uint8_t offset;
+};
+
+// Per triangle inputs of the vertex emitters. Everything that does not vary between the three vertices is resolved
+// once into vertex_template, so emitting a vertex copies the template and only patches the per vertex slots.
+struct VertexEmitParams {
+    float vertex_template[48]; // position, 2 textures with clamps, fog, grayscale and 7 RGBA inputs
+    uint8_t stride;
+    bool invert_y;
+    bool z_is_from_0_to_1;
+    VertexEmitTexture textures[2];
+    uint8_t fog_factor_offset;
+    struct {
+        uint8_t offset;
+        uint8_t channel;
+    } shade_slots[28];
+    uint8_t num_shade_slots;
+};
+
+typedef void (*VertexEmitFunc)(const VertexEmitParams& params, const struct LoadedVertex* vtx);
+
+// Factor from vertex texture coordinates to texels for a tile shift. Scaling by a power of two is exact, so folding
+// the /32 and the shift into one factor changes nothing.
+static inline float gfx_texture_coord_scale(uint8_t shift) {
+    return shift <= 10 ? 1.0f / 32.0f / (1 << shift) : (1 << (16 - shift)) / 32.0f;
+}
+
+static inline void gfx_emit_texture_coords(const VertexEmitTexture& tex, const struct LoadedVertex* vtx, float* out) {
+    float u = vtx->u * tex.scale_s;
+    float v = vtx->v * tex.scale_t;
+
+    u -= tex.offset_s;
+    v -= tex.offset_t;
+    u += tex.bias;
+    v += tex.bias;
+
+    out[tex.offset] = u / tex.width;
+    out[tex.offset + 1] = v / tex.height;
+}
+
+// Writes one vertex of the current triangle into buf_vbo. Specialized on the parts of the vertex layout that are
+// fixed by the shader program, so the per vertex work is straight-line stores.
+template <bool kTexture0, bool kTexture1, bool kFog>
+static void gfx_emit_vertex(const VertexEmitParams& params, const struct LoadedVertex* vtx) {
+    float* out = &buf_vbo[buf_vbo_len];
+    memcpy(out, params.vertex_template, params.stride * sizeof(float));
+
+    float z = vtx->z, w = vtx->w;
+    if (params.z_is_from_0_to_1) {
+        z = (z + w) / 2.0f;
+    }
+
+    out[0] = vtx->x;
+    out[1] = params.invert_y ? -vtx->y : vtx->y;
+    out[2] = z;
+    out[3] = w;
+
+    if constexpr (kTexture0) {
+        gfx_emit_texture_coords(params.textures[0], vtx, out);
+    }
+    if constexpr (kTexture1) {
+        gfx_emit_texture_coords(params.textures[1], vtx, out);
+    }
+    if constexpr (kFog) {
+        out[params.fog_factor_offset] = vtx->color.a / 255.0f;
+    }
+
+    const uint8_t* shade = &vtx->color.r;
+    for (uint8_t i = 0; i < params.num_shade_slots; i++) {
+        out[params.shade_slots[i].offset] = shade[params.shade_slots[i].channel] / 255.0f;
+    }
+
+    buf_vbo_len += params.stride;
+}
+
+// Indexed by used texture 0 | used texture 1 << 1 | fog << 2
+static const VertexEmitFunc vertex_emitters[8] = {
+    gfx_emit_vertex<false, false, false>, gfx_emit_vertex<true, false, false>, gfx_emit_vertex<false, true, false>,
+    gfx_emit_vertex<true, true, false>,   gfx_emit_vertex<false, false, true>, gfx_emit_vertex<true, false, true>,
+    gfx_emit_vertex<false, true, true>,   gfx_emit_vertex<true, true, true>,
+};
+
+// Shader program info and emitter for the last shader program gfx_sp_tri1 drew with
+static struct {
+    struct ShaderProgram* prg;
+    uint8_t num_inputs;
+    bool used_textures[2];
+    VertexEmitFunc emit;
+} vertex_emit_shader;
+
+// Everything VertexEmitParams is built from besides the combiner inputs of the vertices. Compared bytewise, so it is
+// zeroed before it is filled in.
+struct VertexEmitKey {
+    const struct ColorCombiner* comb;
+    const struct ShaderProgram* prg;
+    uint32_t tm;
+    struct {
+        uint32_t width, height, width2, height2;
+        uint16_t uls, ult;
+        uint16_t atlas_x, atlas_y;
+        uint8_t shifts, shiftt;
+        bool atlas;
+    } textures[2];
+    struct RGBA prim_color, env_color, fog_color, grayscale_color;
+    uint8_t prim_lod_fraction;
+    bool lod_from_w;
+    bool linear_filter;
+    bool is_rect;
+    bool invert_y;
+    bool z_is_from_0_to_1;
+};
+
+// Params of the last triangle, which the vertices of the current index buffer batch were emitted with. They are
+// rebuilt when the key changes, or on every triangle while they depend on the w of the first vertex.
+static struct {
+    VertexEmitKey key;
+    VertexEmitParams params;
+    bool valid;
+} vertex_emit_cache;
+
+// Resolves a combiner input for the current triangle. Returns nullptr for the shade color, which varies per vertex.
+static const struct RGBA* gfx_resolve_constant_input(uint8_t input, const struct LoadedVertex* v1, struct RGBA& tmp) {
+    memset(&tmp, 0, sizeof(tmp));
+
+    switch (input) {
+            // Note: CCMUX constants and ACMUX constants used here have same value, which is why this works
+            // (except LOD fraction).
+        case G_CCMUX_PRIMITIVE:
+            return &g_rdp.prim_color;
+        case G_CCMUX_SHADE:
+            return nullptr;
+        case G_CCMUX_ENVIRONMENT:
+            return &g_rdp.env_color;
+        case G_CCMUX_PRIMITIVE_ALPHA:
+            tmp.r = tmp.g = tmp.b = g_rdp.prim_color.a;
+            return &tmp;
+        case G_CCMUX_ENV_ALPHA:
+            tmp.r = tmp.g = tmp.b = g_rdp.env_color.a;
+            return &tmp;
+        case G_CCMUX_PRIM_LOD_FRAC:
+            tmp.r = tmp.g = tmp.b = g_rdp.prim_lod_fraction;
+            return &tmp;
+        case G_CCMUX_LOD_FRACTION: {
+            if (g_rdp.other_mode_l & G_TL_LOD) {
+                // "Hack" that works for Bowser - Peach painting
+                float distance_frac = (v1->w - 3000.0f) / 3000.0f;
+                if (distance_frac < 0.0f) {
+                    distance_frac = 0.0f;
+                }
+                if (distance_frac > 1.0f) {
+                    distance_frac = 1.0f;
+                }
+                tmp.r = tmp.g = tmp.b = tmp.a = distance_frac * 255.0f;
+            } else {
+                tmp.r = tmp.g = tmp.b = tmp.a = 255.0f;
+            }
+            return &tmp;
+        }
+        case G_ACMUX_PRIM_LOD_FRAC:
+            tmp.a = g_rdp.prim_lod_fraction;
+            return &tmp;
+        default:
+            return &tmp;
+    }
+}
+
+// Resolves everything that is constant across a triangle into the vertex template and the slots the emitters patch,
+// and stores the result in vertex_emit_cache. The params are zeroed first so they can be compared bytewise.
+static void gfx_build_vertex_emit_params(const struct ColorCombiner* comb, const VertexEmitKey& key,
+                                         const struct LoadedVertex* v1, bool use_alpha, bool use_fog,
+                                         bool use_grayscale) {
+    VertexEmitParams params;
+    memset(&params, 0, sizeof(params));
+    float* vertex_template = params.vertex_template;
+    uint8_t offset = 4;
+    params.invert_y = key.invert_y;
+    params.z_is_from_0_to_1 = key.z_is_from_0_to_1;
+    params.num_shade_slots = 0;
+
+    for (int t = 0; t < 2; t++) {
+        if (!vertex_emit_shader.used_textures[t]) {
+            continue;
+        }
+        const auto& tile = key.textures[t];
+        VertexEmitTexture& tex = params.textures[t];
+
+        tex.scale_s = gfx_texture_coord_scale(tile.shifts);
+        tex.scale_t = gfx_texture_coord_scale(tile.shiftt);
+        tex.offset_s = tile.uls / 4.0f;
+        tex.offset_t = tile.ult / 4.0f;
+        // Linear filter adds 0.5f to the coordinates
+        tex.bias = (key.linear_filter && !key.is_rect) ? 0.5f : 0.0f;
+        tex.width = tile.width;
+        tex.height = tile.height;
+        if (tile.atlas) {
+            // Texel coordinates of the copy in its page
+            tex.offset_s -= tile.atlas_x;
+            tex.offset_t -= tile.atlas_y;
+            tex.width = TEXTURE_ATLAS_PAGE_SIZE;
+            tex.height = TEXTURE_ATLAS_PAGE_SIZE;
+        }
+        tex.offset = offset;
+        offset += 2;
+
+        if (key.tm & (1 << 2 * t)) {
+            vertex_template[offset++] = (tile.width2 - 0.5f) / tile.width;
+        }
+        if (key.tm & (1 << 2 * t + 1)) {
+            vertex_template[offset++] = (tile.height2 - 0.5f) / tile.height;
+        }
+    }
+
+    if (use_fog) {
+        vertex_template[offset++] = key.fog_color.r / 255.0f;
+        vertex_template[offset++] = key.fog_color.g / 255.0f;
+        vertex_template[offset++] = key.fog_color.b / 255.0f;
+        params.fog_factor_offset = offset++; // fog factor (not alpha)
+    }
+
+    if (use_grayscale) {
+        vertex_template[offset++] = key.grayscale_color.r / 255.0f;
+        vertex_template[offset++] = key.grayscale_color.g / 255.0f;
+        vertex_template[offset++] = key.grayscale_color.b / 255.0f;
+        vertex_template[offset++] = key.grayscale_color.a / 255.0f; // lerp interpolation factor (not alpha)
+    }
+
+    bool uses_w = false;
+    for (int j = 0; j < vertex_emit_shader.num_inputs; j++) {
+        struct RGBA tmp;
+        for (int k = 0; k < 1 + (use_alpha ? 1 : 0); k++) {
+            uses_w |= key.lod_from_w && comb->shader_input_mapping[k][j] == G_CCMUX_LOD_FRACTION;
+            const struct RGBA* color = gfx_resolve_constant_input(comb->shader_input_mapping[k][j], v1, tmp);
+            if (k == 0) {
+                if (color == nullptr) {
+                    params.shade_slots[params.num_shade_slots++] = { offset, 0 };
+                    params.shade_slots[params.num_shade_slots++] = { (uint8_t)(offset + 1), 1 };
+                    params.shade_slots[params.num_shade_slots++] = { (uint8_t)(offset + 2), 2 };
+                } else {
+                    vertex_template[offset] = color->r / 255.0f;
+                    vertex_template[offset + 1] = color->g / 255.0f;
+                    vertex_template[offset + 2] = color->b / 255.0f;
+                }
+                offset += 3;
+            } else {
+                if (color != nullptr) {
+                    vertex_template[offset] = color->a / 255.0f;
+                } else if (use_fog) {
+                    // Shade alpha is 100% for fog
+                    vertex_template[offset] = 1.0f;
+                } else {
+                    params.shade_slots[params.num_shade_slots++] = { offset, 3 };
+                }
+                offset++;
+            }
+        }
+    }
+    params.stride = offset;
+
+    // A vertex emitted earlier in the batch can only be shared if it was emitted with the same inputs
+    if (memcmp(&params, &vertex_emit_cache.params, sizeof(params)) != 0) {
+        memcpy(&vertex_emit_cache.params, &params, sizeof(params));
+        current_emit_generation++;
+    }
+    memcpy(&vertex_emit_cache.key, &key, sizeof(key));
+    // The LOD fraction hack reads the w of the first vertex, so those params only hold for this triangle
+    vertex_emit_cache.valid = !uses_w;
 }
 
 static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bool is_rect) {
@@ -1476,17 +2446,24 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
 
     for (int i = 0; i < 2; i++) {
         uint32_t tile = g_rdp.first_tile_index + i;
+        texture_atlas.active[i] = false;
         if (comb->used_textures[i]) {
             if (g_rdp.textures_changed[i]) {
-                gfx_flush();
-                import_texture(i, tile, false);
-                if (g_rdp.loaded_texture[i].masked) {
-                    import_texture_mask(SHADER_FIRST_MASK_TEXTURE + i, tile);
-                }
-                if (g_rdp.loaded_texture[i].blended) {
-                    import_texture(SHADER_FIRST_REPLACEMENT_TEXTURE + i, tile, true);
+                if (!gfx_texture_atlas_reuse(i, tile)) {
+                    gfx_flush();
+                    import_texture(i, tile, false);
+                    if (g_rdp.loaded_texture[i].masked) {
+                        import_texture_mask(SHADER_FIRST_MASK_TEXTURE + i, tile);
+                    }
+                    if (g_rdp.loaded_texture[i].blended) {
+                        import_texture(SHADER_FIRST_REPLACEMENT_TEXTURE + i, tile, true);
+                    }
                 }
                 g_rdp.textures_changed[i] = false;
+                texture_atlas.suspended[i] = false;
+            }
+            if (rendering_state.textures[i]->second.pending_decode != nullptr) {
+                gfx_texture_finish_decode(i, rendering_state.textures[i]);
             }
 
             uint8_t cms = g_rdp.texture_tile[tile].cms;
@@ -1532,8 +2509,30 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
             }
 
             bool linear_filter = (g_rdp.other_mode_h & (3U << G_MDSFT_TEXTFILT)) != G_TF_POINT;
-            if (linear_filter != rendering_state.textures[i]->second.linear_filter ||
-                cms != rendering_state.textures[i]->second.cms || cmt != rendering_state.textures[i]->second.cmt) {
+
+            // The atlas copy clamps like the texture itself as long as the triangle samples within its padding
+            const TextureCacheValue& cached = rendering_state.textures[i]->second;
+            bool use_atlas = cached.atlas_page != 0 && !texture_atlas.suspended[i] &&
+                             CVarGetInteger("gTextureAtlas", 0) && (cms & (G_TX_CLAMP | G_TX_MIRROR)) == G_TX_CLAMP &&
+                             (cmt & (G_TX_CLAMP | G_TX_MIRROR)) == G_TX_CLAMP && !g_rdp.loaded_texture[i].masked &&
+                             !g_rdp.loaded_texture[i].blended && cached.atlas_width == tex_width[i] &&
+                             cached.atlas_height == tex_height[i];
+            if (use_atlas) {
+                const auto& texture_tile = g_rdp.texture_tile[tile];
+                const float scale_s = gfx_texture_coord_scale(texture_tile.shifts);
+                const float scale_t = gfx_texture_coord_scale(texture_tile.shiftt);
+                const float bias = linear_filter && !is_rect ? 0.5f : 0.0f;
+                const float margin = TEXTURE_ATLAS_PADDING - 1;
+                for (int v = 0; v < 3 && use_atlas; v++) {
+                    float s = v_arr[v]->u * scale_s - texture_tile.uls / 4.0f + bias;
+                    float t = v_arr[v]->v * scale_t - texture_tile.ult / 4.0f + bias;
+                    use_atlas = s >= -margin && s <= tex_width[i] + margin && t >= -margin &&
+                                t <= tex_height[i] + margin;
+                }
+            }
+            if (!gfx_texture_atlas_select(i, use_atlas, linear_filter) &&
+                (linear_filter != rendering_state.textures[i]->second.linear_filter ||
+                 cms != rendering_state.textures[i]->second.cms || cmt != rendering_state.textures[i]->second.cmt)) {
                 gfx_flush();
 
                 // Set the same sampler params on the blended texture. Needed for opengl.
@@ -1545,6 +2544,7 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
                 rendering_state.textures[i]->second.linear_filter = linear_filter;
                 rendering_state.textures[i]->second.cms = cms;
                 rendering_state.textures[i]->second.cmt = cmt;
+                gfx_texture_cache_sync_sampler(rendering_state.textures[i]);
             }
         }
     }
@@ -1565,165 +2565,71 @@ static void gfx_sp_tri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx, bo
         gfx_rapi->set_use_alpha(use_alpha);
         rendering_state.alpha_blend = use_alpha;
     }
-    uint8_t num_inputs;
-    bool used_textures[2];
-
-    gfx_rapi->shader_get_info(prg, &num_inputs, used_textures);
+    if (prg != vertex_emit_shader.prg) {
+        gfx_rapi->shader_get_info(prg, &vertex_emit_shader.num_inputs, vertex_emit_shader.used_textures);
+        vertex_emit_shader.emit =
+            vertex_emitters[(vertex_emit_shader.used_textures[0] ? 1 : 0) |
+                            (vertex_emit_shader.used_textures[1] ? 2 : 0) | (use_fog ? 4 : 0)];
+        vertex_emit_shader.prg = prg;
+    }
 
     struct GfxClipParameters clip_parameters = gfx_rapi->get_clip_parameters();
 
-    for (int i = 0; i < 3; i++) {
-        float z = v_arr[i]->z, w = v_arr[i]->w;
-        if (clip_parameters.z_is_from_0_to_1) {
-            z = (z + w) / 2.0f;
-        }
-
-        buf_vbo[buf_vbo_len++] = v_arr[i]->x;
-        buf_vbo[buf_vbo_len++] = clip_parameters.invert_y ? -v_arr[i]->y : v_arr[i]->y;
-        buf_vbo[buf_vbo_len++] = z;
-        buf_vbo[buf_vbo_len++] = w;
-
-        for (int t = 0; t < 2; t++) {
-            if (!used_textures[t]) {
-                continue;
-            }
-            float u = v_arr[i]->u / 32.0f;
-            float v = v_arr[i]->v / 32.0f;
-
-            int shifts = g_rdp.texture_tile[g_rdp.first_tile_index + t].shifts;
-            int shiftt = g_rdp.texture_tile[g_rdp.first_tile_index + t].shiftt;
-            if (shifts != 0) {
-                if (shifts <= 10) {
-                    u /= 1 << shifts;
-                } else {
-                    u *= 1 << (16 - shifts);
-                }
-            }
-            if (shiftt != 0) {
-                if (shiftt <= 10) {
-                    v /= 1 << shiftt;
-                } else {
-                    v *= 1 << (16 - shiftt);
-                }
-            }
-
-            u -= g_rdp.texture_tile[g_rdp.first_tile_index + t].uls / 4.0f;
-            v -= g_rdp.texture_tile[g_rdp.first_tile_index + t].ult / 4.0f;
-
-            if ((g_rdp.other_mode_h & (3U << G_MDSFT_TEXTFILT)) != G_TF_POINT) {
-                // Linear filter adds 0.5f to the coordinates
-                if (!is_rect) {
-                    u += 0.5f;
-                    v += 0.5f;
-                }
-            }
-
-            buf_vbo[buf_vbo_len++] = u / tex_width[t];
-            buf_vbo[buf_vbo_len++] = v / tex_height[t];
-
-            bool clampS = tm & (1 << 2 * t);
-            bool clampT = tm & (1 << 2 * t + 1);
-
-            if (clampS) {
-                buf_vbo[buf_vbo_len++] = (tex_width2[t] - 0.5f) / tex_width[t];
-            }
-
-            if (clampT) {
-                buf_vbo[buf_vbo_len++] = (tex_height2[t] - 0.5f) / tex_height[t];
-            }
+    VertexEmitKey emit_key;
+    memset(&emit_key, 0, sizeof(emit_key));
+    emit_key.comb = comb;
+    emit_key.prg = prg;
+    emit_key.tm = tm;
+    for (int t = 0; t < 2; t++) {
+        if (!vertex_emit_shader.used_textures[t]) {
+            continue;
         }
-
-        if (use_fog) {
-            buf_vbo[buf_vbo_len++] = g_rdp.fog_color.r / 255.0f;
-            buf_vbo[buf_vbo_len++] = g_rdp.fog_color.g / 255.0f;
-            buf_vbo[buf_vbo_len++] = g_rdp.fog_color.b / 255.0f;
-            buf_vbo[buf_vbo_len++] = v_arr[i]->color.a / 255.0f; // fog factor (not alpha)
-        }
-
-        if (use_grayscale) {
-            buf_vbo[buf_vbo_len++] = g_rdp.grayscale_color.r / 255.0f;
-            buf_vbo[buf_vbo_len++] = g_rdp.grayscale_color.g / 255.0f;
-            buf_vbo[buf_vbo_len++] = g_rdp.grayscale_color.b / 255.0f;
-            buf_vbo[buf_vbo_len++] = g_rdp.grayscale_color.a / 255.0f; // lerp interpolation factor (not alpha)
+        const auto& tile = g_rdp.texture_tile[g_rdp.first_tile_index + t];
+        emit_key.textures[t].width = tex_width[t];
+        emit_key.textures[t].height = tex_height[t];
+        emit_key.textures[t].width2 = tex_width2[t];
+        emit_key.textures[t].height2 = tex_height2[t];
+        emit_key.textures[t].uls = tile.uls;
+        emit_key.textures[t].ult = tile.ult;
+        emit_key.textures[t].shifts = tile.shifts;
+        emit_key.textures[t].shiftt = tile.shiftt;
+        if (texture_atlas.active[t]) {
+            emit_key.textures[t].atlas = true;
+            emit_key.textures[t].atlas_x = rendering_state.textures[t]->second.atlas_x;
+            emit_key.textures[t].atlas_y = rendering_state.textures[t]->second.atlas_y;
         }
-
-        for (int j = 0; j < num_inputs; j++) {
-            struct RGBA* color = 0;
-            struct RGBA tmp;
-            for (int k = 0; k < 1 + (use_alpha ? 1 : 0); k++) {
-                switch (comb->shader_input_mapping[k][j]) {
-                        // Note: CCMUX constants and ACMUX constants used here have same value, which is why this works
-                        // (except LOD fraction).
-                    case G_CCMUX_PRIMITIVE:
-                        color = &g_rdp.prim_color;
-                        break;
-                    case G_CCMUX_SHADE:
-                        color = &v_arr[i]->color;
-                        break;
-                    case G_CCMUX_ENVIRONMENT:
-                        color = &g_rdp.env_color;
-                        break;
-                    case G_CCMUX_PRIMITIVE_ALPHA: {
-                        tmp.r = tmp.g = tmp.b = g_rdp.prim_color.a;
-                        color = &tmp;
-                        break;
-                    }
-                    case G_CCMUX_ENV_ALPHA: {
-                        tmp.r = tmp.g = tmp.b = g_rdp.env_color.a;
-                        color = &tmp;
-                        break;
-                    }
-                    case G_CCMUX_PRIM_LOD_FRAC: {
-                        tmp.r = tmp.g = tmp.b = g_rdp.prim_lod_fraction;
-                        color = &tmp;
-                        break;
-                    }
-                    case G_CCMUX_LOD_FRACTION: {
-                        if (g_rdp.other_mode_l & G_TL_LOD) {
-                            // "Hack" that works for Bowser - Peach painting
-                            float distance_frac = (v1->w - 3000.0f) / 3000.0f;
-                            if (distance_frac < 0.0f) {
-                                distance_frac = 0.0f;
-                            }
-                            if (distance_frac > 1.0f) {
-                                distance_frac = 1.0f;
-                            }
-                            tmp.r = tmp.g = tmp.b = tmp.a = distance_frac * 255.0f;
-                        } else {
-                            tmp.r = tmp.g = tmp.b = tmp.a = 255.0f;
-                        }
-                        color = &tmp;
-                        break;
-                    }
-                    case G_ACMUX_PRIM_LOD_FRAC:
-                        tmp.a = g_rdp.prim_lod_fraction;
-                        color = &tmp;
-                        break;
-                    default:
-                        memset(&tmp, 0, sizeof(tmp));
-                        color = &tmp;
-                        break;
-                }
-                if (k == 0) {
-                    buf_vbo[buf_vbo_len++] = color->r / 255.0f;
-                    buf_vbo[buf_vbo_len++] = color->g / 255.0f;
-                    buf_vbo[buf_vbo_len++] = color->b / 255.0f;
-                } else {
-                    if (use_fog && color == &v_arr[i]->color) {
-                        // Shade alpha is 100% for fog
-                        buf_vbo[buf_vbo_len++] = 1.0f;
-                    } else {
-                        buf_vbo[buf_vbo_len++] = color->a / 255.0f;
-                    }
-                }
+    }
+    emit_key.prim_color = g_rdp.prim_color;
+    emit_key.env_color = g_rdp.env_color;
+    emit_key.fog_color = g_rdp.fog_color;
+    emit_key.grayscale_color = g_rdp.grayscale_color;
+    emit_key.prim_lod_fraction = g_rdp.prim_lod_fraction;
+    emit_key.lod_from_w = (g_rdp.other_mode_l & G_TL_LOD) != 0;
+    emit_key.linear_filter = (g_rdp.other_mode_h & (3U << G_MDSFT_TEXTFILT)) != G_TF_POINT;
+    emit_key.is_rect = is_rect;
+    emit_key.invert_y = clip_parameters.invert_y;
+    emit_key.z_is_from_0_to_1 = clip_parameters.z_is_from_0_to_1;
+
+    if (!vertex_emit_cache.valid || memcmp(&emit_key, &vertex_emit_cache.key, sizeof(emit_key)) != 0) {
+        gfx_build_vertex_emit_params(comb, emit_key, v1, use_alpha, use_fog, use_grayscale);
+    }
+    const VertexEmitParams& params = vertex_emit_cache.params;
+
+    if (gfx_rapi->draw_triangles_indexed != nullptr) {
+        const uint8_t vtx_indices[3] = { vtx1_idx, vtx2_idx, vtx3_idx };
+        for (int i = 0; i < 3; i++) {
+            const uint8_t idx = vtx_indices[i];
+            if (emitted_vertex_generation[idx] != current_emit_generation) {
+                emitted_vertex_generation[idx] = current_emit_generation;
+                emitted_vertex_index[idx] = buf_vbo_num_verts++;
+                vertex_emit_shader.emit(params, v_arr[i]);
             }
+            buf_ibo[buf_ibo_len++] = emitted_vertex_index[idx];
+        }
+    } else {
+        for (int i = 0; i < 3; i++) {
+            vertex_emit_shader.emit(params, v_arr[i]);
         }
-
-        // struct RGBA *color = &v_arr[i]->color;
-        // buf_vbo[buf_vbo_len++] = color->r / 255.0f;
-        // buf_vbo[buf_vbo_len++] = color->g / 255.0f;
-        // buf_vbo[buf_vbo_len++] = color->b / 255.0f;
-        // buf_vbo[buf_vbo_len++] = color->a / 255.0f;
     }
 
     if (++buf_vbo_num_tris == MAX_BUFFERED) {
@@ -2003,10 +2909,10 @@ static void gfx_dp_load_block(uint8_t tile, uint32_t uls, uint32_t ult, uint32_t
     // orig_size_bytes,
     //         g_rdp.texture_to_load.siz, lrs);
 
-    const std::string& texPath =
+    const std::string_view texPath =
         g_rdp.texture_to_load.raw_tex_metadata.resource != nullptr
             ? gfx_get_base_texture_path(g_rdp.texture_to_load.raw_tex_metadata.resource->GetInitData()->Path)
-            : "";
+            : std::string_view();
     auto maskedTextureIter = masked_textures.find(texPath);
     if (maskedTextureIter != masked_textures.end()) {
         g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].masked = true;
@@ -2073,10 +2979,10 @@ static void gfx_dp_load_tile(uint8_t tile, uint32_t uls, uint32_t ult, uint32_t
     g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].raw_tex_metadata = g_rdp.texture_to_load.raw_tex_metadata;
     g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].addr = g_rdp.texture_to_load.addr + start_offset_bytes;
 
-    const std::string& texPath =
+    const std::string_view texPath =
         g_rdp.texture_to_load.raw_tex_metadata.resource != nullptr
             ? gfx_get_base_texture_path(g_rdp.texture_to_load.raw_tex_metadata.resource->GetInitData()->Path)
-            : "";
+            : std::string_view();
     auto maskedTextureIter = masked_textures.find(texPath);
     if (maskedTextureIter != masked_textures.end()) {
         g_rdp.loaded_texture[g_rdp.texture_tile[tile].tmem_index].masked = true;
@@ -2185,6 +3091,9 @@ static void gfx_dp_set_fill_color(uint32_t packed_color) {
 }
 
 static void gfx_draw_rectangle(int32_t ulx, int32_t uly, int32_t lrx, int32_t lry) {
+    // The rectangle vertices below are rewritten in place
+    current_emit_generation++;
+
     uint32_t saved_other_mode_h = g_rdp.other_mode_h;
     uint32_t cycle_type = (g_rdp.other_mode_h & (3U << G_MDSFT_CYCLETYPE));
 
@@ -2643,16 +3552,44 @@ bool gfx_load_ucode_handler_f3dex2(Gfx** cmd) {
     return false;
 }
 
-bool gfx_cull_dl_handler_f3dex2(Gfx** cmd) {
-    // TODO:
-    return false;
+// gCullDisplayLists, read once per frame
+static bool cull_dl_enabled;
+
+bool gfx_end_dl_handler_common(Gfx** cmd0);
+
+// Like the RSP, ends the current display list when every vertex in [vstart, vend] lies outside the same clip plane.
+// The clip bits use the aspect ratio adjusted x, so lists visible in widescreen are kept.
+static bool gfx_cull_dl(Gfx** cmd0, uint32_t vstart, uint32_t vend) {
+    if (!cull_dl_enabled || vstart > vend || vend >= MAX_VERTICES) {
+        return false;
+    }
+
+    uint8_t clip_rej = 0xFF;
+    for (uint32_t i = vstart; i <= vend && clip_rej != 0; i++) {
+        clip_rej &= g_rsp.loaded_vertices[i].clip_rej;
+    }
+    if (clip_rej == 0) {
+        return false;
+    }
+    frame_stats.display_lists_culled++;
+    return gfx_end_dl_handler_common(cmd0);
+}
+
+// F3DEX2 stores vertex indices times two
+bool gfx_cull_dl_handler_f3dex2(Gfx** cmd0) {
+    Gfx* cmd = *cmd0;
+    return gfx_cull_dl(cmd0, C0(0, 16) / 2, C1(0, 16) / 2);
+}
+
+// F3D stores vertex buffer offsets, 40 bytes per vertex, and one past the last vertex
+bool gfx_cull_dl_handler_f3d(Gfx** cmd0) {
+    Gfx* cmd = *cmd0;
+    return gfx_cull_dl(cmd0, C0(0, 16) / 40, C1(0, 16) / 40 - 1);
 }
 
 bool gfx_marker_handler_f3dex2(Gfx** cmd0) {
+    // Skip the CRC of the marked display list's name, only the debugger needs it
     (*cmd0)++;
-    Gfx* cmd = (*cmd0);
-    const uint64_t hash = ((uint64_t)(cmd)->words.w0 << 32) + (cmd)->words.w1;
-    std::string dlName = ResourceGetNameByCrc(hash);
     markerOn = true;
     return false;
 }
@@ -3157,17 +4094,27 @@ bool gfx_set_timg_handler_rdp(Gfx** cmd0) {
     return false;
 }
 
+// Path of the resource with the given CRC. It refers to the archive's own string, so passing it to the resource
+// manager does not build a temporary std::string the way the const char* from ResourceGetNameByCrc would.
+static const std::string& gfx_resource_path_by_crc(uint64_t crc) {
+    static const std::string unknown;
+    const std::string* path =
+        Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToString(crc);
+    return path != nullptr ? *path : unknown;
+}
+
 bool gfx_set_timg_otr_hash_handler_custom(Gfx** cmd0) {
     uintptr_t addr = (*cmd0)->words.w1;
     (*cmd0)++;
     uint64_t hash = ((uint64_t)(*cmd0)->words.w0 << 32) + (uint64_t)(*cmd0)->words.w1;
 
-    const char* fileName = ResourceGetNameByCrc(hash);
+    const std::string& filePath = gfx_resource_path_by_crc(hash);
+    const char* fileName = filePath.c_str();
     uint32_t texFlags = 0;
     RawTexMetadata rawTexMetadata = {};
 
     std::shared_ptr<LUS::Texture> texture = std::static_pointer_cast<LUS::Texture>(
-        Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess(ResourceGetNameByCrc(hash)));
+        Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess(filePath));
     if (texture != nullptr) {
         texFlags = texture->Flags;
         rawTexMetadata.width = texture->Width;
@@ -3322,6 +4269,9 @@ bool gfx_set_timg_fb_handler_custom(Gfx** cmd0) {
     gfx_rapi->select_texture_fb((uint32_t)cmd->words.w1);
     g_rdp.textures_changed[0] = false;
     g_rdp.textures_changed[1] = false;
+    memset(texture_atlas.bound, 0, sizeof(texture_atlas.bound));
+    texture_atlas.suspended[0] = true;
+    texture_atlas.suspended[1] = true;
     return false;
 }
 
@@ -3635,7 +4585,11 @@ const static std::unordered_map<uint32_t, GfxOpcodeHandlerFunc> otrHandlers = {
 
 const static std::unordered_map<uint32_t, GfxOpcodeHandlerFunc> f3dex2Handlers = {
     { G_NOOP, gfx_noop_handler_f3dex2 },
+#ifdef F3DEX_GBI_2
     { G_CULLDL, gfx_cull_dl_handler_f3dex2 },
+#else
+    { G_CULLDL, gfx_cull_dl_handler_f3d },
+#endif
     { G_MARKER, gfx_marker_handler_f3dex2 },
     { G_INVALTEXCACHE, gfx_invalidate_tex_cache_handler_f3dex2 },
     { G_MTX, gfx_mtx_handler_f3dex2 },
@@ -3690,17 +4644,62 @@ const static std::array<const std::unordered_map<uint32_t, GfxOpcodeHandlerFunc>
         &s2dexHandlers,
     };
 
-// TODO, implement a system where we can get the current opcode handler by writing to the GWords. If the powers that be
-// are OK with that...
+// Flat opcode tables compiled from the handler maps above, one per ucode. The OTR and RDP handlers are layered on top
+// of the ucode handlers (matching the old lookup order), and every unclaimed slot points at the fallback handler, so
+// gfx_step dispatches each command with a single indexed load instead of several hash lookups.
+typedef std::array<GfxOpcodeHandlerFunc, 256> GfxOpcodeHandlerTable;
+
+static bool gfx_unhandled_opcode_handler(Gfx** cmd) {
+    SPDLOG_WARN("Unhandled OP code: {}, for loaded ucode: {}", (uint32_t)((*cmd)->words.w0 >> 24),
+                (uint32_t)ucode_handler_index);
+    return false;
+}
+
+static GfxOpcodeHandlerTable gfx_build_handler_table(const std::unordered_map<uint32_t, GfxOpcodeHandlerFunc>& ucode) {
+    GfxOpcodeHandlerTable table;
+    table.fill(gfx_unhandled_opcode_handler);
+
+    // Keys wider than a byte could never match an opcode, so they are skipped rather than truncated.
+    for (const auto& [opcode, handler] : ucode) {
+        if (opcode < table.size()) {
+            table[opcode] = handler;
+        }
+    }
+    for (const auto& [opcode, handler] : rdpHandlers) {
+        table[(uint8_t)opcode] = handler;
+    }
+    for (const auto& [opcode, handler] : otrHandlers) {
+        if (opcode < table.size()) {
+            table[opcode] = handler;
+        }
+    }
+
+    return table;
+}
+
+static const std::array<GfxOpcodeHandlerTable, UcodeHandlers::ucode_max> ucode_handler_tables = [] {
+    std::array<GfxOpcodeHandlerTable, UcodeHandlers::ucode_max> tables;
+    for (size_t i = 0; i < tables.size(); i++) {
+        tables[i] = gfx_build_handler_table(*ucode_handlers[i]);
+    }
+    return tables;
+}();
+
+static const GfxOpcodeHandlerTable* current_handler_table = &ucode_handler_tables[UcodeHandlers::ucode_f3dex2];
+
 static void gfx_set_ucode_handler(UcodeHandlers ucode) {
     // Loaded ucode must be in range of the supported ucode_handlers
     assert(ucode < ucode_max);
+    if (ucode >= ucode_max) {
+        SPDLOG_ERROR("Tried to load unsupported ucode: {}", (uint32_t)ucode);
+        return;
+    }
     ucode_handler_index = ucode;
+    current_handler_table = &ucode_handler_tables[ucode];
 }
 
 static void gfx_step() {
     auto& cmd = g_exec_stack.currCmd();
-    auto cmd0 = cmd;
     uint32_t opcode = (uint32_t)(cmd->words.w0 >> 24);
 
     if (opcode == G_LOAD_UCODE) {
@@ -3710,22 +4709,8 @@ static void gfx_step() {
         // Instead of having a handler for each ucode for switching ucode, just check for it early and return.
     }
 
-    if (otrHandlers.contains(opcode)) {
-        if (otrHandlers.at(opcode)(&cmd)) {
-            return;
-        }
-    } else if (rdpHandlers.contains(opcode)) {
-        if (rdpHandlers.at(opcode)(&cmd)) {
-            return;
-        }
-    } else if (ucode_handler_index < ucode_handlers.size()) {
-        if (ucode_handlers[ucode_handler_index]->contains(opcode)) {
-            if (ucode_handlers[ucode_handler_index]->at(opcode)(&cmd)) {
-                return;
-            }
-        } else {
-            SPDLOG_WARN("Unhandled OP code: {}, for loaded ucode: {}", opcode, (uint32_t)ucode_handler_index);
-        }
+    if ((*current_handler_table)[opcode & 0xFF](&cmd)) {
+        return;
     }
 
     ++cmd;
@@ -3745,6 +4730,7 @@ void gfx_init(struct GfxWindowManagerAPI* wapi, struct GfxRenderingAPI* rapi, co
               bool start_in_fullscreen, uint32_t width, uint32_t height, uint32_t posX, uint32_t posY) {
     gfx_wapi = wapi;
     gfx_rapi = rapi;
+    gfx_backend_rapi = rapi;
     gfx_wapi->init(game_name, rapi->get_name(), start_in_fullscreen, width, height, posX, posY);
     gfx_rapi->init();
     gfx_rapi->update_framebuffer_parameters(0, width, height, 1, false, true, true, true);
@@ -3774,11 +4760,37 @@ void gfx_init(struct GfxWindowManagerAPI* wapi, struct GfxRenderingAPI* rapi, co
         tex_upload_buffer = (uint8_t*)malloc(max_tex_size * max_tex_size * 4);
     }
 
-    ucode_handler_index = UcodeHandlers::ucode_f3dex2;
+    if (CVarGetInteger("gShaderCache", 0)) {
+        gfx_shader_manifest_load();
+    }
+
+    gfx_set_ucode_handler(UcodeHandlers::ucode_f3dex2);
+}
+
+// Takes the backend back from the render thread once it has finished the last frame
+static void gfx_wait_for_threaded_frame(void) {
+    if (!threaded_frame_in_flight) {
+        return;
+    }
+    threaded_frame_in_flight = false;
+    gfx_render_thread_finish();
+    gfx_rapi = gfx_backend_rapi;
+    if (threaded_frame_recorded) {
+        last_frame_stats.draw_calls_submitted = gfx_frame_recorder_get_stats().draws_submitted;
+    }
+    if (gfx_pixel_depth_async()) {
+        gfx_pixel_depth_request();
+    }
+}
+
+static void gfx_render_queued_gui(void) {
+    Ship::Context::GetInstance()->GetWindow()->GetGui()->RenderQueuedDrawData();
 }
 
 void gfx_destroy(void) {
     // TODO: should also destroy rapi and wapi, and any other resources acquired in fast3d
+    gfx_wait_for_threaded_frame();
+    gfx_shader_cache_close(&shader_manifest);
 
     // Texture cache and loaded textures store references to Resources which need to be unreferenced.
     gfx_texture_cache_clear();
@@ -3788,10 +4800,12 @@ void gfx_destroy(void) {
 }
 
 struct GfxRenderingAPI* gfx_get_current_rendering_api(void) {
-    return gfx_rapi;
+    gfx_wait_for_threaded_frame();
+    return gfx_backend_rapi;
 }
 
 void gfx_start_frame(void) {
+    gfx_wait_for_threaded_frame();
     gfx_wapi->handle_events();
     gfx_wapi->get_dimensions(&gfx_current_window_dimensions.width, &gfx_current_window_dimensions.height,
                              &gfx_current_window_position_x, &gfx_current_window_position_y);
@@ -3854,11 +4868,18 @@ void gfx_start_frame(void) {
 GfxExecStack g_exec_stack = {};
 
 void gfx_run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacements) {
+    gfx_wait_for_threaded_frame();
     gfx_sp_reset();
+    frame_stats = {};
+    cull_dl_enabled = CVarGetInteger("gCullDisplayLists", 0);
+    gfx_vertex_memo_start_frame();
+    gfx_texture_decode_start_frame();
 
     // puts("New frame");
-    get_pixel_depth_pending.clear();
-    get_pixel_depth_cached.clear();
+    if (!gfx_pixel_depth_async()) {
+        pixel_depth.num_pending = 0;
+    }
+    pixel_depth.num_samples = 0;
 
     if (!gfx_wapi->start_frame()) {
         dropped_frame = true;
@@ -3876,6 +4897,31 @@ void gfx_run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacemen
     }
 
     current_mtx_replacements = &mtx_replacements;
+    matrix_cache.generation++;
+
+    const bool record_frame = CVarGetInteger("gFrameDrawSorting", 0);
+    const bool threaded_frame = CVarGetInteger("gRenderThread", 0);
+
+    // Looked up while the backend is still on this thread, so the GUI pass of a threaded frame doesn't have to wait
+    // for the render thread
+    void* game_framebuffer_texture = nullptr;
+    if (game_renders_to_framebuffer) {
+        const bool different_size = gfx_current_dimensions.width != gfx_current_game_window_viewport.width ||
+                                    gfx_current_dimensions.height != gfx_current_game_window_viewport.height;
+        game_framebuffer_texture = gfx_rapi->get_framebuffer_texture_id(
+            gfx_msaa_level > 1 && different_size ? game_framebuffer_msaa_resolved : game_framebuffer);
+    }
+
+    if (record_frame) {
+        gfx_rapi = gfx_frame_recorder_begin(gfx_rapi);
+    }
+    if (threaded_frame) {
+        const int num_buffers = CVarGetInteger("gRenderThreadBuffers", 2) >= 3 ? 3 : 2;
+        gfx_rapi = gfx_render_thread_begin(gfx_rapi, gfx_wapi, num_buffers);
+    }
+    if (record_frame || threaded_frame) {
+        gfx_resync_rendering_state();
+    }
 
     gfx_rapi->update_framebuffer_parameters(0, gfx_current_window_dimensions.width,
                                             gfx_current_window_dimensions.height, 1, false, true, true,
@@ -3903,8 +4949,30 @@ void gfx_run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacemen
         gfx_step();
     }
     gfx_flush();
+    // The GUI draws on top of the frame, so everything recorded has to reach the backend first. A threaded frame keeps
+    // gfx_rapi on the render thread until gfx_wait_for_threaded_frame, which also fills in its submitted draw count.
+    if (record_frame) {
+        if (threaded_frame) {
+            gfx_render_thread_post(gfx_frame_recorder_end);
+        } else {
+            gfx_frame_recorder_end();
+            frame_stats.draw_calls_submitted = gfx_frame_recorder_get_stats().draws_submitted;
+        }
+    } else {
+        frame_stats.draw_calls_submitted = frame_stats.draw_calls_issued;
+    }
+    if (!threaded_frame) {
+        gfx_rapi = gfx_backend_rapi;
+        if (gfx_pixel_depth_async()) {
+            gfx_pixel_depth_request();
+        }
+    }
+    frame_stats.vertex_memo_entries = vertex_memo.map.size();
+    frame_stats.texture_cache_entries = gfx_texture_cache.map.size();
+    frame_stats.texture_cache_bytes = gfx_texture_cache.resident_bytes;
+    last_frame_stats = frame_stats;
     gfxFramebuffer = 0;
-    currentDir = std::stack<std::string>();
+    currentDir.clear();
 
     if (game_renders_to_framebuffer) {
         gfx_rapi->start_draw_to_framebuffer(0, 1);
@@ -3916,33 +4984,54 @@ void gfx_run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacemen
 
             if (different_size) {
                 gfx_rapi->resolve_msaa_color_buffer(game_framebuffer_msaa_resolved, game_framebuffer);
-                gfxFramebuffer = (uintptr_t)gfx_rapi->get_framebuffer_texture_id(game_framebuffer_msaa_resolved);
+                gfxFramebuffer = (uintptr_t)game_framebuffer_texture;
             } else {
                 gfx_rapi->resolve_msaa_color_buffer(0, game_framebuffer);
             }
         } else {
-            gfxFramebuffer = (uintptr_t)gfx_rapi->get_framebuffer_texture_id(game_framebuffer);
+            gfxFramebuffer = (uintptr_t)game_framebuffer_texture;
         }
     }
-    Ship::Context::GetInstance()->GetWindow()->GetGui()->StartFrame();
-    Ship::Context::GetInstance()->GetWindow()->GetGui()->RenderViewports();
-    gfx_rapi->end_frame();
-    gfx_wapi->swap_buffers_begin();
+    std::shared_ptr<Ship::Gui> gui = Ship::Context::GetInstance()->GetWindow()->GetGui();
+    gui->StartFrame();
+    if (threaded_frame) {
+        threaded_frame_in_flight = true;
+        threaded_frame_recorded = record_frame;
+    }
+    if (threaded_frame && gui->QueueDrawData()) {
+        // The GUI is drawn and the frame presented on the render thread, so they overlap with the game's work on the
+        // next frame. Anything that needs the backend or ImGui's renderer on this thread waits for them first.
+        gfx_render_thread_post(gfx_render_queued_gui);
+        gfx_rapi->end_frame();
+        gfx_render_thread_post(gfx_wapi->swap_buffers_begin);
+        gfx_render_thread_end();
+    } else {
+        gfx_wait_for_threaded_frame();
+        gui->RenderViewports();
+        gfx_rapi->end_frame();
+        gfx_wapi->swap_buffers_begin();
+    }
     has_drawn_imgui_menu = false;
 }
 
 void gfx_end_frame(void) {
     if (!dropped_frame) {
         gfx_rapi->finish_render();
-        gfx_wapi->swap_buffers_end();
+        if (threaded_frame_in_flight) {
+            gfx_render_thread_post(gfx_wapi->swap_buffers_end);
+        } else {
+            gfx_wapi->swap_buffers_end();
+        }
     }
 }
 
 void gfx_set_target_fps(int fps) {
+    gfx_wait_for_threaded_frame();
     gfx_wapi->set_target_fps(fps);
 }
 
 void gfx_set_maximum_frame_latency(int latency) {
+    gfx_wait_for_threaded_frame();
     gfx_wapi->set_maximum_frame_latency(latency);
 }
 
@@ -4027,33 +5116,141 @@ static void adjust_pixel_depth_coordinates(float& x, float& y) {
     }
 }
 
+static bool gfx_pixel_depth_async(void) {
+    return gfx_rapi->request_pixel_depth != nullptr && CVarGetInteger("gAsyncPixelDepth", 0);
+}
+
+static const PixelDepthSample* gfx_pixel_depth_find(const PixelDepthSample* samples, size_t count,
+                                                    GfxPixelCoord coord) {
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i].coord.x == coord.x && samples[i].coord.y == coord.y) {
+            return &samples[i];
+        }
+    }
+    return nullptr;
+}
+
+// Updates the sample at coord, when full the oldest sample makes room for it
+static void gfx_pixel_depth_store(PixelDepthSample* samples, size_t* count, GfxPixelCoord coord, uint16_t depth) {
+    for (size_t i = 0; i < *count; i++) {
+        if (samples[i].coord.x == coord.x && samples[i].coord.y == coord.y) {
+            samples[i].depth = depth;
+            return;
+        }
+    }
+    if (*count == GFX_PIXEL_DEPTH_MAX_COORDS) {
+        memmove(samples, samples + 1, (GFX_PIXEL_DEPTH_MAX_COORDS - 1) * sizeof(PixelDepthSample));
+        (*count)--;
+    }
+    samples[(*count)++] = { coord, depth };
+}
+
+// Returns false if coord is not pending and there is no room left for it
+static bool gfx_pixel_depth_queue(GfxPixelCoord coord) {
+    for (size_t i = 0; i < pixel_depth.num_pending; i++) {
+        if (pixel_depth.pending[i].x == coord.x && pixel_depth.pending[i].y == coord.y) {
+            return true;
+        }
+    }
+    if (pixel_depth.num_pending == GFX_PIXEL_DEPTH_MAX_COORDS) {
+        return false;
+    }
+    pixel_depth.pending[pixel_depth.num_pending++] = coord;
+    return true;
+}
+
+static void gfx_pixel_depth_poll_slot(int slot, bool wait) {
+    auto& readback = pixel_depth.readbacks[slot];
+    if (!readback.in_flight) {
+        return;
+    }
+    uint16_t depths[GFX_PIXEL_DEPTH_MAX_COORDS];
+    const bool arrived = gfx_rapi->poll_pixel_depth(slot, depths, wait);
+    if (!arrived && !wait) {
+        return;
+    }
+    // A readback that does not arrive even when waited for was lost, for example to a change of backend
+    readback.in_flight = false;
+    if (arrived) {
+        for (size_t i = 0; i < readback.count; i++) {
+            gfx_pixel_depth_store(pixel_depth.resolved, &pixel_depth.num_resolved, readback.coords[i], depths[i]);
+        }
+    }
+}
+
+// Oldest readbacks first, so that newer values of the same coordinate win
+static void gfx_pixel_depth_poll(void) {
+    for (int i = 0; i < GFX_PIXEL_DEPTH_SLOTS; i++) {
+        gfx_pixel_depth_poll_slot((pixel_depth.next_slot + i) % GFX_PIXEL_DEPTH_SLOTS, false);
+    }
+}
+
+// Starts reading back the coordinates queried since the last frame from the frame just drawn
+static void gfx_pixel_depth_request(void) {
+    gfx_pixel_depth_poll();
+    if (pixel_depth.num_pending == 0) {
+        return;
+    }
+
+    const int slot = pixel_depth.next_slot;
+    auto& readback = pixel_depth.readbacks[slot];
+    gfx_pixel_depth_poll_slot(slot, true);
+    memcpy(readback.coords, pixel_depth.pending, pixel_depth.num_pending * sizeof(GfxPixelCoord));
+    readback.count = pixel_depth.num_pending;
+    readback.in_flight = true;
+    gfx_rapi->request_pixel_depth(slot, game_renders_to_framebuffer ? game_framebuffer : 0, readback.coords,
+                                  readback.count);
+    pixel_depth.next_slot = (slot + 1) % GFX_PIXEL_DEPTH_SLOTS;
+    pixel_depth.num_pending = 0;
+}
+
 void gfx_get_pixel_depth_prepare(float x, float y) {
     adjust_pixel_depth_coordinates(x, y);
-    get_pixel_depth_pending.emplace(x, y);
+    gfx_pixel_depth_queue({ x, y });
 }
 
 uint16_t gfx_get_pixel_depth(float x, float y) {
     adjust_pixel_depth_coordinates(x, y);
+    const GfxPixelCoord coord = { x, y };
 
-    if (auto it = get_pixel_depth_cached.find(make_pair(x, y)); it != get_pixel_depth_cached.end()) {
-        return it->second;
+    if (const PixelDepthSample* sample = gfx_pixel_depth_find(pixel_depth.samples, pixel_depth.num_samples, coord)) {
+        return sample->depth;
     }
 
-    get_pixel_depth_pending.emplace(x, y);
+    const bool queued = gfx_pixel_depth_queue(coord);
+    if (gfx_pixel_depth_async()) {
+        gfx_pixel_depth_poll();
+        if (const PixelDepthSample* sample =
+                gfx_pixel_depth_find(pixel_depth.resolved, pixel_depth.num_resolved, coord)) {
+            return sample->depth;
+        }
+    }
 
-    unordered_map<pair<float, float>, uint16_t, hash_pair_ff> res =
-        gfx_rapi->get_pixel_depth(game_renders_to_framebuffer ? game_framebuffer : 0, get_pixel_depth_pending);
-    get_pixel_depth_cached.merge(res);
-    get_pixel_depth_pending.clear();
+    // Blocking fallback, which reads everything pending so the rest of this frame's queries are answered as well
+    const int fb_id = game_renders_to_framebuffer ? game_framebuffer : 0;
+    uint16_t depths[GFX_PIXEL_DEPTH_MAX_COORDS];
+    if (!queued) {
+        gfx_rapi->get_pixel_depth(fb_id, &coord, 1, depths);
+        gfx_pixel_depth_store(pixel_depth.samples, &pixel_depth.num_samples, coord, depths[0]);
+        return depths[0];
+    }
+    gfx_rapi->get_pixel_depth(fb_id, pixel_depth.pending, pixel_depth.num_pending, depths);
+    for (size_t i = 0; i < pixel_depth.num_pending; i++) {
+        gfx_pixel_depth_store(pixel_depth.samples, &pixel_depth.num_samples, pixel_depth.pending[i], depths[i]);
+    }
+    // In async mode they stay pending, so that later frames have their values without blocking
+    if (!gfx_pixel_depth_async()) {
+        pixel_depth.num_pending = 0;
+    }
 
-    return get_pixel_depth_cached.find(make_pair(x, y))->second;
+    return gfx_pixel_depth_find(pixel_depth.samples, pixel_depth.num_samples, coord)->depth;
 }
 
 void gfx_push_current_dir(char* path) {
     if (gfx_check_image_signature(path) == 1)
         path = &path[7];
 
-    currentDir.push(GetPathWithoutFileName(path));
+    currentDir.push_back(GetPathWithoutFileName(path));
 }
 
 int32_t gfx_check_image_signature(const char* imgData) {
@@ -4094,3 +5291,7 @@ void gfx_unregister_blended_texture(const char* name) {
 
     masked_textures.erase(name);
 }
+
+const GfxFrameStats& gfx_get_frame_stats() {
+    return last_frame_stats;
+}
@@ -42,13 +42,22 @@ struct TextureCacheKey {
     uint8_t fmt, siz;
     uint8_t palette_index;
     uint32_t size_bytes;
+    uint32_t line_size_bytes; // Of the tile, determines the texture's width
 
     bool operator==(const TextureCacheKey&) const noexcept = default;
 
     struct Hasher {
         size_t operator()(const TextureCacheKey& key) const noexcept {
-            uintptr_t addr = (uintptr_t)key.texture_addr;
-            return (size_t)(addr ^ (addr >> 5));
+            size_t hash = 0;
+            auto combine = [&hash](uint64_t value) {
+                hash ^= std::hash<uint64_t>()(value) + (size_t)0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+            };
+            combine((uintptr_t)key.texture_addr);
+            combine((uintptr_t)key.palette_addrs[0]);
+            combine((uintptr_t)key.palette_addrs[1]);
+            combine(key.fmt | (key.siz << 8) | (key.palette_index << 16));
+            combine(key.size_bytes | ((uint64_t)key.line_size_bytes << 32));
+            return hash;
         }
     };
 };
@@ -60,6 +69,15 @@ struct TextureCacheValue {
     uint32_t texture_id;
     uint8_t cms, cmt;
     bool linear_filter;
+    // Decoded size of the uploaded image, charged to gTextureCacheBudgetMB
+    uint32_t upload_bytes;
+    // Hash of the source data and decode inputs when gTextureContentDedup is on, 0 otherwise
+    uint64_t content_hash;
+    // 1 + index of the atlas page holding a padded copy of the texture, 0 if none, see gTextureAtlas
+    uint8_t atlas_page;
+    uint16_t atlas_x, atlas_y, atlas_width, atlas_height;
+    // Set while a worker decodes the texture, see gAsyncTextureDecoding
+    std::shared_ptr<struct TextureDecodeJob> pending_decode;
 
     std::list<struct TextureCacheMapIter>::iterator lru_location;
 };
@@ -69,8 +87,9 @@ struct TextureCacheMapIter {
 };
 
 struct GfxExecStack {
-    // This is a dlist stack used to handle dlist calls.
-    std::stack<Gfx*> cmd_stack = {};
+    // This is a dlist stack used to handle dlist calls. It is backed by a vector, which keeps its capacity across
+    // frames instead of allocating and freeing deque blocks as the call depth changes.
+    std::stack<Gfx*, std::vector<Gfx*>> cmd_stack = {};
     // This is also a dlist stack but a std::vector is used to make it possible
     // to iterate on the elements.
     // The purpose of this is to identify an instruction at a poin in time
@@ -99,6 +118,23 @@ struct RGBA {
     uint8_t r, g, b, a;
 };
 
+// Counters collected while interpreting a frame, see gfx_get_frame_stats
+struct GfxFrameStats {
+    uint32_t vertex_memo_hits;
+    uint32_t vertex_memo_misses;
+    uint32_t vertex_memo_entries;
+    uint32_t draw_calls_issued;    // Batches flushed by Fast3D
+    uint32_t draw_calls_submitted; // Batches that reached the backend, fewer when gFrameDrawSorting merges them
+    uint32_t texture_cache_hits;
+    uint32_t texture_cache_misses;
+    uint32_t texture_cache_evictions;
+    uint32_t texture_cache_entries;
+    uint64_t texture_cache_bytes;     // Decoded bytes of all cached textures
+    uint64_t texture_bytes_uploaded;  // Decoded bytes uploaded this frame
+    uint32_t texture_uploads_aliased; // Misses served by a cached texture with the same content
+    uint32_t display_lists_culled;    // G_CULLDL commands that ended their display list
+};
+
 struct LoadedVertex {
     float x, y, z, w;
     float u, v;
@@ -124,6 +160,7 @@ struct RSP {
 
     float MP_matrix[4][4];
     float P_matrix[4][4];
+    bool MP_matrix_dirty; // MP_matrix is recomputed before vertices are next transformed
 
     Light_t lookat[2];
     Light current_lights[MAX_LIGHTS + 1];
@@ -230,5 +267,9 @@ void gfx_push_current_dir(char* path);
 int32_t gfx_check_image_signature(const char* imgData);
 void gfx_register_blended_texture(const char* name, uint8_t* mask, uint8_t* replacement = nullptr);
 void gfx_unregister_blended_texture(const char* name);
+// Starts decoding a texture resource on a worker ahead of its first use, adopted by gAsyncTextureDecoding imports
+void gfx_texture_predecode(const std::shared_ptr<LUS::Texture>& texture);
+// Returns the counters of the last frame that finished rendering
+const GfxFrameStats& gfx_get_frame_stats();
 
 #endif
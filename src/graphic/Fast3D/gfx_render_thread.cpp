@@ -0,0 +1,630 @@
+#include "gfx_render_thread.h"
+
+#include <string.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Filled buffers are handed to the render thread at the next draw once they reach this size
+#define RENDER_THREAD_CHUNK_SIZE (256 * 1024)
+// Texture ids requested from the backend in one go, so texture cache misses rarely wait for the render thread
+#define RENDER_THREAD_TEXTURE_ID_BATCH 64
+
+enum class GfxCommandType : uint8_t {
+    UnloadShader,
+    LoadShader,
+    SelectTexture,
+    UploadTexture,
+    SetSamplerParameters,
+    SetDepthTestAndMask,
+    SetZmodeDecal,
+    SetViewport,
+    SetScissor,
+    SetUseAlpha,
+    DrawTriangles,
+    DrawTrianglesIndexed,
+    OnResize,
+    StartFrame,
+    EndFrame,
+    FinishRender,
+    UpdateFramebufferParameters,
+    StartDrawToFramebuffer,
+    CopyFramebuffer,
+    ClearFramebuffer,
+    ResolveMsaaColorBuffer,
+    SelectTextureFb,
+    DeleteTexture,
+    SetTextureFilter,
+};
+
+struct RenderJob {
+    GfxCommandBuffer* buffer;
+    std::function<void()> task;
+};
+
+static struct RenderThread {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::condition_variable free_cv;
+    std::deque<RenderJob> jobs;
+    std::vector<std::unique_ptr<GfxCommandBuffer>> buffers;
+    std::deque<GfxCommandBuffer*> free_buffers;
+    bool quit;
+
+    ~RenderThread() {
+        if (thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            job_cv.notify_one();
+            thread.join();
+        }
+    }
+} render_thread;
+
+static struct GfxRenderingAPI* backend;
+static struct GfxWindowManagerAPI* window_api;
+static struct GfxRenderingAPI render_thread_api;
+static GfxCommandBuffer* recording;
+
+static int max_texture_size;
+static struct GfxClipParameters clip_parameters;
+static bool clip_parameters_dirty;
+static std::vector<uint32_t> texture_id_pool;
+
+template <typename T> static void put(const T& value) {
+    const size_t offset = recording->data.size();
+    recording->data.resize(offset + sizeof(T));
+    memcpy(&recording->data[offset], &value, sizeof(T));
+}
+
+// Payloads are 4 byte aligned so the backend can read them in place as float or uint16_t arrays
+static void put_payload(const void* src, size_t size) {
+    const size_t offset = (recording->data.size() + 3) & ~(size_t)3;
+    recording->data.resize(offset + size);
+    memcpy(&recording->data[offset], src, size);
+}
+
+template <typename T> static T get(const uint8_t*& cursor) {
+    T value;
+    memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+static const uint8_t* get_payload(const uint8_t* base, const uint8_t*& cursor, size_t size) {
+    const uint8_t* payload = base + (((size_t)(cursor - base) + 3) & ~(size_t)3);
+    cursor = payload + size;
+    return payload;
+}
+
+void gfx_command_buffer_execute(const GfxCommandBuffer& buffer, struct GfxRenderingAPI* rapi) {
+    const uint8_t* base = buffer.data.data();
+    const uint8_t* cursor = base;
+    const uint8_t* end = base + buffer.data.size();
+
+    while (cursor < end) {
+        switch (get<GfxCommandType>(cursor)) {
+            case GfxCommandType::UnloadShader:
+                rapi->unload_shader(get<struct ShaderProgram*>(cursor));
+                break;
+            case GfxCommandType::LoadShader:
+                rapi->load_shader(get<struct ShaderProgram*>(cursor));
+                break;
+            case GfxCommandType::SelectTexture: {
+                int tile = get<int>(cursor);
+                rapi->select_texture(tile, get<uint32_t>(cursor));
+                break;
+            }
+            case GfxCommandType::UploadTexture: {
+                uint32_t width = get<uint32_t>(cursor);
+                uint32_t height = get<uint32_t>(cursor);
+                rapi->upload_texture(get_payload(base, cursor, (size_t)width * height * 4), width, height);
+                break;
+            }
+            case GfxCommandType::SetSamplerParameters: {
+                int sampler = get<int>(cursor);
+                bool linear_filter = get<bool>(cursor);
+                uint32_t cms = get<uint32_t>(cursor);
+                rapi->set_sampler_parameters(sampler, linear_filter, cms, get<uint32_t>(cursor));
+                break;
+            }
+            case GfxCommandType::SetDepthTestAndMask: {
+                bool depth_test = get<bool>(cursor);
+                rapi->set_depth_test_and_mask(depth_test, get<bool>(cursor));
+                break;
+            }
+            case GfxCommandType::SetZmodeDecal:
+                rapi->set_zmode_decal(get<bool>(cursor));
+                break;
+            case GfxCommandType::SetViewport: {
+                int x = get<int>(cursor);
+                int y = get<int>(cursor);
+                int width = get<int>(cursor);
+                rapi->set_viewport(x, y, width, get<int>(cursor));
+                break;
+            }
+            case GfxCommandType::SetScissor: {
+                int x = get<int>(cursor);
+                int y = get<int>(cursor);
+                int width = get<int>(cursor);
+                rapi->set_scissor(x, y, width, get<int>(cursor));
+                break;
+            }
+            case GfxCommandType::SetUseAlpha:
+                rapi->set_use_alpha(get<bool>(cursor));
+                break;
+            case GfxCommandType::DrawTriangles: {
+                size_t buf_vbo_len = get<size_t>(cursor);
+                size_t buf_vbo_num_tris = get<size_t>(cursor);
+                float* buf_vbo = (float*)get_payload(base, cursor, buf_vbo_len * sizeof(float));
+                rapi->draw_triangles(buf_vbo, buf_vbo_len, buf_vbo_num_tris);
+                break;
+            }
+            case GfxCommandType::DrawTrianglesIndexed: {
+                size_t buf_vbo_len = get<size_t>(cursor);
+                size_t buf_ibo_len = get<size_t>(cursor);
+                float* buf_vbo = (float*)get_payload(base, cursor, buf_vbo_len * sizeof(float));
+                const uint16_t* buf_ibo = (const uint16_t*)get_payload(base, cursor, buf_ibo_len * sizeof(uint16_t));
+                rapi->draw_triangles_indexed(buf_vbo, buf_vbo_len, buf_ibo, buf_ibo_len);
+                break;
+            }
+            case GfxCommandType::OnResize:
+                rapi->on_resize();
+                break;
+            case GfxCommandType::StartFrame:
+                rapi->start_frame();
+                break;
+            case GfxCommandType::EndFrame:
+                rapi->end_frame();
+                break;
+            case GfxCommandType::FinishRender:
+                rapi->finish_render();
+                break;
+            case GfxCommandType::UpdateFramebufferParameters: {
+                int fb_id = get<int>(cursor);
+                uint32_t width = get<uint32_t>(cursor);
+                uint32_t height = get<uint32_t>(cursor);
+                uint32_t msaa_level = get<uint32_t>(cursor);
+                bool opengl_invert_y = get<bool>(cursor);
+                bool render_target = get<bool>(cursor);
+                bool has_depth_buffer = get<bool>(cursor);
+                bool can_extract_depth = get<bool>(cursor);
+                rapi->update_framebuffer_parameters(fb_id, width, height, msaa_level, opengl_invert_y, render_target,
+                                                    has_depth_buffer, can_extract_depth);
+                break;
+            }
+            case GfxCommandType::StartDrawToFramebuffer: {
+                int fb_id = get<int>(cursor);
+                rapi->start_draw_to_framebuffer(fb_id, get<float>(cursor));
+                break;
+            }
+            case GfxCommandType::CopyFramebuffer: {
+                int args[10];
+                for (int& arg : args) {
+                    arg = get<int>(cursor);
+                }
+                rapi->copy_framebuffer(args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], args[8],
+                                       args[9]);
+                break;
+            }
+            case GfxCommandType::ClearFramebuffer:
+                rapi->clear_framebuffer();
+                break;
+            case GfxCommandType::ResolveMsaaColorBuffer: {
+                int fb_id_target = get<int>(cursor);
+                rapi->resolve_msaa_color_buffer(fb_id_target, get<int>(cursor));
+                break;
+            }
+            case GfxCommandType::SelectTextureFb:
+                rapi->select_texture_fb(get<int>(cursor));
+                break;
+            case GfxCommandType::DeleteTexture:
+                rapi->delete_texture(get<uint32_t>(cursor));
+                break;
+            case GfxCommandType::SetTextureFilter:
+                rapi->set_texture_filter(get<FilteringMode>(cursor));
+                break;
+        }
+    }
+}
+
+static void render_thread_main(void) {
+    std::unique_lock<std::mutex> lock(render_thread.mutex);
+    for (;;) {
+        render_thread.job_cv.wait(lock, [] { return render_thread.quit || !render_thread.jobs.empty(); });
+        if (render_thread.jobs.empty()) {
+            return;
+        }
+        RenderJob job = std::move(render_thread.jobs.front());
+        render_thread.jobs.pop_front();
+        lock.unlock();
+
+        if (job.buffer != nullptr) {
+            gfx_command_buffer_execute(*job.buffer, backend);
+            job.buffer->data.clear();
+        } else {
+            job.task();
+        }
+
+        lock.lock();
+        if (job.buffer != nullptr) {
+            render_thread.free_buffers.push_back(job.buffer);
+            render_thread.free_cv.notify_one();
+        }
+    }
+}
+
+static void push_job(RenderJob job) {
+    {
+        std::lock_guard<std::mutex> lock(render_thread.mutex);
+        render_thread.jobs.push_back(std::move(job));
+    }
+    render_thread.job_cv.notify_one();
+}
+
+// Queues the buffer being recorded and waits for a free one, which is where the interpreter gets throttled when it
+// runs more than num_buffers ahead of the backend
+static void submit_recording(void) {
+    if (recording->data.empty()) {
+        return;
+    }
+    push_job({ recording, nullptr });
+
+    std::unique_lock<std::mutex> lock(render_thread.mutex);
+    render_thread.free_cv.wait(lock, [] { return !render_thread.free_buffers.empty(); });
+    recording = render_thread.free_buffers.front();
+    render_thread.free_buffers.pop_front();
+}
+
+template <typename F> static auto run_on_render_thread(F&& func) -> decltype(func()) {
+    submit_recording();
+    std::packaged_task<decltype(func())()> task(std::forward<F>(func));
+    auto result = task.get_future();
+    push_job({ nullptr, [&task] { task(); } });
+    return result.get();
+}
+
+static void put_command(GfxCommandType type) {
+    put(type);
+}
+
+static const char* gfx_render_thread_get_name(void) {
+    return backend->get_name();
+}
+
+static int gfx_render_thread_get_max_texture_size(void) {
+    return max_texture_size;
+}
+
+// The clip parameters may depend on the framebuffer being drawn to, so they are only queried again after a change
+static struct GfxClipParameters gfx_render_thread_get_clip_parameters(void) {
+    if (clip_parameters_dirty) {
+        clip_parameters = run_on_render_thread([] { return backend->get_clip_parameters(); });
+        clip_parameters_dirty = false;
+    }
+    return clip_parameters;
+}
+
+static void gfx_render_thread_unload_shader(struct ShaderProgram* old_prg) {
+    put_command(GfxCommandType::UnloadShader);
+    put(old_prg);
+}
+
+static void gfx_render_thread_load_shader(struct ShaderProgram* new_prg) {
+    put_command(GfxCommandType::LoadShader);
+    put(new_prg);
+}
+
+static struct ShaderProgram* gfx_render_thread_create_and_load_new_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    return run_on_render_thread(
+        [shader_id0, shader_id1] { return backend->create_and_load_new_shader(shader_id0, shader_id1); });
+}
+
+// Shader pools are only written from create_and_load_new_shader, which never overlaps with the interpreter
+static struct ShaderProgram* gfx_render_thread_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    return backend->lookup_shader(shader_id0, shader_id1);
+}
+
+static void gfx_render_thread_shader_get_info(struct ShaderProgram* prg, uint8_t* num_inputs, bool used_textures[2]) {
+    backend->shader_get_info(prg, num_inputs, used_textures);
+}
+
+static uint32_t gfx_render_thread_new_texture(void) {
+    if (texture_id_pool.empty()) {
+        run_on_render_thread([] {
+            for (int i = 0; i < RENDER_THREAD_TEXTURE_ID_BATCH; i++) {
+                texture_id_pool.push_back(backend->new_texture());
+            }
+        });
+    }
+    uint32_t texture_id = texture_id_pool.back();
+    texture_id_pool.pop_back();
+    return texture_id;
+}
+
+static void gfx_render_thread_select_texture(int tile, uint32_t texture_id) {
+    put_command(GfxCommandType::SelectTexture);
+    put(tile);
+    put(texture_id);
+}
+
+static void gfx_render_thread_upload_texture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
+    put_command(GfxCommandType::UploadTexture);
+    put(width);
+    put(height);
+    put_payload(rgba32_buf, (size_t)width * height * 4);
+}
+
+static void gfx_render_thread_set_sampler_parameters(int sampler, bool linear_filter, uint32_t cms, uint32_t cmt) {
+    put_command(GfxCommandType::SetSamplerParameters);
+    put(sampler);
+    put(linear_filter);
+    put(cms);
+    put(cmt);
+}
+
+static void gfx_render_thread_set_depth_test_and_mask(bool depth_test, bool z_upd) {
+    put_command(GfxCommandType::SetDepthTestAndMask);
+    put(depth_test);
+    put(z_upd);
+}
+
+static void gfx_render_thread_set_zmode_decal(bool zmode_decal) {
+    put_command(GfxCommandType::SetZmodeDecal);
+    put(zmode_decal);
+}
+
+static void gfx_render_thread_set_viewport(int x, int y, int width, int height) {
+    put_command(GfxCommandType::SetViewport);
+    put(x);
+    put(y);
+    put(width);
+    put(height);
+}
+
+static void gfx_render_thread_set_scissor(int x, int y, int width, int height) {
+    put_command(GfxCommandType::SetScissor);
+    put(x);
+    put(y);
+    put(width);
+    put(height);
+}
+
+static void gfx_render_thread_set_use_alpha(bool use_alpha) {
+    put_command(GfxCommandType::SetUseAlpha);
+    put(use_alpha);
+}
+
+static void gfx_render_thread_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+    put_command(GfxCommandType::DrawTriangles);
+    put(buf_vbo_len);
+    put(buf_vbo_num_tris);
+    put_payload(buf_vbo, buf_vbo_len * sizeof(float));
+    if (recording->data.size() >= RENDER_THREAD_CHUNK_SIZE) {
+        submit_recording();
+    }
+}
+
+static void gfx_render_thread_draw_triangles_indexed(float buf_vbo[], size_t buf_vbo_len, const uint16_t buf_ibo[],
+                                                     size_t buf_ibo_len) {
+    put_command(GfxCommandType::DrawTrianglesIndexed);
+    put(buf_vbo_len);
+    put(buf_ibo_len);
+    put_payload(buf_vbo, buf_vbo_len * sizeof(float));
+    put_payload(buf_ibo, buf_ibo_len * sizeof(uint16_t));
+    if (recording->data.size() >= RENDER_THREAD_CHUNK_SIZE) {
+        submit_recording();
+    }
+}
+
+static void gfx_render_thread_init(void) {
+    run_on_render_thread([] { backend->init(); });
+}
+
+static void gfx_render_thread_on_resize(void) {
+    put_command(GfxCommandType::OnResize);
+}
+
+static void gfx_render_thread_start_frame(void) {
+    put_command(GfxCommandType::StartFrame);
+}
+
+static void gfx_render_thread_end_frame(void) {
+    put_command(GfxCommandType::EndFrame);
+}
+
+static void gfx_render_thread_finish_render(void) {
+    put_command(GfxCommandType::FinishRender);
+}
+
+static int gfx_render_thread_create_framebuffer(void) {
+    return run_on_render_thread([] { return backend->create_framebuffer(); });
+}
+
+static void gfx_render_thread_update_framebuffer_parameters(int fb_id, uint32_t width, uint32_t height,
+                                                            uint32_t msaa_level, bool opengl_invert_y,
+                                                            bool render_target, bool has_depth_buffer,
+                                                            bool can_extract_depth) {
+    put_command(GfxCommandType::UpdateFramebufferParameters);
+    put(fb_id);
+    put(width);
+    put(height);
+    put(msaa_level);
+    put(opengl_invert_y);
+    put(render_target);
+    put(has_depth_buffer);
+    put(can_extract_depth);
+    clip_parameters_dirty = true;
+}
+
+static void gfx_render_thread_start_draw_to_framebuffer(int fb_id, float noise_scale) {
+    put_command(GfxCommandType::StartDrawToFramebuffer);
+    put(fb_id);
+    put(noise_scale);
+    clip_parameters_dirty = true;
+}
+
+static void gfx_render_thread_copy_framebuffer(int fb_dst_id, int fb_src_id, int srcX0, int srcY0, int srcX1,
+                                               int srcY1, int dstX0, int dstY0, int dstX1, int dstY1) {
+    put_command(GfxCommandType::CopyFramebuffer);
+    for (int arg : { fb_dst_id, fb_src_id, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1 }) {
+        put(arg);
+    }
+}
+
+static void gfx_render_thread_clear_framebuffer(void) {
+    put_command(GfxCommandType::ClearFramebuffer);
+}
+
+static void gfx_render_thread_read_framebuffer_to_cpu(int fb_id, uint32_t width, uint32_t height,
+                                                      uint16_t* rgba16_buf) {
+    run_on_render_thread(
+        [fb_id, width, height, rgba16_buf] { backend->read_framebuffer_to_cpu(fb_id, width, height, rgba16_buf); });
+}
+
+static void gfx_render_thread_resolve_msaa_color_buffer(int fb_id_target, int fb_id_source) {
+    put_command(GfxCommandType::ResolveMsaaColorBuffer);
+    put(fb_id_target);
+    put(fb_id_source);
+}
+
+static void gfx_render_thread_get_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count,
+                                              uint16_t* depths) {
+    run_on_render_thread(
+        [fb_id, coordinates, count, depths] { backend->get_pixel_depth(fb_id, coordinates, count, depths); });
+}
+
+static void* gfx_render_thread_get_framebuffer_texture_id(int fb_id) {
+    return run_on_render_thread([fb_id] { return backend->get_framebuffer_texture_id(fb_id); });
+}
+
+static void gfx_render_thread_select_texture_fb(int fb_id) {
+    put_command(GfxCommandType::SelectTextureFb);
+    put(fb_id);
+}
+
+static void gfx_render_thread_delete_texture(uint32_t texID) {
+    put_command(GfxCommandType::DeleteTexture);
+    put(texID);
+}
+
+static void gfx_render_thread_set_texture_filter(FilteringMode mode) {
+    put_command(GfxCommandType::SetTextureFilter);
+    put(mode);
+}
+
+static FilteringMode gfx_render_thread_get_texture_filter(void) {
+    return run_on_render_thread([] { return backend->get_texture_filter(); });
+}
+
+struct GfxRenderingAPI* gfx_render_thread_begin(struct GfxRenderingAPI* rapi, struct GfxWindowManagerAPI* wapi,
+                                                int num_buffers) {
+    if (backend != rapi) {
+        // Ids from the previous backend mean nothing to this one
+        texture_id_pool.clear();
+    }
+    backend = rapi;
+    window_api = wapi;
+    max_texture_size = rapi->get_max_texture_size();
+    clip_parameters_dirty = true;
+
+    // The render thread is idle between frames, so the pool can be resized here
+    if (render_thread.buffers.size() != (size_t)num_buffers) {
+        render_thread.buffers.clear();
+        render_thread.free_buffers.clear();
+        for (int i = 0; i < num_buffers; i++) {
+            render_thread.buffers.push_back(std::make_unique<GfxCommandBuffer>());
+            render_thread.free_buffers.push_back(render_thread.buffers.back().get());
+        }
+    }
+    recording = render_thread.free_buffers.front();
+    render_thread.free_buffers.pop_front();
+
+    if (!render_thread.thread.joinable()) {
+        render_thread.thread = std::thread(render_thread_main);
+    }
+    if (window_api->make_context_current != nullptr) {
+        window_api->make_context_current(false);
+        run_on_render_thread([] { window_api->make_context_current(true); });
+    }
+
+    render_thread_api = {
+        gfx_render_thread_get_name,
+        gfx_render_thread_get_max_texture_size,
+        gfx_render_thread_get_clip_parameters,
+        gfx_render_thread_unload_shader,
+        gfx_render_thread_load_shader,
+        gfx_render_thread_create_and_load_new_shader,
+        gfx_render_thread_lookup_shader,
+        gfx_render_thread_shader_get_info,
+        gfx_render_thread_new_texture,
+        gfx_render_thread_select_texture,
+        gfx_render_thread_upload_texture,
+        gfx_render_thread_set_sampler_parameters,
+        gfx_render_thread_set_depth_test_and_mask,
+        gfx_render_thread_set_zmode_decal,
+        gfx_render_thread_set_viewport,
+        gfx_render_thread_set_scissor,
+        gfx_render_thread_set_use_alpha,
+        gfx_render_thread_draw_triangles,
+        rapi->draw_triangles_indexed != nullptr ? gfx_render_thread_draw_triangles_indexed : nullptr,
+        gfx_render_thread_init,
+        gfx_render_thread_on_resize,
+        gfx_render_thread_start_frame,
+        gfx_render_thread_end_frame,
+        gfx_render_thread_finish_render,
+        gfx_render_thread_create_framebuffer,
+        gfx_render_thread_update_framebuffer_parameters,
+        gfx_render_thread_start_draw_to_framebuffer,
+        gfx_render_thread_copy_framebuffer,
+        gfx_render_thread_clear_framebuffer,
+        gfx_render_thread_read_framebuffer_to_cpu,
+        gfx_render_thread_resolve_msaa_color_buffer,
+        gfx_render_thread_get_pixel_depth,
+        // Asynchronous depth reads are requested after the render thread has handed the backend back
+        nullptr,
+        nullptr,
+        gfx_render_thread_get_framebuffer_texture_id,
+        gfx_render_thread_select_texture_fb,
+        gfx_render_thread_delete_texture,
+        gfx_render_thread_set_texture_filter,
+        gfx_render_thread_get_texture_filter,
+    };
+    return &render_thread_api;
+}
+
+void gfx_render_thread_invoke(void (*func)(void)) {
+    run_on_render_thread(func);
+}
+
+void gfx_render_thread_post(void (*func)(void)) {
+    submit_recording();
+    push_job({ nullptr, func });
+}
+
+void gfx_render_thread_end(void) {
+    submit_recording();
+}
+
+void gfx_render_thread_finish(void) {
+    run_on_render_thread([] {
+        if (window_api->make_context_current != nullptr) {
+            window_api->make_context_current(false);
+        }
+    });
+    if (window_api->make_context_current != nullptr) {
+        window_api->make_context_current(true);
+    }
+
+    std::lock_guard<std::mutex> lock(render_thread.mutex);
+    render_thread.free_buffers.push_back(recording);
+    recording = nullptr;
+}
@@ -0,0 +1,33 @@
+#ifndef GFX_RENDER_THREAD_H
+#define GFX_RENDER_THREAD_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "gfx_rendering_api.h"
+#include "gfx_window_manager_api.h"
+
+// Self-contained stream of rendering API calls. Vertex, index and texture data are copied in, so the buffer stays
+// valid after Fast3D reuses its own buffers.
+struct GfxCommandBuffer {
+    std::vector<uint8_t> data;
+};
+
+void gfx_command_buffer_execute(const GfxCommandBuffer& buffer, struct GfxRenderingAPI* rapi);
+
+// Hands the backend to the render thread and returns an API that records into command buffers. Filled buffers are
+// queued to the render thread while Fast3D keeps interpreting; num_buffers (2 or 3) bounds how far ahead it may get.
+// Calls that return a value wait for the queued work and run on the render thread.
+struct GfxRenderingAPI* gfx_render_thread_begin(struct GfxRenderingAPI* backend, struct GfxWindowManagerAPI* wapi,
+                                                int num_buffers);
+// Runs func on the render thread after all queued work and waits for it
+void gfx_render_thread_invoke(void (*func)(void));
+// Queues func to run on the render thread after all queued work, without waiting for it
+void gfx_render_thread_post(void (*func)(void));
+// Hands the rest of the frame to the render thread and returns without waiting, so the caller can get on with the
+// next frame. The API returned by begin stays usable until gfx_render_thread_finish.
+void gfx_render_thread_end(void);
+// Waits for all queued work and gives the backend back to the calling thread
+void gfx_render_thread_finish(void);
+
+#endif
@@ -5,10 +5,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#include <map>
-#include <unordered_map>
-#include <set>
-
 struct ShaderProgram;
 
 struct GfxClipParameters {
@@ -18,15 +14,13 @@ struct GfxClipParameters {
 
 enum FilteringMode { FILTER_THREE_POINT, FILTER_LINEAR, FILTER_NONE };
 
-// A hash function used to hash a: pair<float, float>
-struct hash_pair_ff {
-    size_t operator()(const std::pair<float, float>& p) const {
-        auto hash1 = std::hash<float>{}(p.first);
-        auto hash2 = std::hash<float>{}(p.second);
+// Most depth samples read back in one batch, backends may size their readback resources for this many
+#define GFX_PIXEL_DEPTH_MAX_COORDS 64
+// Asynchronous depth readbacks that can be in flight at once, one per frame
+#define GFX_PIXEL_DEPTH_SLOTS 3
 
-        // If hash1 == hash2, their XOR is zero.
-        return (hash1 != hash2) ? hash1 ^ hash2 : hash1;
-    }
+struct GfxPixelCoord {
+    float x, y;
 };
 
 struct GfxRenderingAPI {
@@ -48,6 +42,8 @@ struct GfxRenderingAPI {
     void (*set_scissor)(int x, int y, int width, int height);
     void (*set_use_alpha)(bool use_alpha);
     void (*draw_triangles)(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris);
+    // Optional, backends without index buffer support leave this null and only get draw_triangles
+    void (*draw_triangles_indexed)(float buf_vbo[], size_t buf_vbo_len, const uint16_t buf_ibo[], size_t buf_ibo_len);
     void (*init)(void);
     void (*on_resize)(void);
     void (*start_frame)(void);
@@ -63,8 +59,12 @@ struct GfxRenderingAPI {
     void (*clear_framebuffer)(void);
     void (*read_framebuffer_to_cpu)(int fb_id, uint32_t width, uint32_t height, uint16_t* rgba16_buf);
     void (*resolve_msaa_color_buffer)(int fb_id_target, int fb_id_source);
-    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> (*get_pixel_depth)(
-        int fb_id, const std::set<std::pair<float, float>>& coordinates);
+    // Reads the depth at up to GFX_PIXEL_DEPTH_MAX_COORDS coordinates, waiting for the GPU to finish drawing them
+    void (*get_pixel_depth)(int fb_id, const GfxPixelCoord* coordinates, size_t count, uint16_t* depths);
+    // Optional, starts reading the depth at coordinates into a slot without waiting for it. poll_pixel_depth returns
+    // false until the values have arrived, unless wait is set. Backends without readback fences leave both null.
+    void (*request_pixel_depth)(int slot, int fb_id, const GfxPixelCoord* coordinates, size_t count);
+    bool (*poll_pixel_depth)(int slot, uint16_t* depths, bool wait);
     void* (*get_framebuffer_texture_id)(int fb_id);
     void (*select_texture_fb)(int fb_id);
     void (*delete_texture)(uint32_t texID);
@@ -645,6 +645,13 @@ bool gfx_sdl_can_disable_vsync() {
     return false;
 }
 
+static void gfx_sdl_make_context_current(bool current) {
+    // Only the OpenGL renderer has a context, Metal isn't bound to a thread
+    if (ctx != nullptr) {
+        SDL_GL_MakeCurrent(wnd, current ? ctx : nullptr);
+    }
+}
+
 struct GfxWindowManagerAPI gfx_sdl = { gfx_sdl_init,
                                        gfx_sdl_close,
                                        gfx_sdl_set_keyboard_callbacks,
@@ -662,6 +669,7 @@ struct GfxWindowManagerAPI gfx_sdl = { gfx_sdl_init,
                                        gfx_sdl_set_target_fps,
                                        gfx_sdl_set_maximum_frame_latency,
                                        gfx_sdl_get_key_name,
-                                       gfx_sdl_can_disable_vsync };
+                                       gfx_sdl_can_disable_vsync,
+                                       gfx_sdl_make_context_current };
 
 #endif
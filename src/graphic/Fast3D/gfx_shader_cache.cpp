@@ -0,0 +1,109 @@
+#include "gfx_shader_cache.h"
+
+#include <string.h>
+
+#include <spdlog/spdlog.h>
+#include <StrHash64.h>
+
+// shader_id0, shader_id1, source hash, format and size, followed by the binary
+#define PROGRAM_BINARY_RECORD_HEADER_SIZE 28
+
+static bool gfx_shader_cache_read(const std::string& path, const std::vector<uint8_t>& header,
+                                  std::vector<uint8_t>* records) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    std::vector<uint8_t> contents;
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        contents.insert(contents.end(), chunk, chunk + read);
+    }
+    fclose(file);
+
+    if (contents.size() < header.size() || memcmp(contents.data(), header.data(), header.size()) != 0) {
+        return false;
+    }
+    records->assign(contents.begin() + header.size(), contents.end());
+    return true;
+}
+
+bool gfx_shader_cache_open(GfxShaderCacheFile* cache, const std::string& path, const std::vector<uint8_t>& header,
+                           std::vector<uint8_t>* records) {
+    gfx_shader_cache_close(cache);
+    records->clear();
+
+    if (gfx_shader_cache_read(path, header, records)) {
+        cache->file = fopen(path.c_str(), "ab");
+    } else {
+        cache->file = fopen(path.c_str(), "wb");
+        if (cache->file != nullptr) {
+            fwrite(header.data(), 1, header.size(), cache->file);
+            fflush(cache->file);
+        }
+    }
+    if (cache->file == nullptr) {
+        SPDLOG_ERROR("Failed to open shader cache {}", path);
+        return false;
+    }
+    return true;
+}
+
+void gfx_shader_cache_append(GfxShaderCacheFile* cache, const void* data, size_t size) {
+    if (cache->file == nullptr) {
+        return;
+    }
+    fwrite(data, 1, size, cache->file);
+    fflush(cache->file);
+}
+
+void gfx_shader_cache_close(GfxShaderCacheFile* cache) {
+    if (cache->file != nullptr) {
+        fclose(cache->file);
+        cache->file = nullptr;
+    }
+}
+
+uint64_t gfx_shader_source_hash(const char* vs, size_t vs_len, const char* fs, size_t fs_len) {
+    // The vertex shader's length goes in first, so moving text from one shader to the other changes the hash
+    const uint32_t vs_len32 = vs_len;
+    uint64_t hash = update_crc64(&vs_len32, sizeof(vs_len32), INITIAL_CRC64);
+    hash = update_crc64(vs, vs_len, hash);
+    return update_crc64(fs, fs_len, hash);
+}
+
+void gfx_shader_cache_append_program_binary(GfxShaderCacheFile* cache, const GfxProgramBinary& binary) {
+    const uint32_t size = binary.data.size();
+    std::vector<uint8_t> record(PROGRAM_BINARY_RECORD_HEADER_SIZE + size);
+    memcpy(&record[0], &binary.shader_id0, sizeof(binary.shader_id0));
+    memcpy(&record[8], &binary.shader_id1, sizeof(binary.shader_id1));
+    memcpy(&record[12], &binary.source_hash, sizeof(binary.source_hash));
+    memcpy(&record[20], &binary.format, sizeof(binary.format));
+    memcpy(&record[24], &size, sizeof(size));
+    memcpy(&record[PROGRAM_BINARY_RECORD_HEADER_SIZE], binary.data.data(), size);
+    gfx_shader_cache_append(cache, record.data(), record.size());
+}
+
+std::vector<GfxProgramBinary> gfx_shader_cache_read_program_binaries(const std::vector<uint8_t>& records) {
+    std::vector<GfxProgramBinary> binaries;
+    size_t pos = 0;
+    while (pos + PROGRAM_BINARY_RECORD_HEADER_SIZE <= records.size()) {
+        GfxProgramBinary binary;
+        uint32_t size;
+        memcpy(&binary.shader_id0, &records[pos], sizeof(binary.shader_id0));
+        memcpy(&binary.shader_id1, &records[pos + 8], sizeof(binary.shader_id1));
+        memcpy(&binary.source_hash, &records[pos + 12], sizeof(binary.source_hash));
+        memcpy(&binary.format, &records[pos + 20], sizeof(binary.format));
+        memcpy(&size, &records[pos + 24], sizeof(size));
+        pos += PROGRAM_BINARY_RECORD_HEADER_SIZE;
+        if (records.size() - pos < size) {
+            break;
+        }
+        binary.data.assign(records.begin() + pos, records.begin() + pos + size);
+        binaries.push_back(std::move(binary));
+        pos += size;
+    }
+    return binaries;
+}
@@ -0,0 +1,37 @@
+#ifndef GFX_SHADER_CACHE_H
+#define GFX_SHADER_CACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Append-only file of records behind a fixed header, used to keep shader data across sessions. Records are flushed
+// as they are appended, so a crash loses at most the record being written; readers must ignore a truncated tail.
+struct GfxShaderCacheFile {
+    FILE* file = nullptr;
+};
+
+// Opens the file at path for appending. If it starts with header, the bytes that follow are returned in records;
+// otherwise (missing file, older version, other driver) it is recreated holding only the header.
+bool gfx_shader_cache_open(GfxShaderCacheFile* cache, const std::string& path, const std::vector<uint8_t>& header,
+                           std::vector<uint8_t>* records);
+void gfx_shader_cache_append(GfxShaderCacheFile* cache, const void* data, size_t size);
+void gfx_shader_cache_close(GfxShaderCacheFile* cache);
+
+// Linked program saved by a backend. source_hash identifies the shader source it was built from, so a binary written
+// by an older shader generator is never loaded in place of the current program.
+struct GfxProgramBinary {
+    uint64_t shader_id0;
+    uint32_t shader_id1;
+    uint64_t source_hash;
+    uint32_t format;
+    std::vector<uint8_t> data;
+};
+
+uint64_t gfx_shader_source_hash(const char* vs, size_t vs_len, const char* fs, size_t fs_len);
+void gfx_shader_cache_append_program_binary(GfxShaderCacheFile* cache, const GfxProgramBinary& binary);
+// Splits the records of a program binary cache in the order they were appended, ignoring a truncated tail
+std::vector<GfxProgramBinary> gfx_shader_cache_read_program_binaries(const std::vector<uint8_t>& records);
+
+#endif
@@ -0,0 +1,1165 @@
+#include "gfx_software.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "gfx_cc.h"
+#include "gfx_hash_pool.h"
+#include "gfx_pc.h"
+#include "thread-pool/BS_thread_pool.hpp"
+#include <public/bridge/consolevariablebridge.h>
+
+// Side of the square screen tiles triangles are binned into. Each tile is shaded by one worker at a time.
+#define TILE_SIZE 64
+// Fractional bits of the fixed point positions the edge functions are evaluated with
+#define SUBPIXEL_BITS 4
+// Triangles are clipped to this multiple of the viewport, which keeps the fixed point products within 64 bits
+#define GUARD_BAND 16.0f
+// Clip space position followed by the varyings, the largest vertex gfx_cc can describe needs 48 floats
+#define MAX_VERTEX_FLOATS 64
+// A triangle gains at most one vertex per clip plane
+#define MAX_CLIP_VERTICES 8
+
+struct SoftwareSampler {
+    bool linear; // Already combined with the filtering mode, like the GPU backends do when the parameters are set
+    uint32_t cms;
+    uint32_t cmt;
+};
+
+// Texels are never modified after an upload, queued draws keep a reference to the data they were issued with
+struct SoftwareTextureData {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> rgba32;
+};
+
+struct SoftwareTexture {
+    std::shared_ptr<SoftwareTextureData> data;
+    SoftwareSampler sampler = { true, G_TX_NOMIRROR | G_TX_WRAP, G_TX_NOMIRROR | G_TX_WRAP };
+};
+
+// Rows are stored from the bottom up, the same as an OpenGL framebuffer, so viewports, scissors, copies and reads
+// take the coordinates Fast3D already computes for OpenGL
+struct SoftwareFramebuffer {
+    uint32_t width;
+    uint32_t height;
+    bool invert_y;
+    bool has_depth_buffer;
+    SoftwareTexture color; // Alpha is always opaque, sampled by select_texture_fb
+    std::vector<float> depth;
+};
+
+struct ShaderProgramSoftware {
+    uint64_t shader_id0;
+    uint32_t shader_id1;
+    struct CCFeatures cc_features;
+    bool uses_noise;
+    // Offsets of the varyings, counted from the float after the clip space position
+    uint8_t tex_coord[2];
+    uint8_t tex_clamp[2][2];
+    uint8_t fog;
+    uint8_t grayscale;
+    uint8_t inputs;
+    uint8_t input_size;
+    uint8_t num_varyings;
+};
+
+// Pixel rectangle, x1 and y1 exclusive
+struct SoftwareRect {
+    int32_t x0, y0, x1, y1;
+};
+
+// Everything a queued draw reads, captured when it is issued
+struct SoftwareDrawState {
+    const ShaderProgramSoftware* prg;
+    SoftwareTexture textures[SHADER_MAX_TEXTURES];
+    bool three_point;
+    bool depth_test;
+    bool depth_mask;
+    bool use_alpha;
+    float noise_scale;
+    uint32_t frame_count;
+    SoftwareRect clip; // Viewport, scissor and framebuffer bounds
+};
+
+struct SoftwareTriangle {
+    uint32_t draw;
+    SoftwareRect bounds;
+    // Edge functions on fixed point pixel centers, positive inside. The fill rule bias is folded into c.
+    int64_t edge_a[3];
+    int64_t edge_b[3];
+    int64_t edge_c[3];
+    float origin_x;
+    float origin_y;
+    float depth_offset;
+    // Index into planes of the screen space planes of z/w, 1/w and each varying/w, as value at the origin, d/dx, d/dy
+    uint32_t planes;
+};
+
+static GfxHashPool<std::pair<uint64_t, uint32_t>, ShaderProgramSoftware, GfxShaderIdHasher> shader_program_pool;
+static const ShaderProgramSoftware* current_program;
+
+static std::unordered_map<uint32_t, SoftwareTexture> textures;
+static uint32_t next_texture_id = 1;
+static SoftwareTexture* bound_textures[SHADER_MAX_TEXTURES];
+static int active_tile;
+
+static std::deque<SoftwareFramebuffer> framebuffers;
+static int current_framebuffer;
+
+static FilteringMode texture_filter = FILTER_THREE_POINT;
+static bool depth_test;
+static bool depth_mask;
+static bool zmode_decal;
+static bool use_alpha;
+static SoftwareRect viewport;
+static SoftwareRect scissor;
+static float noise_scale = 1.0f;
+static uint32_t frame_count;
+
+// Draws queued for current_framebuffer, rasterized together at the next flush
+static std::vector<SoftwareDrawState> draws;
+static std::vector<SoftwareTriangle> triangles;
+static std::vector<float> planes;
+static std::vector<std::vector<uint32_t>> tile_bins;
+static std::vector<uint32_t> busy_tiles;
+
+static std::unique_ptr<BS::thread_pool> worker_pool;
+static uint32_t thread_count;
+
+static inline float gfx_software_fract(float x) {
+    return x - floorf(x);
+}
+
+static inline float gfx_software_mix(float x, float y, float a) {
+    return x + (y - x) * a;
+}
+
+// GLSL mod(x - low, high - low) + low
+static inline float gfx_software_wrap(float x, float low, float high) {
+    const float range = high - low;
+    x -= low;
+    return x - range * floorf(x / range) + low;
+}
+
+static inline uint8_t gfx_software_to_unorm8(float x) {
+    return (uint8_t)(std::min(std::max(x, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static inline int32_t gfx_software_floor_to_int(float x) {
+    if (!(x > -1073741824.0f)) {
+        return -1073741824;
+    }
+    if (!(x < 1073741824.0f)) {
+        return 1073741823;
+    }
+    return (int32_t)floorf(x);
+}
+
+// Same hash as the GPU backends' noise, evaluated in single precision
+static float gfx_software_random(float x, float y, float z) {
+    const float value = sinf(x) * 12.9898f + sinf(y) * 78.233f + sinf(z) * 37.719f;
+    return gfx_software_fract(sinf(value) * 143758.5453f);
+}
+
+static std::shared_ptr<SoftwareTextureData> gfx_software_new_color_buffer(uint32_t width, uint32_t height) {
+    auto data = std::make_shared<SoftwareTextureData>();
+    data->width = width;
+    data->height = height;
+    data->rgba32.assign((size_t)width * height * 4, 0);
+    for (size_t i = 3; i < data->rgba32.size(); i += 4) {
+        data->rgba32[i] = 0xff;
+    }
+    return data;
+}
+
+// Gives the framebuffer its own color buffer before writing to it, if queued draws still sample the current one
+static void gfx_software_detach_color(SoftwareFramebuffer& fb) {
+    if (fb.color.data.use_count() > 1) {
+        fb.color.data = std::make_shared<SoftwareTextureData>(*fb.color.data);
+    }
+}
+
+static int32_t gfx_software_wrap_texel(int32_t i, int32_t size, uint32_t cm) {
+    switch (cm) {
+        case G_TX_NOMIRROR | G_TX_CLAMP:
+            return std::min(std::max(i, 0), size - 1);
+        case G_TX_MIRROR | G_TX_CLAMP:
+            return std::min(i < 0 ? -1 - i : i, size - 1);
+        case G_TX_MIRROR | G_TX_WRAP: {
+            int32_t period = i % (2 * size);
+            period += period < 0 ? 2 * size : 0;
+            return period < size ? period : 2 * size - 1 - period;
+        }
+        default: {
+            int32_t period = i % size;
+            return period < 0 ? period + size : period;
+        }
+    }
+}
+
+static inline void gfx_software_fetch(const SoftwareTexture& tex, int32_t x, int32_t y, float out[4]) {
+    const SoftwareTextureData& data = *tex.data;
+    x = gfx_software_wrap_texel(x, data.width, tex.sampler.cms);
+    y = gfx_software_wrap_texel(y, data.height, tex.sampler.cmt);
+    const uint8_t* texel = &data.rgba32[((size_t)y * data.width + x) * 4];
+    for (int j = 0; j < 4; j++) {
+        out[j] = texel[j] * (1.0f / 255.0f);
+    }
+}
+
+// texture() on a normalized coordinate with the texture's own filter and wrap modes
+static void gfx_software_sample_point(const SoftwareTexture& tex, float s, float t, float out[4]) {
+    const float x = s * tex.data->width;
+    const float y = t * tex.data->height;
+    if (!tex.sampler.linear) {
+        gfx_software_fetch(tex, gfx_software_floor_to_int(x), gfx_software_floor_to_int(y), out);
+        return;
+    }
+
+    const int32_t x0 = gfx_software_floor_to_int(x - 0.5f);
+    const int32_t y0 = gfx_software_floor_to_int(y - 0.5f);
+    const float fx = gfx_software_fract(x - 0.5f);
+    const float fy = gfx_software_fract(y - 0.5f);
+    float c00[4], c10[4], c01[4], c11[4];
+    gfx_software_fetch(tex, x0, y0, c00);
+    gfx_software_fetch(tex, x0 + 1, y0, c10);
+    gfx_software_fetch(tex, x0, y0 + 1, c01);
+    gfx_software_fetch(tex, x0 + 1, y0 + 1, c11);
+    for (int j = 0; j < 4; j++) {
+        out[j] = gfx_software_mix(gfx_software_mix(c00[j], c10[j], fx), gfx_software_mix(c01[j], c11[j], fx), fy);
+    }
+}
+
+// hookTexture2D of the GPU backends. The three point filter steps by texels of size, which is the size of the main
+// texture even when sampling its blend texture.
+static void gfx_software_sample(const SoftwareTexture& tex, float s, float t, float tex_width, float tex_height,
+                                bool three_point, float out[4]) {
+    if (tex.data == nullptr || tex.data->rgba32.empty()) {
+        out[0] = out[1] = out[2] = out[3] = 0.0f;
+        return;
+    }
+    if (!three_point) {
+        gfx_software_sample_point(tex, s, t, out);
+        return;
+    }
+
+    float offset_s = gfx_software_fract(s * tex_width - 0.5f);
+    float offset_t = gfx_software_fract(t * tex_height - 0.5f);
+    if (offset_s + offset_t >= 1.0f) {
+        offset_s -= 1.0f;
+        offset_t -= 1.0f;
+    }
+    const float sign_s = offset_s > 0.0f ? 1.0f : (offset_s < 0.0f ? -1.0f : 0.0f);
+    const float sign_t = offset_t > 0.0f ? 1.0f : (offset_t < 0.0f ? -1.0f : 0.0f);
+
+    float c0[4], c1[4], c2[4];
+    gfx_software_sample_point(tex, s - offset_s / tex_width, t - offset_t / tex_height, c0);
+    gfx_software_sample_point(tex, s - (offset_s - sign_s) / tex_width, t - offset_t / tex_height, c1);
+    gfx_software_sample_point(tex, s - offset_s / tex_width, t - (offset_t - sign_t) / tex_height, c2);
+    for (int j = 0; j < 4; j++) {
+        out[j] = c0[j] + fabsf(offset_s) * (c1[j] - c0[j]) + fabsf(offset_t) * (c2[j] - c0[j]);
+    }
+}
+
+static inline float gfx_software_combine(const uint8_t c[4], bool do_single, bool do_multiply, bool do_mix,
+                                         const float items[][4], int component) {
+    const float a = items[c[0]][component];
+    const float b = items[c[1]][component];
+    const float factor = items[c[2]][component];
+    const float d = items[c[3]][component];
+    if (do_single) {
+        return d;
+    }
+    if (do_multiply) {
+        return a * factor;
+    }
+    if (do_mix) {
+        return gfx_software_mix(b, a, factor);
+    }
+    return (a - b) * factor + d;
+}
+
+// Fragment shader the GPU backends generate for the program. Returns false for a discarded fragment.
+static bool gfx_software_shade(const SoftwareDrawState& draw, const float* varyings, float frag_x, float frag_y,
+                               float texel[4]) {
+    const ShaderProgramSoftware* prg = draw.prg;
+    const CCFeatures& cc = prg->cc_features;
+
+    // Every combiner input as a color whose alpha is the value the alpha combiner reads
+    float items[SHADER_NOISE + 1][4] = {};
+    items[SHADER_1][0] = items[SHADER_1][1] = items[SHADER_1][2] = items[SHADER_1][3] = 1.0f;
+
+    for (int i = 0; i < 2; i++) {
+        if (!cc.used_textures[i]) {
+            continue;
+        }
+        const SoftwareTexture& tex = draw.textures[SHADER_FIRST_TEXTURE + i];
+        const bool has_data = tex.data != nullptr && !tex.data->rgba32.empty();
+        const float tex_width = has_data ? tex.data->width : 1.0f;
+        const float tex_height = has_data ? tex.data->height : 1.0f;
+
+        float s = varyings[prg->tex_coord[i]];
+        float t = varyings[prg->tex_coord[i] + 1];
+        if (cc.clamp[i][0]) {
+            s = std::min(std::max(s, 0.5f / tex_width), varyings[prg->tex_clamp[i][0]]);
+        }
+        if (cc.clamp[i][1]) {
+            t = std::min(std::max(t, 0.5f / tex_height), varyings[prg->tex_clamp[i][1]]);
+        }
+
+        float* tex_val = items[SHADER_TEXEL0 + 2 * i];
+        gfx_software_sample(tex, s, t, tex_width, tex_height, draw.three_point, tex_val);
+        if (cc.used_masks[i]) {
+            const SoftwareTexture& mask = draw.textures[SHADER_FIRST_MASK_TEXTURE + i];
+            float mask_val[4];
+            float blend_val[4] = {};
+            if (mask.data != nullptr && !mask.data->rgba32.empty()) {
+                gfx_software_sample(mask, s, t, mask.data->width, mask.data->height, draw.three_point, mask_val);
+            } else {
+                mask_val[3] = 0.0f;
+            }
+            if (cc.used_blend[i]) {
+                gfx_software_sample(draw.textures[SHADER_FIRST_REPLACEMENT_TEXTURE + i], s, t, tex_width, tex_height,
+                                    draw.three_point, blend_val);
+            }
+            for (int j = 0; j < 4; j++) {
+                tex_val[j] = gfx_software_mix(tex_val[j], blend_val[j], mask_val[3]);
+            }
+        }
+        float* tex_alpha = items[SHADER_TEXEL0A + 2 * i];
+        tex_alpha[0] = tex_alpha[1] = tex_alpha[2] = tex_alpha[3] = tex_val[3];
+    }
+
+    for (int i = 0; i < cc.num_inputs && i < SHADER_INPUT_7; i++) {
+        const float* input = varyings + prg->inputs + i * prg->input_size;
+        float* item = items[SHADER_INPUT_1 + i];
+        item[0] = input[0];
+        item[1] = input[1];
+        item[2] = input[2];
+        item[3] = cc.opt_alpha ? input[3] : 1.0f;
+    }
+
+    if (prg->uses_noise) {
+        const float noise = (gfx_software_random(floorf(frag_x * draw.noise_scale), floorf(frag_y * draw.noise_scale),
+                                                 (float)draw.frame_count) +
+                             1.0f) /
+                            2.0f;
+        items[SHADER_NOISE][0] = items[SHADER_NOISE][1] = items[SHADER_NOISE][2] = items[SHADER_NOISE][3] = noise;
+    }
+
+    for (int c = 0; c < (cc.opt_2cyc ? 2 : 1); c++) {
+        float combined[4];
+        for (int j = 0; j < 3; j++) {
+            combined[j] =
+                gfx_software_combine(cc.c[c][0], cc.do_single[c][0], cc.do_multiply[c][0], cc.do_mix[c][0], items, j);
+        }
+        if (!cc.opt_alpha) {
+            combined[3] = 1.0f;
+        } else if (cc.color_alpha_same[c]) {
+            combined[3] =
+                gfx_software_combine(cc.c[c][0], cc.do_single[c][0], cc.do_multiply[c][0], cc.do_mix[c][0], items, 3);
+        } else {
+            combined[3] =
+                gfx_software_combine(cc.c[c][1], cc.do_single[c][1], cc.do_multiply[c][1], cc.do_mix[c][1], items, 3);
+        }
+
+        if (c == 0) {
+            for (int j = 0; j < 3; j++) {
+                combined[j] = gfx_software_wrap(combined[j], -1.01f, 1.01f);
+            }
+        }
+        memcpy(items[SHADER_COMBINED], combined, sizeof(combined));
+    }
+
+    memcpy(texel, items[SHADER_COMBINED], 4 * sizeof(float));
+    for (int j = 0; j < 3; j++) {
+        texel[j] = std::min(std::max(gfx_software_wrap(texel[j], -0.51f, 1.51f), 0.0f), 1.0f);
+    }
+
+    if (cc.opt_fog) {
+        const float* fog = varyings + prg->fog;
+        for (int j = 0; j < 3; j++) {
+            texel[j] = gfx_software_mix(texel[j], fog[j], fog[3]);
+        }
+    }
+
+    if (cc.opt_texture_edge && cc.opt_alpha) {
+        if (!(texel[3] > 0.19f)) {
+            return false;
+        }
+        texel[3] = 1.0f;
+    }
+
+    if (cc.opt_alpha && cc.opt_noise) {
+        const float noise = gfx_software_random(floorf(frag_x * draw.noise_scale), floorf(frag_y * draw.noise_scale),
+                                                (float)draw.frame_count);
+        texel[3] *= floorf(std::min(std::max(noise + texel[3], 0.0f), 1.0f));
+    }
+
+    if (cc.opt_grayscale) {
+        const float* grayscale = varyings + prg->grayscale;
+        const float intensity = (texel[0] + texel[1] + texel[2]) / 3.0f;
+        for (int j = 0; j < 3; j++) {
+            texel[j] = gfx_software_mix(texel[j], grayscale[j] * intensity, grayscale[3]);
+        }
+    }
+
+    if (cc.opt_alpha) {
+        if (cc.opt_alpha_threshold && texel[3] < 8.0f / 256.0f) {
+            return false;
+        }
+        if (cc.opt_invisible) {
+            texel[3] = 0.0f;
+        }
+    } else {
+        texel[3] = 1.0f;
+    }
+    return true;
+}
+
+static void gfx_software_raster_tile(uint32_t tile, uint32_t tiles_x, SoftwareFramebuffer& fb) {
+    const int32_t tile_x0 = (tile % tiles_x) * TILE_SIZE;
+    const int32_t tile_y0 = (tile / tiles_x) * TILE_SIZE;
+    const int32_t tile_x1 = std::min(tile_x0 + TILE_SIZE, (int32_t)fb.width);
+    const int32_t tile_y1 = std::min(tile_y0 + TILE_SIZE, (int32_t)fb.height);
+    uint8_t* color = fb.color.data->rgba32.data();
+    float* depth = fb.has_depth_buffer ? fb.depth.data() : nullptr;
+    float varyings[MAX_VERTEX_FLOATS];
+
+    for (uint32_t index : tile_bins[tile]) {
+        const SoftwareTriangle& tri = triangles[index];
+        const SoftwareDrawState& draw = draws[tri.draw];
+        const float* plane = &planes[tri.planes];
+        const uint32_t num_varyings = draw.prg->num_varyings;
+
+        const int32_t x0 = std::max(tri.bounds.x0, tile_x0);
+        const int32_t y0 = std::max(tri.bounds.y0, tile_y0);
+        const int32_t x1 = std::min(tri.bounds.x1, tile_x1);
+        const int32_t y1 = std::min(tri.bounds.y1, tile_y1);
+
+        for (int32_t y = y0; y < y1; y++) {
+            const int64_t center_y = ((int64_t)y << SUBPIXEL_BITS) + (1 << (SUBPIXEL_BITS - 1));
+            const int64_t center_x = ((int64_t)x0 << SUBPIXEL_BITS) + (1 << (SUBPIXEL_BITS - 1));
+            int64_t e[3];
+            for (int k = 0; k < 3; k++) {
+                e[k] = tri.edge_a[k] * center_x + tri.edge_b[k] * center_y + tri.edge_c[k];
+            }
+
+            for (int32_t x = x0; x < x1; x++) {
+                const bool inside = (e[0] | e[1] | e[2]) >= 0;
+                for (int k = 0; k < 3; k++) {
+                    e[k] += tri.edge_a[k] << SUBPIXEL_BITS;
+                }
+                if (!inside) {
+                    continue;
+                }
+
+                const size_t pixel = (size_t)y * fb.width + x;
+                const float dx = x + 0.5f - tri.origin_x;
+                const float dy = y + 0.5f - tri.origin_y;
+                float z = (plane[0] + plane[1] * dx + plane[2] * dy) * 0.5f + 0.5f + tri.depth_offset;
+                z = std::min(std::max(z, 0.0f), 1.0f);
+                if (depth != nullptr && draw.depth_test && z > depth[pixel]) {
+                    continue;
+                }
+
+                const float w = 1.0f / (plane[3] + plane[4] * dx + plane[5] * dy);
+                for (uint32_t k = 0; k < num_varyings; k++) {
+                    const float* p = plane + 6 + k * 3;
+                    varyings[k] = (p[0] + p[1] * dx + p[2] * dy) * w;
+                }
+
+                float texel[4];
+                if (!gfx_software_shade(draw, varyings, x + 0.5f, y + 0.5f, texel)) {
+                    continue;
+                }
+                if (depth != nullptr && draw.depth_mask) {
+                    depth[pixel] = z;
+                }
+
+                uint8_t* dst = color + pixel * 4;
+                for (int j = 0; j < 3; j++) {
+                    const float value =
+                        draw.use_alpha ? gfx_software_mix(dst[j] * (1.0f / 255.0f), texel[j], texel[3]) : texel[j];
+                    dst[j] = gfx_software_to_unorm8(value);
+                }
+            }
+        }
+    }
+}
+
+// Rasterizes the queued draws, shading tiles on the worker pool and the calling thread
+static void gfx_software_flush(void) {
+    if (triangles.empty()) {
+        draws.clear();
+        return;
+    }
+
+    SoftwareFramebuffer& fb = framebuffers[current_framebuffer];
+    gfx_software_detach_color(fb);
+
+    const uint32_t tiles_x = (fb.width + TILE_SIZE - 1) / TILE_SIZE;
+    const uint32_t tiles_y = (fb.height + TILE_SIZE - 1) / TILE_SIZE;
+    if (tile_bins.size() < tiles_x * tiles_y) {
+        tile_bins.resize(tiles_x * tiles_y);
+    }
+    for (uint32_t i = 0; i < triangles.size(); i++) {
+        const SoftwareRect& bounds = triangles[i].bounds;
+        for (int32_t ty = bounds.y0 / TILE_SIZE; ty <= (bounds.y1 - 1) / TILE_SIZE; ty++) {
+            for (int32_t tx = bounds.x0 / TILE_SIZE; tx <= (bounds.x1 - 1) / TILE_SIZE; tx++) {
+                tile_bins[ty * tiles_x + tx].push_back(i);
+            }
+        }
+    }
+    busy_tiles.clear();
+    for (uint32_t tile = 0; tile < tiles_x * tiles_y; tile++) {
+        if (!tile_bins[tile].empty()) {
+            busy_tiles.push_back(tile);
+        }
+    }
+
+    const uint32_t threads = thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+    if (threads > 1 && (worker_pool == nullptr || worker_pool->get_thread_count() != threads - 1)) {
+        worker_pool = std::make_unique<BS::thread_pool>(threads - 1);
+    }
+
+    std::atomic<size_t> next_tile = 0;
+    auto shade_tiles = [&]() {
+        for (size_t i = next_tile++; i < busy_tiles.size(); i = next_tile++) {
+            gfx_software_raster_tile(busy_tiles[i], tiles_x, fb);
+        }
+    };
+    const size_t helpers = std::min<size_t>(threads - 1, busy_tiles.size() - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        worker_pool->push_task_back(shade_tiles);
+    }
+    shade_tiles();
+    if (helpers > 0) {
+        worker_pool->wait_for_tasks();
+    }
+
+    for (uint32_t tile : busy_tiles) {
+        tile_bins[tile].clear();
+    }
+    draws.clear();
+    triangles.clear();
+    planes.clear();
+}
+
+// Polygon offset of the OpenGL backend for decals, in window depth units
+static float gfx_software_decal_offset(float depth_slope) {
+    const float height = (float)framebuffers[current_framebuffer].height;
+    float factor;
+    switch (CVarGetInteger("gZFightingMode", 0)) {
+        case 1:
+            factor = -height / 120.0f;
+            break;
+        case 2:
+            factor = -height / 100.0f;
+            break;
+        default:
+            factor = -2.0f;
+            break;
+    }
+    return factor * depth_slope - 2.0f / 16777216.0f;
+}
+
+static void gfx_software_setup_triangle(const float* v0, const float* v1, const float* v2, uint32_t stride) {
+    const SoftwareDrawState& draw = draws.back();
+    const float* v[3] = { v0, v1, v2 };
+
+    int64_t fixed_x[3], fixed_y[3];
+    for (int i = 0; i < 3; i++) {
+        const float inv_w = 1.0f / v[i][3];
+        const float x = viewport.x0 + (v[i][0] * inv_w + 1.0f) * 0.5f * (viewport.x1 - viewport.x0);
+        const float y = viewport.y0 + (v[i][1] * inv_w + 1.0f) * 0.5f * (viewport.y1 - viewport.y0);
+        fixed_x[i] = (int64_t)floorf(x * (1 << SUBPIXEL_BITS) + 0.5f);
+        fixed_y[i] = (int64_t)floorf(y * (1 << SUBPIXEL_BITS) + 0.5f);
+    }
+
+    // Counterclockwise in window coordinates, where y points up
+    int64_t area = (fixed_x[1] - fixed_x[0]) * (fixed_y[2] - fixed_y[0]) -
+                   (fixed_y[1] - fixed_y[0]) * (fixed_x[2] - fixed_x[0]);
+    if (area == 0) {
+        return;
+    }
+    if (area < 0) {
+        std::swap(v[1], v[2]);
+        std::swap(fixed_x[1], fixed_x[2]);
+        std::swap(fixed_y[1], fixed_y[2]);
+    }
+
+    SoftwareTriangle tri;
+    tri.draw = (uint32_t)(draws.size() - 1);
+
+    const int64_t min_x = std::min({ fixed_x[0], fixed_x[1], fixed_x[2] });
+    const int64_t max_x = std::max({ fixed_x[0], fixed_x[1], fixed_x[2] });
+    const int64_t min_y = std::min({ fixed_y[0], fixed_y[1], fixed_y[2] });
+    const int64_t max_y = std::max({ fixed_y[0], fixed_y[1], fixed_y[2] });
+    const int64_t half = 1 << (SUBPIXEL_BITS - 1);
+    const int64_t round_up = (1 << SUBPIXEL_BITS) - 1;
+    // Pixels whose centers lie within the bounding box
+    tri.bounds.x0 = (int32_t)std::max<int64_t>((min_x - half + round_up) >> SUBPIXEL_BITS, draw.clip.x0);
+    tri.bounds.y0 = (int32_t)std::max<int64_t>((min_y - half + round_up) >> SUBPIXEL_BITS, draw.clip.y0);
+    tri.bounds.x1 = (int32_t)std::min<int64_t>(((max_x - half) >> SUBPIXEL_BITS) + 1, draw.clip.x1);
+    tri.bounds.y1 = (int32_t)std::min<int64_t>(((max_y - half) >> SUBPIXEL_BITS) + 1, draw.clip.y1);
+    if (tri.bounds.x0 >= tri.bounds.x1 || tri.bounds.y0 >= tri.bounds.y1) {
+        return;
+    }
+
+    for (int k = 0; k < 3; k++) {
+        const int a = k;
+        const int b = (k + 1) % 3;
+        const int64_t dx = fixed_x[b] - fixed_x[a];
+        const int64_t dy = fixed_y[b] - fixed_y[a];
+        tri.edge_a[k] = -dy;
+        tri.edge_b[k] = dx;
+        tri.edge_c[k] = dy * fixed_x[a] - dx * fixed_y[a];
+        // Pixel centers exactly on an edge belong to the triangle to its right or below it, so shared edges are
+        // drawn once. With a counterclockwise winding those are left edges, going down, and top edges, going left.
+        const bool top_left = dy < 0 || (dy == 0 && dx < 0);
+        if (!top_left) {
+            tri.edge_c[k] -= 1;
+        }
+    }
+
+    const float scale = 1.0f / (1 << SUBPIXEL_BITS);
+    tri.origin_x = fixed_x[0] * scale;
+    tri.origin_y = fixed_y[0] * scale;
+    const double dx1 = (fixed_x[1] - fixed_x[0]) * (double)scale;
+    const double dy1 = (fixed_y[1] - fixed_y[0]) * (double)scale;
+    const double dx2 = (fixed_x[2] - fixed_x[0]) * (double)scale;
+    const double dy2 = (fixed_y[2] - fixed_y[0]) * (double)scale;
+    const double det = dx1 * dy2 - dx2 * dy1;
+
+    tri.planes = (uint32_t)planes.size();
+    const uint32_t num_varyings = stride - 4;
+    const size_t first = planes.size();
+    planes.resize(first + (2 + num_varyings) * 3);
+    float* out = &planes[first];
+    const double inv_w[3] = { 1.0 / v[0][3], 1.0 / v[1][3], 1.0 / v[2][3] };
+    auto set_plane = [&](float* plane, double f0, double f1, double f2) {
+        plane[0] = (float)f0;
+        plane[1] = (float)(((f1 - f0) * dy2 - (f2 - f0) * dy1) / det);
+        plane[2] = (float)(((f2 - f0) * dx1 - (f1 - f0) * dx2) / det);
+    };
+    set_plane(out, v[0][2] * inv_w[0], v[1][2] * inv_w[1], v[2][2] * inv_w[2]);
+    set_plane(out + 3, inv_w[0], inv_w[1], inv_w[2]);
+    for (uint32_t k = 0; k < num_varyings; k++) {
+        set_plane(out + 6 + k * 3, v[0][4 + k] * inv_w[0], v[1][4 + k] * inv_w[1], v[2][4 + k] * inv_w[2]);
+    }
+
+    tri.depth_offset = 0.0f;
+    if (zmode_decal) {
+        tri.depth_offset = gfx_software_decal_offset(std::max(fabsf(out[1]), fabsf(out[2])) * 0.5f);
+    }
+    triangles.push_back(tri);
+}
+
+// Distance of a clip space vertex to one side of the guard band, or to w = 0. Depth is clamped rather than clipped,
+// as the OpenGL backend does.
+static inline float gfx_software_clip_distance(const float* v, int plane) {
+    switch (plane) {
+        case 0:
+            return v[3] - 1e-5f;
+        case 1:
+            return GUARD_BAND * v[3] - v[0];
+        case 2:
+            return GUARD_BAND * v[3] + v[0];
+        case 3:
+            return GUARD_BAND * v[3] - v[1];
+        default:
+            return GUARD_BAND * v[3] + v[1];
+    }
+}
+
+static void gfx_software_clip_triangle(const float* v0, const float* v1, const float* v2, uint32_t stride) {
+    bool inside = true;
+    for (int plane = 0; plane < 5 && inside; plane++) {
+        inside = gfx_software_clip_distance(v0, plane) >= 0.0f && gfx_software_clip_distance(v1, plane) >= 0.0f &&
+                 gfx_software_clip_distance(v2, plane) >= 0.0f;
+    }
+    if (inside) {
+        gfx_software_setup_triangle(v0, v1, v2, stride);
+        return;
+    }
+
+    float polygons[2][MAX_CLIP_VERTICES + 1][MAX_VERTEX_FLOATS];
+    size_t count = 3;
+    memcpy(polygons[0][0], v0, stride * sizeof(float));
+    memcpy(polygons[0][1], v1, stride * sizeof(float));
+    memcpy(polygons[0][2], v2, stride * sizeof(float));
+
+    int src = 0;
+    for (int plane = 0; plane < 5 && count >= 3; plane++) {
+        size_t out_count = 0;
+        for (size_t i = 0; i < count; i++) {
+            const float* a = polygons[src][i];
+            const float* b = polygons[src][(i + 1) % count];
+            const float da = gfx_software_clip_distance(a, plane);
+            const float db = gfx_software_clip_distance(b, plane);
+            if (da >= 0.0f) {
+                memcpy(polygons[src ^ 1][out_count++], a, stride * sizeof(float));
+            }
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                const float t = da / (da - db);
+                float* out = polygons[src ^ 1][out_count++];
+                for (uint32_t k = 0; k < stride; k++) {
+                    out[k] = gfx_software_mix(a[k], b[k], t);
+                }
+            }
+        }
+        count = out_count;
+        src ^= 1;
+    }
+
+    for (size_t i = 2; i < count; i++) {
+        gfx_software_setup_triangle(polygons[src][0], polygons[src][i - 1], polygons[src][i], stride);
+    }
+}
+
+static const char* gfx_software_get_name(void) {
+    return "Software";
+}
+
+static int gfx_software_get_max_texture_size(void) {
+    return 8192;
+}
+
+static struct GfxClipParameters gfx_software_get_clip_parameters(void) {
+    return { false, framebuffers[current_framebuffer].invert_y };
+}
+
+static void gfx_software_unload_shader(struct ShaderProgram* old_prg) {
+}
+
+static void gfx_software_load_shader(struct ShaderProgram* new_prg) {
+    current_program = (const ShaderProgramSoftware*)new_prg;
+}
+
+static struct ShaderProgram* gfx_software_create_and_load_new_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    ShaderProgramSoftware* prg = shader_program_pool.insert(std::make_pair(shader_id0, shader_id1));
+    prg->shader_id0 = shader_id0;
+    prg->shader_id1 = shader_id1;
+    gfx_cc_get_features(shader_id0, shader_id1, &prg->cc_features);
+    const CCFeatures& cc = prg->cc_features;
+
+    prg->uses_noise = false;
+    for (int c = 0; c < (cc.opt_2cyc ? 2 : 1); c++) {
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 4; j++) {
+                prg->uses_noise |= cc.c[c][i][j] == SHADER_NOISE;
+            }
+        }
+    }
+
+    // Same vertex layout as the GPU backends
+    uint8_t offset = 0;
+    for (int i = 0; i < 2; i++) {
+        if (cc.used_textures[i]) {
+            prg->tex_coord[i] = offset;
+            offset += 2;
+            for (int j = 0; j < 2; j++) {
+                if (cc.clamp[i][j]) {
+                    prg->tex_clamp[i][j] = offset++;
+                }
+            }
+        }
+    }
+    if (cc.opt_fog) {
+        prg->fog = offset;
+        offset += 4;
+    }
+    if (cc.opt_grayscale) {
+        prg->grayscale = offset;
+        offset += 4;
+    }
+    prg->inputs = offset;
+    prg->input_size = cc.opt_alpha ? 4 : 3;
+    prg->num_varyings = offset + cc.num_inputs * prg->input_size;
+
+    gfx_software_load_shader((struct ShaderProgram*)prg);
+    return (struct ShaderProgram*)prg;
+}
+
+static struct ShaderProgram* gfx_software_lookup_shader(uint64_t shader_id0, uint32_t shader_id1) {
+    return (struct ShaderProgram*)shader_program_pool.find(std::make_pair(shader_id0, shader_id1));
+}
+
+static void gfx_software_shader_get_info(struct ShaderProgram* prg, uint8_t* num_inputs, bool used_textures[2]) {
+    const ShaderProgramSoftware* p = (const ShaderProgramSoftware*)prg;
+    *num_inputs = p->cc_features.num_inputs;
+    used_textures[0] = p->cc_features.used_textures[0];
+    used_textures[1] = p->cc_features.used_textures[1];
+}
+
+static uint32_t gfx_software_new_texture(void) {
+    const uint32_t id = next_texture_id++;
+    textures[id];
+    return id;
+}
+
+static void gfx_software_select_texture(int tile, uint32_t texture_id) {
+    active_tile = tile;
+    auto it = textures.find(texture_id);
+    bound_textures[tile] = it != textures.end() ? &it->second : nullptr;
+}
+
+static void gfx_software_upload_texture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
+    SoftwareTexture* tex = bound_textures[active_tile];
+    if (tex == nullptr) {
+        return;
+    }
+    // Replaced rather than overwritten, the previous texels may still be read by queued draws
+    auto data = std::make_shared<SoftwareTextureData>();
+    data->width = width;
+    data->height = height;
+    data->rgba32.assign(rgba32_buf, rgba32_buf + (size_t)width * height * 4);
+    tex->data = std::move(data);
+}
+
+static void gfx_software_set_sampler_parameters(int tile, bool linear_filter, uint32_t cms, uint32_t cmt) {
+    active_tile = tile;
+    SoftwareTexture* tex = bound_textures[tile];
+    if (tex != nullptr) {
+        tex->sampler = { linear_filter && texture_filter == FILTER_LINEAR, cms, cmt };
+    }
+}
+
+static void gfx_software_set_depth_test_and_mask(bool depth_test_, bool z_upd) {
+    depth_test = depth_test_;
+    depth_mask = z_upd;
+}
+
+static void gfx_software_set_zmode_decal(bool zmode_decal_) {
+    zmode_decal = zmode_decal_;
+}
+
+static void gfx_software_set_viewport(int x, int y, int width, int height) {
+    viewport = { x, y, x + width, y + height };
+}
+
+static void gfx_software_set_scissor(int x, int y, int width, int height) {
+    scissor = { x, y, x + width, y + height };
+}
+
+static void gfx_software_set_use_alpha(bool use_alpha_) {
+    use_alpha = use_alpha_;
+}
+
+static void gfx_software_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+    if (current_program == nullptr || buf_vbo_num_tris == 0) {
+        return;
+    }
+    const SoftwareFramebuffer& fb = framebuffers[current_framebuffer];
+
+    SoftwareDrawState& draw = draws.emplace_back();
+    draw.prg = current_program;
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        if (bound_textures[i] != nullptr) {
+            draw.textures[i] = *bound_textures[i];
+        }
+    }
+    draw.three_point = texture_filter == FILTER_THREE_POINT;
+    draw.depth_test = depth_test;
+    draw.depth_mask = depth_mask;
+    draw.use_alpha = use_alpha;
+    draw.noise_scale = noise_scale;
+    draw.frame_count = frame_count;
+    draw.clip.x0 = std::max({ viewport.x0, scissor.x0, 0 });
+    draw.clip.y0 = std::max({ viewport.y0, scissor.y0, 0 });
+    draw.clip.x1 = std::min({ viewport.x1, scissor.x1, (int32_t)fb.width });
+    draw.clip.y1 = std::min({ viewport.y1, scissor.y1, (int32_t)fb.height });
+
+    const uint32_t stride = 4 + current_program->num_varyings;
+    if (draw.clip.x0 >= draw.clip.x1 || draw.clip.y0 >= draw.clip.y1 || stride > MAX_VERTEX_FLOATS ||
+        buf_vbo_len < buf_vbo_num_tris * 3 * stride) {
+        draws.pop_back();
+        return;
+    }
+
+    for (size_t i = 0; i < buf_vbo_num_tris; i++) {
+        const float* v = buf_vbo + i * 3 * stride;
+        gfx_software_clip_triangle(v, v + stride, v + 2 * stride, stride);
+    }
+}
+
+static void gfx_software_init(void) {
+    framebuffers.resize(1); // for the default screen buffer
+    framebuffers[0].width = 1;
+    framebuffers[0].height = 1;
+    framebuffers[0].color.data = gfx_software_new_color_buffer(1, 1);
+}
+
+static void gfx_software_on_resize(void) {
+}
+
+static void gfx_software_start_frame(void) {
+    frame_count++;
+}
+
+static void gfx_software_end_frame(void) {
+    gfx_software_flush();
+}
+
+static void gfx_software_finish_render(void) {
+    gfx_software_flush();
+}
+
+static int gfx_software_create_framebuffer(void) {
+    SoftwareFramebuffer& fb = framebuffers.emplace_back();
+    fb.width = 1;
+    fb.height = 1;
+    fb.color.data = gfx_software_new_color_buffer(1, 1);
+    return (int)framebuffers.size() - 1;
+}
+
+static void gfx_software_update_framebuffer_parameters(int fb_id, uint32_t width, uint32_t height,
+                                                       uint32_t msaa_level, bool opengl_invert_y, bool render_target,
+                                                       bool has_depth_buffer, bool can_extract_depth) {
+    gfx_software_flush();
+    SoftwareFramebuffer& fb = framebuffers[fb_id];
+
+    // Multisampling is not emulated, every framebuffer has one sample per pixel
+    width = std::max(width, 1U);
+    height = std::max(height, 1U);
+    if (fb.width != width || fb.height != height) {
+        fb.color.data = gfx_software_new_color_buffer(width, height);
+    }
+    if (!has_depth_buffer) {
+        fb.depth.clear();
+    } else if (fb.depth.size() != (size_t)width * height) {
+        fb.depth.assign((size_t)width * height, 1.0f);
+    }
+
+    fb.width = width;
+    fb.height = height;
+    fb.invert_y = opengl_invert_y;
+    fb.has_depth_buffer = has_depth_buffer;
+}
+
+static void gfx_software_start_draw_to_framebuffer(int fb_id, float noise_scale_) {
+    if (fb_id != current_framebuffer) {
+        gfx_software_flush();
+        current_framebuffer = fb_id;
+    }
+    if (noise_scale_ != 0.0f) {
+        noise_scale = 1.0f / noise_scale_;
+    }
+}
+
+// Nearest neighbour copy between rectangles in the manner of glBlitFramebuffer, flipping when src or dst are reversed
+static void gfx_software_blit(SoftwareTextureData& dst, const SoftwareTextureData& src, int src_x0, int src_y0,
+                              int src_x1, int src_y1, int dst_x0, int dst_y0, int dst_x1, int dst_y1) {
+    if (dst_x1 < dst_x0) {
+        std::swap(dst_x0, dst_x1);
+        std::swap(src_x0, src_x1);
+    }
+    if (dst_y1 < dst_y0) {
+        std::swap(dst_y0, dst_y1);
+        std::swap(src_y0, src_y1);
+    }
+    if (dst_x0 == dst_x1 || dst_y0 == dst_y1) {
+        return;
+    }
+
+    const float scale_x = (float)(src_x1 - src_x0) / (dst_x1 - dst_x0);
+    const float scale_y = (float)(src_y1 - src_y0) / (dst_y1 - dst_y0);
+    for (int y = std::max(dst_y0, 0); y < std::min(dst_y1, (int)dst.height); y++) {
+        const int sy = gfx_software_floor_to_int(src_y0 + (y - dst_y0 + 0.5f) * scale_y);
+        if (sy < 0 || sy >= (int)src.height) {
+            continue;
+        }
+        for (int x = std::max(dst_x0, 0); x < std::min(dst_x1, (int)dst.width); x++) {
+            const int sx = gfx_software_floor_to_int(src_x0 + (x - dst_x0 + 0.5f) * scale_x);
+            if (sx < 0 || sx >= (int)src.width) {
+                continue;
+            }
+            memcpy(&dst.rgba32[((size_t)y * dst.width + x) * 4], &src.rgba32[((size_t)sy * src.width + sx) * 4], 4);
+        }
+    }
+}
+
+static void gfx_software_copy_framebuffer(int fb_dst_id, int fb_src_id, int srcX0, int srcY0, int srcX1, int srcY1,
+                                          int dstX0, int dstY0, int dstX1, int dstY1) {
+    if (fb_dst_id >= (int)framebuffers.size() || fb_src_id >= (int)framebuffers.size()) {
+        return;
+    }
+    gfx_software_flush();
+
+    const SoftwareFramebuffer& src = framebuffers[fb_src_id];
+    SoftwareFramebuffer& dst = framebuffers[fb_dst_id];
+
+    // Same adjustments as the OpenGL backend, whose coordinates Fast3D passes
+    if (!src.invert_y) {
+        int temp = srcY1 - srcY0;
+        srcY1 = src.height - srcY0;
+        srcY0 = srcY1 - temp;
+    }
+    if (src.invert_y != dst.invert_y) {
+        std::swap(srcY0, srcY1);
+    }
+
+    // Holding the source makes a copy within one framebuffer read the texels from before the copy
+    const std::shared_ptr<SoftwareTextureData> src_data = src.color.data;
+    gfx_software_detach_color(dst);
+    gfx_software_blit(*dst.color.data, *src_data, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1);
+}
+
+static void gfx_software_clear_framebuffer(void) {
+    gfx_software_flush();
+    SoftwareFramebuffer& fb = framebuffers[current_framebuffer];
+    fb.color.data = gfx_software_new_color_buffer(fb.width, fb.height);
+    std::fill(fb.depth.begin(), fb.depth.end(), 1.0f);
+}
+
+static void gfx_software_read_framebuffer_to_cpu(int fb_id, uint32_t width, uint32_t height, uint16_t* rgba16_buf) {
+    if (fb_id >= (int)framebuffers.size()) {
+        return;
+    }
+    gfx_software_flush();
+
+    // RGBA5551 from the bottom row up, as glReadPixels returns it
+    const SoftwareFramebuffer& fb = framebuffers[fb_id];
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint16_t pixel = 0;
+            if (x < fb.width && y < fb.height) {
+                const uint8_t* src = &fb.color.data->rgba32[((size_t)y * fb.width + x) * 4];
+                pixel = (uint16_t)((((src[0] * 31 + 127) / 255) << 11) | (((src[1] * 31 + 127) / 255) << 6) |
+                                   (((src[2] * 31 + 127) / 255) << 1) | (src[3] >= 128 ? 1 : 0));
+            }
+            rgba16_buf[(size_t)y * width + x] = pixel;
+        }
+    }
+}
+
+static void gfx_software_resolve_msaa_color_buffer(int fb_id_target, int fb_id_source) {
+    gfx_software_flush();
+    const SoftwareFramebuffer& src = framebuffers[fb_id_source];
+    SoftwareFramebuffer& dst = framebuffers[fb_id_target];
+    const std::shared_ptr<SoftwareTextureData> src_data = src.color.data;
+    gfx_software_detach_color(dst);
+    gfx_software_blit(*dst.color.data, *src_data, 0, 0, src.width, src.height, 0, 0, dst.width, dst.height);
+}
+
+static void gfx_software_get_pixel_depth(int fb_id, const GfxPixelCoord* coordinates, size_t count,
+                                         uint16_t* depths) {
+    gfx_software_flush();
+    const SoftwareFramebuffer& fb = framebuffers[fb_id];
+
+    for (size_t i = 0; i < count; i++) {
+        const int x = (int)coordinates[i].x;
+        int y = (int)coordinates[i].y;
+        if (fb.invert_y) {
+            y = fb.height - y;
+        }
+        depths[i] = 0;
+        if (fb.has_depth_buffer && x >= 0 && y >= 0 && x < (int)fb.width && y < (int)fb.height) {
+            // Quantized like the 24 bit depth buffers of the GPU backends
+            const uint32_t depth24 = (uint32_t)(fb.depth[(size_t)y * fb.width + x] * 16777215.0f + 0.5f);
+            depths[i] = (depth24 >> 10) << 2;
+        }
+    }
+}
+
+static void* gfx_software_get_framebuffer_texture_id(int fb_id) {
+    return nullptr;
+}
+
+static void gfx_software_select_texture_fb(int fb_id) {
+    if (fb_id == current_framebuffer) {
+        gfx_software_flush();
+    }
+    active_tile = 0;
+    bound_textures[0] = &framebuffers[fb_id].color;
+}
+
+static void gfx_software_delete_texture(uint32_t texID) {
+    auto it = textures.find(texID);
+    if (it == textures.end()) {
+        return;
+    }
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        if (bound_textures[i] == &it->second) {
+            bound_textures[i] = nullptr;
+        }
+    }
+    textures.erase(it);
+}
+
+static void gfx_software_set_texture_filter(FilteringMode mode) {
+    texture_filter = mode;
+    gfx_texture_cache_clear();
+}
+
+static FilteringMode gfx_software_get_texture_filter(void) {
+    return texture_filter;
+}
+
+struct GfxRenderingAPI gfx_software_rapi = { gfx_software_get_name,
+                                             gfx_software_get_max_texture_size,
+                                             gfx_software_get_clip_parameters,
+                                             gfx_software_unload_shader,
+                                             gfx_software_load_shader,
+                                             gfx_software_create_and_load_new_shader,
+                                             gfx_software_lookup_shader,
+                                             gfx_software_shader_get_info,
+                                             gfx_software_new_texture,
+                                             gfx_software_select_texture,
+                                             gfx_software_upload_texture,
+                                             gfx_software_set_sampler_parameters,
+                                             gfx_software_set_depth_test_and_mask,
+                                             gfx_software_set_zmode_decal,
+                                             gfx_software_set_viewport,
+                                             gfx_software_set_scissor,
+                                             gfx_software_set_use_alpha,
+                                             gfx_software_draw_triangles,
+                                             nullptr,
+                                             gfx_software_init,
+                                             gfx_software_on_resize,
+                                             gfx_software_start_frame,
+                                             gfx_software_end_frame,
+                                             gfx_software_finish_render,
+                                             gfx_software_create_framebuffer,
+                                             gfx_software_update_framebuffer_parameters,
+                                             gfx_software_start_draw_to_framebuffer,
+                                             gfx_software_copy_framebuffer,
+                                             gfx_software_clear_framebuffer,
+                                             gfx_software_read_framebuffer_to_cpu,
+                                             gfx_software_resolve_msaa_color_buffer,
+                                             gfx_software_get_pixel_depth,
+                                             nullptr,
+                                             nullptr,
+                                             gfx_software_get_framebuffer_texture_id,
+                                             gfx_software_select_texture_fb,
+                                             gfx_software_delete_texture,
+                                             gfx_software_set_texture_filter,
+                                             gfx_software_get_texture_filter };
+
+void gfx_software_set_thread_count(uint32_t count) {
+    thread_count = count;
+}
+
+void gfx_software_read_framebuffer(int fb_id, std::vector<uint8_t>* rgba32_buf, uint32_t* width, uint32_t* height) {
+    gfx_software_flush();
+    const SoftwareFramebuffer& fb = framebuffers[fb_id];
+    const size_t row_size = (size_t)fb.width * 4;
+    rgba32_buf->resize(row_size * fb.height);
+    for (uint32_t y = 0; y < fb.height; y++) {
+        // Framebuffers Fast3D draws with inverted y already hold the image from the top down
+        const uint32_t src_y = fb.invert_y ? y : fb.height - 1 - y;
+        memcpy(rgba32_buf->data() + y * row_size, fb.color.data->rgba32.data() + src_y * row_size, row_size);
+    }
+    *width = fb.width;
+    *height = fb.height;
+}
@@ -0,0 +1,20 @@
+#ifndef GFX_SOFTWARE_H
+#define GFX_SOFTWARE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "gfx_rendering_api.h"
+
+// Rendering API that rasterizes on the CPU and evaluates the combiners described by gfx_cc. Triangles are binned into
+// screen tiles, and the tiles are shaded in parallel on a worker pool. Each tile draws its triangles in submission
+// order, so the output does not depend on the number of workers. Nothing is presented; pair it with gfx_headless_wapi
+// for golden-image tests, or read frames back on machines whose GPU drivers cannot be used.
+extern struct GfxRenderingAPI gfx_software_rapi;
+
+// Number of threads shading tiles, including the one calling into the API. 0 uses every hardware thread.
+void gfx_software_set_thread_count(uint32_t count);
+// Copies the color buffer of a framebuffer as RGBA8 rows from top to bottom, after finishing the queued draws
+void gfx_software_read_framebuffer(int fb_id, std::vector<uint8_t>* rgba32_buf, uint32_t* width, uint32_t* height);
+
+#endif
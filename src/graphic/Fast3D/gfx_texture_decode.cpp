@@ -0,0 +1,391 @@
+#include "gfx_texture_decode.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GFX_DECODE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define GFX_DECODE_NEON
+#include <arm_neon.h>
+#endif
+
+// Same expansions as SCALE_M_N in gfx_pc.cpp
+#define SCALE_5_8(VAL_) (((VAL_)*0xFF) / 0x1F)
+#define SCALE_4_8(VAL_) ((VAL_)*0x11)
+#define SCALE_3_8(VAL_) ((VAL_)*0x24)
+
+// (v * 1053) >> 7 equals SCALE_5_8(v) for every 5-bit v and fits in 16 bits, so the vector paths can use it
+#define SCALE_5_8_MUL 1053
+#define SCALE_5_8_SHIFT 7
+
+void gfx_decode_rgba16_scalar(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t col16 = (src[2 * i] << 8) | src[2 * i + 1];
+        uint8_t a = col16 & 1;
+        uint8_t r = col16 >> 11;
+        uint8_t g = (col16 >> 6) & 0x1f;
+        uint8_t b = (col16 >> 1) & 0x1f;
+        dst[4 * i + 0] = SCALE_5_8(r);
+        dst[4 * i + 1] = SCALE_5_8(g);
+        dst[4 * i + 2] = SCALE_5_8(b);
+        dst[4 * i + 3] = a ? 255 : 0;
+    }
+}
+
+void gfx_decode_ia4_scalar(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t part = (src[i / 2] >> (4 - (i % 2) * 4)) & 0xf;
+        uint8_t intensity = SCALE_3_8(part >> 1);
+        dst[4 * i + 0] = intensity;
+        dst[4 * i + 1] = intensity;
+        dst[4 * i + 2] = intensity;
+        dst[4 * i + 3] = (part & 1) ? 255 : 0;
+    }
+}
+
+void gfx_decode_ia8_scalar(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t intensity = SCALE_4_8(src[i] >> 4);
+        dst[4 * i + 0] = intensity;
+        dst[4 * i + 1] = intensity;
+        dst[4 * i + 2] = intensity;
+        dst[4 * i + 3] = SCALE_4_8(src[i] & 0xf);
+    }
+}
+
+void gfx_decode_ia16_scalar(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t intensity = src[2 * i];
+        dst[4 * i + 0] = intensity;
+        dst[4 * i + 1] = intensity;
+        dst[4 * i + 2] = intensity;
+        dst[4 * i + 3] = src[2 * i + 1];
+    }
+}
+
+void gfx_decode_i4_scalar(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t part = (src[i / 2] >> (4 - (i % 2) * 4)) & 0xf;
+        memset(dst + 4 * i, SCALE_4_8(part), 4);
+    }
+}
+
+void gfx_decode_i8_scalar(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        memset(dst + 4 * i, src[i], 4);
+    }
+}
+
+#if defined(GFX_DECODE_SSE2)
+
+// Interleaves eight texels held as 16-bit channel lanes into 32 bytes of RGBA8
+static inline void store_rgba8_sse2(uint8_t* dst, __m128i r, __m128i g, __m128i b, __m128i a) {
+    __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    __m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(rg, ba));
+}
+
+static inline __m128i scale_5_8_sse2(__m128i v) {
+    return _mm_srli_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(SCALE_5_8_MUL)), SCALE_5_8_SHIFT);
+}
+
+// 0xFF in every lane whose lowest bit is set
+static inline __m128i bit0_to_alpha_sse2(__m128i v) {
+    __m128i bit = _mm_and_si128(v, _mm_set1_epi16(1));
+    return _mm_and_si128(_mm_sub_epi16(_mm_setzero_si128(), bit), _mm_set1_epi16(0xff));
+}
+
+// Splits eight bytes into their sixteen nibbles, high nibble first, as two vectors of 16-bit lanes
+static inline void load_nibbles_sse2(const uint8_t* src, __m128i nibbles[2]) {
+    __m128i bytes = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)src), _mm_setzero_si128());
+    __m128i hi = _mm_srli_epi16(bytes, 4);
+    __m128i lo = _mm_and_si128(bytes, _mm_set1_epi16(0xf));
+    nibbles[0] = _mm_unpacklo_epi16(hi, lo);
+    nibbles[1] = _mm_unpackhi_epi16(hi, lo);
+}
+
+void gfx_decode_rgba16(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)); // Big endian load
+        __m128i r = _mm_srli_epi16(v, 11);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(v, 6), mask5);
+        __m128i b = _mm_and_si128(_mm_srli_epi16(v, 1), mask5);
+        store_rgba8_sse2(dst + 4 * i, scale_5_8_sse2(r), scale_5_8_sse2(g), scale_5_8_sse2(b), bit0_to_alpha_sse2(v));
+    }
+    gfx_decode_rgba16_scalar(src + 2 * i, dst + 4 * i, count - i);
+}
+
+void gfx_decode_ia4(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i nibbles[2];
+        load_nibbles_sse2(src + i / 2, nibbles);
+        for (int k = 0; k < 2; k++) {
+            __m128i intensity = _mm_mullo_epi16(_mm_srli_epi16(nibbles[k], 1), _mm_set1_epi16(0x24));
+            store_rgba8_sse2(dst + 4 * (i + 8 * k), intensity, intensity, intensity, bit0_to_alpha_sse2(nibbles[k]));
+        }
+    }
+    gfx_decode_ia4_scalar(src + i / 2, dst + 4 * i, count - i);
+}
+
+void gfx_decode_ia8(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mul4 = _mm_set1_epi16(0x11);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i halves[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+        for (int k = 0; k < 2; k++) {
+            __m128i intensity = _mm_mullo_epi16(_mm_srli_epi16(halves[k], 4), mul4);
+            __m128i alpha = _mm_mullo_epi16(_mm_and_si128(halves[k], _mm_set1_epi16(0xf)), mul4);
+            store_rgba8_sse2(dst + 4 * (i + 8 * k), intensity, intensity, intensity, alpha);
+        }
+    }
+    gfx_decode_ia8_scalar(src + i, dst + 4 * i, count - i);
+}
+
+void gfx_decode_ia16(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Each lane holds intensity in its low byte and alpha in its high byte
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+        __m128i intensity = _mm_and_si128(v, _mm_set1_epi16(0xff));
+        store_rgba8_sse2(dst + 4 * i, intensity, intensity, intensity, _mm_srli_epi16(v, 8));
+    }
+    gfx_decode_ia16_scalar(src + 2 * i, dst + 4 * i, count - i);
+}
+
+void gfx_decode_i4(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i nibbles[2];
+        load_nibbles_sse2(src + i / 2, nibbles);
+        for (int k = 0; k < 2; k++) {
+            __m128i intensity = _mm_mullo_epi16(nibbles[k], _mm_set1_epi16(0x11));
+            store_rgba8_sse2(dst + 4 * (i + 8 * k), intensity, intensity, intensity, intensity);
+        }
+    }
+    gfx_decode_i4_scalar(src + i / 2, dst + 4 * i, count - i);
+}
+
+void gfx_decode_i8(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, v);
+        __m128i hi = _mm_unpackhi_epi8(v, v);
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_unpacklo_epi16(lo, lo));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 16), _mm_unpackhi_epi16(lo, lo));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 32), _mm_unpacklo_epi16(hi, hi));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i + 48), _mm_unpackhi_epi16(hi, hi));
+    }
+    gfx_decode_i8_scalar(src + i, dst + 4 * i, count - i);
+}
+
+#elif defined(GFX_DECODE_NEON)
+
+// Splits eight bytes into their sixteen nibbles, high nibble first
+static inline uint8x8x2_t load_nibbles_neon(const uint8_t* src) {
+    uint8x8_t bytes = vld1_u8(src);
+    return vzip_u8(vshr_n_u8(bytes, 4), vand_u8(bytes, vdup_n_u8(0xf)));
+}
+
+void gfx_decode_rgba16(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    const uint16x8_t mul5 = vdupq_n_u16(SCALE_5_8_MUL);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + 2 * i))); // Big endian load
+        uint16x8_t r = vshrq_n_u16(v, 11);
+        uint16x8_t g = vandq_u16(vshrq_n_u16(v, 6), mask5);
+        uint16x8_t b = vandq_u16(vshrq_n_u16(v, 1), mask5);
+        uint8x8x4_t rgba;
+        rgba.val[0] = vmovn_u16(vshrq_n_u16(vmulq_u16(r, mul5), SCALE_5_8_SHIFT));
+        rgba.val[1] = vmovn_u16(vshrq_n_u16(vmulq_u16(g, mul5), SCALE_5_8_SHIFT));
+        rgba.val[2] = vmovn_u16(vshrq_n_u16(vmulq_u16(b, mul5), SCALE_5_8_SHIFT));
+        rgba.val[3] = vmovn_u16(vtstq_u16(v, vdupq_n_u16(1)));
+        vst4_u8(dst + 4 * i, rgba);
+    }
+    gfx_decode_rgba16_scalar(src + 2 * i, dst + 4 * i, count - i);
+}
+
+void gfx_decode_ia4(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x8x2_t nibbles = load_nibbles_neon(src + i / 2);
+        for (int k = 0; k < 2; k++) {
+            uint8x8_t intensity = vmul_u8(vshr_n_u8(nibbles.val[k], 1), vdup_n_u8(0x24));
+            uint8x8x4_t rgba = { { intensity, intensity, intensity, vtst_u8(nibbles.val[k], vdup_n_u8(1)) } };
+            vst4_u8(dst + 4 * (i + 8 * k), rgba);
+        }
+    }
+    gfx_decode_ia4_scalar(src + i / 2, dst + 4 * i, count - i);
+}
+
+void gfx_decode_ia8(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint8x16_t intensity = vmulq_u8(vshrq_n_u8(v, 4), vdupq_n_u8(0x11));
+        uint8x16_t alpha = vmulq_u8(vandq_u8(v, vdupq_n_u8(0xf)), vdupq_n_u8(0x11));
+        uint8x16x4_t rgba = { { intensity, intensity, intensity, alpha } };
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+    gfx_decode_ia8_scalar(src + i, dst + 4 * i, count - i);
+}
+
+void gfx_decode_ia16(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t ia = vld2q_u8(src + 2 * i);
+        uint8x16x4_t rgba = { { ia.val[0], ia.val[0], ia.val[0], ia.val[1] } };
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+    gfx_decode_ia16_scalar(src + 2 * i, dst + 4 * i, count - i);
+}
+
+void gfx_decode_i4(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x8x2_t nibbles = load_nibbles_neon(src + i / 2);
+        for (int k = 0; k < 2; k++) {
+            uint8x8_t intensity = vmul_u8(nibbles.val[k], vdup_n_u8(0x11));
+            uint8x8x4_t rgba = { { intensity, intensity, intensity, intensity } };
+            vst4_u8(dst + 4 * (i + 8 * k), rgba);
+        }
+    }
+    gfx_decode_i4_scalar(src + i / 2, dst + 4 * i, count - i);
+}
+
+void gfx_decode_i8(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint8x16x4_t rgba = { { v, v, v, v } };
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+    gfx_decode_i8_scalar(src + i, dst + 4 * i, count - i);
+}
+
+#else
+
+void gfx_decode_rgba16(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    gfx_decode_rgba16_scalar(src, dst, count);
+}
+
+void gfx_decode_ia4(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    gfx_decode_ia4_scalar(src, dst, count);
+}
+
+void gfx_decode_ia8(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    gfx_decode_ia8_scalar(src, dst, count);
+}
+
+void gfx_decode_ia16(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    gfx_decode_ia16_scalar(src, dst, count);
+}
+
+void gfx_decode_i4(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    gfx_decode_i4_scalar(src, dst, count);
+}
+
+void gfx_decode_i8(const uint8_t* src, uint8_t* dst, uint32_t count) {
+    gfx_decode_i8_scalar(src, dst, count);
+}
+
+#endif
+
+void gfx_mark_ci4_indices(const uint8_t* src, uint32_t count, bool* used) {
+    for (uint32_t i = 0; i < count; i++) {
+        used[(src[i / 2] >> (4 - (i % 2) * 4)) & 0xf] = true;
+    }
+}
+
+void gfx_mark_ci8_indices(const uint8_t* src, uint32_t count, bool* used) {
+    for (uint32_t i = 0; i < count; i++) {
+        used[src[i]] = true;
+    }
+}
+
+void gfx_decode_palette_rgba16(const uint8_t* palette, const bool* used, uint32_t entries, uint32_t* lut) {
+    for (uint32_t idx = 0; idx < entries; idx++) {
+        if (used[idx]) {
+            gfx_decode_rgba16_scalar(palette + 2 * idx, (uint8_t*)&lut[idx], 1);
+        }
+    }
+}
+
+void gfx_decode_ci4(const uint8_t* src, const uint32_t* lut, uint8_t* dst, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        uint8_t byte = src[i / 2];
+        memcpy(dst + 4 * i, &lut[byte >> 4], 4);
+        memcpy(dst + 4 * i + 4, &lut[byte & 0xf], 4);
+    }
+    if (i < count) {
+        memcpy(dst + 4 * i, &lut[src[i / 2] >> 4], 4);
+    }
+}
+
+void gfx_decode_ci8(const uint8_t* src, const uint32_t* lut, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(dst + 4 * i, &lut[src[i]], 4);
+    }
+}
+
+void gfx_decode_ci4_scalar(const uint8_t* src, const uint8_t* palette, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t idx = (src[i / 2] >> (4 - (i % 2) * 4)) & 0xf;
+        gfx_decode_rgba16_scalar(palette + 2 * idx, dst + 4 * i, 1);
+    }
+}
+
+void gfx_decode_ci8_scalar(const uint8_t* src, const uint8_t* palette, uint8_t* dst, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        gfx_decode_rgba16_scalar(palette + 2 * src[i], dst + 4 * i, 1);
+    }
+}
+
+static inline uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+uint64_t gfx_hash_texels(const uint8_t* src, uint32_t size) {
+    const uint64_t k = 0x9e3779b97f4a7c15ULL;
+    // Four independent lanes so the multiplies of consecutive words can overlap
+    uint64_t lanes[4] = { k, k * 3, k * 5, k * 7 };
+    uint32_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t word;
+            memcpy(&word, src + i + 8 * l, 8);
+            lanes[l] = (lanes[l] ^ word) * k;
+            lanes[l] ^= lanes[l] >> 29;
+        }
+    }
+
+    uint64_t h = size;
+    for (int l = 0; l < 4; l++) {
+        h = hash_mix(h ^ lanes[l]);
+    }
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, src + i, 8);
+        h = hash_mix(h ^ word);
+    }
+    if (i < size) {
+        uint64_t word = 0;
+        memcpy(&word, src + i, size - i);
+        h = hash_mix(h ^ word);
+    }
+    return h;
+}
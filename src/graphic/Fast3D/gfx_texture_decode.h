@@ -0,0 +1,38 @@
+#ifndef GFX_TEXTURE_DECODE_H
+#define GFX_TEXTURE_DECODE_H
+
+#include <stdint.h>
+
+// Span decoders from N64 texture formats to RGBA8. Each converts count consecutive texels from src into 4 * count
+// bytes at dst, using SSE2 or NEON where available; the results are identical to the scalar path on every target.
+// 4-bit formats read the high nibble of each byte first.
+void gfx_decode_rgba16(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_ia4(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_ia8(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_ia16(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_i4(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_i8(const uint8_t* src, uint8_t* dst, uint32_t count);
+
+// CI textures are decoded through a lookup table holding the RGBA8 word of each palette entry. Only the entries
+// marked as used are read from the palette, since a TLUT may be shorter than the full 16 or 256 entries.
+void gfx_mark_ci4_indices(const uint8_t* src, uint32_t count, bool* used);
+void gfx_mark_ci8_indices(const uint8_t* src, uint32_t count, bool* used);
+void gfx_decode_palette_rgba16(const uint8_t* palette, const bool* used, uint32_t entries, uint32_t* lut);
+void gfx_decode_ci4(const uint8_t* src, const uint32_t* lut, uint8_t* dst, uint32_t count);
+void gfx_decode_ci8(const uint8_t* src, const uint32_t* lut, uint8_t* dst, uint32_t count);
+
+// One texel at a time, as Fast3D decoded textures before the vector paths. The vector paths are tested against these,
+// and the CI variants read the big endian palette directly instead of going through a lookup table.
+void gfx_decode_rgba16_scalar(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_ia4_scalar(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_ia8_scalar(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_ia16_scalar(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_i4_scalar(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_i8_scalar(const uint8_t* src, uint8_t* dst, uint32_t count);
+void gfx_decode_ci4_scalar(const uint8_t* src, const uint8_t* palette, uint8_t* dst, uint32_t count);
+void gfx_decode_ci8_scalar(const uint8_t* src, const uint8_t* palette, uint8_t* dst, uint32_t count);
+
+// 64-bit hash of raw texture data, used to find identical textures loaded from different addresses
+uint64_t gfx_hash_texels(const uint8_t* src, uint32_t size);
+
+#endif
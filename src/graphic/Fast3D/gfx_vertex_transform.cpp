@@ -0,0 +1,486 @@
+#include "gfx_vertex_transform.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GFX_TRANSFORM_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define GFX_TRANSFORM_NEON
+#include <arm_neon.h>
+#endif
+
+void gfx_transform_vertex_positions_scalar(const float mtx[4][4], const Vtx* vertices, size_t count, float (*out)[4]) {
+    for (size_t i = 0; i < count; i++) {
+        const Vtx_t* v = &vertices[i].v;
+        for (int j = 0; j < 4; j++) {
+            out[i][j] = v->ob[0] * mtx[0][j] + v->ob[1] * mtx[1][j] + v->ob[2] * mtx[2][j] + mtx[3][j];
+        }
+    }
+}
+
+void gfx_transform_vertex_positions(const float mtx[4][4], const Vtx* vertices, size_t count, float (*out)[4]) {
+    size_t i = 0;
+
+#if defined(GFX_TRANSFORM_SSE)
+    __m128 m[4][4];
+    for (int r = 0; r < 4; r++) {
+        for (int j = 0; j < 4; j++) {
+            m[r][j] = _mm_set1_ps(mtx[r][j]);
+        }
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        const Vtx_t* v0 = &vertices[i + 0].v;
+        const Vtx_t* v1 = &vertices[i + 1].v;
+        const Vtx_t* v2 = &vertices[i + 2].v;
+        const Vtx_t* v3 = &vertices[i + 3].v;
+        const __m128 x = _mm_setr_ps(v0->ob[0], v1->ob[0], v2->ob[0], v3->ob[0]);
+        const __m128 y = _mm_setr_ps(v0->ob[1], v1->ob[1], v2->ob[1], v3->ob[1]);
+        const __m128 z = _mm_setr_ps(v0->ob[2], v1->ob[2], v2->ob[2], v3->ob[2]);
+
+        // res[j] holds component j of all four vertices
+        __m128 res[4];
+        for (int j = 0; j < 4; j++) {
+            __m128 sum = _mm_mul_ps(x, m[0][j]);
+            sum = _mm_add_ps(sum, _mm_mul_ps(y, m[1][j]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(z, m[2][j]));
+            res[j] = _mm_add_ps(sum, m[3][j]);
+        }
+
+        _MM_TRANSPOSE4_PS(res[0], res[1], res[2], res[3]);
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_ps(out[i + k], res[k]);
+        }
+    }
+#elif defined(GFX_TRANSFORM_NEON)
+    for (; i + 4 <= count; i += 4) {
+        const Vtx_t* v0 = &vertices[i + 0].v;
+        const Vtx_t* v1 = &vertices[i + 1].v;
+        const Vtx_t* v2 = &vertices[i + 2].v;
+        const Vtx_t* v3 = &vertices[i + 3].v;
+        const float xs[4] = { (float)v0->ob[0], (float)v1->ob[0], (float)v2->ob[0], (float)v3->ob[0] };
+        const float ys[4] = { (float)v0->ob[1], (float)v1->ob[1], (float)v2->ob[1], (float)v3->ob[1] };
+        const float zs[4] = { (float)v0->ob[2], (float)v1->ob[2], (float)v2->ob[2], (float)v3->ob[2] };
+        const float32x4_t x = vld1q_f32(xs);
+        const float32x4_t y = vld1q_f32(ys);
+        const float32x4_t z = vld1q_f32(zs);
+
+        // res.val[j] holds component j of all four vertices, and vst4q interleaves them back into xyzw per vertex
+        float32x4x4_t res;
+        for (int j = 0; j < 4; j++) {
+            float32x4_t sum = vmulq_n_f32(x, mtx[0][j]);
+            sum = vaddq_f32(sum, vmulq_n_f32(y, mtx[1][j]));
+            sum = vaddq_f32(sum, vmulq_n_f32(z, mtx[2][j]));
+            res.val[j] = vaddq_f32(sum, vdupq_n_f32(mtx[3][j]));
+        }
+
+        vst4q_f32(out[i], res);
+    }
+#endif
+
+    gfx_transform_vertex_positions_scalar(mtx, vertices + i, count - i, out + i);
+}
+
+void gfx_matrix_mul_scalar(float res[4][4], const float a[4][4], const float b[4][4]) {
+    float tmp[4][4];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            tmp[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+        }
+    }
+    memcpy(res, tmp, sizeof(tmp));
+}
+
+void gfx_matrix_mul(float res[4][4], const float a[4][4], const float b[4][4]) {
+#if defined(GFX_TRANSFORM_SSE)
+    const __m128 row0 = _mm_loadu_ps(b[0]);
+    const __m128 row1 = _mm_loadu_ps(b[1]);
+    const __m128 row2 = _mm_loadu_ps(b[2]);
+    const __m128 row3 = _mm_loadu_ps(b[3]);
+    __m128 tmp[4];
+    for (int i = 0; i < 4; i++) {
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(a[i][0]), row0);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i][1]), row1));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i][2]), row2));
+        tmp[i] = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i][3]), row3));
+    }
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_ps(res[i], tmp[i]);
+    }
+#elif defined(GFX_TRANSFORM_NEON)
+    const float32x4_t row0 = vld1q_f32(b[0]);
+    const float32x4_t row1 = vld1q_f32(b[1]);
+    const float32x4_t row2 = vld1q_f32(b[2]);
+    const float32x4_t row3 = vld1q_f32(b[3]);
+    float32x4_t tmp[4];
+    for (int i = 0; i < 4; i++) {
+        float32x4_t sum = vmulq_n_f32(row0, a[i][0]);
+        sum = vaddq_f32(sum, vmulq_n_f32(row1, a[i][1]));
+        sum = vaddq_f32(sum, vmulq_n_f32(row2, a[i][2]));
+        tmp[i] = vaddq_f32(sum, vmulq_n_f32(row3, a[i][3]));
+    }
+    for (int i = 0; i < 4; i++) {
+        vst1q_f32(res[i], tmp[i]);
+    }
+#else
+    gfx_matrix_mul_scalar(res, a, b);
+#endif
+}
+
+void gfx_transposed_matrix_mul_scalar(float res[3], const float a[3], const float b[4][4]) {
+    res[0] = a[0] * b[0][0] + a[1] * b[0][1] + a[2] * b[0][2];
+    res[1] = a[0] * b[1][0] + a[1] * b[1][1] + a[2] * b[1][2];
+    res[2] = a[0] * b[2][0] + a[1] * b[2][1] + a[2] * b[2][2];
+}
+
+void gfx_transposed_matrix_mul(float res[3], const float a[3], const float b[4][4]) {
+#if defined(GFX_TRANSFORM_SSE)
+    __m128 col0 = _mm_loadu_ps(b[0]);
+    __m128 col1 = _mm_loadu_ps(b[1]);
+    __m128 col2 = _mm_loadu_ps(b[2]);
+    __m128 col3 = _mm_loadu_ps(b[3]);
+    _MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+    __m128 sum = _mm_mul_ps(_mm_set1_ps(a[0]), col0);
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[1]), col1));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[2]), col2));
+    float out[4];
+    _mm_storeu_ps(out, sum);
+    memcpy(res, out, 3 * sizeof(float));
+#elif defined(GFX_TRANSFORM_NEON)
+    const float32x4x4_t cols = vld4q_f32(&b[0][0]);
+    float32x4_t sum = vmulq_n_f32(cols.val[0], a[0]);
+    sum = vaddq_f32(sum, vmulq_n_f32(cols.val[1], a[1]));
+    sum = vaddq_f32(sum, vmulq_n_f32(cols.val[2], a[2]));
+    float out[4];
+    vst1q_f32(out, sum);
+    memcpy(res, out, 3 * sizeof(float));
+#else
+    gfx_transposed_matrix_mul_scalar(res, a, b);
+#endif
+}
+
+// Ship::Math::clamp(v, -1.0f, 1.0f), which passes NaN through
+static inline float gfx_clamp_unit(float v) {
+    const float t = v < -1.0f ? -1.0f : v;
+    return t > 1.0f ? 1.0f : t;
+}
+
+void gfx_light_vertices_scalar(const GfxVertexLight* lights, int num_lights, const uint8_t ambient[3],
+                               const float modelview[4][4], const Vtx* vertices, const float (*eye_pos)[4],
+                               size_t count, uint8_t (*out)[3]) {
+    for (size_t i = 0; i < count; i++) {
+        const Vtx_tn* vn = &vertices[i].n;
+        int r = ambient[0];
+        int g = ambient[1];
+        int b = ambient[2];
+
+        for (int l = 0; l < num_lights; l++) {
+            const GfxVertexLight* light = &lights[l];
+            float intensity;
+            if (light->positional) {
+                // Calculate distance from the light to the vertex
+                float dist_vec[3] = { light->pos[0] - eye_pos[i][0], light->pos[1] - eye_pos[i][1],
+                                      light->pos[2] - eye_pos[i][2] };
+                float dist_sq = dist_vec[0] * dist_vec[0] + dist_vec[1] * dist_vec[1] +
+                                dist_vec[2] * dist_vec[2] * 2; // The *2 comes from GLideN64, unsure of why it does it
+                float dist = sqrtf(dist_sq);
+
+                // Transform distance vector (which acts as a direction light vector) into model's space
+                float light_model[3];
+                gfx_transposed_matrix_mul_scalar(light_model, dist_vec, modelview);
+
+                // Calculate intensity for each axis using standard formula for intensity
+                float light_intensity[3];
+                for (int k = 0; k < 3; k++) {
+                    light_intensity[k] = gfx_clamp_unit(4.0f * light_model[k] / dist_sq);
+                }
+
+                // Adjust intensity based on surface normal and sum up total
+                float total_intensity = gfx_clamp_unit(light_intensity[0] * vn->n[0] + light_intensity[1] * vn->n[1] +
+                                                       light_intensity[2] * vn->n[2]);
+
+                // Attenuate intensity based on attenuation values.
+                // Example formula found at https://ogldev.org/www/tutorial20/tutorial20.html
+                // Specific coefficients for MM's microcode sourced from GLideN64
+                // https://github.com/gonetz/GLideN64/blob/3b43a13a80dfc2eb6357673440b335e54eaa3896/src/gSP.cpp#L636
+                float distf = floorf(dist);
+                float attenuation =
+                    (distf * light->linear_attenuation + distf * distf * light->quadratic_attenuation) / (float)0xFFFF +
+                    1.0f;
+                intensity = total_intensity / attenuation;
+            } else {
+                intensity = (vn->n[0] * light->dir[0] + vn->n[1] * light->dir[1] + vn->n[2] * light->dir[2]) / 127.0f;
+            }
+            if (intensity > 0.0f) {
+                r += intensity * light->color[0];
+                g += intensity * light->color[1];
+                b += intensity * light->color[2];
+            }
+        }
+
+        out[i][0] = r > 255 ? 255 : r;
+        out[i][1] = g > 255 ? 255 : g;
+        out[i][2] = b > 255 ? 255 : b;
+    }
+}
+
+#if defined(GFX_TRANSFORM_SSE)
+static inline __m128 gfx_clamp_unit_sse(__m128 v) {
+    // With the bound first, max and min return the second operand for NaN the way the scalar clamp does
+    return _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_set1_ps(-1.0f), v));
+}
+
+static inline __m128 gfx_truncate_sse(__m128 v) {
+    return _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+}
+
+static inline __m128 gfx_select_sse(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#elif defined(GFX_TRANSFORM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+// Division, square roots and rounding toward zero only have vector forms on AArch64
+#define GFX_LIGHTING_NEON
+
+static inline float32x4_t gfx_clamp_unit_neon(float32x4_t v) {
+    return vminq_f32(vdupq_n_f32(1.0f), vmaxq_f32(vdupq_n_f32(-1.0f), v));
+}
+#endif
+
+void gfx_light_vertices(const GfxVertexLight* lights, int num_lights, const uint8_t ambient[3],
+                        const float modelview[4][4], const Vtx* vertices, const float (*eye_pos)[4], size_t count,
+                        uint8_t (*out)[3]) {
+    size_t i = 0;
+
+#if defined(GFX_TRANSFORM_SSE)
+    for (; i + 4 <= count; i += 4) {
+        const Vtx_tn* n0 = &vertices[i + 0].n;
+        const Vtx_tn* n1 = &vertices[i + 1].n;
+        const Vtx_tn* n2 = &vertices[i + 2].n;
+        const Vtx_tn* n3 = &vertices[i + 3].n;
+        const __m128 nx = _mm_setr_ps(n0->n[0], n1->n[0], n2->n[0], n3->n[0]);
+        const __m128 ny = _mm_setr_ps(n0->n[1], n1->n[1], n2->n[1], n3->n[1]);
+        const __m128 nz = _mm_setr_ps(n0->n[2], n1->n[2], n2->n[2], n3->n[2]);
+
+        // eye[j] holds component j of all four eye space positions
+        __m128 eye[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+        if (eye_pos != NULL) {
+            for (int k = 0; k < 4; k++) {
+                eye[k] = _mm_loadu_ps(eye_pos[i + k]);
+            }
+            _MM_TRANSPOSE4_PS(eye[0], eye[1], eye[2], eye[3]);
+        }
+
+        __m128 color[3];
+        for (int c = 0; c < 3; c++) {
+            color[c] = _mm_set1_ps(ambient[c]);
+        }
+
+        for (int l = 0; l < num_lights; l++) {
+            const GfxVertexLight* light = &lights[l];
+            __m128 intensity;
+            if (light->positional) {
+                const __m128 dx = _mm_sub_ps(_mm_set1_ps(light->pos[0]), eye[0]);
+                const __m128 dy = _mm_sub_ps(_mm_set1_ps(light->pos[1]), eye[1]);
+                const __m128 dz = _mm_sub_ps(_mm_set1_ps(light->pos[2]), eye[2]);
+                const __m128 dist_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                                  _mm_mul_ps(_mm_mul_ps(dz, dz), _mm_set1_ps(2.0f)));
+                const __m128 dist = _mm_sqrt_ps(dist_sq);
+
+                __m128 light_intensity[3];
+                for (int k = 0; k < 3; k++) {
+                    __m128 light_model = _mm_mul_ps(dx, _mm_set1_ps(modelview[k][0]));
+                    light_model = _mm_add_ps(light_model, _mm_mul_ps(dy, _mm_set1_ps(modelview[k][1])));
+                    light_model = _mm_add_ps(light_model, _mm_mul_ps(dz, _mm_set1_ps(modelview[k][2])));
+                    light_intensity[k] =
+                        gfx_clamp_unit_sse(_mm_div_ps(_mm_mul_ps(_mm_set1_ps(4.0f), light_model), dist_sq));
+                }
+
+                __m128 total_intensity = _mm_mul_ps(light_intensity[0], nx);
+                total_intensity = _mm_add_ps(total_intensity, _mm_mul_ps(light_intensity[1], ny));
+                total_intensity = _mm_add_ps(total_intensity, _mm_mul_ps(light_intensity[2], nz));
+                total_intensity = gfx_clamp_unit_sse(total_intensity);
+
+                // The distance is never negative, so truncating floors it. Distances from 2^23 up, infinity and NaN
+                // have no fraction to drop and are kept as they are.
+                const __m128 has_fraction = _mm_cmplt_ps(dist, _mm_set1_ps(8388608.0f));
+                const __m128 distf = gfx_select_sse(has_fraction, gfx_truncate_sse(dist), dist);
+                __m128 attenuation = _mm_add_ps(_mm_mul_ps(distf, _mm_set1_ps(light->linear_attenuation)),
+                                                _mm_mul_ps(_mm_mul_ps(distf, distf),
+                                                           _mm_set1_ps(light->quadratic_attenuation)));
+                attenuation = _mm_add_ps(_mm_div_ps(attenuation, _mm_set1_ps((float)0xFFFF)), _mm_set1_ps(1.0f));
+                intensity = _mm_div_ps(total_intensity, attenuation);
+            } else {
+                __m128 dot = _mm_mul_ps(nx, _mm_set1_ps(light->dir[0]));
+                dot = _mm_add_ps(dot, _mm_mul_ps(ny, _mm_set1_ps(light->dir[1])));
+                dot = _mm_add_ps(dot, _mm_mul_ps(nz, _mm_set1_ps(light->dir[2])));
+                intensity = _mm_div_ps(dot, _mm_set1_ps(127.0f));
+            }
+
+            // The scalar path adds to an int, which truncates every sum
+            const __m128 lit = _mm_cmpgt_ps(intensity, _mm_setzero_ps());
+            for (int c = 0; c < 3; c++) {
+                const __m128 sum =
+                    gfx_truncate_sse(_mm_add_ps(color[c], _mm_mul_ps(intensity, _mm_set1_ps(light->color[c]))));
+                color[c] = gfx_select_sse(lit, sum, color[c]);
+            }
+        }
+
+        float colors[3][4];
+        for (int c = 0; c < 3; c++) {
+            _mm_storeu_ps(colors[c], _mm_min_ps(color[c], _mm_set1_ps(255.0f)));
+        }
+        for (int k = 0; k < 4; k++) {
+            for (int c = 0; c < 3; c++) {
+                out[i + k][c] = (uint8_t)colors[c][k];
+            }
+        }
+    }
+#elif defined(GFX_LIGHTING_NEON)
+    for (; i + 4 <= count; i += 4) {
+        const Vtx_tn* n0 = &vertices[i + 0].n;
+        const Vtx_tn* n1 = &vertices[i + 1].n;
+        const Vtx_tn* n2 = &vertices[i + 2].n;
+        const Vtx_tn* n3 = &vertices[i + 3].n;
+        const float xs[4] = { (float)n0->n[0], (float)n1->n[0], (float)n2->n[0], (float)n3->n[0] };
+        const float ys[4] = { (float)n0->n[1], (float)n1->n[1], (float)n2->n[1], (float)n3->n[1] };
+        const float zs[4] = { (float)n0->n[2], (float)n1->n[2], (float)n2->n[2], (float)n3->n[2] };
+        const float32x4_t nx = vld1q_f32(xs);
+        const float32x4_t ny = vld1q_f32(ys);
+        const float32x4_t nz = vld1q_f32(zs);
+
+        // eye.val[j] holds component j of all four eye space positions
+        float32x4x4_t eye = { { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) } };
+        if (eye_pos != NULL) {
+            eye = vld4q_f32(eye_pos[i]);
+        }
+
+        float32x4_t color[3];
+        for (int c = 0; c < 3; c++) {
+            color[c] = vdupq_n_f32(ambient[c]);
+        }
+
+        for (int l = 0; l < num_lights; l++) {
+            const GfxVertexLight* light = &lights[l];
+            float32x4_t intensity;
+            if (light->positional) {
+                const float32x4_t dx = vsubq_f32(vdupq_n_f32(light->pos[0]), eye.val[0]);
+                const float32x4_t dy = vsubq_f32(vdupq_n_f32(light->pos[1]), eye.val[1]);
+                const float32x4_t dz = vsubq_f32(vdupq_n_f32(light->pos[2]), eye.val[2]);
+                const float32x4_t dist_sq =
+                    vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_n_f32(vmulq_f32(dz, dz), 2.0f));
+                const float32x4_t dist = vsqrtq_f32(dist_sq);
+
+                float32x4_t light_intensity[3];
+                for (int k = 0; k < 3; k++) {
+                    float32x4_t light_model = vmulq_n_f32(dx, modelview[k][0]);
+                    light_model = vaddq_f32(light_model, vmulq_n_f32(dy, modelview[k][1]));
+                    light_model = vaddq_f32(light_model, vmulq_n_f32(dz, modelview[k][2]));
+                    light_intensity[k] = gfx_clamp_unit_neon(vdivq_f32(vmulq_n_f32(light_model, 4.0f), dist_sq));
+                }
+
+                float32x4_t total_intensity = vmulq_f32(light_intensity[0], nx);
+                total_intensity = vaddq_f32(total_intensity, vmulq_f32(light_intensity[1], ny));
+                total_intensity = vaddq_f32(total_intensity, vmulq_f32(light_intensity[2], nz));
+                total_intensity = gfx_clamp_unit_neon(total_intensity);
+
+                // The distance is never negative, so rounding toward zero floors it
+                const float32x4_t distf = vrndq_f32(dist);
+                float32x4_t attenuation = vaddq_f32(vmulq_n_f32(distf, light->linear_attenuation),
+                                                    vmulq_n_f32(vmulq_f32(distf, distf), light->quadratic_attenuation));
+                attenuation = vaddq_f32(vdivq_f32(attenuation, vdupq_n_f32((float)0xFFFF)), vdupq_n_f32(1.0f));
+                intensity = vdivq_f32(total_intensity, attenuation);
+            } else {
+                float32x4_t dot = vmulq_n_f32(nx, light->dir[0]);
+                dot = vaddq_f32(dot, vmulq_n_f32(ny, light->dir[1]));
+                dot = vaddq_f32(dot, vmulq_n_f32(nz, light->dir[2]));
+                intensity = vdivq_f32(dot, vdupq_n_f32(127.0f));
+            }
+
+            // The scalar path adds to an int, which truncates every sum
+            const uint32x4_t lit = vcgtq_f32(intensity, vdupq_n_f32(0.0f));
+            for (int c = 0; c < 3; c++) {
+                const float32x4_t sum = vrndq_f32(vaddq_f32(color[c], vmulq_n_f32(intensity, light->color[c])));
+                color[c] = vbslq_f32(lit, sum, color[c]);
+            }
+        }
+
+        float colors[3][4];
+        for (int c = 0; c < 3; c++) {
+            vst1q_f32(colors[c], vminq_f32(color[c], vdupq_n_f32(255.0f)));
+        }
+        for (int k = 0; k < 4; k++) {
+            for (int c = 0; c < 3; c++) {
+                out[i + k][c] = (uint8_t)colors[c][k];
+            }
+        }
+    }
+#endif
+
+    gfx_light_vertices_scalar(lights, num_lights, ambient, modelview, vertices + i,
+                              eye_pos != NULL ? eye_pos + i : NULL, count - i, out + i);
+}
+
+void gfx_texgen_vertices_scalar(const float lookat[2][3], const Vtx* vertices, size_t count, float (*out)[2]) {
+    for (size_t i = 0; i < count; i++) {
+        const Vtx_tn* vn = &vertices[i].n;
+        for (int j = 0; j < 2; j++) {
+            const float dot = vn->n[0] * lookat[j][0] + vn->n[1] * lookat[j][1] + vn->n[2] * lookat[j][2];
+            out[i][j] = gfx_clamp_unit(dot / 127.0f);
+        }
+    }
+}
+
+void gfx_texgen_vertices(const float lookat[2][3], const Vtx* vertices, size_t count, float (*out)[2]) {
+    size_t i = 0;
+
+#if defined(GFX_TRANSFORM_SSE)
+    for (; i + 4 <= count; i += 4) {
+        const Vtx_tn* n0 = &vertices[i + 0].n;
+        const Vtx_tn* n1 = &vertices[i + 1].n;
+        const Vtx_tn* n2 = &vertices[i + 2].n;
+        const Vtx_tn* n3 = &vertices[i + 3].n;
+        const __m128 nx = _mm_setr_ps(n0->n[0], n1->n[0], n2->n[0], n3->n[0]);
+        const __m128 ny = _mm_setr_ps(n0->n[1], n1->n[1], n2->n[1], n3->n[1]);
+        const __m128 nz = _mm_setr_ps(n0->n[2], n1->n[2], n2->n[2], n3->n[2]);
+
+        float dots[2][4];
+        for (int j = 0; j < 2; j++) {
+            __m128 dot = _mm_mul_ps(nx, _mm_set1_ps(lookat[j][0]));
+            dot = _mm_add_ps(dot, _mm_mul_ps(ny, _mm_set1_ps(lookat[j][1])));
+            dot = _mm_add_ps(dot, _mm_mul_ps(nz, _mm_set1_ps(lookat[j][2])));
+            _mm_storeu_ps(dots[j], gfx_clamp_unit_sse(_mm_div_ps(dot, _mm_set1_ps(127.0f))));
+        }
+        for (int k = 0; k < 4; k++) {
+            out[i + k][0] = dots[0][k];
+            out[i + k][1] = dots[1][k];
+        }
+    }
+#elif defined(GFX_LIGHTING_NEON)
+    for (; i + 4 <= count; i += 4) {
+        const Vtx_tn* n0 = &vertices[i + 0].n;
+        const Vtx_tn* n1 = &vertices[i + 1].n;
+        const Vtx_tn* n2 = &vertices[i + 2].n;
+        const Vtx_tn* n3 = &vertices[i + 3].n;
+        const float xs[4] = { (float)n0->n[0], (float)n1->n[0], (float)n2->n[0], (float)n3->n[0] };
+        const float ys[4] = { (float)n0->n[1], (float)n1->n[1], (float)n2->n[1], (float)n3->n[1] };
+        const float zs[4] = { (float)n0->n[2], (float)n1->n[2], (float)n2->n[2], (float)n3->n[2] };
+        const float32x4_t nx = vld1q_f32(xs);
+        const float32x4_t ny = vld1q_f32(ys);
+        const float32x4_t nz = vld1q_f32(zs);
+
+        // vst2q interleaves the two dot products back into pairs per vertex
+        float32x4x2_t dots;
+        for (int j = 0; j < 2; j++) {
+            float32x4_t dot = vmulq_n_f32(nx, lookat[j][0]);
+            dot = vaddq_f32(dot, vmulq_n_f32(ny, lookat[j][1]));
+            dot = vaddq_f32(dot, vmulq_n_f32(nz, lookat[j][2]));
+            dots.val[j] = gfx_clamp_unit_neon(vdivq_f32(dot, vdupq_n_f32(127.0f)));
+        }
+        vst2q_f32(out[i], dots);
+    }
+#endif
+
+    gfx_texgen_vertices_scalar(lookat, vertices + i, count - i, out + i);
+}
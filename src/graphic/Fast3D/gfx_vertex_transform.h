@@ -0,0 +1,53 @@
+#ifndef GFX_VERTEX_TRANSFORM_H
+#define GFX_VERTEX_TRANSFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libultraship/libultra/types.h"
+#include "libultraship/libultra/gbi.h"
+
+// Transforms the positions of count vertices by a row vector matrix, writing x, y, z and w for each vertex. The SSE
+// and NEON paths transform four vertices at a time with one vertex per lane, and keep the multiply and add order of
+// the scalar path. Both give identical results unless the compiler contracts the scalar math into fused multiply-adds,
+// in which case they differ by an ulp or so.
+void gfx_transform_vertex_positions(const float mtx[4][4], const Vtx* vertices, size_t count, float (*out)[4]);
+void gfx_transform_vertex_positions_scalar(const float mtx[4][4], const Vtx* vertices, size_t count, float (*out)[4]);
+
+// res = a * b, where res may alias either input. The SIMD paths add the products in the same order as the scalar
+// path, so again the results only differ where the scalar math is contracted.
+void gfx_matrix_mul(float res[4][4], const float a[4][4], const float b[4][4]);
+void gfx_matrix_mul_scalar(float res[4][4], const float a[4][4], const float b[4][4]);
+// res = a * the transposed upper 3x3 of b
+void gfx_transposed_matrix_mul(float res[3], const float a[3], const float b[4][4]);
+void gfx_transposed_matrix_mul_scalar(float res[3], const float a[3], const float b[4][4]);
+
+// A directional or point light as gfx_light_vertices takes it, filled in from the RSP light state
+typedef struct {
+    // The light direction as calculate_normal_dir normalizes it
+    float dir[3];
+    float color[3];
+    // Point lights light a vertex by its distance to pos and ignore dir
+    bool positional;
+    float pos[3];
+    // The light's attenuation bytes times 2 and divided by 8, which scales them exactly
+    float linear_attenuation;
+    float quadratic_attenuation;
+} GfxVertexLight;
+
+// Lights count vertices by their normals, starting from the ambient color and adding every light facing the normal,
+// and writes the colors clamped to 255. Point lights need the eye space position of each vertex in eye_pos, which may
+// be NULL otherwise, and the modelview matrix to bring the light vector back into model space. The SIMD paths light
+// four vertices at a time with the same operations in the same order as the scalar path.
+void gfx_light_vertices(const GfxVertexLight* lights, int num_lights, const uint8_t ambient[3],
+                        const float modelview[4][4], const Vtx* vertices, const float (*eye_pos)[4], size_t count,
+                        uint8_t (*out)[3]);
+void gfx_light_vertices_scalar(const GfxVertexLight* lights, int num_lights, const uint8_t ambient[3],
+                               const float modelview[4][4], const Vtx* vertices, const float (*eye_pos)[4],
+                               size_t count, uint8_t (*out)[3]);
+
+// Writes the dot products of each normal with the two lookat directions, divided by 127 and clamped to [-1, 1]
+void gfx_texgen_vertices(const float lookat[2][3], const Vtx* vertices, size_t count, float (*out)[2]);
+void gfx_texgen_vertices_scalar(const float lookat[2][3], const Vtx* vertices, size_t count, float (*out)[2]);
+
+#endif
@@ -25,6 +25,9 @@ struct GfxWindowManagerAPI {
     void (*set_maximum_frame_latency)(int latency);
     const char* (*get_key_name)(int scancode);
     bool (*can_disable_vsync)();
+    // Optional, binds the rendering context to the calling thread or releases it. Null when the rendering API isn't
+    // tied to a thread.
+    void (*make_context_current)(bool current);
 };
 
 #endif
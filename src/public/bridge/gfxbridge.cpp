@@ -1,6 +1,7 @@
 #include "gfxbridge.h"
 
 #include "graphic/Fast3D/gfx_pc.h"
+#include "public/bridge/resourcebridge.h"
 
 // Set the dimensions for the VI mode that the console would be using
 // (Usually 320x240 for lo-res and 640x480 for hi-res)
@@ -8,3 +9,11 @@ extern "C" void GfxSetNativeDimensions(uint32_t width, uint32_t height) {
     gfx_native_dimensions.width = width;
     gfx_native_dimensions.height = height;
 }
+
+// Decode a texture ahead of its first draw, for example while a scene is loading
+extern "C" void GfxPredecodeTexture(const char* texPath) {
+    auto texture = std::dynamic_pointer_cast<LUS::Texture>(ResourceLoad(texPath));
+    if (texture != nullptr) {
+        gfx_texture_predecode(texture);
+    }
+}
@@ -14,6 +14,7 @@ typedef enum UcodeHandlers {
 } UcodeHandlers;
 
 void GfxSetNativeDimensions(uint32_t width, uint32_t height);
+void GfxPredecodeTexture(const char* texPath);
 
 #ifdef __cplusplus
 }
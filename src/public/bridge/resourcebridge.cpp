@@ -9,14 +9,16 @@ std::shared_ptr<Ship::IResource> ResourceLoad(const char* name) {
 }
 
 std::shared_ptr<Ship::IResource> ResourceLoad(uint64_t crc) {
-    auto name = ResourceGetNameByCrc(crc);
+    // The archive's path string is passed on as is, converting it to const char* would copy it for every lookup
+    const std::string* name =
+        Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToString(crc);
 
-    if (name == nullptr || strlen(name) == 0) {
+    if (name == nullptr || name->empty()) {
         SPDLOG_TRACE("ResourceLoad: Unknown crc {}\n", crc);
         return nullptr;
     }
 
-    return ResourceLoad(name);
+    return Ship::Context::GetInstance()->GetResourceManager()->LoadResource(*name);
 }
 
 extern "C" {
@@ -70,14 +72,13 @@ void* ResourceGetDataByName(const char* name) {
 }
 
 void* ResourceGetDataByCrc(uint64_t crc) {
-    auto name = ResourceGetNameByCrc(crc);
+    auto resource = ResourceLoad(crc);
 
-    if (name == nullptr || strlen(name) == 0) {
-        SPDLOG_TRACE("ResourceGetDataByCrc: Unknown crc {}\n", crc);
+    if (resource == nullptr) {
         return nullptr;
     }
 
-    return ResourceGetDataByName(name);
+    return resource->GetRawPointer();
 }
 
 uint16_t ResourceGetTexWidthByName(const char* name) {
@@ -12,13 +12,15 @@
 namespace Ship {
 
 ResourceManager::ResourceManager() {
+    // Resources of these types are never changed after loading and nothing looks them up by the path they were loaded
+    // from, so byte-identical files can share one instance. Textures stay out, see SetResourceTypeDeduplicated.
+    mDeduplicatedResourceTypes = { static_cast<uint32_t>(LUS::ResourceType::Vertex),
+                                   static_cast<uint32_t>(LUS::ResourceType::Array),
+                                   static_cast<uint32_t>(LUS::ResourceType::Blob) };
 }
 
 void ResourceManager::Init(const std::vector<std::string>& otrFiles, const std::unordered_set<uint32_t>& validHashes,
                            int32_t reservedThreadCount) {
-    mResourceLoader = std::make_shared<ResourceLoader>();
-    mArchiveManager = std::make_shared<ArchiveManager>();
-    GetArchiveManager()->Init(otrFiles, validHashes);
 #if defined(__SWITCH__)
     size_t threadCount = 1;
 #else
@@ -27,6 +29,10 @@ void ResourceManager::Init(const std::vector<std::string>& otrFiles, const std::
 #endif
     mThreadPool = std::make_shared<BS::thread_pool>(threadCount);
 
+    mResourceLoader = std::make_shared<ResourceLoader>();
+    mArchiveManager = std::make_shared<ArchiveManager>();
+    GetArchiveManager()->Init(otrFiles, validHashes);
+
     if (!DidLoadSuccessfully()) {
         // Nothing ever unpauses the thread pool since nothing will ever try to load the archive again.
         mThreadPool->pause();
@@ -74,7 +80,7 @@ ResourceManager::LoadResourceProcess(const std::string& filePath, bool loadExact
 
     // While waiting in the queue, another thread could have loaded the resource.
     // In a last attempt to avoid doing work that will be discarded, let's check if the cached version exists.
-    auto cacheLine = CheckCache(filePath, loadExact);
+    auto cacheLine = CheckCache(filePath, loadExact, initData);
     auto cachedResource = GetCachedResource(cacheLine);
     if (cachedResource != nullptr) {
         return cachedResource;
@@ -97,6 +103,14 @@ ResourceManager::LoadResourceProcess(const std::string& filePath, bool loadExact
         }
     }
 
+    // Another path with byte-identical content may already be loaded.
+    if (initData == nullptr) {
+        auto deduplicatedResource = GetDeduplicatedResource(filePath);
+        if (deduplicatedResource != nullptr) {
+            return deduplicatedResource;
+        }
+    }
+
     // Get the file from the OTR
     auto file = LoadFileProcess(filePath, initData);
     if (file == nullptr) {
@@ -106,9 +120,25 @@ ResourceManager::LoadResourceProcess(const std::string& filePath, bool loadExact
     // Transform the raw data into a resource
     auto resource = GetResourceLoader()->LoadResource(file);
 
+    resource = CacheResource(filePath, resource);
+    if (initData == nullptr) {
+        RegisterDeduplicatedResource(filePath, resource);
+    }
+
+    if (resource != nullptr) {
+        SPDLOG_TRACE("Loaded Resource {} on ResourceManager", filePath);
+    } else {
+        SPDLOG_TRACE("Resource load FAILED {} on ResourceManager", filePath);
+    }
+
+    return resource;
+}
+
+std::shared_ptr<Ship::IResource> ResourceManager::CacheResource(const std::string& filePath,
+                                                                std::shared_ptr<Ship::IResource> resource) {
     // Another thread could have loaded the resource while we were processing, so we want to check before setting to
     // the cache.
-    cachedResource = GetCachedResource(filePath, true);
+    auto cachedResource = GetCachedResource(filePath, true);
     {
         const std::lock_guard<std::mutex> lock(mMutex);
 
@@ -126,15 +156,83 @@ ResourceManager::LoadResourceProcess(const std::string& filePath, bool loadExact
         }
     }
 
-    if (resource != nullptr) {
-        SPDLOG_TRACE("Loaded Resource {} on ResourceManager", filePath);
-    } else {
-        SPDLOG_TRACE("Resource load FAILED {} on ResourceManager", filePath);
+    return resource;
+}
+
+std::shared_ptr<Ship::IResource> ResourceManager::GetDeduplicatedResource(const std::string& filePath) {
+    const auto fileInfo = GetArchiveManager()->GetFileInfo(filePath);
+    if (fileInfo == nullptr || fileInfo->HasMetaFile || (fileInfo->Crc32 == 0 && fileInfo->Size == 0)) {
+        return nullptr;
+    }
+
+    // Declared before the lock for the same reason as in CheckCache, the reference may be the last one.
+    std::shared_ptr<Ship::IResource> resource = nullptr;
+    const std::lock_guard<std::mutex> lock(mMutex);
+
+    auto contentFind = mResourcesByContent.find({ fileInfo->Crc32, fileInfo->Size });
+    if (contentFind == mResourcesByContent.end()) {
+        return nullptr;
+    }
+
+    resource = contentFind->second.lock();
+    if (resource == nullptr) {
+        mResourcesByContent.erase(contentFind);
+        return nullptr;
+    }
+
+    if (resource->IsDirty() || !mDeduplicatedResourceTypes.contains(resource->GetInitData()->Type)) {
+        return nullptr;
     }
 
+    mDeduplicatedResourceCount++;
+    mDeduplicatedByteCount += fileInfo->Size;
+    mResourceCache[filePath] = resource;
     return resource;
 }
 
+void ResourceManager::RegisterDeduplicatedResource(const std::string& filePath,
+                                                   std::shared_ptr<Ship::IResource> resource) {
+    if (resource == nullptr || resource->GetInitData() == nullptr) {
+        return;
+    }
+
+    const auto fileInfo = GetArchiveManager()->GetFileInfo(filePath);
+    if (fileInfo == nullptr || fileInfo->HasMetaFile || (fileInfo->Crc32 == 0 && fileInfo->Size == 0)) {
+        return;
+    }
+
+    const std::lock_guard<std::mutex> lock(mMutex);
+
+    if (!mDeduplicatedResourceTypes.contains(resource->GetInitData()->Type)) {
+        return;
+    }
+
+    auto& contentResource = mResourcesByContent[{ fileInfo->Crc32, fileInfo->Size }];
+    if (contentResource.expired()) {
+        contentResource = resource;
+    }
+}
+
+void ResourceManager::SetResourceTypeDeduplicated(uint32_t resourceType, bool deduplicated) {
+    const std::lock_guard<std::mutex> lock(mMutex);
+
+    if (deduplicated) {
+        mDeduplicatedResourceTypes.insert(resourceType);
+    } else {
+        mDeduplicatedResourceTypes.erase(resourceType);
+    }
+}
+
+size_t ResourceManager::GetDeduplicatedResourceCount() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mDeduplicatedResourceCount;
+}
+
+uint64_t ResourceManager::GetDeduplicatedByteCount() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mDeduplicatedByteCount;
+}
+
 std::shared_future<std::shared_ptr<Ship::IResource>>
 ResourceManager::LoadResourceAsync(const std::string& filePath, bool loadExact, bool priority,
                                    std::shared_ptr<Ship::ResourceInitData> initData) {
@@ -145,7 +243,7 @@ ResourceManager::LoadResourceAsync(const std::string& filePath, bool loadExact,
     }
 
     // Check the cache before queueing the job.
-    auto cacheCheck = GetCachedResource(filePath, loadExact);
+    auto cacheCheck = GetCachedResource(CheckCache(filePath, loadExact, initData));
     if (cacheCheck) {
         auto promise = std::make_shared<std::promise<std::shared_ptr<Ship::IResource>>>();
         promise->set_value(cacheCheck);
@@ -163,6 +261,15 @@ ResourceManager::LoadResourceAsync(const std::string& filePath, bool loadExact,
 
 std::shared_ptr<Ship::IResource> ResourceManager::LoadResource(const std::string& filePath, bool loadExact,
                                                                std::shared_ptr<Ship::ResourceInitData> initData) {
+    // Return cached resources directly, the already fulfilled promise LoadResourceAsync makes for them would be
+    // allocated on every call.
+    if (!OtrSignatureCheck(filePath.c_str())) {
+        auto cachedResource = GetCachedResource(CheckCache(filePath, loadExact, initData));
+        if (cachedResource != nullptr) {
+            return cachedResource;
+        }
+    }
+
     auto resource = LoadResourceAsync(filePath, loadExact, true, initData).get();
     if (resource == nullptr) {
         SPDLOG_ERROR("Failed to load resource file at path {}", filePath);
@@ -170,11 +277,145 @@ std::shared_ptr<Ship::IResource> ResourceManager::LoadResource(const std::string
     return resource;
 }
 
+std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>>>
+ResourceManager::LoadResources(std::span<const std::string> filePaths, bool priority) {
+    auto batch = std::make_shared<ResourceBatch>();
+    batch->Resources = std::make_shared<std::vector<std::shared_ptr<Ship::IResource>>>(filePaths.size());
+    auto future = batch->Promise.get_future().share();
+
+    // Group every uncached file by the archive that owns it, so that each archive is read front to back in a single
+    // pass instead of seeking back and forth between files requested in arbitrary order.
+    std::vector<std::pair<std::shared_ptr<Archive>, std::vector<ResourceBatchEntry>>> groups;
+    size_t pending = 0;
+
+    for (size_t i = 0; i < filePaths.size(); i++) {
+        auto filePath = filePaths[i];
+
+        // Hashes that no archive knows about arrive as empty paths. Leave their slot empty instead of caching a miss
+        // under an empty key.
+        if (filePath.empty()) {
+            continue;
+        }
+
+        // Check for and remove the OTR signature
+        if (OtrSignatureCheck(filePath.c_str())) {
+            filePath = filePath.substr(7);
+        }
+
+        // Prefer the alternate version of the asset when it exists.
+        if (CVarGetInteger("gAltAssets", 0) && !filePath.starts_with(IResource::gAltAssetPrefix)) {
+            const auto altPath = IResource::gAltAssetPrefix + filePath;
+            if (GetArchiveManager()->HasFile(altPath)) {
+                filePath = altPath;
+            }
+        }
+
+        auto cachedResource = GetCachedResource(filePath, true);
+        if (cachedResource == nullptr) {
+            cachedResource = GetDeduplicatedResource(filePath);
+        }
+        if (cachedResource != nullptr) {
+            batch->Resources->at(i) = cachedResource;
+            continue;
+        }
+
+        auto archive = GetArchiveManager()->GetArchiveForFile(filePath);
+        if (archive == nullptr) {
+            SPDLOG_TRACE("Failed to load resource file at path {}", filePath);
+            CacheResource(filePath, nullptr);
+            continue;
+        }
+
+        auto group =
+            std::find_if(groups.begin(), groups.end(), [&archive](const auto& g) { return g.first == archive; });
+        if (group == groups.end()) {
+            group = groups.insert(groups.end(), { archive, {} });
+        }
+        group->second.push_back({ archive->GetFileOffset(filePath), i, filePath });
+        pending++;
+    }
+
+    if (pending == 0) {
+        batch->Promise.set_value(batch->Resources);
+        return future;
+    }
+
+    batch->Remaining = pending;
+    for (auto& [archive, entries] : groups) {
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const ResourceBatchEntry& a, const ResourceBatchEntry& b) { return a.Offset < b.Offset; });
+
+        if (priority) {
+            mThreadPool->push_task_front(&ResourceManager::LoadResourcesProcess, this, batch, archive,
+                                         std::move(entries), priority);
+        } else {
+            mThreadPool->push_task_back(&ResourceManager::LoadResourcesProcess, this, batch, archive,
+                                        std::move(entries), priority);
+        }
+    }
+
+    return future;
+}
+
+std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>>>
+ResourceManager::LoadResources(std::span<const uint64_t> hashes, bool priority) {
+    std::vector<std::string> filePaths;
+    filePaths.reserve(hashes.size());
+
+    for (const auto hash : hashes) {
+        const auto filePath = GetArchiveManager()->HashToString(hash);
+        if (filePath == nullptr) {
+            SPDLOG_ERROR("Failed to load resource with unknown hash {:016X}", hash);
+            filePaths.emplace_back();
+            continue;
+        }
+        filePaths.push_back(*filePath);
+    }
+
+    return LoadResources(std::span<const std::string>(filePaths), priority);
+}
+
+void ResourceManager::LoadResourcesProcess(std::shared_ptr<ResourceBatch> batch, std::shared_ptr<Archive> archive,
+                                           std::vector<ResourceBatchEntry> entries, bool priority) {
+    // Reads happen sequentially in archive order on this worker. Turning the raw files into resources is independent
+    // per file, so that part is handed back to the pool. This task never waits on the work it queues, which keeps it
+    // safe when the pool only has a single thread.
+    for (const auto& entry : entries) {
+        auto file = archive->LoadFile(entry.Path);
+        if (file != nullptr) {
+            file->Parent = archive;
+        }
+
+        if (priority) {
+            mThreadPool->push_task_front(&ResourceManager::LoadResourcesFinish, this, batch, entry.Index, entry.Path,
+                                         file);
+        } else {
+            mThreadPool->push_task_back(&ResourceManager::LoadResourcesFinish, this, batch, entry.Index, entry.Path,
+                                        file);
+        }
+    }
+}
+
+void ResourceManager::LoadResourcesFinish(std::shared_ptr<ResourceBatch> batch, size_t index,
+                                          const std::string& filePath, std::shared_ptr<Ship::File> file) {
+    auto resource = CacheResource(filePath, GetResourceLoader()->LoadResource(file));
+    RegisterDeduplicatedResource(filePath, resource);
+    if (resource == nullptr) {
+        SPDLOG_TRACE("Resource load FAILED {} on ResourceManager", filePath);
+    }
+
+    batch->Resources->at(index) = resource;
+    if (--batch->Remaining == 0) {
+        batch->Promise.set_value(batch->Resources);
+    }
+}
+
 std::variant<ResourceManager::ResourceLoadError, std::shared_ptr<Ship::IResource>>
-ResourceManager::CheckCache(const std::string& filePath, bool loadExact) {
+ResourceManager::CheckCache(const std::string& filePath, bool loadExact,
+                            std::shared_ptr<Ship::ResourceInitData> initData) {
     if (!loadExact && CVarGetInteger("gAltAssets", 0) && !filePath.starts_with(IResource::gAltAssetPrefix)) {
         const auto altPath = IResource::gAltAssetPrefix + filePath;
-        auto altCacheResult = CheckCache(altPath, loadExact);
+        auto altCacheResult = CheckCache(altPath, loadExact, initData);
 
         // If the type held at this cache index is a resource, then we return it.
         // Else we attempt to load standard definition assets.
@@ -183,11 +424,32 @@ ResourceManager::CheckCache(const std::string& filePath, bool loadExact) {
         }
     }
 
+    // The reference taken on an unloaded resource may turn out to be the last one, so it is declared before the lock to
+    // be released after it. The resource will attempt to load other resources on the destructor, and this will fail if
+    // we still hold the mutex.
+    std::shared_ptr<Ship::IResource> unloadedResource = nullptr;
     const std::lock_guard<std::mutex> lock(mMutex);
 
     auto resourceCacheFind = mResourceCache.find(filePath);
     if (resourceCacheFind == mResourceCache.end()) {
-        return ResourceLoadError::NotCached;
+        DropStaleUnloadedResources();
+        auto unloadedFind = mUnloadedResources.find(filePath);
+        if (unloadedFind == mUnloadedResources.end()) {
+            return ResourceLoadError::NotCached;
+        }
+
+        unloadedResource = unloadedFind->second.lock();
+        mUnloadedResources.erase(unloadedFind);
+        if (unloadedResource == nullptr || unloadedResource->IsDirty() ||
+            !InitDataMatches(unloadedResource->GetInitData(), initData)) {
+            return ResourceLoadError::NotCached;
+        }
+
+        // Something outside the cache kept the resource alive after it was unloaded. Put it back instead of loading a
+        // duplicate.
+        mResurrectedResourceCount++;
+        mResourceCache[filePath] = unloadedResource;
+        return unloadedResource;
     }
 
     return resourceCacheFind->second;
@@ -239,16 +501,8 @@ ResourceManager::LoadDirectoryAsync(const std::string& searchMask, bool priority
 
 std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>>
 ResourceManager::LoadDirectory(const std::string& searchMask) {
-    auto futureList = LoadDirectoryAsync(searchMask, true);
-    auto loadedList = std::make_shared<std::vector<std::shared_ptr<Ship::IResource>>>();
-
-    for (size_t i = 0; i < futureList->size(); i++) {
-        const auto future = futureList->at(i);
-        const auto resource = future.get();
-        loadedList->push_back(resource);
-    }
-
-    return loadedList;
+    auto fileList = GetArchiveManager()->ListFiles(searchMask);
+    return LoadResources(*fileList, true).get();
 }
 
 void ResourceManager::DirtyDirectory(const std::string& searchMask) {
@@ -291,11 +545,55 @@ size_t ResourceManager::UnloadResource(const std::string& filePath) {
         const std::lock_guard<std::mutex> lock(mMutex);
         value = mResourceCache[filePath];
         ret = mResourceCache.erase(filePath);
+        DropStaleUnloadedResources();
+
+        if (std::holds_alternative<std::shared_ptr<Ship::IResource>>(value)) {
+            auto resource = std::get<std::shared_ptr<Ship::IResource>>(value);
+            if (resource != nullptr) {
+                mUnloadedResources[filePath] = resource;
+            }
+        }
+
+        // Forget unloaded resources that have since been destroyed, doubling the threshold so this stays amortized.
+        if (mUnloadedResources.size() >= mUnloadedResourcesPruneSize) {
+            std::erase_if(mUnloadedResources, [](const auto& entry) { return entry.second.expired(); });
+            mUnloadedResourcesPruneSize = std::max<size_t>(64, mUnloadedResources.size() * 2);
+        }
     }
 
     return ret;
 }
 
+void ResourceManager::DropStaleUnloadedResources() {
+    const auto generation = GetArchiveManager()->GetGeneration();
+    if (mUnloadedResourcesGeneration != generation) {
+        mUnloadedResources.clear();
+        mUnloadedResourcesGeneration = generation;
+    }
+}
+
+bool ResourceManager::InitDataMatches(std::shared_ptr<Ship::ResourceInitData> resourceInitData,
+                                      std::shared_ptr<Ship::ResourceInitData> requestedInitData) {
+    // Without explicit init data the resource is read with whatever the archive says, which is what it was built with.
+    if (requestedInitData == nullptr) {
+        return true;
+    }
+    if (resourceInitData == nullptr) {
+        return false;
+    }
+
+    return resourceInitData->Type == requestedInitData->Type &&
+           resourceInitData->ResourceVersion == requestedInitData->ResourceVersion &&
+           resourceInitData->ByteOrder == requestedInitData->ByteOrder &&
+           resourceInitData->Format == requestedInitData->Format &&
+           resourceInitData->IsCustom == requestedInitData->IsCustom;
+}
+
+size_t ResourceManager::GetResurrectedResourceCount() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mResurrectedResourceCount;
+}
+
 bool ResourceManager::OtrSignatureCheck(const char* fileName) {
     static const char* sOtrSignature = "__OTR__";
     return strncmp(fileName, sOtrSignature, strlen(sOtrSignature)) == 0;
@@ -6,6 +6,10 @@
 #include <mutex>
 #include <queue>
 #include <variant>
+#include <map>
+#include <span>
+#include <atomic>
+#include <future>
 #include "resource/Resource.h"
 #include "resource/ResourceLoader.h"
 #include "resource/archive/ArchiveManager.h"
@@ -38,23 +42,76 @@ class ResourceManager {
     std::shared_future<std::shared_ptr<Ship::IResource>>
     LoadResourceAsync(const std::string& filePath, bool loadExact = false, bool priority = false,
                       std::shared_ptr<Ship::ResourceInitData> initData = nullptr);
+    std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>>>
+    LoadResources(std::span<const std::string> filePaths, bool priority = false);
+    std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>>>
+    LoadResources(std::span<const uint64_t> hashes, bool priority = false);
     std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>> LoadDirectory(const std::string& searchMask);
     std::shared_ptr<std::vector<std::shared_future<std::shared_ptr<Ship::IResource>>>>
     LoadDirectoryAsync(const std::string& searchMask, bool priority = false);
     void DirtyDirectory(const std::string& searchMask);
     void UnloadDirectory(const std::string& searchMask);
     bool OtrSignatureCheck(const char* fileName);
+    size_t GetResurrectedResourceCount();
+    // Sets whether a resource type shares one instance between paths whose files are byte-identical. Vertices, arrays
+    // and blobs do by default. The shared instance keeps the init data of the path that loaded it first, and dirtying
+    // it affects every path. Textures are left out since the renderer looks up masks and replacements by the path in
+    // their init data; a game that uses neither can opt them in after Context::Init with
+    // SetResourceTypeDeduplicated(static_cast<uint32_t>(LUS::ResourceType::Texture), true).
+    void SetResourceTypeDeduplicated(uint32_t resourceType, bool deduplicated);
+    size_t GetDeduplicatedResourceCount();
+    uint64_t GetDeduplicatedByteCount();
 
   protected:
+    // Shared state for one LoadResources call. Every file that has to be read out of an archive decrements Remaining
+    // once its resource is created, and whoever brings it to zero fulfills the batch promise.
+    struct ResourceBatch {
+        std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>> Resources;
+        std::atomic<size_t> Remaining;
+        std::promise<std::shared_ptr<std::vector<std::shared_ptr<Ship::IResource>>>> Promise;
+    };
+
+    struct ResourceBatchEntry {
+        uint64_t Offset;
+        size_t Index;
+        std::string Path;
+    };
+
+    void LoadResourcesProcess(std::shared_ptr<ResourceBatch> batch, std::shared_ptr<Archive> archive,
+                              std::vector<ResourceBatchEntry> entries, bool priority);
+    void LoadResourcesFinish(std::shared_ptr<ResourceBatch> batch, size_t index, const std::string& filePath,
+                             std::shared_ptr<Ship::File> file);
+    std::shared_ptr<Ship::IResource> CacheResource(const std::string& filePath,
+                                                   std::shared_ptr<Ship::IResource> resource);
+    std::shared_ptr<Ship::IResource> GetDeduplicatedResource(const std::string& filePath);
+    void RegisterDeduplicatedResource(const std::string& filePath, std::shared_ptr<Ship::IResource> resource);
     std::shared_ptr<Ship::File> LoadFileProcess(const std::string& filePath,
                                                 std::shared_ptr<Ship::ResourceInitData> initData = nullptr);
     std::shared_ptr<Ship::IResource>
     GetCachedResource(std::variant<ResourceLoadError, std::shared_ptr<Ship::IResource>> cacheLine);
-    std::variant<ResourceLoadError, std::shared_ptr<Ship::IResource>> CheckCache(const std::string& filePath,
-                                                                                 bool loadExact = false);
+    std::variant<ResourceLoadError, std::shared_ptr<Ship::IResource>>
+    CheckCache(const std::string& filePath, bool loadExact = false,
+               std::shared_ptr<Ship::ResourceInitData> initData = nullptr);
+    // Must be called with mMutex held.
+    void DropStaleUnloadedResources();
+    static bool InitDataMatches(std::shared_ptr<Ship::ResourceInitData> resourceInitData,
+                                std::shared_ptr<Ship::ResourceInitData> requestedInitData);
 
   private:
     std::unordered_map<std::string, std::variant<ResourceLoadError, std::shared_ptr<Ship::IResource>>> mResourceCache;
+    // Resources dropped by UnloadResource that may still be referenced elsewhere. Looking one of these up again hands
+    // back the live object instead of reading and parsing a second copy. The entries are dropped once the archives
+    // change, since the path may then refer to different data.
+    std::unordered_map<std::string, std::weak_ptr<Ship::IResource>> mUnloadedResources;
+    uint32_t mUnloadedResourcesGeneration = 0;
+    size_t mUnloadedResourcesPruneSize = 64;
+    size_t mResurrectedResourceCount = 0;
+    // Resources keyed by the CRC32 and size of the file they were read from, so byte-identical files at different
+    // paths share a single instance. Only resource types in mDeduplicatedResourceTypes take part.
+    std::map<std::pair<uint32_t, uint64_t>, std::weak_ptr<Ship::IResource>> mResourcesByContent;
+    std::unordered_set<uint32_t> mDeduplicatedResourceTypes;
+    size_t mDeduplicatedResourceCount = 0;
+    uint64_t mDeduplicatedByteCount = 0;
     std::shared_ptr<ResourceLoader> mResourceLoader;
     std::shared_ptr<ArchiveManager> mArchiveManager;
     std::shared_ptr<BS::thread_pool> mThreadPool;
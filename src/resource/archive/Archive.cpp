@@ -76,6 +76,12 @@ bool Archive::HasFile(uint64_t hash) {
     return mHashes->count(hash) > 0;
 }
 
+uint64_t Archive::GetFileOffset(const std::string& filePath) {
+    // Archives that cannot report where a file lives return the same offset for everything, which keeps batched loads
+    // in request order.
+    return 0;
+}
+
 bool Archive::HasGameVersion() {
     return mHasGameVersion;
 }
@@ -100,13 +106,27 @@ void Archive::SetGameVersion(uint32_t gameVersion) {
     mGameVersion = gameVersion;
 }
 
-void Archive::IndexFile(const std::string& filePath) {
+const ArchiveFileInfo* Archive::GetFileInfo(uint64_t hash) {
+    auto it = mFileInfos.find(hash);
+    return it != mFileInfos.end() ? &it->second : nullptr;
+}
+
+void Archive::IndexFile(const std::string& filePath, uint32_t crc32, uint64_t size) {
     if (filePath.length() > 5 && filePath.substr(filePath.length() - 5) == ".meta") {
-        IndexFile(filePath.substr(0, filePath.length() - 5));
+        const auto dataFilePath = filePath.substr(0, filePath.length() - 5);
+        IndexFile(dataFilePath);
+        mFileInfos[CRC64(dataFilePath.c_str())].HasMetaFile = true;
         return;
     }
 
-    (*mHashes)[CRC64(filePath.c_str())] = filePath;
+    const auto hash = CRC64(filePath.c_str());
+    (*mHashes)[hash] = filePath;
+
+    if (crc32 != 0 || size != 0) {
+        auto& fileInfo = mFileInfos[hash];
+        fileInfo.Crc32 = crc32;
+        fileInfo.Size = size;
+    }
 }
 
 std::shared_ptr<Ship::ResourceInitData> Archive::ReadResourceInitData(const std::string& filePath,
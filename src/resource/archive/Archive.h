@@ -13,6 +13,14 @@ namespace Ship {
 struct File;
 struct ResourceInitData;
 
+// Content information recorded while indexing. A zero Crc32 and Size means the archive format could not provide it.
+struct ArchiveFileInfo {
+    uint32_t Crc32 = 0;
+    uint64_t Size = 0;
+    // The file is described by a separate .meta file, so its bytes alone do not determine the resource.
+    bool HasMetaFile = false;
+};
+
 class Archive {
     friend class ArchiveManager;
 
@@ -31,6 +39,8 @@ class Archive {
     std::shared_ptr<std::unordered_map<uint64_t, std::string>> ListFiles(const std::string& filter);
     bool HasFile(const std::string& filePath);
     bool HasFile(uint64_t hash);
+    virtual uint64_t GetFileOffset(const std::string& filePath);
+    const ArchiveFileInfo* GetFileInfo(uint64_t hash);
     bool HasGameVersion();
     uint32_t GetGameVersion();
     const std::string& GetPath();
@@ -42,7 +52,7 @@ class Archive {
   protected:
     void SetLoaded(bool isLoaded);
     void SetGameVersion(uint32_t gameVersion);
-    void IndexFile(const std::string& filePath);
+    void IndexFile(const std::string& filePath, uint32_t crc32 = 0, uint64_t size = 0);
     virtual std::shared_ptr<Ship::File> LoadFileRaw(const std::string& filePath) = 0;
     virtual std::shared_ptr<Ship::File> LoadFileRaw(uint64_t hash) = 0;
 
@@ -64,5 +74,6 @@ class Archive {
     uint32_t mGameVersion;
     std::string mPath;
     std::shared_ptr<std::unordered_map<uint64_t, std::string>> mHashes;
+    std::unordered_map<uint64_t, ArchiveFileInfo> mFileInfos;
 };
 } // namespace Ship
@@ -1,6 +1,9 @@
 #include "ArchiveManager.h"
 
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include "spdlog/spdlog.h"
 
 #include "resource/archive/Archive.h"
@@ -9,6 +12,7 @@
 #include "Utils/StringHelper.h"
 #include "utils/glob.h"
 #include <StrHash64.h>
+#include "thread-pool/BS_thread_pool.hpp"
 
 namespace Ship {
 ArchiveManager::ArchiveManager() {
@@ -21,8 +25,16 @@ void ArchiveManager::Init(const std::vector<std::string>& archivePaths) {
 void ArchiveManager::Init(const std::vector<std::string>& archivePaths,
                           const std::unordered_set<uint32_t>& validGameVersions) {
     mValidGameVersions = validGameVersions;
-    auto archives = GetArchiveListInPaths(archivePaths);
-    for (const auto archive : archives) {
+
+    std::vector<std::shared_ptr<Archive>> archives;
+    for (const auto& archivePath : GetArchiveListInPaths(archivePaths)) {
+        archives.push_back(CreateArchive(archivePath));
+    }
+
+    LoadArchives(archives);
+
+    // Archives are added in the order they were listed so later archives still override files from earlier ones.
+    for (const auto& archive : archives) {
         AddArchive(archive);
     }
 }
@@ -64,6 +76,21 @@ bool ArchiveManager::HasFile(uint64_t hash) {
     return mFileToArchive.count(hash) > 0;
 }
 
+std::shared_ptr<Archive> ArchiveManager::GetArchiveForFile(const std::string& filePath) {
+    return GetArchiveForFile(CRC64(filePath.c_str()));
+}
+
+std::shared_ptr<Archive> ArchiveManager::GetArchiveForFile(uint64_t hash) {
+    auto it = mFileToArchive.find(hash);
+    return it != mFileToArchive.end() ? it->second : nullptr;
+}
+
+const ArchiveFileInfo* ArchiveManager::GetFileInfo(const std::string& filePath) {
+    const auto hash = CRC64(filePath.c_str());
+    const auto archive = GetArchiveForFile(hash);
+    return archive != nullptr ? archive->GetFileInfo(hash) : nullptr;
+}
+
 std::shared_ptr<std::vector<std::string>> ArchiveManager::ListFiles(const std::string& filter) {
     auto list = ListFiles();
     auto result = std::make_shared<std::vector<std::string>>();
@@ -102,14 +129,60 @@ void ArchiveManager::SetArchives(const std::vector<std::shared_ptr<Archive>>& ar
     mGameVersions.clear();
     mHashes.clear();
     mFileToArchive.clear();
+    mGeneration++;
+    std::vector<std::shared_ptr<Archive>> unloadedArchives;
+    std::copy_if(archives.begin(), archives.end(), std::back_inserter(unloadedArchives),
+                 [](const std::shared_ptr<Archive>& archive) { return !archive->IsLoaded(); });
+    LoadArchives(unloadedArchives);
+
     for (const auto& archive : archives) {
-        if (!archive->IsLoaded()) {
-            archive->Load();
-        }
         AddArchive(archive);
     }
 }
 
+void ArchiveManager::LoadArchives(const std::vector<std::shared_ptr<Archive>>& archives) {
+    // Opening an archive reads and hashes its whole file list, and every archive is independent of the others until it
+    // gets added, so they are opened in parallel. This uses a pool of its own rather than the resource manager's, since
+    // SetArchives may be called from a resource task, and waiting on that pool from one of its own threads could block
+    // forever.
+    const auto startTime = std::chrono::steady_clock::now();
+    std::vector<double> loadTimes(archives.size());
+
+    auto loadArchive = [&archives, &loadTimes](size_t index) {
+        const auto archiveStartTime = std::chrono::steady_clock::now();
+        archives[index]->Load();
+        loadTimes[index] =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - archiveStartTime).count();
+    };
+
+#if defined(__SWITCH__)
+    const size_t threadCount = 1;
+#else
+    const size_t threadCount = std::min<size_t>(archives.size(), std::max(1u, std::thread::hardware_concurrency()));
+#endif
+    if (threadCount > 1) {
+        BS::thread_pool threadPool(threadCount);
+        for (size_t i = 0; i < archives.size(); i++) {
+            threadPool.push_task_back(loadArchive, i);
+        }
+        threadPool.wait_for_tasks();
+    } else {
+        for (size_t i = 0; i < archives.size(); i++) {
+            loadArchive(i);
+        }
+    }
+
+    for (size_t i = 0; i < archives.size(); i++) {
+        SPDLOG_INFO("Opened archive {} in {:.2f} ms ({} files)", archives[i]->GetPath(), loadTimes[i],
+                    archives[i]->ListFiles()->size());
+    }
+
+    if (!archives.empty()) {
+        SPDLOG_INFO("Opened {} archives in {:.2f} ms", archives.size(),
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+    }
+}
+
 const std::string* ArchiveManager::HashToString(uint64_t hash) const {
     auto it = mHashes.find(hash);
     return it != mHashes.end() ? &it->second : nullptr;
@@ -142,7 +215,7 @@ std::vector<std::string> ArchiveManager::GetArchiveListInPaths(const std::vector
     return fileList;
 }
 
-std::shared_ptr<Archive> ArchiveManager::AddArchive(const std::string& archivePath) {
+std::shared_ptr<Archive> ArchiveManager::CreateArchive(const std::string& archivePath) {
     const std::filesystem::path path = archivePath;
     const std::string extension = path.extension().string();
     std::shared_ptr<Archive> archive = nullptr;
@@ -159,6 +232,11 @@ std::shared_ptr<Archive> ArchiveManager::AddArchive(const std::string& archivePa
         archive = std::make_shared<O2rArchive>(archivePath);
     }
 
+    return archive;
+}
+
+std::shared_ptr<Archive> ArchiveManager::AddArchive(const std::string& archivePath) {
+    auto archive = CreateArchive(archivePath);
     archive->Load();
     return AddArchive(archive);
 }
@@ -178,6 +256,7 @@ std::shared_ptr<Archive> ArchiveManager::AddArchive(std::shared_ptr<Archive> arc
     SPDLOG_INFO("Adding Archive {} to Archive Manager", archive->GetPath());
 
     mArchives.push_back(archive);
+    mGeneration++;
     if (archive->HasGameVersion()) {
         mGameVersions.push_back(archive->GetGameVersion());
     }
@@ -193,4 +272,8 @@ bool ArchiveManager::IsGameVersionValid(uint32_t gameVersion) {
     return mValidGameVersions.empty() || mValidGameVersions.contains(gameVersion);
 }
 
+uint32_t ArchiveManager::GetGeneration() const {
+    return mGeneration;
+}
+
 } // namespace Ship
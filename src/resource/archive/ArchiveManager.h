@@ -5,11 +5,13 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <atomic>
 #include <stdint.h>
 #include "resource/File.h"
 
 namespace Ship {
 struct File;
+struct ArchiveFileInfo;
 class Archive;
 
 class ArchiveManager {
@@ -25,6 +27,9 @@ class ArchiveManager {
     std::shared_ptr<Ship::File> LoadFile(uint64_t hash, std::shared_ptr<Ship::ResourceInitData> initData = nullptr);
     bool HasFile(const std::string& filePath);
     bool HasFile(uint64_t hash);
+    std::shared_ptr<Archive> GetArchiveForFile(const std::string& filePath);
+    std::shared_ptr<Archive> GetArchiveForFile(uint64_t hash);
+    const ArchiveFileInfo* GetFileInfo(const std::string& filePath);
     std::shared_ptr<std::vector<std::string>> ListFiles(const std::string& filter);
     std::shared_ptr<std::vector<std::string>> ListFiles();
     std::vector<uint32_t> GetGameVersions();
@@ -32,10 +37,15 @@ class ArchiveManager {
     void SetArchives(const std::vector<std::shared_ptr<Archive>>& archives);
     const std::string* HashToString(uint64_t hash) const;
     bool IsGameVersionValid(uint32_t gameVersion);
+    // Incremented whenever the set of archives changes, so callers can tell when a path may resolve to other data.
+    uint32_t GetGeneration() const;
 
   protected:
     static std::vector<std::string> GetArchiveListInPaths(const std::vector<std::string>& archivePaths);
 
+    static std::shared_ptr<Archive> CreateArchive(const std::string& archivePath);
+
+    void LoadArchives(const std::vector<std::shared_ptr<Archive>>& archives);
     std::shared_ptr<Archive> AddArchive(const std::string& archivePath);
     std::shared_ptr<Archive> AddArchive(std::shared_ptr<Archive> archive);
     void AddGameVersion(uint32_t newGameVersion);
@@ -46,5 +56,6 @@ class ArchiveManager {
     std::unordered_set<uint32_t> mValidGameVersions;
     std::unordered_map<uint64_t, std::string> mHashes;
     std::unordered_map<uint64_t, std::shared_ptr<Archive>> mFileToArchive;
+    std::atomic<uint32_t> mGeneration = 0;
 };
 } // namespace Ship
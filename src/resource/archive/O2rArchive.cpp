@@ -58,6 +58,21 @@ std::shared_ptr<Ship::File> O2rArchive::LoadFileRaw(const std::string& filePath)
     return fileToLoad;
 }
 
+uint64_t O2rArchive::GetFileOffset(const std::string& filePath) {
+    if (mZipArchive == nullptr) {
+        return 0;
+    }
+
+    // libzip does not expose the local header offset. Central directory entries are written in the same order as the
+    // local headers they point to, so the entry index sorts files the same way.
+    auto zipEntryIndex = zip_name_locate(mZipArchive, filePath.c_str(), 0);
+    if (zipEntryIndex < 0) {
+        return 0;
+    }
+
+    return zipEntryIndex;
+}
+
 bool O2rArchive::Open() {
     mZipArchive = zip_open(GetPath().c_str(), ZIP_RDONLY, nullptr);
     if (mZipArchive == nullptr) {
@@ -67,9 +82,15 @@ bool O2rArchive::Open() {
 
     auto zipNumEntries = zip_get_num_entries(mZipArchive, 0);
     for (auto i = 0; i < zipNumEntries; i++) {
-        auto zipEntryName = zip_get_name(mZipArchive, i, 0);
-
-        IndexFile(zipEntryName);
+        struct zip_stat zipEntryStat;
+        zip_stat_init(&zipEntryStat);
+        if (zip_stat_index(mZipArchive, i, 0, &zipEntryStat) != 0 || zipEntryStat.name == nullptr) {
+            continue;
+        }
+
+        const uint32_t crc32 = (zipEntryStat.valid & ZIP_STAT_CRC) ? zipEntryStat.crc : 0;
+        const uint64_t size = (zipEntryStat.valid & ZIP_STAT_SIZE) ? zipEntryStat.size : 0;
+        IndexFile(zipEntryStat.name, crc32, size);
     }
 
     return true;
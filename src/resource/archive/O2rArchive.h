@@ -22,6 +22,7 @@ class O2rArchive : virtual public Archive {
 
     bool Open();
     bool Close();
+    uint64_t GetFileOffset(const std::string& filePath);
 
   protected:
     std::shared_ptr<Ship::File> LoadFileRaw(const std::string& filePath);
@@ -61,6 +61,25 @@ std::shared_ptr<Ship::File> OtrArchive::LoadFileRaw(uint64_t hash) {
     return LoadFileRaw(filePath);
 }
 
+uint64_t OtrArchive::GetFileOffset(const std::string& filePath) {
+    if (mHandle == nullptr) {
+        return 0;
+    }
+
+    HANDLE fileHandle;
+    if (!SFileOpenFileEx(mHandle, filePath.c_str(), 0, &fileHandle)) {
+        return 0;
+    }
+
+    ULONGLONG byteOffset = 0;
+    if (!SFileGetFileInfo(fileHandle, SFileInfoByteOffset, &byteOffset, sizeof(byteOffset), NULL)) {
+        byteOffset = 0;
+    }
+
+    SFileCloseFile(fileHandle);
+    return byteOffset;
+}
+
 bool OtrArchive::Open() {
     const bool opened = SFileOpenArchive(GetPath().c_str(), 0, MPQ_OPEN_READ_ONLY, &mHandle);
     if (opened) {
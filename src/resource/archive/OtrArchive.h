@@ -26,6 +26,7 @@ class OtrArchive : virtual public Archive {
 
     bool Open();
     bool Close();
+    uint64_t GetFileOffset(const std::string& filePath);
 
   protected:
     std::shared_ptr<Ship::File> LoadFileRaw(const std::string& filePath);
@@ -1,8 +1,45 @@
 #include "resource/factory/ArrayFactory.h"
 #include "resource/type/Array.h"
 #include "spdlog/spdlog.h"
+#include <cstring>
 
 namespace LUS {
+static void SwapScalars(uint8_t* data, size_t count, size_t scalarSize) {
+    for (size_t i = 0; i < count; i++, data += scalarSize) {
+        switch (scalarSize) {
+            case sizeof(uint16_t): {
+                uint16_t value;
+                memcpy(&value, data, sizeof(value));
+                value = BSWAP16(value);
+                memcpy(data, &value, sizeof(value));
+                break;
+            }
+            case sizeof(uint32_t): {
+                uint32_t value;
+                memcpy(&value, data, sizeof(value));
+                value = BSWAP32(value);
+                memcpy(data, &value, sizeof(value));
+                break;
+            }
+            case sizeof(uint64_t): {
+                uint64_t value;
+                memcpy(&value, data, sizeof(value));
+                value = BSWAP64(value);
+                memcpy(data, &value, sizeof(value));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// Whether the file holds at least byteCount more bytes past the reader's position.
+static bool HasBytes(std::shared_ptr<Ship::File> file, std::shared_ptr<Ship::BinaryReader> reader, size_t byteCount) {
+    const size_t position = reader->GetBaseAddress();
+    return position <= file->Buffer->size() && byteCount <= file->Buffer->size() - position;
+}
+
 std::shared_ptr<Ship::IResource> ResourceFactoryBinaryArrayV0::ReadResource(std::shared_ptr<Ship::File> file) {
     if (!FileHasValidFormatAndReader(file)) {
         return nullptr;
@@ -10,51 +47,99 @@ std::shared_ptr<Ship::IResource> ResourceFactoryBinaryArrayV0::ReadResource(std:
 
     auto array = std::make_shared<Array>(file->InitData);
     auto reader = std::get<std::shared_ptr<Ship::BinaryReader>>(file->Reader);
+    const bool swap = reader->GetEndianness() != Ship::Endianness::Native;
+
+    if (!HasBytes(file, reader, 2 * sizeof(uint32_t))) {
+        SPDLOG_ERROR("Array {} is too small to hold its header", file->InitData->Path);
+        return nullptr;
+    }
 
     array->ArrayType = (ArrayResourceType)reader->ReadUInt32();
     array->ArrayCount = reader->ReadUInt32();
+    array->ArrayScalarType = ScalarType::ZSCALAR_NONE;
+    array->ArrayComponentCount = 1;
+
+    if (array->ArrayType == ArrayResourceType::Vertex) {
+        // OTRTODO: Implement Vertex arrays as just a vertex resource.
+        // Vertices are stored back to back with the same layout as Vtx, so they can be read in one go.
+        const size_t size = array->ArrayCount * sizeof(Vtx);
+        if (size == 0) {
+            return array;
+        }
+        if (!HasBytes(file, reader, size)) {
+            SPDLOG_ERROR("Array {} needs {} bytes of vertex data but the file is too small", file->InitData->Path,
+                         size);
+            return nullptr;
+        }
+
+        array->Data.resize(size);
+        reader->Read(reinterpret_cast<char*>(array->Data.data()), size);
 
+        if (swap) {
+            // ob[3], flag and tc[2] are 16 bit. The colour/normal bytes do not need swapping.
+            for (auto& vertex : array->GetVertices()) {
+                SwapScalars(reinterpret_cast<uint8_t*>(&vertex.v), 6, sizeof(int16_t));
+            }
+        }
+
+        return array;
+    }
+
+    // Every scalar or vector element carries its own type tag (and width for vectors), so elements are copied one at a
+    // time straight into the packed buffer.
+    const size_t tagSize = (array->ArrayType == ArrayResourceType::Vector ? 2 : 1) * sizeof(uint32_t);
+    size_t scalarSize = 0;
     for (uint32_t i = 0; i < array->ArrayCount; i++) {
-        if (array->ArrayType == ArrayResourceType::Vertex) {
-            // OTRTODO: Implement Vertex arrays as just a vertex resource.
-            Vtx data;
-            data.v.ob[0] = reader->ReadInt16();
-            data.v.ob[1] = reader->ReadInt16();
-            data.v.ob[2] = reader->ReadInt16();
-            data.v.flag = reader->ReadUInt16();
-            data.v.tc[0] = reader->ReadInt16();
-            data.v.tc[1] = reader->ReadInt16();
-            data.v.cn[0] = reader->ReadUByte();
-            data.v.cn[1] = reader->ReadUByte();
-            data.v.cn[2] = reader->ReadUByte();
-            data.v.cn[3] = reader->ReadUByte();
-            array->Vertices.push_back(data);
-        } else {
-            array->ArrayScalarType = (ScalarType)reader->ReadUInt32();
-
-            int iter = 1;
-
-            if (array->ArrayType == ArrayResourceType::Vector) {
-                iter = reader->ReadUInt32();
+        if (!HasBytes(file, reader, tagSize)) {
+            SPDLOG_ERROR("Array {} ends before the type of element {}", file->InitData->Path, i);
+            return nullptr;
+        }
+
+        const auto scalarType = (ScalarType)reader->ReadUInt32();
+        const size_t componentCount = array->ArrayType == ArrayResourceType::Vector ? reader->ReadUInt32() : 1;
+
+        if (i == 0) {
+            array->ArrayScalarType = scalarType;
+            array->ArrayComponentCount = componentCount;
+            scalarSize = Array::GetScalarTypeSize(scalarType);
+
+            if (scalarSize == 0) {
+                SPDLOG_ERROR("Array {} has unsupported scalar type {}", file->InitData->Path, (int)scalarType);
+                return nullptr;
             }
 
-            for (int k = 0; k < iter; k++) {
-                ScalarData data;
-
-                switch (array->ArrayScalarType) {
-                    case ScalarType::ZSCALAR_S16:
-                        data.s16 = reader->ReadInt16();
-                        break;
-                    case ScalarType::ZSCALAR_U16:
-                        data.u16 = reader->ReadUInt16();
-                        break;
-                    default:
-                        // OTRTODO: IMPLEMENT OTHER TYPES!
-                        break;
-                }
-
-                array->Scalars.push_back(data);
+            // Make sure every element fits in the file before sizing the buffer from counts that came out of it. The
+            // first element's tag has already been read.
+            const size_t remaining = file->Buffer->size() - reader->GetBaseAddress();
+            const size_t elementSize = componentCount * scalarSize;
+            const size_t stride = tagSize + elementSize;
+            if (componentCount > remaining / scalarSize || elementSize > remaining ||
+                array->ArrayCount - 1 > (remaining - elementSize) / stride) {
+                SPDLOG_ERROR("Array {} declares {} elements of {} bytes but the file is too small",
+                             file->InitData->Path, array->ArrayCount, elementSize);
+                return nullptr;
             }
+
+            array->Data.resize(array->ArrayCount * elementSize);
+        } else if (scalarType != array->ArrayScalarType || componentCount != array->ArrayComponentCount) {
+            SPDLOG_ERROR("Array {} element {} does not match the type of the first element", file->InitData->Path, i);
+            return nullptr;
+        }
+
+        const size_t elementSize = componentCount * scalarSize;
+        if (elementSize == 0) {
+            continue;
+        }
+        if (!HasBytes(file, reader, elementSize)) {
+            SPDLOG_ERROR("Array {} ends before element {}", file->InitData->Path, i);
+            return nullptr;
+        }
+
+        uint8_t* element = array->Data.data() + i * elementSize;
+        reader->Read(reinterpret_cast<char*>(element), elementSize);
+
+        if (swap) {
+            SwapScalars(element, componentCount, scalarSize);
         }
     }
 
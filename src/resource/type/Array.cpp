@@ -1,45 +1,99 @@
 #include "Array.h"
+#include <cstring>
+#include <spdlog/spdlog.h>
 
 namespace LUS {
 Array::Array() : Resource(std::shared_ptr<Ship::ResourceInitData>()) {
 }
 
 void* Array::GetPointer() {
-    void* dataPointer = nullptr;
-    switch (ArrayType) {
-        case ArrayResourceType::Vertex:
-            dataPointer = Vertices.data();
-            break;
-        case ArrayResourceType::Scalar:
+    return Data.data();
+}
+
+size_t Array::GetPointerSize() {
+    return Data.size();
+}
+
+size_t Array::GetScalarTypeSize(ScalarType type) {
+    switch (type) {
+        case ScalarType::ZSCALAR_S8:
+        case ScalarType::ZSCALAR_U8:
+        case ScalarType::ZSCALAR_X8:
+            return sizeof(uint8_t);
+        case ScalarType::ZSCALAR_S16:
+        case ScalarType::ZSCALAR_U16:
+        case ScalarType::ZSCALAR_X16:
+            return sizeof(uint16_t);
+        case ScalarType::ZSCALAR_S32:
+        case ScalarType::ZSCALAR_U32:
+        case ScalarType::ZSCALAR_X32:
+        case ScalarType::ZSCALAR_F32:
+            return sizeof(uint32_t);
+        case ScalarType::ZSCALAR_S64:
+        case ScalarType::ZSCALAR_U64:
+        case ScalarType::ZSCALAR_X64:
+        case ScalarType::ZSCALAR_F64:
+            return sizeof(uint64_t);
+        case ScalarType::ZSCALAR_NONE:
         default:
-            dataPointer = Scalars.data();
-            break;
+            return 0;
     }
+}
 
-    return dataPointer;
+size_t Array::GetElementSize() {
+    if (ArrayType == ArrayResourceType::Vertex) {
+        return sizeof(Vtx);
+    }
+
+    return GetScalarTypeSize(ArrayScalarType) * ArrayComponentCount;
 }
 
-size_t Array::GetPointerSize() {
-    size_t typeSize = 0;
-    switch (ArrayType) {
-        case ArrayResourceType::Vertex:
-            typeSize = sizeof(Vtx);
-            break;
-        case ArrayResourceType::Scalar:
-        default:
-            switch (ArrayScalarType) {
-                case ScalarType::ZSCALAR_S16:
-                    typeSize = sizeof(int16_t);
-                    break;
-                case ScalarType::ZSCALAR_U16:
-                    typeSize = sizeof(uint16_t);
-                    break;
-                default:
-                    // OTRTODO: IMPLEMENT OTHER TYPES!
-                    break;
-            }
-            break;
+std::span<Vtx> Array::GetVertices() {
+    if (ArrayType != ArrayResourceType::Vertex) {
+        SPDLOG_ERROR("Array of type {} cannot be read as vertices", (int)ArrayType);
+        return {};
+    }
+
+    return std::span<Vtx>(reinterpret_cast<Vtx*>(Data.data()), Data.size() / sizeof(Vtx));
+}
+
+ScalarData Array::GetScalar(size_t index) {
+    ScalarData scalar = {};
+    const size_t scalarSize = GetScalarTypeSize(ArrayScalarType);
+    if (ArrayType == ArrayResourceType::Vertex || scalarSize == 0 || index >= Data.size() / scalarSize) {
+        SPDLOG_ERROR("Array has no scalar at index {}", index);
+        return scalar;
+    }
+
+    // Every member of the union starts at its first byte, so copying the stored width fills the matching member.
+    memcpy(&scalar, Data.data() + index * scalarSize, scalarSize);
+    return scalar;
+}
+
+std::vector<ScalarData> Array::GetScalarDataCopy() {
+    std::vector<ScalarData> scalars;
+    const size_t scalarSize = GetScalarTypeSize(ArrayScalarType);
+    if (ArrayType == ArrayResourceType::Vertex || scalarSize == 0) {
+        return scalars;
+    }
+
+    scalars.reserve(Data.size() / scalarSize);
+    for (size_t i = 0; i < Data.size() / scalarSize; i++) {
+        scalars.push_back(GetScalar(i));
     }
-    return ArrayCount * typeSize;
+    return scalars;
+}
+
+std::vector<Vtx> Array::GetVerticesCopy() {
+    if (ArrayType != ArrayResourceType::Vertex) {
+        return {};
+    }
+
+    const auto vertices = GetVertices();
+    return std::vector<Vtx>(vertices.begin(), vertices.end());
+}
+
+void Array::LogScalarTypeMismatch(size_t requestedSize) {
+    SPDLOG_ERROR("Array scalar type {} cannot be read as a {} byte type", (int)ArrayScalarType, requestedSize);
 }
 } // namespace LUS
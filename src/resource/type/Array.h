@@ -2,6 +2,9 @@
 
 #include "resource/Resource.h"
 #include "Vertex.h"
+#include <span>
+#include <type_traits>
+#include <vector>
 
 namespace LUS {
 typedef union ScalarData {
@@ -75,11 +78,73 @@ class Array : public Ship::Resource<void> {
     void* GetPointer() override;
     size_t GetPointerSize() override;
 
+    static size_t GetScalarTypeSize(ScalarType type);
+    size_t GetElementSize();
+    std::span<Vtx> GetVertices();
+    // Reads one scalar component by its index in the flat span GetScalars<T>() would return. This replaces the old
+    // Scalars vector for callers that only learn the scalar type at runtime.
+    ScalarData GetScalar(size_t index);
+
+    // Copies of the data in the layout of the Scalars and Vertices members this class used to have, one ScalarData per
+    // scalar component. Kept for existing callers only, since every call copies the whole array.
+    [[deprecated("Use GetScalar() or GetScalars<T>() instead")]] std::vector<ScalarData> GetScalarDataCopy();
+    [[deprecated("Use GetVertices() instead")]] std::vector<Vtx> GetVerticesCopy();
+
+    // Returns the scalar components of every element as one flat span. An empty span is returned when T does not match
+    // the stored scalar type, so callers never reinterpret the buffer with the wrong element width.
+    template <typename T> std::span<T> GetScalars() {
+        if (Data.empty()) {
+            return {};
+        }
+
+        if (ArrayType == ArrayResourceType::Vertex || !IsScalarTypeCompatible<T>(ArrayScalarType)) {
+            LogScalarTypeMismatch(sizeof(T));
+            return {};
+        }
+
+        return std::span<T>(reinterpret_cast<T*>(Data.data()), Data.size() / sizeof(T));
+    }
+
     ArrayResourceType ArrayType;
     ScalarType ArrayScalarType;
     size_t ArrayCount;
-    // OTRTODO: Should be a vector of resource pointers...
-    std::vector<ScalarData> Scalars;
-    std::vector<Vtx> Vertices;
+    // Number of scalars in each element. Always 1 for scalar arrays, the vector width for vector arrays.
+    size_t ArrayComponentCount;
+    // Elements packed at their native width, e.g. 2 bytes per element for a U16 array or sizeof(Vtx) per vertex.
+    std::vector<uint8_t> Data;
+
+  private:
+    void LogScalarTypeMismatch(size_t requestedSize);
+
+    template <typename T> static constexpr bool IsScalarTypeCompatible(ScalarType type) {
+        switch (type) {
+            case ScalarType::ZSCALAR_S8:
+                return std::is_same_v<T, int8_t>;
+            case ScalarType::ZSCALAR_U8:
+            case ScalarType::ZSCALAR_X8:
+                return std::is_same_v<T, uint8_t>;
+            case ScalarType::ZSCALAR_S16:
+                return std::is_same_v<T, int16_t>;
+            case ScalarType::ZSCALAR_U16:
+            case ScalarType::ZSCALAR_X16:
+                return std::is_same_v<T, uint16_t>;
+            case ScalarType::ZSCALAR_S32:
+                return std::is_same_v<T, int32_t>;
+            case ScalarType::ZSCALAR_U32:
+            case ScalarType::ZSCALAR_X32:
+                return std::is_same_v<T, uint32_t>;
+            case ScalarType::ZSCALAR_S64:
+                return std::is_same_v<T, int64_t>;
+            case ScalarType::ZSCALAR_U64:
+            case ScalarType::ZSCALAR_X64:
+                return std::is_same_v<T, uint64_t>;
+            case ScalarType::ZSCALAR_F32:
+                return std::is_same_v<T, float>;
+            case ScalarType::ZSCALAR_F64:
+                return std::is_same_v<T, double>;
+            default:
+                return false;
+        }
+    }
 };
 } // namespace LUS
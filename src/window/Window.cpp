@@ -10,6 +10,8 @@
 #include "graphic/Fast3D/gfx_metal.h"
 #include "graphic/Fast3D/gfx_direct3d11.h"
 #include "graphic/Fast3D/gfx_direct3d12.h"
+#include "graphic/Fast3D/gfx_headless.h"
+#include "graphic/Fast3D/gfx_software.h"
 #include "controller/controldevice/controller/mapping/keyboard/KeyboardScancodes.h"
 #include "Context.h"
 
@@ -232,6 +234,16 @@ void Window::InitWindowManager() {
             mWindowManagerApi = &gfx_sdl;
             break;
 #endif
+        // Only chosen through the config, for benchmarks and tests on machines without a display
+        case WindowBackend::HEADLESS:
+            mRenderingApi = &gfx_headless_rapi;
+            mWindowManagerApi = &gfx_headless_wapi;
+            break;
+        // Rasterizes on the CPU without presenting, frames are read back with gfx_software_read_framebuffer
+        case WindowBackend::SOFTWARE:
+            mRenderingApi = &gfx_software_rapi;
+            mWindowManagerApi = &gfx_headless_wapi;
+            break;
         default:
             SPDLOG_ERROR("Could not load the correct rendering backend");
             break;
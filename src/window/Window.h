@@ -9,7 +9,7 @@
 #include "window/gui/Gui.h"
 
 namespace Ship {
-enum class WindowBackend { DX11, DX12, GLX_OPENGL, SDL_OPENGL, SDL_METAL, GX2, BACKEND_COUNT };
+enum class WindowBackend { DX11, DX12, GLX_OPENGL, SDL_OPENGL, SDL_METAL, GX2, HEADLESS, SOFTWARE, BACKEND_COUNT };
 
 class Config;
 
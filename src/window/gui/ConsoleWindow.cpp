@@ -247,12 +247,12 @@ void ConsoleWindow::InitElement() {
 }
 
 void ConsoleWindow::UpdateElement() {
-    for (auto [key, cmd] : mBindings) {
+    for (const auto& [key, cmd] : mBindings) {
         if (ImGui::IsKeyPressed(key)) {
             Dispatch(cmd);
         }
     }
-    for (auto [key, var] : mBindingToggle) {
+    for (const auto& [key, var] : mBindingToggle) {
         if (ImGui::IsKeyPressed(key)) {
             Dispatch("set " + var + " " + std::to_string(!static_cast<bool>(CVarGetInteger(var.c_str(), 0))));
         }
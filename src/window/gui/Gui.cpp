@@ -81,6 +81,7 @@ Gui::Gui() : Gui(nullptr) {
 
 Gui::~Gui() {
     SPDLOG_TRACE("destruct gui");
+    ClearQueuedDrawData();
 }
 
 void Gui::Init(GuiWindowInitData windowImpl) {
@@ -203,6 +204,14 @@ void Gui::ImGuiBackendInit() {
                                 static_cast<ID3D11DeviceContext*>(mImpl.Dx11.DeviceContext));
             break;
 #endif
+        case WindowBackend::HEADLESS:
+        case WindowBackend::SOFTWARE: {
+            // Nothing draws the GUI, but ImGui still expects the font atlas a renderer would have built
+            unsigned char* pixels;
+            int width, height;
+            mImGuiIo->Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+            break;
+        }
         default:
             break;
     }
@@ -453,6 +462,13 @@ void Gui::ImGuiWMNewFrame() {
             ImGui_ImplWin32_NewFrame();
             break;
 #endif
+        case WindowBackend::HEADLESS:
+        case WindowBackend::SOFTWARE: {
+            const std::shared_ptr<Window> wnd = Context::GetInstance()->GetWindow();
+            mImGuiIo->DisplaySize = ImVec2((float)wnd->GetWidth(), (float)wnd->GetHeight());
+            mImGuiIo->DeltaTime = 1.0f / 60.0f;
+            break;
+        }
         default:
             break;
     }
@@ -624,6 +640,35 @@ void Gui::RenderViewports() {
     }
 }
 
+// Finalizes the frame and keeps a copy of its draw lists, so RenderQueuedDrawData can draw them on the render thread
+// while this thread builds the next frame. Platform windows are created and drawn by ImGui itself, which can't be
+// handed to another thread, so nothing is queued while viewports are enabled.
+bool Gui::QueueDrawData() {
+    if (mImGuiIo->ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+        return false;
+    }
+
+    ImGui::Render();
+    ClearQueuedDrawData();
+    const ImDrawData* data = ImGui::GetDrawData();
+    mQueuedDrawData = *data;
+    for (int i = 0; i < mQueuedDrawData.CmdLists.Size; i++) {
+        mQueuedDrawData.CmdLists[i] = data->CmdLists[i]->CloneOutput();
+    }
+    return true;
+}
+
+void Gui::RenderQueuedDrawData() {
+    ImGuiRenderDrawData(&mQueuedDrawData);
+}
+
+void Gui::ClearQueuedDrawData() {
+    for (ImDrawList* list : mQueuedDrawData.CmdLists) {
+        IM_DELETE(list);
+    }
+    mQueuedDrawData.Clear();
+}
+
 ImTextureID Gui::GetTextureById(int32_t id) {
 #ifdef ENABLE_DX11
     if (Context::GetInstance()->GetWindow()->GetWindowBackend() == WindowBackend::DX11) {
@@ -70,6 +70,8 @@ class Gui {
     void StartFrame();
     void EndFrame();
     void RenderViewports();
+    bool QueueDrawData();
+    void RenderQueuedDrawData();
     void DrawMenu();
 
     void SaveConsoleVariablesOnNextTick();
@@ -99,6 +101,7 @@ class Gui {
     void ImGuiBackendNewFrame();
     void ImGuiWMNewFrame();
     void ImGuiRenderDrawData(ImDrawData* data);
+    void ClearQueuedDrawData();
     ImTextureID GetTextureById(int32_t id);
     void ApplyResolutionChanges();
     int16_t GetIntegerScaleFactor();
@@ -111,6 +114,7 @@ class Gui {
     std::shared_ptr<GuiMenuBar> mMenuBar;
     std::map<std::string, GuiTextureMetadata> mGuiTextures;
     std::map<std::string, std::shared_ptr<GuiWindow>> mGuiWindows;
+    ImDrawData mQueuedDrawData;
 };
 } // namespace Ship
 
@@ -5,6 +5,8 @@
 #include "ImGui/imgui.h"
 #include "public/bridge/consolevariablebridge.h"
 #include "spdlog/spdlog.h"
+#include "Context.h"
+#include "graphic/Fast3D/gfx_pc.h"
 
 namespace Ship {
 StatsWindow::~StatsWindow() {
@@ -34,6 +36,33 @@ void StatsWindow::DrawElement() {
     ImGui::Text("Platform: Unknown");
 #endif
     ImGui::Text("Status: %.3f ms/frame (%.1f FPS)", deltatime * 1000.0f, framerate);
+
+    auto resourceManager = Context::GetInstance()->GetResourceManager();
+    if (resourceManager != nullptr) {
+        ImGui::Text("Resources resurrected after unload: %zu", resourceManager->GetResurrectedResourceCount());
+        ImGui::Text("Duplicate resources shared: %zu (%.2f MiB saved)", resourceManager->GetDeduplicatedResourceCount(),
+                    resourceManager->GetDeduplicatedByteCount() / (1024.0 * 1024.0));
+    }
+
+    const GfxFrameStats& frameStats = gfx_get_frame_stats();
+    ImGui::Text("Draw calls: %u issued, %u submitted", frameStats.draw_calls_issued, frameStats.draw_calls_submitted);
+    ImGui::Text("Texture cache: %u hits, %u misses, %u evictions, %.2f MiB uploaded", frameStats.texture_cache_hits,
+                frameStats.texture_cache_misses, frameStats.texture_cache_evictions,
+                frameStats.texture_bytes_uploaded / (1024.0 * 1024.0));
+    ImGui::Text("Texture cache size: %u textures, %.2f MiB", frameStats.texture_cache_entries,
+                frameStats.texture_cache_bytes / (1024.0 * 1024.0));
+    if (CVarGetInteger("gTextureContentDedup", 0)) {
+        ImGui::Text("Texture uploads avoided by content match: %u", frameStats.texture_uploads_aliased);
+    }
+    if (CVarGetInteger("gCullDisplayLists", 0)) {
+        ImGui::Text("Display lists culled: %u", frameStats.display_lists_culled);
+    }
+    if (CVarGetInteger("gVertexMemoization", 0)) {
+        const uint32_t lookups = frameStats.vertex_memo_hits + frameStats.vertex_memo_misses;
+        ImGui::Text("Vertex memo: %u/%u hits (%.1f%%), %u entries", frameStats.vertex_memo_hits, lookups,
+                    lookups > 0 ? frameStats.vertex_memo_hits * 100.0f / lookups : 0.0f,
+                    frameStats.vertex_memo_entries);
+    }
     ImGui::End();
     ImGui::PopStyleColor();
 }
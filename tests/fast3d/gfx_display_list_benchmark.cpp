@@ -0,0 +1,72 @@
+// Replays a large display list through gfx_run on the headless backend with recording off, so the time is spent in
+// the interpreter rather than a GPU driver, and reports commands and triangles interpreted per second. The list
+// repeats a mesh-like pattern of vertex loads, triangles and combiner and render mode changes. Not run by ctest.
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "fast3d/gfx_headless_fixture.h"
+
+static const int segments = 4000;
+static const int frames = 50;
+
+static Vtx vertices[32];
+
+static std::vector<Gfx> build_display_list(uint32_t* triangles) {
+    std::vector<Gfx> list(segments * 24 + 16);
+    Gfx* g = list.data();
+    *triangles = 0;
+
+    gDPPipeSync(g++);
+    gSPClearGeometryMode(g++, 0xFFFFFFFF);
+    gSPSetGeometryMode(g++, G_SHADE | G_SHADING_SMOOTH);
+    gSPMatrix(g++, &lus_test_identity_mtx, G_MTX_PROJECTION | G_MTX_LOAD | G_MTX_NOPUSH);
+    gSPMatrix(g++, &lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH);
+    for (int s = 0; s < segments; s++) {
+        gDPPipeSync(g++);
+        if (s % 2 == 0) {
+            gDPSetCombineMode(g++, G_CC_SHADE, G_CC_SHADE);
+            gDPSetRenderMode(g++, G_RM_OPA_SURF, G_RM_OPA_SURF2);
+        } else {
+            gDPSetPrimColor(g++, 0, 0, s & 0xFF, 0x80, 0x80, 0xFF);
+            gDPSetCombineMode(g++, G_CC_PRIMITIVE, G_CC_PRIMITIVE);
+            gDPSetRenderMode(g++, G_RM_XLU_SURF, G_RM_XLU_SURF2);
+        }
+        __gSPVertex(g++, vertices, 32, 0);
+        for (int t = 0; t < 8; t++) {
+            gSP2Triangles(g++, t * 4, t * 4 + 1, t * 4 + 2, 0, t * 4, t * 4 + 2, t * 4 + 3, 0);
+            *triangles += 2;
+        }
+    }
+    gSPEndDisplayList(g++);
+    list.resize(g - list.data());
+    return list;
+}
+
+int main() {
+    for (int i = 0; i < 32; i++) {
+        // Every group of four is the same quad inside the clip volume, so no triangle is rejected
+        const short x = (i % 4 == 1 || i % 4 == 2), y = (i % 4 >= 2);
+        vertices[i] = { { { x, y, 0 }, 0, { 0, 0 }, { (uint8_t)(i * 8), 0x80, 0xFF, 0xFF } } };
+    }
+
+    auto context = lus_test_create_headless_context();
+    gfx_headless_set_recording(false);
+    uint32_t triangles;
+    std::vector<Gfx> list = build_display_list(&triangles);
+
+    // The first frame creates the combiners and shaders
+    lus_test_run_frame(list.data());
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        lus_test_run_frame(list.data());
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("%zu commands, %u triangles per frame\n", list.size(), triangles);
+    printf("%.2f ms per frame\n", elapsed.count() * 1000 / frames);
+    printf("%.1f M commands/s, %.1f M triangles/s\n", list.size() * frames / elapsed.count() / 1e6,
+           (double)triangles * frames / elapsed.count() / 1e6);
+    return 0;
+}
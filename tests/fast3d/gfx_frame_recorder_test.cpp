@@ -0,0 +1,228 @@
+// Sends the same random mix of opaque, decal and alpha draws straight to a fake backend and through the frame recorder,
+// and checks that the recorder's sorted and merged output draws the same triangles with the same state. Opaque
+// triangles between two decal or alpha ones may come out in any order, everything else keeps its order. Textures are
+// re-uploaded along the way, so a draw replayed after its texture changed would sample the wrong contents.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_frame_recorder.h"
+
+#define NUM_SHADERS 2
+#define NUM_TEXTURES 4
+#define STRIDE 4
+
+static char shader_storage[NUM_SHADERS];
+
+static struct ShaderProgram* fake_shader(int index) {
+    return reinterpret_cast<struct ShaderProgram*>(&shader_storage[index]);
+}
+
+// The backend state a triangle was drawn with, followed by the values of its three vertices
+typedef std::vector<int64_t> Triangle;
+
+static struct {
+    int shader;
+    uint32_t textures[2];
+    int tile;
+    int depth_test_and_mask;
+    int zmode_decal;
+    int use_alpha;
+    uint32_t texture_versions[NUM_TEXTURES];
+    std::vector<Triangle> triangles;
+} fake;
+
+static void fake_reset(void) {
+    fake.shader = -1;
+    fake.textures[0] = fake.textures[1] = 0;
+    fake.tile = 0;
+    fake.depth_test_and_mask = fake.zmode_decal = fake.use_alpha = -1;
+    std::fill(std::begin(fake.texture_versions), std::end(fake.texture_versions), 0);
+    fake.triangles.clear();
+}
+
+static void fake_unload_shader(struct ShaderProgram* old_prg) {
+}
+
+static void fake_load_shader(struct ShaderProgram* new_prg) {
+    fake.shader = (int)(reinterpret_cast<char*>(new_prg) - shader_storage);
+}
+
+static void fake_select_texture(int tile, uint32_t texture_id) {
+    fake.textures[tile] = texture_id;
+    fake.tile = tile;
+}
+
+static void fake_upload_texture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
+    fake.texture_versions[fake.textures[fake.tile]]++;
+}
+
+static void fake_set_depth_test_and_mask(bool depth_test, bool z_upd) {
+    fake.depth_test_and_mask = (depth_test ? 1 : 0) | (z_upd ? 2 : 0);
+}
+
+static void fake_set_zmode_decal(bool zmode_decal) {
+    fake.zmode_decal = zmode_decal;
+}
+
+static void fake_set_use_alpha(bool use_alpha) {
+    fake.use_alpha = use_alpha;
+}
+
+static void fake_add_triangle(const float* vertices[3]) {
+    Triangle triangle = { fake.shader,
+                          fake.textures[0],
+                          fake.texture_versions[fake.textures[0]],
+                          fake.textures[1],
+                          fake.texture_versions[fake.textures[1]],
+                          fake.depth_test_and_mask,
+                          fake.zmode_decal,
+                          fake.use_alpha };
+    for (int i = 0; i < 3; i++) {
+        triangle.insert(triangle.end(), vertices[i], vertices[i] + STRIDE);
+    }
+    fake.triangles.push_back(triangle);
+}
+
+static void fake_draw_triangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+    for (size_t t = 0; t < buf_vbo_num_tris; t++) {
+        const float* vertices[3];
+        for (int i = 0; i < 3; i++) {
+            vertices[i] = &buf_vbo[(t * 3 + i) * STRIDE];
+        }
+        fake_add_triangle(vertices);
+    }
+}
+
+static void fake_draw_triangles_indexed(float buf_vbo[], size_t buf_vbo_len, const uint16_t buf_ibo[],
+                                        size_t buf_ibo_len) {
+    for (size_t t = 0; t < buf_ibo_len / 3; t++) {
+        const float* vertices[3];
+        for (int i = 0; i < 3; i++) {
+            vertices[i] = &buf_vbo[buf_ibo[t * 3 + i] * STRIDE];
+        }
+        fake_add_triangle(vertices);
+    }
+}
+
+static void fake_no_op(void) {
+}
+
+static bool is_sortable(const Triangle& triangle) {
+    return triangle[5] == 3 && triangle[6] == 0 && triangle[7] == 0;
+}
+
+// Compares the runs of sortable triangles as sets and everything between them in order
+static bool same_output(std::vector<Triangle> expected, std::vector<Triangle> actual) {
+    if (expected.size() != actual.size()) {
+        return false;
+    }
+    for (size_t begin = 0; begin < expected.size();) {
+        size_t end = begin;
+        while (end < expected.size() && is_sortable(expected[end])) {
+            end++;
+        }
+        if (end == begin) {
+            end++;
+        }
+        std::sort(expected.begin() + begin, expected.begin() + end);
+        std::sort(actual.begin() + begin, actual.begin() + end);
+        if (!std::equal(expected.begin() + begin, expected.begin() + end, actual.begin() + begin)) {
+            return false;
+        }
+        begin = end;
+    }
+    return true;
+}
+
+struct Command {
+    int kind; // 0: opaque, 1: decal, 2: alpha
+    int shader;
+    uint32_t textures[2];
+    bool indexed;
+    int num_tris;
+    int upload; // Texture to upload before drawing, or -1
+};
+
+static void run(struct GfxRenderingAPI* rapi, const std::vector<Command>& commands) {
+    std::vector<float> vbo;
+    std::vector<uint16_t> ibo;
+    rapi->start_frame();
+    for (size_t c = 0; c < commands.size(); c++) {
+        const Command& command = commands[c];
+        if (command.upload != -1) {
+            rapi->select_texture(0, command.upload);
+            rapi->upload_texture(nullptr, 1, 1);
+        }
+        rapi->load_shader(fake_shader(command.shader));
+        rapi->select_texture(0, command.textures[0]);
+        rapi->select_texture(1, command.textures[1]);
+        rapi->set_depth_test_and_mask(true, command.kind != 2);
+        rapi->set_zmode_decal(command.kind == 1);
+        rapi->set_use_alpha(command.kind == 2);
+
+        // Every vertex value is unique to its draw, so triangles can only match their own
+        const int num_verts = command.indexed ? command.num_tris + 2 : command.num_tris * 3;
+        vbo.clear();
+        for (int v = 0; v < num_verts * STRIDE; v++) {
+            vbo.push_back((float)(c * 1000 + v));
+        }
+        if (command.indexed) {
+            ibo.clear();
+            for (int t = 0; t < command.num_tris; t++) {
+                ibo.insert(ibo.end(), { (uint16_t)t, (uint16_t)(t + 1), (uint16_t)(t + 2) });
+            }
+            rapi->draw_triangles_indexed(vbo.data(), vbo.size(), ibo.data(), ibo.size());
+        } else {
+            rapi->draw_triangles(vbo.data(), vbo.size(), command.num_tris);
+        }
+    }
+    rapi->end_frame();
+}
+
+int main() {
+    struct GfxRenderingAPI backend = {};
+    backend.unload_shader = fake_unload_shader;
+    backend.load_shader = fake_load_shader;
+    backend.select_texture = fake_select_texture;
+    backend.upload_texture = fake_upload_texture;
+    backend.set_depth_test_and_mask = fake_set_depth_test_and_mask;
+    backend.set_zmode_decal = fake_set_zmode_decal;
+    backend.set_use_alpha = fake_set_use_alpha;
+    backend.draw_triangles = fake_draw_triangles;
+    backend.draw_triangles_indexed = fake_draw_triangles_indexed;
+    backend.start_frame = fake_no_op;
+    backend.end_frame = fake_no_op;
+
+    std::mt19937 rng(0xF3D);
+    for (int frame = 0; frame < 20; frame++) {
+        std::vector<Command> commands(300);
+        for (Command& command : commands) {
+            // Mostly opaque, so the runs between decal and alpha draws are long enough to sort and merge
+            const int kind = (int)(rng() % 20);
+            command.kind = kind < 18 ? 0 : kind < 19 ? 1 : 2;
+            command.shader = (int)(rng() % NUM_SHADERS);
+            command.textures[0] = rng() % 2;
+            command.textures[1] = 2 + rng() % 2;
+            command.indexed = rng() % 2 == 0;
+            command.num_tris = 1 + (int)(rng() % 4);
+            command.upload = rng() % 25 == 0 ? (int)(rng() % NUM_TEXTURES) : -1;
+        }
+
+        fake_reset();
+        run(&backend, commands);
+        const std::vector<Triangle> expected = fake.triangles;
+
+        fake_reset();
+        run(gfx_frame_recorder_begin(&backend), commands);
+        gfx_frame_recorder_end();
+
+        LUS_CHECK(same_output(expected, fake.triangles));
+        LUS_CHECK(gfx_frame_recorder_get_stats().draws_recorded == commands.size());
+        LUS_CHECK(gfx_frame_recorder_get_stats().draws_submitted < commands.size());
+    }
+
+    return lus_test_result();
+}
@@ -0,0 +1,81 @@
+// Replays a combiner lookup trace that switches often, through GfxHashPool and through the std::map the pools used
+// before, and reports lookups per second for each. The trace mostly alternates between a few combiners, as a HUD or a
+// level mesh does, with a lookup of one of several hundred others every few draws. Not run by ctest.
+
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "graphic/Fast3D/gfx_hash_pool.h"
+
+// Same layout and hash as the color combiner keys in gfx_pc.cpp
+struct CombinerKey {
+    uint64_t combine_mode;
+    uint64_t options;
+
+    bool operator==(const CombinerKey& other) const {
+        return combine_mode == other.combine_mode && options == other.options;
+    }
+    bool operator<(const CombinerKey& other) const {
+        return combine_mode != other.combine_mode ? combine_mode < other.combine_mode : options < other.options;
+    }
+};
+
+struct CombinerKeyHasher {
+    uint64_t operator()(const CombinerKey& key) const {
+        return key.combine_mode ^ (key.options * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+struct Combiner {
+    uint64_t shader_id0;
+    uint32_t shader_id1;
+};
+
+static const uint32_t combiner_count = 400;
+static const uint32_t trace_length = 1 << 20;
+static const int rounds = 20;
+
+int main() {
+    std::mt19937_64 rng(0x5eed);
+    std::vector<CombinerKey> keys(combiner_count);
+    for (CombinerKey& key : keys) {
+        key = { rng(), rng() & 0xFFFF };
+    }
+
+    std::vector<uint32_t> trace(trace_length);
+    for (uint32_t i = 0; i < trace_length; i++) {
+        trace[i] = (i % 5 == 4) ? (uint32_t)(rng() % combiner_count) : (uint32_t)(rng() % 3);
+    }
+
+    GfxHashPool<CombinerKey, Combiner, CombinerKeyHasher> pool;
+    std::map<CombinerKey, Combiner> map;
+    for (uint32_t i = 0; i < combiner_count; i++) {
+        pool.insert(keys[i])->shader_id1 = i;
+        map[keys[i]].shader_id1 = i;
+    }
+
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t index : trace) {
+            checksum += pool.find(keys[index])->shader_id1;
+        }
+    }
+    const std::chrono::duration<double> pool_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t index : trace) {
+            checksum -= map.find(keys[index])->second.shader_id1;
+        }
+    }
+    const std::chrono::duration<double> map_time = std::chrono::steady_clock::now() - start;
+
+    const double lookups = (double)trace_length * rounds;
+    printf("GfxHashPool %8.1f M lookups/s\n", lookups / pool_time.count() / 1e6);
+    printf("std::map    %8.1f M lookups/s\n", lookups / map_time.count() / 1e6);
+    return checksum == 0 ? 0 : 1;
+}
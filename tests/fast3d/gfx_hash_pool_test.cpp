@@ -0,0 +1,77 @@
+// Fills GfxHashPool past several table sizes and checks that every key finds the value it was inserted with, that
+// missing keys are not found, that values keep their address as the pool grows, and that keys whose hashes all collide
+// are still told apart.
+
+#include <stdint.h>
+#include <vector>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_hash_pool.h"
+
+struct ConstantHasher {
+    uint64_t operator()(uint32_t) const {
+        return 42;
+    }
+};
+
+struct IdentityHasher {
+    uint64_t operator()(uint32_t key) const {
+        return key;
+    }
+};
+
+template <typename Hasher> static void check_pool(uint32_t count) {
+    GfxHashPool<uint32_t, uint32_t, Hasher> pool;
+    LUS_CHECK(pool.find(1) == nullptr);
+
+    std::vector<uint32_t*> values;
+    for (uint32_t i = 0; i < count; i++) {
+        // Spread over the key space so the low bits alone would collide
+        const uint32_t key = i << 16;
+        LUS_CHECK(pool.find(key) == nullptr);
+        uint32_t* value = pool.insert(key);
+        LUS_CHECK(value != nullptr && *value == 0);
+        *value = i + 1;
+        values.push_back(value);
+    }
+    LUS_CHECK(pool.size() == count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t* value = pool.find(i << 16);
+        LUS_CHECK(value == values[i] && *value == i + 1);
+        LUS_CHECK(pool.find((i << 16) | 1) == nullptr);
+    }
+
+    // Alternating between a few values is served from the recently found ones, and must still return the right one
+    for (uint32_t round = 0; round < 8; round++) {
+        for (uint32_t i = 0; i < count && i < 6; i++) {
+            LUS_CHECK(pool.find(i << 16) == values[i]);
+        }
+    }
+
+    pool.clear();
+    LUS_CHECK(pool.size() == 0);
+    for (uint32_t i = 0; i < count; i++) {
+        LUS_CHECK(pool.find(i << 16) == nullptr);
+    }
+    uint32_t* value = pool.insert(7);
+    LUS_CHECK(pool.find(7) == value && pool.size() == 1);
+}
+
+int main() {
+    for (uint32_t count : { 0, 1, 4, 5, 31, 32, 33, 1000 }) {
+        check_pool<IdentityHasher>(count);
+        check_pool<ConstantHasher>(count);
+    }
+
+    GfxHashPool<std::pair<uint64_t, uint32_t>, int, GfxShaderIdHasher> shaders;
+    *shaders.insert({ 0x01080108, 0 }) = 1;
+    *shaders.insert({ 0x01080108, 1 }) = 2;
+    *shaders.insert({ 0x0108010800000000ULL, 0 }) = 3;
+    LUS_CHECK(*shaders.find({ 0x01080108, 0 }) == 1);
+    LUS_CHECK(*shaders.find({ 0x01080108, 1 }) == 2);
+    LUS_CHECK(*shaders.find({ 0x0108010800000000ULL, 0 }) == 3);
+    LUS_CHECK(shaders.find({ 0x0108010800000000ULL, 1 }) == nullptr);
+
+    return lus_test_result();
+}
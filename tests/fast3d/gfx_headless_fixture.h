@@ -0,0 +1,42 @@
+#ifndef LUS_TEST_GFX_HEADLESS_FIXTURE_H
+#define LUS_TEST_GFX_HEADLESS_FIXTURE_H
+
+#include <memory>
+#include <unordered_map>
+
+#include "Context.h"
+#include "config/Config.h"
+#include "window/Window.h"
+#include "graphic/Fast3D/gfx_pc.h"
+#include "graphic/Fast3D/gfx_headless.h"
+
+// Brings up a Context whose window uses the headless backend, so display lists can be run through gfx_run without a
+// display or game archives
+static std::shared_ptr<Ship::Context> lus_test_create_headless_context() {
+    std::shared_ptr<Ship::Context> context =
+        Ship::Context::CreateUninitializedInstance("libultraship tests", "lustest", "lustest.json");
+    context->InitLogging();
+    context->InitConfiguration();
+    context->GetConfig()->SetWindowBackend(Ship::WindowBackend::HEADLESS);
+    context->InitConsoleVariables();
+    context->InitResourceManager();
+    context->InitControlDeck();
+    context->InitConsole();
+    context->InitGfxDebugger();
+    context->InitWindow();
+    return context;
+}
+
+// Runs one frame the way a game loop does
+static void lus_test_run_frame(Gfx* commands) {
+    static const std::unordered_map<Mtx*, MtxF> no_replacements;
+    gfx_start_frame();
+    gfx_run(commands, no_replacements);
+    gfx_end_frame();
+}
+
+// Identity in the fixed point layout gfx_sp_matrix decodes: the integer halves of each row come first, two elements
+// per word, followed by the fraction halves
+static Mtx lus_test_identity_mtx = { { { 0x10000, 0, 1, 0 }, { 0, 0x10000, 0, 1 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 } } };
+
+#endif
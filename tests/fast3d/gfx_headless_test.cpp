@@ -0,0 +1,96 @@
+// Runs a textured triangle on the headless backend and checks what the call log holds: nothing while recording is off,
+// and with it on the frame's start and end, the texture upload at its size and the draw with its vertex count.
+
+#include <string.h>
+#include <vector>
+
+#include "test_utils.h"
+#include "fast3d/gfx_headless_fixture.h"
+
+static Vtx triangle[3] = {
+    { { { 0, 0, 0 }, 0, { 0, 0 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+    { { { 1, 0, 0 }, 0, { 4 << 5, 0 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+    { { { 0, 1, 0 }, 0, { 0, 4 << 5 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+};
+
+// 4x4 RGBA16, aligned since an odd address marks a resource path
+alignas(8) static uint16_t texels[16] = {
+    0xF801, 0x07C1, 0x003F, 0xFFFF, 0xF801, 0x07C1, 0x003F, 0xFFFF,
+    0xF801, 0x07C1, 0x003F, 0xFFFF, 0xF801, 0x07C1, 0x003F, 0xFFFF,
+};
+
+static Gfx frame[] = {
+    gsDPPipeSync(),
+    gsSPClearGeometryMode(0xFFFFFFFF),
+    gsSPSetGeometryMode(G_SHADE | G_SHADING_SMOOTH),
+    gsDPSetRenderMode(G_RM_OPA_SURF, G_RM_OPA_SURF2),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_PROJECTION | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsSPTexture(0xFFFF, 0xFFFF, 0, G_TX_RENDERTILE, G_ON),
+    gsDPSetCombineMode(G_CC_MODULATEIDECALA, G_CC_MODULATEIDECALA),
+    gsDPLoadTextureBlock(texels, G_IM_FMT_RGBA, G_IM_SIZ_16b, 4, 4, 0, G_TX_CLAMP, G_TX_CLAMP, G_TX_NOMASK,
+                         G_TX_NOMASK, G_TX_NOLOD, G_TX_NOLOD),
+    gsSPVertex(triangle, 3, 0),
+    gsSP1Triangle(0, 1, 2, 0),
+    gsSPEndDisplayList(),
+};
+
+static std::vector<const GfxHeadlessCall*> find_calls(GfxHeadlessCallType type) {
+    std::vector<const GfxHeadlessCall*> calls;
+    for (const GfxHeadlessCall& call : gfx_headless_get_log()) {
+        if (call.type == type) {
+            calls.push_back(&call);
+        }
+    }
+    return calls;
+}
+
+int main() {
+    auto context = lus_test_create_headless_context();
+
+    gfx_headless_set_recording(false);
+    gfx_headless_clear_log();
+    lus_test_run_frame(frame);
+    LUS_CHECK(gfx_headless_get_log().empty());
+
+    // The texture was uploaded by the unrecorded frame, so clear the cache to see the upload again
+    gfx_texture_cache_clear();
+    gfx_headless_set_recording(true);
+    lus_test_run_frame(frame);
+
+    const std::vector<const GfxHeadlessCall*> starts = find_calls(GfxHeadlessCallType::StartFrame);
+    const std::vector<const GfxHeadlessCall*> ends = find_calls(GfxHeadlessCallType::EndFrame);
+    LUS_CHECK(starts.size() == 1 && ends.size() == 1);
+
+    const std::vector<const GfxHeadlessCall*> uploads = find_calls(GfxHeadlessCallType::UploadTexture);
+    LUS_CHECK(uploads.size() == 1);
+    if (uploads.size() == 1) {
+        LUS_CHECK(uploads[0]->args[0] == 4 && uploads[0]->args[1] == 4);
+    }
+
+    // Position and texture coordinates at least, whichever way the batch was submitted
+    std::vector<const GfxHeadlessCall*> draws = find_calls(GfxHeadlessCallType::DrawTriangles);
+    const std::vector<const GfxHeadlessCall*> indexed = find_calls(GfxHeadlessCallType::DrawTrianglesIndexed);
+    draws.insert(draws.end(), indexed.begin(), indexed.end());
+    LUS_CHECK(draws.size() == 1);
+    if (draws.size() == 1) {
+        LUS_CHECK(draws[0]->args[0] == 1 && draws[0]->args[1] == 3);
+        LUS_CHECK(draws[0]->args[2] >= 6);
+        if (starts.size() == 1 && ends.size() == 1) {
+            LUS_CHECK(starts[0] < draws[0] && draws[0] < ends[0]);
+        }
+    }
+
+    // Every call type has its own name
+    for (uint8_t a = 0; a <= (uint8_t)GfxHeadlessCallType::DeleteTexture; a++) {
+        const char* name = gfx_headless_get_call_name((GfxHeadlessCallType)a);
+        LUS_CHECK(name != nullptr && name[0] != '\0');
+        for (uint8_t b = 0; b < a; b++) {
+            LUS_CHECK(strcmp(name, gfx_headless_get_call_name((GfxHeadlessCallType)b)) != 0);
+        }
+    }
+
+    gfx_headless_clear_log();
+    LUS_CHECK(gfx_headless_get_log().empty());
+    return lus_test_result();
+}
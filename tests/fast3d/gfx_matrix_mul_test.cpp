@@ -0,0 +1,75 @@
+// Checks the SIMD matrix products against the scalar path on random matrices, including a product written over one of
+// its inputs the way gfx_sp_matrix multiplies onto the matrix stacks.
+
+#include <math.h>
+#include <string.h>
+#include <random>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_vertex_transform.h"
+
+// Sums of four products, so contracted scalar math is off by a few rounding errors of the largest term at most
+static bool nearly_equal(float a, float b, float magnitude) {
+    return fabsf(a - b) <= magnitude * 4 * 1.1920929e-7f;
+}
+
+int main() {
+    std::mt19937 rng(0x5eed);
+    std::uniform_real_distribution<float> element(-4.0f, 4.0f);
+
+    for (int round = 0; round < 100; round++) {
+        float a[4][4], b[4][4];
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                a[i][j] = element(rng);
+                b[i][j] = element(rng);
+            }
+        }
+
+        float simd[4][4], scalar[4][4];
+        gfx_matrix_mul(simd, a, b);
+        gfx_matrix_mul_scalar(scalar, a, b);
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                float magnitude = 0;
+                for (int k = 0; k < 4; k++) {
+                    magnitude += fabsf(a[i][k] * b[k][j]);
+                }
+                LUS_CHECK(nearly_equal(simd[i][j], scalar[i][j], magnitude));
+            }
+        }
+
+        // res aliasing either input gives the same product
+        float in_place[4][4];
+        memcpy(in_place, a, sizeof(in_place));
+        gfx_matrix_mul(in_place, in_place, b);
+        LUS_CHECK(memcmp(in_place, simd, sizeof(simd)) == 0);
+        memcpy(in_place, b, sizeof(in_place));
+        gfx_matrix_mul(in_place, a, in_place);
+        LUS_CHECK(memcmp(in_place, simd, sizeof(simd)) == 0);
+
+        const float v[3] = { element(rng), element(rng), element(rng) };
+        float simd_v[3], scalar_v[3];
+        gfx_transposed_matrix_mul(simd_v, v, b);
+        gfx_transposed_matrix_mul_scalar(scalar_v, v, b);
+        for (int i = 0; i < 3; i++) {
+            const float magnitude = fabsf(v[0] * b[i][0]) + fabsf(v[1] * b[i][1]) + fabsf(v[2] * b[i][2]);
+            LUS_CHECK(nearly_equal(simd_v[i], scalar_v[i], magnitude));
+        }
+    }
+
+    // Multiplying by the identity is exact
+    const float identity[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+    const float m[4][4] = { { 1, 2, 3, 4 }, { 5, 6, 7, 8 }, { 9, 10, 11, 12 }, { 13, 14, 15, 16 } };
+    float res[4][4];
+    gfx_matrix_mul(res, m, identity);
+    LUS_CHECK(memcmp(res, m, sizeof(m)) == 0);
+    gfx_matrix_mul(res, identity, m);
+    LUS_CHECK(memcmp(res, m, sizeof(m)) == 0);
+    const float axis[3] = { 0, 1, 0 };
+    float row[3];
+    gfx_transposed_matrix_mul(row, axis, m);
+    LUS_CHECK(row[0] == 2 && row[1] == 6 && row[2] == 10);
+
+    return lus_test_result();
+}
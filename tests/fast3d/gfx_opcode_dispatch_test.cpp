@@ -0,0 +1,92 @@
+// Runs display lists through the flat opcode tables on the headless backend. An opcode no ucode handles is skipped
+// without ending the list. Under S2DEX the byte values of G_VTX and G_TRI1 belong to G_OBJ_RECTANGLE and to an object
+// command S2DEX does not handle, so a triangle command draws nothing while an object rectangle draws its two
+// triangles, and the same bytes load vertices and draw again once G_LOAD_UCODE has switched back to F3DEX2.
+
+#include <vector>
+
+#include "test_utils.h"
+#include "fast3d/gfx_headless_fixture.h"
+#include "public/bridge/gfxbridge.h"
+#include "libultraship/libultra/gs2dex.h"
+
+static_assert(G_OBJ_RECTANGLE == G_VTX, "S2DEX reuses the F3DEX2 vertex opcode for object rectangles");
+static_assert(G_OBJ_LOADTXTR == G_TRI1, "S2DEX reuses the F3DEX2 triangle opcode for texture loads");
+
+#define LOAD_UCODE(ucode) { _SHIFTL(G_LOAD_UCODE, 24, 8) | _SHIFTL(ucode, 0, 16), 0 }
+
+static Vtx triangle[3] = {
+    { { { 0, 0, 0 }, 0, { 0, 0 }, { 0xFF, 0x00, 0x00, 0xFF } } },
+    { { { 1, 0, 0 }, 0, { 0, 0 }, { 0x00, 0xFF, 0x00, 0xFF } } },
+    { { { 0, 1, 0 }, 0, { 0, 0 }, { 0x00, 0x00, 0xFF, 0xFF } } },
+};
+
+// 32x32 pixels at the top left of the screen, unscaled
+static uObjSprite sprite = { { 0, 1 << 10, 32 << 5, 0, 0, 1 << 10, 32 << 5, 0, 0, 0, G_IM_FMT_RGBA, G_IM_SIZ_16b, 0,
+                               0 } };
+
+#define FRAME_SETUP()                                                                                                  \
+    gsDPPipeSync(), gsSPClearGeometryMode(0xFFFFFFFF), gsSPSetGeometryMode(G_SHADE),                                   \
+        gsDPSetRenderMode(G_RM_OPA_SURF, G_RM_OPA_SURF2),                                                              \
+        gsSPMatrix(&lus_test_identity_mtx, G_MTX_PROJECTION | G_MTX_LOAD | G_MTX_NOPUSH),                              \
+        gsSPMatrix(&lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH),                               \
+        gsDPSetCombineMode(G_CC_SHADE, G_CC_SHADE)
+
+// F3DEX2 only: one triangle, an opcode nobody handles, and a second triangle after it
+static Gfx f3dex2_frame[] = {
+    FRAME_SETUP(),
+    gsSPVertex(triangle, 3, 0),
+    gsSP1Triangle(0, 1, 2, 0),
+    // Not an opcode of any ucode
+    gsDPNoParam(0x80),
+    gsSP1Triangle(0, 2, 1, 0),
+    gsSPEndDisplayList(),
+};
+
+// The triangle command is not an S2DEX command and draws nothing, the object rectangle draws two triangles
+static Gfx s2dex_frame[] = {
+    FRAME_SETUP(),
+    gsSPVertex(triangle, 3, 0),
+    LOAD_UCODE(ucode_s2dex),
+    gsSP1Triangle(0, 1, 2, 0),
+    gsSPObjRectangle(&sprite),
+    LOAD_UCODE(ucode_f3dex2),
+    gsSPEndDisplayList(),
+};
+
+// Back under F3DEX2 the same byte values load vertices and draw a triangle again
+static Gfx switch_back_frame[] = {
+    FRAME_SETUP(),
+    LOAD_UCODE(ucode_s2dex),
+    LOAD_UCODE(ucode_f3dex2),
+    gsSPVertex(triangle, 3, 0),
+    gsSP1Triangle(0, 1, 2, 0),
+    gsSPEndDisplayList(),
+};
+
+static int count_triangles(Gfx* frame) {
+    gfx_headless_clear_log();
+    lus_test_run_frame(frame);
+
+    int triangles = 0;
+    for (const GfxHeadlessCall& call : gfx_headless_get_log()) {
+        if (call.type == GfxHeadlessCallType::DrawTriangles || call.type == GfxHeadlessCallType::DrawTrianglesIndexed) {
+            triangles += call.args[0];
+        }
+    }
+    return triangles;
+}
+
+int main() {
+    auto context = lus_test_create_headless_context();
+    gfx_headless_set_recording(true);
+
+    // Twice each, so a frame does not depend on the ucode the previous one ended with
+    for (int i = 0; i < 2; i++) {
+        LUS_CHECK(count_triangles(f3dex2_frame) == 2);
+        LUS_CHECK(count_triangles(s2dex_frame) == 2);
+        LUS_CHECK(count_triangles(switch_back_frame) == 1);
+    }
+
+    return lus_test_result();
+}
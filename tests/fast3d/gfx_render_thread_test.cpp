@@ -0,0 +1,84 @@
+// Runs the same frames with and without gRenderThread on the headless backend and checks that the backend sees the
+// same calls in the same order, including the end of each frame, which a threaded frame hands to the render thread.
+
+#include <vector>
+
+#include "test_utils.h"
+#include "fast3d/gfx_headless_fixture.h"
+#include "public/bridge/consolevariablebridge.h"
+
+static Vtx quad[4] = {
+    { { { 0, 0, 0 }, 0, { 0, 0 }, { 0xFF, 0x00, 0x00, 0xFF } } },
+    { { { 1, 0, 0 }, 0, { 0, 0 }, { 0x00, 0xFF, 0x00, 0xFF } } },
+    { { { 1, 1, 0 }, 0, { 0, 0 }, { 0x00, 0x00, 0xFF, 0xFF } } },
+    { { { 0, 1, 0 }, 0, { 0, 0 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+};
+
+// Two batches, split by the combiner change
+static Gfx frame[] = {
+    gsDPPipeSync(),
+    gsSPClearGeometryMode(0xFFFFFFFF),
+    gsSPSetGeometryMode(G_SHADE | G_SHADING_SMOOTH),
+    gsDPSetRenderMode(G_RM_OPA_SURF, G_RM_OPA_SURF2),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_PROJECTION | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsDPSetCombineMode(G_CC_SHADE, G_CC_SHADE),
+    gsSPVertex(quad, 4, 0),
+    gsSP1Triangle(0, 1, 2, 0),
+    gsDPPipeSync(),
+    gsDPSetPrimColor(0, 0, 0x80, 0x80, 0x80, 0xFF),
+    gsDPSetCombineMode(G_CC_PRIMITIVE, G_CC_PRIMITIVE),
+    gsSP1Triangle(0, 2, 3, 0),
+    gsSPEndDisplayList(),
+};
+
+static std::vector<GfxHeadlessCall> run_frames(bool threaded, int count) {
+    CVarSetInteger("gRenderThread", threaded);
+    gfx_headless_clear_log();
+    for (int i = 0; i < count; i++) {
+        lus_test_run_frame(frame);
+    }
+    // The last threaded frame is still being finished on the render thread until something waits for it
+    gfx_get_current_rendering_api();
+    return gfx_headless_get_log();
+}
+
+static int count_calls(const std::vector<GfxHeadlessCall>& log, GfxHeadlessCallType type) {
+    int count = 0;
+    for (const GfxHeadlessCall& call : log) {
+        count += call.type == type;
+    }
+    return count;
+}
+
+int main() {
+    auto context = lus_test_create_headless_context();
+    gfx_headless_set_recording(true);
+
+    // Shaders and textures are created on the first frames, after which every frame makes the same calls
+    run_frames(false, 2);
+    const std::vector<GfxHeadlessCall> direct = run_frames(false, 3);
+    const std::vector<GfxHeadlessCall> threaded = run_frames(true, 3);
+
+    LUS_CHECK(count_calls(direct, GfxHeadlessCallType::DrawTriangles) == 6);
+    LUS_CHECK(count_calls(direct, GfxHeadlessCallType::EndFrame) == 3);
+    LUS_CHECK(direct.size() == threaded.size());
+    for (size_t i = 0; i < direct.size() && i < threaded.size(); i++) {
+        LUS_CHECK(direct[i].type == threaded[i].type);
+        // The frame number keeps counting across both runs
+        if (direct[i].type != GfxHeadlessCallType::StartFrame) {
+            for (int j = 0; j < 4; j++) {
+                LUS_CHECK(direct[i].args[j] == threaded[i].args[j]);
+            }
+        }
+    }
+
+    // A threaded frame that is still in flight is finished before the next one starts
+    CVarSetInteger("gRenderThread", 1);
+    gfx_headless_clear_log();
+    lus_test_run_frame(frame);
+    gfx_start_frame();
+    LUS_CHECK(count_calls(gfx_headless_get_log(), GfxHeadlessCallType::EndFrame) == 1);
+
+    return lus_test_result();
+}
@@ -0,0 +1,180 @@
+// Replaces the global allocator with one that counts, then runs the same frame repeatedly on the headless backend
+// with recording off and checks that gfx_run makes no heap allocations once the first frames have created the
+// combiners, shaders and textures. The frame calls into a nested display list, pushes and pops matrices, loads a
+// texture and carries a marker, which covers the per-command state the interpreter keeps.
+//
+// With glibc the C allocation functions are replaced too, which also counts C code such as ImGui and SDL. Elsewhere
+// only operator new is counted.
+
+#include <errno.h>
+#include <stdlib.h>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#include "test_utils.h"
+#include "fast3d/gfx_headless_fixture.h"
+
+static std::atomic<bool> counting;
+static std::atomic<int> allocations;
+
+static void count_allocation(void) {
+    if (counting) {
+        allocations++;
+    }
+}
+
+#if defined(__GLIBC__)
+// glibc lets a program replace its allocator by defining these, and keeps the originals available under these names
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+extern "C" void* malloc(size_t size) {
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    count_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    count_allocation();
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr != nullptr ? 0 : ENOMEM;
+}
+
+extern "C" void free(void* ptr) {
+    __libc_free(ptr);
+}
+#endif
+
+static void* counted_alloc(size_t size, size_t alignment) {
+#if !defined(__GLIBC__)
+    // With glibc the malloc and aligned_alloc below count themselves
+    count_allocation();
+#endif
+    void* ptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        ptr = malloc(size != 0 ? size : 1);
+    } else {
+#ifdef _WIN32
+        ptr = _aligned_malloc(size != 0 ? size : 1, alignment);
+#else
+        ptr = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// The array and nothrow forms call these by default
+void* operator new(size_t size) {
+    return counted_alloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return counted_alloc(size, (size_t)alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t alignment) noexcept {
+    operator delete(ptr, alignment);
+}
+
+static Vtx quad[4] = {
+    { { { 0, 0, 0 }, 0, { 0, 8 << 5 }, { 0xFF, 0x00, 0x00, 0xFF } } },
+    { { { 1, 0, 0 }, 0, { 8 << 5, 8 << 5 }, { 0x00, 0xFF, 0x00, 0xFF } } },
+    { { { 1, 1, 0 }, 0, { 8 << 5, 0 }, { 0x00, 0x00, 0xFF, 0xFF } } },
+    { { { 0, 1, 0 }, 0, { 0, 0 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+};
+
+// 8x8 RGBA16, aligned since an odd address marks a resource path
+alignas(8) static uint16_t texels[64];
+
+static Gfx textured_quad[] = {
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_PUSH),
+    gsSPTexture(0xFFFF, 0xFFFF, 0, G_TX_RENDERTILE, G_ON),
+    gsDPSetCombineMode(G_CC_MODULATEIDECALA, G_CC_MODULATEIDECALA),
+    gsDPLoadTextureBlock(texels, G_IM_FMT_RGBA, G_IM_SIZ_16b, 8, 8, 0, G_TX_WRAP, G_TX_WRAP, 3, 3, G_TX_NOLOD,
+                         G_TX_NOLOD),
+    gsSPVertex(quad, 4, 0),
+    gsSP2Triangles(0, 1, 2, 0, 0, 2, 3, 0),
+    gsSPPopMatrix(G_MTX_MODELVIEW),
+    gsSPEndDisplayList(),
+};
+
+static Gfx frame[] = {
+    gsDPPipeSync(),
+    gsSPClearGeometryMode(0xFFFFFFFF),
+    gsSPSetGeometryMode(G_SHADE | G_SHADING_SMOOTH),
+    gsDPSetRenderMode(G_RM_OPA_SURF, G_RM_OPA_SURF2),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_PROJECTION | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsDPSetCombineMode(G_CC_SHADE, G_CC_SHADE),
+    gsSPVertex(quad, 4, 0),
+    gsSP1Triangle(0, 1, 2, 0),
+    // A marker is followed by the CRC of the marked list's name
+    { _SHIFTL(G_MARKER, 24, 8), 0 },
+    { 0, 0x1234ABCD },
+    gsSPDisplayList(textured_quad),
+    gsSPDisplayList(textured_quad),
+    gsSPEndDisplayList(),
+};
+
+int main() {
+    for (int i = 0; i < 64; i++) {
+        texels[i] = (uint16_t)((i << 10) | (i << 1) | 1);
+    }
+
+    auto context = lus_test_create_headless_context();
+    gfx_headless_set_recording(false);
+
+    for (int i = 0; i < 3; i++) {
+        lus_test_run_frame(frame);
+    }
+
+    static const std::unordered_map<Mtx*, MtxF> no_replacements;
+    for (int i = 0; i < 10; i++) {
+        gfx_start_frame();
+        allocations = 0;
+        counting = true;
+        gfx_run(frame, no_replacements);
+        counting = false;
+        LUS_CHECK(allocations == 0);
+        gfx_end_frame();
+    }
+
+    return lus_test_result();
+}
@@ -0,0 +1,87 @@
+// Writes shader cache files and reads them back: records survive a reopen with the same header, a different header
+// starts the file over, a truncated tail is dropped, and the source hash tells generated shaders apart.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_shader_cache.h"
+
+static const std::vector<uint8_t> header = { 'T', 'E', 'S', 'T', 1 };
+
+static GfxProgramBinary make_binary(uint64_t shader_id0, uint32_t shader_id1, uint64_t source_hash, size_t size) {
+    GfxProgramBinary binary = { shader_id0, shader_id1, source_hash, 0x8741, std::vector<uint8_t>(size) };
+    for (size_t i = 0; i < size; i++) {
+        binary.data[i] = (uint8_t)(shader_id1 + i);
+    }
+    return binary;
+}
+
+static bool same_binary(const GfxProgramBinary& a, const GfxProgramBinary& b) {
+    return a.shader_id0 == b.shader_id0 && a.shader_id1 == b.shader_id1 && a.source_hash == b.source_hash &&
+           a.format == b.format && a.data == b.data;
+}
+
+int main() {
+    const std::string path = "gfx_shader_cache_test.bin";
+    remove(path.c_str());
+
+    const GfxProgramBinary first = make_binary(0x0123456789ABCDEFULL, 7, 0x1111, 100);
+    const GfxProgramBinary second = make_binary(0x01080108, 0, 0x2222, 0);
+    const GfxProgramBinary third = make_binary(0x0123456789ABCDEFULL, 7, 0x3333, 37);
+
+    // A missing file is created holding only the header
+    GfxShaderCacheFile cache;
+    std::vector<uint8_t> records;
+    LUS_CHECK(gfx_shader_cache_open(&cache, path, header, &records));
+    LUS_CHECK(records.empty());
+    gfx_shader_cache_append_program_binary(&cache, first);
+    gfx_shader_cache_append_program_binary(&cache, second);
+    gfx_shader_cache_close(&cache);
+
+    // Reopening appends after the records already there
+    LUS_CHECK(gfx_shader_cache_open(&cache, path, header, &records));
+    gfx_shader_cache_append_program_binary(&cache, third);
+    gfx_shader_cache_close(&cache);
+    LUS_CHECK(gfx_shader_cache_open(&cache, path, header, &records));
+    gfx_shader_cache_close(&cache);
+    std::vector<GfxProgramBinary> binaries = gfx_shader_cache_read_program_binaries(records);
+    LUS_CHECK(binaries.size() == 3);
+    if (binaries.size() == 3) {
+        LUS_CHECK(same_binary(binaries[0], first));
+        LUS_CHECK(same_binary(binaries[1], second));
+        LUS_CHECK(same_binary(binaries[2], third));
+    }
+
+    // A record cut short by a crash is ignored, along with a header too short to hold its size
+    for (size_t cut = 1; cut <= 28 + third.data.size(); cut++) {
+        std::vector<uint8_t> truncated(records.begin(), records.end() - cut);
+        binaries = gfx_shader_cache_read_program_binaries(truncated);
+        LUS_CHECK(binaries.size() == 2);
+    }
+
+    // Another header, as written by an older version or another driver, starts the file over
+    const std::vector<uint8_t> other_header = { 'T', 'E', 'S', 'T', 2 };
+    LUS_CHECK(gfx_shader_cache_open(&cache, path, other_header, &records));
+    gfx_shader_cache_close(&cache);
+    LUS_CHECK(records.empty());
+    LUS_CHECK(gfx_shader_cache_open(&cache, path, header, &records));
+    gfx_shader_cache_close(&cache);
+    LUS_CHECK(records.empty());
+    remove(path.c_str());
+
+    // Any change to either shader changes the hash, including text moving from one shader to the other
+    const char* vs = "void main() { gl_Position = aVtxPos; }";
+    const char* fs = "void main() { gl_FragColor = vec4(1.0); }";
+    const uint64_t hash = gfx_shader_source_hash(vs, strlen(vs), fs, strlen(fs));
+    LUS_CHECK(hash == gfx_shader_source_hash(vs, strlen(vs), fs, strlen(fs)));
+    LUS_CHECK(hash != gfx_shader_source_hash(vs, strlen(vs) - 1, fs, strlen(fs)));
+    LUS_CHECK(hash != gfx_shader_source_hash(vs, strlen(vs), fs, strlen(fs) - 1));
+    const std::string joined = std::string(vs) + fs;
+    LUS_CHECK(hash != gfx_shader_source_hash(joined.c_str(), strlen(vs) + 1, joined.c_str() + strlen(vs) + 1,
+                                             strlen(fs) - 1));
+
+    return lus_test_result();
+}
@@ -0,0 +1,179 @@
+// Draws scenes through the software rendering API and reads them back. A scene of flat quads, a blended quad and a
+// point sampled texture is compared with a golden image of what each 10x10 block holds, and a scene of overlapping
+// shaded, blended and depth tested triangles must come out byte for byte the same on one thread and on several.
+
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_software.h"
+#include "graphic/Fast3D/gfx_cc.h"
+#include "libultraship/libultra/gbi.h"
+
+// The backend only reads the Z-fighting mode and clears the texture cache of the interpreter, which is not linked
+extern "C" int32_t CVarGetInteger(const char* name, int32_t defaultValue) {
+    return defaultValue;
+}
+
+extern "C" void gfx_texture_cache_clear() {
+}
+
+// Output of input 1, color and alpha
+static const uint64_t shade_shader_id0 = 0x10001000;
+// TEXEL0 times input 1, color and alpha
+static const uint64_t texture_shader_id0 = 0x01080108;
+
+static const uint32_t width = 160;
+static const uint32_t height = 120;
+
+// One character per 10x10 block, from the top left
+static const char* const golden[] = {
+    "RRRRRRRR........", "RRRRRRRR........", "RRRRRRRR........", "RRRRRRRRGGGG....",
+    "RRRRRRRRGGGG....", "RRRRRRRRGGGG....", "....GGGGGGccbbbb", "....GGGGGGccbbbb",
+    "YYMMGGGGGGccbbbb", "YYMM......bbbbbb", "CCWW......bbbbbb", "CCWW......bbbbbb",
+};
+
+static bool golden_color(char block, int rgb[3]) {
+    static const struct {
+        char block;
+        int rgb[3];
+    } colors[] = {
+        { '.', { 0, 0, 0 } },     { 'R', { 255, 0, 0 } },     { 'G', { 0, 255, 0 } },   { 'b', { 0, 0, 128 } },
+        { 'c', { 0, 127, 128 } }, { 'Y', { 255, 255, 0 } },   { 'M', { 255, 0, 255 } }, { 'C', { 0, 255, 255 } },
+        { 'W', { 255, 255, 255 } },
+    };
+    for (const auto& color : colors) {
+        if (color.block == block) {
+            memcpy(rgb, color.rgb, sizeof(color.rgb));
+            return true;
+        }
+    }
+    return false;
+}
+
+// Two triangles covering the pixel rectangle, with the varyings after the clip space position given per corner from
+// the top left, clockwise
+static void draw_rect(float x0, float y0, float x1, float y1, float z, const std::vector<std::vector<float>>& corners) {
+    const float left = x0 / width * 2 - 1, right = x1 / width * 2 - 1;
+    const float top = 1 - y0 / height * 2, bottom = 1 - y1 / height * 2;
+    const float positions[4][4] = { { left, top, z, 1 }, { right, top, z, 1 }, { right, bottom, z, 1 },
+                                    { left, bottom, z, 1 } };
+    std::vector<float> vbo;
+    for (int i : { 0, 3, 2, 0, 2, 1 }) {
+        vbo.insert(vbo.end(), positions[i], positions[i] + 4);
+        vbo.insert(vbo.end(), corners[i].begin(), corners[i].end());
+    }
+    gfx_software_rapi.draw_triangles(vbo.data(), vbo.size(), 2);
+}
+
+static void begin_frame(int fb, uint32_t fb_width, uint32_t fb_height) {
+    gfx_software_rapi.update_framebuffer_parameters(fb, fb_width, fb_height, 1, false, true, true, true);
+    gfx_software_rapi.start_frame();
+    gfx_software_rapi.start_draw_to_framebuffer(fb, 1.0f);
+    gfx_software_rapi.clear_framebuffer();
+    gfx_software_rapi.set_viewport(0, 0, fb_width, fb_height);
+    gfx_software_rapi.set_scissor(0, 0, fb_width, fb_height);
+}
+
+static std::vector<uint8_t> read_frame(int fb) {
+    gfx_software_rapi.end_frame();
+    std::vector<uint8_t> rgba;
+    uint32_t w, h;
+    gfx_software_read_framebuffer(fb, &rgba, &w, &h);
+    return rgba;
+}
+
+static std::vector<uint8_t> draw_golden_scene(int fb, uint32_t texture) {
+    begin_frame(fb, width, height);
+    gfx_software_rapi.create_and_load_new_shader(shade_shader_id0, SHADER_OPT_ALPHA);
+
+    // Red in front of green, which is drawn later but fails the depth test
+    gfx_software_rapi.set_depth_test_and_mask(true, true);
+    gfx_software_rapi.set_use_alpha(false);
+    const std::vector<float> red = { 1, 0, 0, 1 }, green = { 0, 1, 0, 1 }, blue = { 0, 0, 1, 128 / 255.0f };
+    draw_rect(0, 0, 80, 60, -0.5f, { red, red, red, red });
+    draw_rect(40, 30, 120, 90, 0.5f, { green, green, green, green });
+
+    // Blue at half alpha over green and over the cleared black
+    gfx_software_rapi.set_depth_test_and_mask(false, false);
+    gfx_software_rapi.set_use_alpha(true);
+    draw_rect(100, 60, 160, 120, 0, { blue, blue, blue, blue });
+
+    // 2x2 texture stretched over 40x40 pixels, point sampled
+    gfx_software_rapi.set_use_alpha(false);
+    gfx_software_rapi.create_and_load_new_shader(texture_shader_id0, SHADER_OPT_ALPHA);
+    gfx_software_rapi.select_texture(0, texture);
+    gfx_software_rapi.set_sampler_parameters(0, false, G_TX_CLAMP, G_TX_CLAMP);
+    draw_rect(0, 80, 40, 120, 0,
+              { { 0, 0, 1, 1, 1, 1 }, { 1, 0, 1, 1, 1, 1 }, { 1, 1, 1, 1, 1, 1 }, { 0, 1, 1, 1, 1, 1 } });
+
+    return read_frame(fb);
+}
+
+// Hundreds of triangles crossing tile boundaries on a framebuffer that ends in partial tiles, each drawn over the
+// ones before it in a different mode, so any change in order between tiles would show
+static std::vector<uint8_t> draw_stress_scene(int fb) {
+    const uint32_t fb_width = 333, fb_height = 217;
+    begin_frame(fb, fb_width, fb_height);
+    gfx_software_rapi.create_and_load_new_shader(shade_shader_id0, SHADER_OPT_ALPHA);
+
+    std::mt19937 rng(0x5eed);
+    std::uniform_real_distribution<float> position(-1.2f, 1.2f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int i = 0; i < 300; i++) {
+        gfx_software_rapi.set_depth_test_and_mask(i % 3 != 0, i % 2 == 0);
+        gfx_software_rapi.set_use_alpha(i % 4 == 1);
+        std::vector<float> vbo;
+        for (int v = 0; v < 3; v++) {
+            const float w = 0.5f + unit(rng);
+            vbo.insert(vbo.end(), { position(rng) * w, position(rng) * w, (unit(rng) * 2 - 1) * w, w });
+            vbo.insert(vbo.end(), { unit(rng), unit(rng), unit(rng), unit(rng) });
+        }
+        gfx_software_rapi.draw_triangles(vbo.data(), vbo.size(), 1);
+    }
+
+    return read_frame(fb);
+}
+
+int main() {
+    gfx_software_rapi.init();
+    gfx_software_rapi.set_texture_filter(FILTER_NONE);
+    const int fb = gfx_software_rapi.create_framebuffer();
+
+    // Yellow and magenta on the top row, cyan and white below
+    const uint8_t texels[16] = { 255, 255, 0, 255, 255, 0, 255, 255, 0, 255, 255, 255, 255, 255, 255, 255 };
+    const uint32_t texture = gfx_software_rapi.new_texture();
+    gfx_software_rapi.select_texture(0, texture);
+    gfx_software_rapi.upload_texture(texels, 2, 2);
+
+    for (uint32_t threads : { 1, 4 }) {
+        gfx_software_set_thread_count(threads);
+        const std::vector<uint8_t> image = draw_golden_scene(fb, texture);
+        LUS_CHECK(image.size() == width * height * 4);
+        if (image.size() != width * height * 4) {
+            continue;
+        }
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                int rgb[3];
+                LUS_CHECK(golden_color(golden[y / 10][x / 10], rgb));
+                const uint8_t* pixel = &image[(y * width + x) * 4];
+                for (int j = 0; j < 3; j++) {
+                    // Blending is the only rounding, and may land on either side
+                    LUS_CHECK(pixel[j] >= rgb[j] - 1 && pixel[j] <= rgb[j] + 1);
+                }
+                LUS_CHECK(pixel[3] == 255);
+            }
+        }
+    }
+
+    gfx_software_set_thread_count(1);
+    const std::vector<uint8_t> single = draw_stress_scene(fb);
+    for (uint32_t threads : { 2, 3, 8, 0 }) {
+        gfx_software_set_thread_count(threads);
+        LUS_CHECK(draw_stress_scene(fb) == single);
+    }
+
+    return lus_test_result();
+}
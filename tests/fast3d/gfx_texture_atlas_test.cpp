@@ -0,0 +1,95 @@
+// Runs a synthetic HUD, a dozen small clamped icons drawn one after another, on the headless backend and counts the
+// draw calls. Each icon is a draw of its own without gTextureAtlas, and they all share one draw once their copies sit
+// on the same atlas page.
+
+#include "test_utils.h"
+#include "fast3d/gfx_headless_fixture.h"
+#include "public/bridge/consolevariablebridge.h"
+
+static Vtx quad[4] = {
+    { { { 0, 0, 0 }, 0, { 0, 8 << 5 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+    { { { 1, 0, 0 }, 0, { 8 << 5, 8 << 5 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+    { { { 1, 1, 0 }, 0, { 8 << 5, 0 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+    { { { 0, 1, 0 }, 0, { 0, 0 }, { 0xFF, 0xFF, 0xFF, 0xFF } } },
+};
+
+// 8x8 RGBA16 icons, each different so none is found as a duplicate of another. Aligned since an odd address marks a
+// resource path.
+alignas(8) static uint16_t icons[12][64];
+
+#define HUD_ICON(texels)                                                                                               \
+    gsDPLoadTextureBlock(texels, G_IM_FMT_RGBA, G_IM_SIZ_16b, 8, 8, 0, G_TX_CLAMP, G_TX_CLAMP, G_TX_NOMASK,            \
+                         G_TX_NOMASK, G_TX_NOLOD, G_TX_NOLOD),                                                         \
+        gsSP2Triangles(0, 1, 2, 0, 0, 2, 3, 0)
+
+static Gfx hud[] = {
+    gsDPPipeSync(),
+    gsSPClearGeometryMode(0xFFFFFFFF),
+    gsSPSetGeometryMode(G_SHADE),
+    gsDPSetRenderMode(G_RM_XLU_SURF, G_RM_XLU_SURF2),
+    gsDPSetTextureFilter(G_TF_POINT),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_PROJECTION | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsSPMatrix(&lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH),
+    gsSPTexture(0xFFFF, 0xFFFF, 0, G_TX_RENDERTILE, G_ON),
+    gsDPSetCombineMode(G_CC_DECALRGBA, G_CC_DECALRGBA),
+    gsSPVertex(quad, 4, 0),
+    HUD_ICON(icons[0]),
+    HUD_ICON(icons[1]),
+    HUD_ICON(icons[2]),
+    HUD_ICON(icons[3]),
+    HUD_ICON(icons[4]),
+    HUD_ICON(icons[5]),
+    HUD_ICON(icons[6]),
+    HUD_ICON(icons[7]),
+    HUD_ICON(icons[8]),
+    HUD_ICON(icons[9]),
+    HUD_ICON(icons[10]),
+    HUD_ICON(icons[11]),
+    gsSPEndDisplayList(),
+};
+
+// Runs the HUD twice with the texture cache emptied first, so the icons are imported, and with the atlas on copied,
+// in the first frame. Returns the draw calls and triangles of the second.
+static void count_draws(bool atlas, int* draws, int* triangles) {
+    CVarSetInteger("gTextureAtlas", atlas);
+    gfx_texture_cache_clear();
+    lus_test_run_frame(hud);
+    gfx_headless_clear_log();
+    lus_test_run_frame(hud);
+
+    *draws = 0;
+    *triangles = 0;
+    for (const GfxHeadlessCall& call : gfx_headless_get_log()) {
+        if (call.type == GfxHeadlessCallType::DrawTriangles ||
+            call.type == GfxHeadlessCallType::DrawTrianglesIndexed) {
+            (*draws)++;
+            *triangles += call.args[0];
+        }
+    }
+}
+
+int main() {
+    for (int i = 0; i < 12; i++) {
+        for (int j = 0; j < 64; j++) {
+            icons[i][j] = (uint16_t)((i << 11) | (j << 1) | 1);
+        }
+    }
+
+    auto context = lus_test_create_headless_context();
+    gfx_headless_set_recording(true);
+
+    int draws, triangles;
+    count_draws(false, &draws, &triangles);
+    LUS_CHECK(draws == 12);
+    LUS_CHECK(triangles == 24);
+
+    count_draws(true, &draws, &triangles);
+    LUS_CHECK(draws == 1);
+    LUS_CHECK(triangles == 24);
+
+    // Turning the atlas off again goes back to a draw per icon
+    count_draws(false, &draws, &triangles);
+    LUS_CHECK(draws == 12);
+
+    return lus_test_result();
+}
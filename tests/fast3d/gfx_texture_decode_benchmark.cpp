@@ -0,0 +1,77 @@
+// Reports how many megatexels per second each texture decoder converts, for the SIMD and scalar paths, on a 256x256
+// texture of random texels. Not run by ctest; run it on the target machine to compare builds.
+
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "graphic/Fast3D/gfx_texture_decode.h"
+
+struct DecoderCase {
+    const char* name;
+    void (*decode)(const uint8_t* src, uint8_t* dst, uint32_t count);
+    void (*decode_scalar)(const uint8_t* src, uint8_t* dst, uint32_t count);
+};
+
+static const DecoderCase decoders[] = {
+    { "RGBA16", gfx_decode_rgba16, gfx_decode_rgba16_scalar }, { "IA4", gfx_decode_ia4, gfx_decode_ia4_scalar },
+    { "IA8", gfx_decode_ia8, gfx_decode_ia8_scalar },          { "IA16", gfx_decode_ia16, gfx_decode_ia16_scalar },
+    { "I4", gfx_decode_i4, gfx_decode_i4_scalar },             { "I8", gfx_decode_i8, gfx_decode_i8_scalar },
+};
+
+static const uint32_t texels = 256 * 256;
+static const int rounds = 500;
+
+static double megatexels_per_second(void (*decode)(const uint8_t*, uint8_t*, uint32_t), const uint8_t* src,
+                                    uint8_t* dst) {
+    decode(src, dst, texels);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        decode(src, dst, texels);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double)texels * rounds / elapsed.count() / 1e6;
+}
+
+int main() {
+    std::mt19937 rng(0x5eed);
+    std::vector<uint8_t> src(texels * 2);
+    for (uint8_t& byte : src) {
+        byte = (uint8_t)rng();
+    }
+    std::vector<uint8_t> dst(texels * 4);
+
+    printf("%-8s %12s %12s\n", "format", "simd Mt/s", "scalar Mt/s");
+    for (const DecoderCase& decoder : decoders) {
+        const double simd = megatexels_per_second(decoder.decode, src.data(), dst.data());
+        const double scalar = megatexels_per_second(decoder.decode_scalar, src.data(), dst.data());
+        printf("%-8s %12.1f %12.1f\n", decoder.name, simd, scalar);
+    }
+
+    // CI goes through the palette lookup table in both the texture import and here
+    std::vector<uint8_t> palette(256 * 2);
+    for (uint8_t& byte : palette) {
+        byte = (uint8_t)rng();
+    }
+    bool used[256];
+    for (bool& entry : used) {
+        entry = true;
+    }
+    uint32_t lut[256];
+    gfx_decode_palette_rgba16(palette.data(), used, 256, lut);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        gfx_decode_ci4(src.data(), lut, dst.data(), texels);
+    }
+    const std::chrono::duration<double> ci4 = std::chrono::steady_clock::now() - start;
+    const auto ci8_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        gfx_decode_ci8(src.data(), lut, dst.data(), texels);
+    }
+    const std::chrono::duration<double> ci8 = std::chrono::steady_clock::now() - ci8_start;
+    printf("%-8s %12.1f\n", "CI4", (double)texels * rounds / ci4.count() / 1e6);
+    printf("%-8s %12.1f\n", "CI8", (double)texels * rounds / ci8.count() / 1e6);
+
+    return 0;
+}
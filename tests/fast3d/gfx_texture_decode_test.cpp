@@ -0,0 +1,108 @@
+// Checks the SIMD texture decoders against the scalar path byte for byte: every 16-bit texel value, random spans of
+// every length up to a few vector widths so each tail is covered, and source and destination at odd offsets. CI
+// textures are checked through the palette lookup table against reading the palette per texel.
+
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_texture_decode.h"
+
+struct DecoderCase {
+    const char* name;
+    void (*decode)(const uint8_t* src, uint8_t* dst, uint32_t count);
+    void (*decode_scalar)(const uint8_t* src, uint8_t* dst, uint32_t count);
+    uint32_t bits_per_texel;
+};
+
+static const DecoderCase decoders[] = {
+    { "RGBA16", gfx_decode_rgba16, gfx_decode_rgba16_scalar, 16 },
+    { "IA4", gfx_decode_ia4, gfx_decode_ia4_scalar, 4 },
+    { "IA8", gfx_decode_ia8, gfx_decode_ia8_scalar, 8 },
+    { "IA16", gfx_decode_ia16, gfx_decode_ia16_scalar, 16 },
+    { "I4", gfx_decode_i4, gfx_decode_i4_scalar, 4 },
+    { "I8", gfx_decode_i8, gfx_decode_i8_scalar, 8 },
+};
+
+static uint32_t src_size(uint32_t bits_per_texel, uint32_t count) {
+    return (count * bits_per_texel + 7) / 8;
+}
+
+static bool decodes_alike(const DecoderCase& decoder, const uint8_t* src, uint32_t count, uint32_t dst_offset) {
+    // Bytes past the span must be left alone, so both outputs start from the same fill
+    std::vector<uint8_t> simd(dst_offset + count * 4 + 16, 0xCD);
+    std::vector<uint8_t> scalar(simd.size(), 0xCD);
+    decoder.decode(src, simd.data() + dst_offset, count);
+    decoder.decode_scalar(src, scalar.data() + dst_offset, count);
+    return memcmp(simd.data(), scalar.data(), simd.size()) == 0;
+}
+
+int main() {
+    std::mt19937 rng(0x5eed);
+
+    // Every value a texel can hold, laid out as one long span
+    std::vector<uint8_t> all_values(0x10000 * 2);
+    for (uint32_t i = 0; i < 0x10000; i++) {
+        all_values[2 * i] = i >> 8;
+        all_values[2 * i + 1] = i & 0xFF;
+    }
+    for (const DecoderCase& decoder : decoders) {
+        const uint32_t count = (uint32_t)all_values.size() * 8 / decoder.bits_per_texel;
+        LUS_CHECK(decodes_alike(decoder, all_values.data(), count, 0));
+    }
+
+    // Short spans hit the scalar tail after zero, one or more vector iterations
+    for (const DecoderCase& decoder : decoders) {
+        for (uint32_t count = 0; count <= 67; count++) {
+            for (uint32_t offset = 0; offset < 4; offset++) {
+                std::vector<uint8_t> src(offset + src_size(decoder.bits_per_texel, count));
+                for (uint8_t& byte : src) {
+                    byte = (uint8_t)rng();
+                }
+                LUS_CHECK(decodes_alike(decoder, src.data() + offset, count, offset));
+            }
+        }
+    }
+
+    // CI through the lookup table matches reading the palette per texel, with only the used entries decoded
+    std::vector<uint8_t> palette(256 * 2);
+    for (uint8_t& byte : palette) {
+        byte = (uint8_t)rng();
+    }
+    for (uint32_t count = 0; count <= 67; count++) {
+        std::vector<uint8_t> src(count);
+        for (uint8_t& byte : src) {
+            byte = (uint8_t)rng();
+        }
+        std::vector<uint8_t> lut_out(count * 4 + 16, 0xCD);
+        std::vector<uint8_t> scalar(lut_out.size(), 0xCD);
+
+        bool used[256] = {};
+        uint32_t lut[256];
+        gfx_mark_ci4_indices(src.data(), count, used);
+        gfx_decode_palette_rgba16(palette.data(), used, 16, lut);
+        gfx_decode_ci4(src.data(), lut, lut_out.data(), count);
+        gfx_decode_ci4_scalar(src.data(), palette.data(), scalar.data(), count);
+        LUS_CHECK(memcmp(lut_out.data(), scalar.data(), lut_out.size()) == 0);
+
+        memset(used, 0, sizeof(used));
+        gfx_mark_ci8_indices(src.data(), count, used);
+        gfx_decode_palette_rgba16(palette.data(), used, 256, lut);
+        gfx_decode_ci8(src.data(), lut, lut_out.data(), count);
+        gfx_decode_ci8_scalar(src.data(), palette.data(), scalar.data(), count);
+        LUS_CHECK(memcmp(lut_out.data(), scalar.data(), lut_out.size()) == 0);
+    }
+
+    // Known values: full and zero intensity, and the 5-bit and 4-bit channels scaled to the full byte range
+    const uint8_t rgba16[2] = { 0xF8, 0x01 };
+    uint8_t out[4];
+    gfx_decode_rgba16(rgba16, out, 1);
+    LUS_CHECK(out[0] == 0xFF && out[1] == 0x00 && out[2] == 0x00 && out[3] == 0xFF);
+    const uint8_t i4 = 0xF0;
+    uint8_t i4_out[8];
+    gfx_decode_i4(&i4, i4_out, 2);
+    LUS_CHECK(i4_out[0] == 0xFF && i4_out[3] == 0xFF && i4_out[4] == 0x00 && i4_out[7] == 0x00);
+
+    return lus_test_result();
+}
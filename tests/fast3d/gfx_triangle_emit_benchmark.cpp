@@ -0,0 +1,88 @@
+// Emits a million triangles per frame through gfx_run on the headless backend with recording off, once with a shaded
+// combiner and once with a texture and fog, and reports triangles per second for each. Almost all the time goes into
+// gfx_sp_tri1 writing the vertex buffer, since every batch shares one combiner. Not run by ctest.
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "fast3d/gfx_headless_fixture.h"
+
+static const uint32_t triangles_per_frame = 1000000;
+static const int frames = 5;
+
+static Vtx vertices[32];
+
+// 8x8 RGBA16, aligned since an odd address marks a resource path
+alignas(8) static uint16_t texels[64];
+
+static Gfx load_texture[] = {
+    gsDPLoadTextureBlock(texels, G_IM_FMT_RGBA, G_IM_SIZ_16b, 8, 8, 0, G_TX_WRAP, G_TX_WRAP, 3, 3, G_TX_NOLOD,
+                         G_TX_NOLOD),
+    gsSPEndDisplayList(),
+};
+
+static std::vector<Gfx> build_display_list(bool textured) {
+    // Each vertex load is followed by eight commands of two triangles
+    std::vector<Gfx> list(triangles_per_frame / 16 * 9 + 32);
+    Gfx* g = list.data();
+
+    gDPPipeSync(g++);
+    gSPClearGeometryMode(g++, 0xFFFFFFFF);
+    gSPMatrix(g++, &lus_test_identity_mtx, G_MTX_PROJECTION | G_MTX_LOAD | G_MTX_NOPUSH);
+    gSPMatrix(g++, &lus_test_identity_mtx, G_MTX_MODELVIEW | G_MTX_LOAD | G_MTX_NOPUSH);
+    if (textured) {
+        gSPSetGeometryMode(g++, G_SHADE | G_SHADING_SMOOTH | G_FOG);
+        gDPSetRenderMode(g++, G_RM_FOG_SHADE_A, G_RM_OPA_SURF2);
+        gSPFogPosition(g++, 900, 1000);
+        gDPSetFogColor(g++, 0x40, 0x60, 0x80, 0xFF);
+        gSPTexture(g++, 0xFFFF, 0xFFFF, 0, G_TX_RENDERTILE, G_ON);
+        gDPSetCombineMode(g++, G_CC_MODULATEIDECALA, G_CC_PASS2);
+        __gSPDisplayList(g++, load_texture);
+    } else {
+        gSPSetGeometryMode(g++, G_SHADE | G_SHADING_SMOOTH);
+        gDPSetRenderMode(g++, G_RM_OPA_SURF, G_RM_OPA_SURF2);
+        gDPSetCombineMode(g++, G_CC_SHADE, G_CC_SHADE);
+    }
+    for (uint32_t t = 0; t < triangles_per_frame; t += 16) {
+        __gSPVertex(g++, vertices, 32, 0);
+        for (int q = 0; q < 8; q++) {
+            gSP2Triangles(g++, q * 4, q * 4 + 1, q * 4 + 2, 0, q * 4, q * 4 + 2, q * 4 + 3, 0);
+        }
+    }
+    gSPEndDisplayList(g++);
+    list.resize(g - list.data());
+    return list;
+}
+
+static double triangles_per_second(Gfx* list) {
+    // The first frame creates the combiner, the shader and the texture
+    lus_test_run_frame(list);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        lus_test_run_frame(list);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double)triangles_per_frame * frames / elapsed.count();
+}
+
+int main() {
+    for (int i = 0; i < 32; i++) {
+        // Every group of four is the same quad inside the clip volume, so no triangle is rejected
+        const short x = (i % 4 == 1 || i % 4 == 2), y = (i % 4 >= 2);
+        const short s = (short)(x << 8), t = (short)(y << 8);
+        vertices[i] = { { { x, y, 0 }, 0, { s, t }, { (uint8_t)(i * 8), 0x80, 0xFF, 0xFF } } };
+    }
+    for (int i = 0; i < 64; i++) {
+        texels[i] = (uint16_t)(i * 0x0421) | 1;
+    }
+
+    auto context = lus_test_create_headless_context();
+    gfx_headless_set_recording(false);
+
+    std::vector<Gfx> shaded = build_display_list(false);
+    std::vector<Gfx> textured = build_display_list(true);
+    printf("shaded            %6.2f M triangles/s\n", triangles_per_second(shaded.data()) / 1e6);
+    printf("textured with fog %6.2f M triangles/s\n", triangles_per_second(textured.data()) / 1e6);
+    return 0;
+}
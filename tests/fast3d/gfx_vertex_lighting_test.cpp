@@ -0,0 +1,110 @@
+// Checks the SIMD vertex lighting and texgen against the scalar path on random lights and normals, with directional
+// and point lights mixed and batch sizes that leave a tail for the scalar loop.
+
+#include <math.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_vertex_transform.h"
+
+static void normalize(float v[3]) {
+    const float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (int j = 0; j < 3; j++) {
+        v[j] /= length;
+    }
+}
+
+int main() {
+    std::mt19937 rng(0x1167);
+    std::uniform_real_distribution<float> element(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> normal(-128, 127);
+    std::uniform_int_distribution<int> coordinate(-2000, 2000);
+
+    for (size_t count = 0; count <= 37; count++) {
+        float modelview[4][4];
+        for (auto& row : modelview) {
+            for (float& value : row) {
+                value = element(rng);
+            }
+        }
+
+        GfxVertexLight lights[7];
+        const int num_lights = (int)(count % 8);
+        for (int l = 0; l < num_lights; l++) {
+            for (int j = 0; j < 3; j++) {
+                lights[l].dir[j] = element(rng);
+                lights[l].color[j] = byte(rng);
+                lights[l].pos[j] = coordinate(rng);
+            }
+            normalize(lights[l].dir);
+            lights[l].positional = l % 2 == 1;
+            lights[l].linear_attenuation = byte(rng) * 2.0f;
+            lights[l].quadratic_attenuation = byte(rng) / 8.0f;
+        }
+        const uint8_t ambient[3] = { (uint8_t)byte(rng), (uint8_t)byte(rng), (uint8_t)byte(rng) };
+
+        float lookat[2][3];
+        for (auto& direction : lookat) {
+            for (float& value : direction) {
+                value = element(rng);
+            }
+            normalize(direction);
+        }
+
+        std::vector<Vtx> vertices(count);
+        std::vector<float> eye_pos(count * 4);
+        for (size_t i = 0; i < count; i++) {
+            vertices[i] = {};
+            for (signed char& n : vertices[i].n.n) {
+                n = (signed char)normal(rng);
+            }
+            for (int j = 0; j < 4; j++) {
+                eye_pos[i * 4 + j] = (float)coordinate(rng);
+            }
+        }
+
+        std::vector<uint8_t> simd(count * 3, 0);
+        std::vector<uint8_t> scalar(count * 3, 0);
+        gfx_light_vertices(lights, num_lights, ambient, modelview, vertices.data(), (float(*)[4])eye_pos.data(),
+                           count, (uint8_t(*)[3])simd.data());
+        gfx_light_vertices_scalar(lights, num_lights, ambient, modelview, vertices.data(),
+                                  (float(*)[4])eye_pos.data(), count, (uint8_t(*)[3])scalar.data());
+
+        // Both paths round the same way, but a contracted multiply-add in the scalar path can move a sum across an
+        // integer and change a channel by one
+        for (size_t i = 0; i < count * 3; i++) {
+            LUS_CHECK(abs(simd[i] - scalar[i]) <= 1);
+        }
+
+        std::vector<float> simd_dots(count * 2, NAN);
+        std::vector<float> scalar_dots(count * 2, NAN);
+        gfx_texgen_vertices(lookat, vertices.data(), count, (float(*)[2])simd_dots.data());
+        gfx_texgen_vertices_scalar(lookat, vertices.data(), count, (float(*)[2])scalar_dots.data());
+        for (size_t i = 0; i < count * 2; i++) {
+            LUS_CHECK(fabsf(simd_dots[i] - scalar_dots[i]) <= 1e-6f);
+            LUS_CHECK(simd_dots[i] >= -1.0f && simd_dots[i] <= 1.0f);
+        }
+    }
+
+    // A light shining along the normal adds its full color to the ambient color, one facing away adds nothing, and the
+    // sum stops at 255
+    GfxVertexLight light = { { 1.0f, 0.0f, 0.0f }, { 100.0f, 200.0f, 50.0f }, false, { 0, 0, 0 }, 0.0f, 0.0f };
+    const uint8_t ambient[3] = { 10, 100, 20 };
+    const float identity[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+    Vtx facing[4] = {};
+    facing[0].n.n[0] = 127;
+    facing[1].n.n[0] = -127;
+    facing[2].n.n[0] = 127;
+    facing[3].n.n[1] = 127;
+    uint8_t out[4][3];
+    gfx_light_vertices(&light, 1, ambient, identity, facing, NULL, 4, out);
+    LUS_CHECK(out[0][0] == 110 && out[0][1] == 255 && out[0][2] == 70);
+    LUS_CHECK(out[1][0] == 10 && out[1][1] == 100 && out[1][2] == 20);
+    LUS_CHECK(out[2][0] == out[0][0] && out[2][1] == out[0][1] && out[2][2] == out[0][2]);
+    LUS_CHECK(out[3][0] == 10 && out[3][1] == 100 && out[3][2] == 20);
+
+    return lus_test_result();
+}
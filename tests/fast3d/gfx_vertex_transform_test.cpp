@@ -0,0 +1,68 @@
+// Checks the SIMD vertex transform against the scalar path on random matrices and vertices, including batch sizes that
+// leave a tail for the scalar loop.
+
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "test_utils.h"
+#include "graphic/Fast3D/gfx_vertex_transform.h"
+
+// Both paths round every product and sum the same way. If the compiler contracted the scalar math into fused
+// multiply-adds, the results can differ by a few rounding errors of the largest term, but never by more.
+static bool nearly_equal(float a, float b, const Vtx_t* v, const float mtx[4][4], int j) {
+    const float magnitude = fabsf(v->ob[0] * mtx[0][j]) + fabsf(v->ob[1] * mtx[1][j]) +
+                            fabsf(v->ob[2] * mtx[2][j]) + fabsf(mtx[3][j]);
+    return fabsf(a - b) <= magnitude * 4 * 1.1920929e-7f;
+}
+
+int main() {
+    std::mt19937 rng(0x5eed);
+    std::uniform_real_distribution<float> element(-4.0f, 4.0f);
+    std::uniform_int_distribution<int> coordinate(-32768, 32767);
+
+    for (size_t count = 0; count <= 37; count++) {
+        float mtx[4][4];
+        for (auto& row : mtx) {
+            for (float& value : row) {
+                value = element(rng);
+            }
+        }
+
+        std::vector<Vtx> vertices(count);
+        for (Vtx& vertex : vertices) {
+            vertex = {};
+            for (short& ob : vertex.v.ob) {
+                ob = (short)coordinate(rng);
+            }
+        }
+
+        std::vector<float> simd(count * 4, NAN);
+        std::vector<float> scalar(count * 4, NAN);
+        gfx_transform_vertex_positions(mtx, vertices.data(), count, (float(*)[4])simd.data());
+        gfx_transform_vertex_positions_scalar(mtx, vertices.data(), count, (float(*)[4])scalar.data());
+
+        for (size_t i = 0; i < count; i++) {
+            for (int j = 0; j < 4; j++) {
+                LUS_CHECK(nearly_equal(simd[i * 4 + j], scalar[i * 4 + j], &vertices[i].v, mtx, j));
+            }
+        }
+    }
+
+    // A vertex at the origin picks out the translation row, and unit axes pick out the matching rows
+    const float mtx[4][4] = { { 1, 2, 3, 4 }, { 5, 6, 7, 8 }, { 9, 10, 11, 12 }, { 13, 14, 15, 16 } };
+    Vtx axes[4] = {};
+    axes[1].v.ob[0] = 1;
+    axes[2].v.ob[1] = 1;
+    axes[3].v.ob[2] = 1;
+    float out[4][4];
+    gfx_transform_vertex_positions(mtx, axes, 4, out);
+    for (int j = 0; j < 4; j++) {
+        LUS_CHECK(out[0][j] == mtx[3][j]);
+        LUS_CHECK(out[1][j] == mtx[0][j] + mtx[3][j]);
+        LUS_CHECK(out[2][j] == mtx[1][j] + mtx[3][j]);
+        LUS_CHECK(out[3][j] == mtx[2][j] + mtx[3][j]);
+    }
+
+    return lus_test_result();
+}
@@ -0,0 +1,118 @@
+// Loads a resource from a zip archive written for the test, unloads it and loads it again while another thread drops
+// the last outside reference to it. The resource looks up another resource in its destructor the way game resources
+// do, which deadlocks if the resource manager destroys it while holding its own lock.
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include <zip.h>
+
+#include "test_utils.h"
+#include "Context.h"
+#include "resource/ResourceManager.h"
+#include "resource/archive/Archive.h"
+#include "resource/ResourceFactoryBinary.h"
+
+static const uint32_t test_resource_type = 0x4C555354; // LUST
+static const char* const test_resource_path = "lus_test/resource";
+static const int iterations = 2000;
+
+static std::atomic<int> live_resources;
+
+class TestResource : public Ship::Resource<void> {
+  public:
+    TestResource(std::shared_ptr<Ship::ResourceInitData> initData) : Resource(initData) {
+        live_resources++;
+    }
+
+    ~TestResource() override {
+        auto context = Ship::Context::GetInstance();
+        if (context != nullptr && context->GetResourceManager() != nullptr) {
+            context->GetResourceManager()->GetCachedResource("lus_test/other");
+        }
+        live_resources--;
+    }
+
+    void* GetPointer() override {
+        return nullptr;
+    }
+
+    size_t GetPointerSize() override {
+        return 0;
+    }
+};
+
+class TestResourceFactory : public Ship::ResourceFactoryBinary {
+  public:
+    std::shared_ptr<Ship::IResource> ReadResource(std::shared_ptr<Ship::File> file) override {
+        if (!FileHasValidFormatAndReader(file)) {
+            return nullptr;
+        }
+        return std::make_shared<TestResource>(file->InitData);
+    }
+};
+
+// One binary resource of the test type, which is nothing but its header
+static bool write_archive(const std::string& path) {
+    std::vector<char> header(OTR_HEADER_SIZE, 0);
+    header[0] = (char)Ship::Endianness::Native;
+    memcpy(&header[4], &test_resource_type, sizeof(test_resource_type));
+
+    int error;
+    zip_t* archive = zip_open(path.c_str(), ZIP_CREATE | ZIP_TRUNCATE, &error);
+    if (archive == nullptr) {
+        return false;
+    }
+    zip_source_t* source = zip_source_buffer(archive, header.data(), header.size(), 0);
+    if (source == nullptr || zip_file_add(archive, test_resource_path, source, ZIP_FL_OVERWRITE) < 0) {
+        zip_source_free(source);
+        zip_discard(archive);
+        return false;
+    }
+    return zip_close(archive) == 0;
+}
+
+int main() {
+    const std::string archivePath = (std::filesystem::temp_directory_path() / "lus_resource_unload_test.zip").string();
+    LUS_CHECK(write_archive(archivePath));
+
+    auto context = Ship::Context::CreateUninitializedInstance("libultraship tests", "lustest", "lustest.json");
+    context->InitLogging();
+    context->InitConfiguration();
+    context->InitConsoleVariables();
+    context->InitResourceManager({ archivePath });
+    auto resourceManager = context->GetResourceManager();
+    LUS_CHECK(resourceManager->DidLoadSuccessfully());
+    resourceManager->GetResourceLoader()->RegisterResourceFactory(std::make_shared<TestResourceFactory>(),
+                                                                  RESOURCE_FORMAT_BINARY, "LusTestResource",
+                                                                  test_resource_type, 0);
+
+    // A resource still referenced when it is loaded again comes back as the same instance
+    auto resource = resourceManager->LoadResource(test_resource_path);
+    LUS_CHECK(resource != nullptr);
+    LUS_CHECK(resourceManager->UnloadResource(test_resource_path) == 1);
+    LUS_CHECK(resourceManager->LoadResource(test_resource_path) == resource);
+    LUS_CHECK(resourceManager->GetResurrectedResourceCount() == 1);
+
+    // A dirty resource is found among the unloaded ones and then thrown away, and whether that lookup or the other
+    // thread ends up holding the last reference changes from one iteration to the next
+    for (int i = 0; i < iterations; i++) {
+        resource->Dirty();
+        resourceManager->UnloadResource(test_resource_path);
+        std::thread release([&resource]() { resource = nullptr; });
+        auto reloaded = resourceManager->LoadResource(test_resource_path);
+        release.join();
+        LUS_CHECK(reloaded != nullptr && !reloaded->IsDirty());
+        resource = reloaded;
+    }
+
+    resource = nullptr;
+    resourceManager->UnloadResource(test_resource_path);
+    LUS_CHECK(live_resources == 0);
+
+    std::filesystem::remove(archivePath);
+    return lus_test_result();
+}
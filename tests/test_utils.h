@@ -0,0 +1,26 @@
+#ifndef LUS_TEST_UTILS_H
+#define LUS_TEST_UTILS_H
+
+#include <stdio.h>
+
+// Checks for the test executables. A failed check reports where it failed and the test keeps running, so one run
+// shows every failure. main returns lus_test_result() to hand the outcome to CTest.
+static int lus_test_failures = 0;
+
+#define LUS_CHECK(cond)                                                              \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            lus_test_failures++;                                                     \
+        }                                                                            \
+    } while (0)
+
+static inline int lus_test_result() {
+    if (lus_test_failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", lus_test_failures);
+        return 1;
+    }
+    return 0;
+}
+
+#endif